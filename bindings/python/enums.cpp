@@ -34,7 +34,8 @@ void init_enums(py::module& m) {
     .value("TypeClash", broker::ec::type_clash)
     .value("InvalidData", broker::ec::invalid_data)
     .value("BackendFailure", broker::ec::backend_failure)
-    .value("StaleData", broker::ec::stale_data);
+    .value("StaleData", broker::ec::stale_data)
+    .value("BackpressureOverflow", broker::ec::backpressure_overflow);
 
   py::enum_<broker::sc>(m, "SC")
     .value("Unspecified", broker::sc::unspecified)
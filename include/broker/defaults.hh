@@ -61,8 +61,99 @@ constexpr timespan max_age = std::chrono::seconds{5};
 
 } // namespace broker::defaults::path_revocations
 
+namespace broker::defaults::flight_recorder {
+
+/// Number of records in the ring buffer of the flight recorder. Each record
+/// occupies 64 bytes.
+constexpr size_t capacity = 16384;
+
+/// File name for dumping the flight recorder when receiving a signal.
+constexpr std::string_view dump_file = "broker-flight-recorder.dat";
+
+} // namespace broker::defaults::flight_recorder
+
 namespace broker::defaults::metrics {
 
 constexpr timespan export_interval = std::chrono::seconds{1};
 
+/// Time between two updates of the flow metrics.
+constexpr timespan flow_update_interval = std::chrono::seconds{1};
+
+/// Number of exports between two full refreshes when using delta encoding.
+constexpr size_t full_refresh_interval = 60;
+
+/// Number of messages per sample for the latency and payload size metrics.
+constexpr size_t latency_sample_interval = 1024;
+
 } // namespace broker::defaults::metrics
+
+namespace broker::defaults::topic_statistics {
+
+/// Maximum number of topics that Broker tracks per direction and peer.
+constexpr size_t capacity = 128;
+
+/// Number of topics in status snapshots and metrics.
+constexpr size_t top_k = 10;
+
+/// Maximum number of distinct topics that Broker exports as metric labels.
+constexpr size_t max_topics = 100;
+
+/// Average number of messages per sample for the topic statistics.
+constexpr size_t sample_interval = 16;
+
+} // namespace broker::defaults::topic_statistics
+
+namespace broker::defaults::tracing {
+
+/// Number of messages per trace. Disabled by default, because endpoints that
+/// do not support tracing reject traced messages.
+constexpr size_t sample_interval = 0;
+
+/// Maximum number of combinations of origin and topic prefix that Broker
+/// exports as metric labels.
+constexpr size_t max_label_sets = 64;
+
+} // namespace broker::defaults::tracing
+
+namespace broker::defaults::web_socket {
+
+/// Default for the maximum number of messages in a single batch.
+constexpr size_t max_batch_count = 100;
+
+/// Default for the maximum size of a single batch in bytes.
+constexpr size_t max_batch_bytes = 64 * 1024;
+
+/// Default for the maximum time a message may wait for more messages before
+/// the server sends out a partial batch.
+constexpr timespan max_batch_linger = std::chrono::milliseconds{5};
+
+/// Upper bound for the maximum number of messages in a single batch that
+/// clients may request.
+constexpr size_t batch_count_limit = 10'000;
+
+/// Upper bound for the maximum size of a single batch that clients may
+/// request.
+constexpr size_t batch_bytes_limit = 1024 * 1024;
+
+/// Upper bound for the maximum linger time of a batch that clients may
+/// request.
+constexpr timespan batch_linger_limit = std::chrono::seconds{1};
+
+/// Maximum number of projections per handshake.
+constexpr size_t projection_count_limit = 64;
+
+/// Maximum number of paths in a single projection.
+constexpr size_t projection_path_limit = 64;
+
+/// Maximum number of indexes in a single path of a projection.
+constexpr size_t projection_depth_limit = 32;
+
+/// Default for the maximum number of messages that Broker buffers for a single
+/// client before applying the overflow policy.
+constexpr size_t max_buffered_messages = 4096;
+
+/// Default for the policy that Broker applies to clients that exceed their
+/// output buffer.
+constexpr std::string_view overflow_policy = "disconnect";
+
+} // namespace broker::defaults::web_socket
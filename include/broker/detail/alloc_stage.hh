@@ -0,0 +1,69 @@
+#pragma once
+
+#include "broker/config.hh"
+
+#include <cstdint>
+#include <string_view>
+
+namespace broker::detail {
+
+/// Identifies a stage of the message pipeline for attributing heap
+/// allocations. Only meaningful when building with
+/// `BROKER_ENABLE_ALLOC_TRACKING`.
+enum class alloc_stage : uint8_t {
+  /// Allocations outside of any instrumented stage.
+  none,
+  /// Creating a data message in the publisher API.
+  publish,
+  /// Serializing the content of a message into a packed message.
+  pack,
+  /// Wrapping packed messages into node messages for the central merge point
+  /// and the outbound paths to peers.
+  route,
+  /// Serializing a node message into a buffer for the network.
+  wire_encode,
+  /// Deserializing a node message from the network.
+  wire_decode,
+  /// Deserializing the content of a packed message.
+  unpack,
+  /// Handing messages over to local subscribers.
+  deliver,
+  /// Number of stages, not a stage itself.
+  num_stages,
+};
+
+/// @relates alloc_stage
+std::string_view to_string(alloc_stage x) noexcept;
+
+/// Returns the pipeline stage of the calling thread.
+alloc_stage current_alloc_stage() noexcept;
+
+/// Sets the pipeline stage of the calling thread for the lifetime of the
+/// object and restores the previous stage afterwards.
+class alloc_stage_scope {
+public:
+  explicit alloc_stage_scope(alloc_stage stage) noexcept;
+
+  alloc_stage_scope(const alloc_stage_scope&) = delete;
+
+  alloc_stage_scope& operator=(const alloc_stage_scope&) = delete;
+
+  ~alloc_stage_scope();
+
+private:
+  alloc_stage prev_;
+};
+
+} // namespace broker::detail
+
+// Attributes all allocations of the calling thread until the end of the
+// current scope to the given stage. Compiles to nothing unless building with
+// BROKER_ENABLE_ALLOC_TRACKING.
+#ifdef BROKER_ENABLE_ALLOC_TRACKING
+#  define BROKER_ALLOC_STAGE(name)                                             \
+    ::broker::detail::alloc_stage_scope broker_alloc_stage_scope {             \
+      ::broker::detail::alloc_stage::name                                      \
+    }
+#else
+#  define BROKER_ALLOC_STAGE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#  define BROKER_HAS_RDTSC
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#endif
+
+namespace broker::detail {
+
+/// A cheap clock for sampling latencies. Reads the time stamp counter (TSC) on
+/// x86 and falls back to `std::chrono::steady_clock` on other platforms.
+/// Comparing ticks from different threads assumes an invariant TSC that is
+/// synchronized across cores, as is the case for all recent x86 CPUs.
+class cycle_clock {
+public:
+  /// Returns the current number of ticks.
+  static uint64_t now() noexcept {
+#ifdef BROKER_HAS_RDTSC
+    return __rdtsc();
+#else
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t).count());
+#endif
+  }
+
+  /// Returns the duration of a single tick in seconds.
+  static double seconds_per_tick() noexcept;
+
+  /// Returns the number of seconds that passed since `start`.
+  static double seconds_since(uint64_t start) noexcept {
+    auto t = now();
+    return t > start ? static_cast<double>(t - start) * seconds_per_tick()
+                     : 0.0;
+  }
+};
+
+} // namespace broker::detail
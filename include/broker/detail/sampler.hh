@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace broker::detail {
+
+/// Selects every n-th event for sampling.
+class sampler {
+public:
+  /// Creates a sampler that selects one out of `interval` events. A sampler
+  /// with interval 0 never selects any event.
+  explicit sampler(size_t interval = 0) noexcept : interval_(interval) {
+    // nop
+  }
+
+  /// Returns whether to sample the current event.
+  bool operator()() noexcept {
+    if (interval_ == 0 || ++count_ < interval_)
+      return false;
+    count_ = 0;
+    return true;
+  }
+
+  /// Returns the number of events per sample.
+  size_t interval() const noexcept {
+    return interval_;
+  }
+
+private:
+  size_t interval_;
+  size_t count_ = 0;
+};
+
+} // namespace broker::detail
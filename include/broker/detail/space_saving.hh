@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace broker::detail {
+
+/// Approximates the most frequent keys of a stream in fixed memory by using the
+/// Space-Saving algorithm (Metwally et al., "Efficient Computation of Frequent
+/// and Top-k Elements in Data Streams", 2005). The summary tracks at most
+/// `capacity` keys. Once full, a new key replaces the key with the smallest
+/// count and inherits its count. Hence, estimates never undercount and
+/// overcount by at most `error`.
+class space_saving {
+public:
+  struct entry {
+    std::string key;
+    uint64_t count;
+    uint64_t error;
+  };
+
+  /// @pre `capacity > 0`
+  explicit space_saving(size_t capacity);
+
+  /// Adds `weight` to the count of `key`.
+  void add(const std::string& key, uint64_t weight = 1);
+
+  /// Returns up to `k` entries, sorted by count in descending order.
+  std::vector<entry> top(size_t k) const;
+
+  /// Returns the number of tracked keys.
+  size_t size() const noexcept {
+    return heap_.size();
+  }
+
+  /// Returns the maximum number of tracked keys.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /// Returns the sum of all weights.
+  uint64_t total() const noexcept {
+    return total_;
+  }
+
+private:
+  /// Restores the heap property after increasing the count at `pos`.
+  void sift_down(size_t pos);
+
+  size_t capacity_;
+
+  uint64_t total_ = 0;
+
+  /// A min-heap by count. The root always holds the replacement candidate.
+  std::vector<entry> heap_;
+
+  /// Maps keys to their position in `heap_`.
+  std::unordered_map<std::string, size_t> index_;
+};
+
+} // namespace broker::detail
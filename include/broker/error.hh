@@ -103,6 +103,8 @@ enum class ec : uint8_t {
   redundant_connection,
   /// Broker encountered a
   logic_error = 40,
+  /// Broker dropped a client because it could not keep up with the data rate.
+  backpressure_overflow,
 };
 // --ec-enum-end
 
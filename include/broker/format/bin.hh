@@ -0,0 +1,111 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/endpoint_id.hh"
+#include "broker/filter_type.hh"
+#include "broker/topic.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// This is a self-contained implementation of Broker's native binary format for
+// `data` values. It has no dependencies beyond the public Broker headers and
+// produces the same bytes that Broker uses internally when packing messages.
+// Clients of the binary WebSocket API may use these functions for encoding and
+// decoding frames. Clients in other languages can use the implementation as
+// reference, the format is also documented in `doc/web-socket.rst`.
+
+namespace broker::format::bin::v1 {
+
+// -- constants ----------------------------------------------------------------
+
+/// Identifies the content of a frame on the binary WebSocket API.
+enum class frame_tag : uint8_t {
+  /// A data message with topic and data.
+  data_message = 1,
+  /// Confirms the handshake. Contains the endpoint ID and the Broker version.
+  ack = 2,
+  /// Reports an error. Contains the error code and a context string.
+  error = 3,
+};
+
+// -- encoding -----------------------------------------------------------------
+
+// All encoding functions return `false` if the input exceeds the limits of the
+// format, i.e., if a size does not fit into 32 bits. On error, `buf` may
+// contain a partially encoded value.
+
+/// Appends `value` as variable-length integer to `buf`.
+bool encode_varbyte(size_t value, std::vector<std::byte>& buf);
+
+/// Appends the size of `str` as variable-length integer to `buf`, followed by
+/// the characters of `str`.
+bool encode(std::string_view str, std::vector<std::byte>& buf);
+
+/// Appends the native binary representation of `x` to `buf`.
+bool encode(const data& x, std::vector<std::byte>& buf);
+
+/// Appends the native binary representation of `x` to `buf`.
+bool encode(const filter_type& x, std::vector<std::byte>& buf);
+
+/// Appends a complete data message frame to `buf`.
+bool encode_data_message(const topic& t, const data& d,
+                         std::vector<std::byte>& buf);
+
+/// Appends a complete ACK frame to `buf`.
+bool encode_ack(const endpoint_id& id, std::string_view version,
+                std::vector<std::byte>& buf);
+
+/// Appends a complete error frame to `buf`.
+bool encode_error(std::string_view code, std::string_view context,
+                  std::vector<std::byte>& buf);
+
+// -- decoding -----------------------------------------------------------------
+
+// All decoding functions return a pointer to the first byte after the decoded
+// value on success and `nullptr` on error.
+
+/// Maximum nesting depth of containers when decoding `data` values.
+constexpr size_t max_nesting_depth = 128;
+
+/// Decodes a variable-length integer from `[first, last)`. Fails for values
+/// that do not fit into 32 bits.
+const std::byte* decode_varbyte(const std::byte* first, const std::byte* last,
+                                size_t& result);
+
+/// Decodes a length-prefixed string from `[first, last)`.
+const std::byte* decode(const std::byte* first, const std::byte* last,
+                        std::string& result);
+
+/// Decodes a `data` value from `[first, last)`. Fails for values that nest
+/// containers deeper than `max_nesting_depth`.
+const std::byte* decode(const std::byte* first, const std::byte* last,
+                        data& result);
+
+/// Decodes a filter from `[first, last)`.
+const std::byte* decode(const std::byte* first, const std::byte* last,
+                        filter_type& result);
+
+/// Returns the tag of a frame or `std::nullopt` if the frame has no valid tag.
+std::optional<frame_tag> tag_of(const std::byte* first, const std::byte* last);
+
+/// Decodes a complete data message frame.
+/// @returns `true` if `[first, last)` contains exactly one data message.
+bool decode_data_message(const std::byte* first, const std::byte* last,
+                         topic& t, data& d);
+
+/// Decodes a complete ACK frame.
+/// @returns `true` if `[first, last)` contains exactly one ACK.
+bool decode_ack(const std::byte* first, const std::byte* last, endpoint_id& id,
+                std::string& version);
+
+/// Decodes a complete error frame.
+/// @returns `true` if `[first, last)` contains exactly one error.
+bool decode_error(const std::byte* first, const std::byte* last,
+                  std::string& code, std::string& context);
+
+} // namespace broker::format::bin::v1
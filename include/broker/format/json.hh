@@ -0,0 +1,50 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/topic.hh"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// This is a self-contained implementation of the JSON format that Broker uses
+// for `data` values on the WebSocket API. In contrast to the generic JSON
+// reader and writer from CAF, this implementation never builds an intermediate
+// DOM and scans strings for characters that require escaping 16 bytes at a
+// time if SSE2 (x86) or NEON (AArch64) are available. The format is documented
+// in `doc/web-socket.rst`. The encoder produces the same bytes as the CAF JSON
+// writer, i.e., it puts a single space after each colon and comma and formats
+// real numbers and timespans like CAF. The decoder also accepts fractional
+// timespans such as "1.5s".
+
+namespace broker::format::json::v1 {
+
+// -- encoding -----------------------------------------------------------------
+
+/// Appends `str` as quoted and escaped JSON string to `out`.
+void encode(std::string_view str, std::string& out);
+
+/// Appends `x` as JSON object with the keys `@data-type` and `data` to `out`.
+void encode(const data& x, std::string& out);
+
+/// Appends a data message with topic `t` and content `d` to `out`.
+void encode_data_message(const topic& t, const data& d, std::string& out);
+
+// -- decoding -----------------------------------------------------------------
+
+/// Decodes a JSON object with the keys `@data-type` and `data`.
+/// @returns `true` if `input` contains exactly one valid object.
+bool decode(std::string_view input, data& result);
+
+/// Decodes a single data message.
+/// @returns `true` if `input` contains exactly one valid data message.
+bool decode_data_message(std::string_view input, topic& t, data& d);
+
+/// Decodes either a single data message or a JSON array of data messages and
+/// appends all messages to `result`. Leaves `result` unchanged on error.
+/// @returns `true` if `input` contains only valid data messages.
+bool decode_data_messages(std::string_view input,
+                          std::vector<std::pair<topic, data>>& result);
+
+} // namespace broker::format::json::v1
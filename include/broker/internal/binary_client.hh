@@ -0,0 +1,75 @@
+#pragma once
+
+#include "broker/endpoint_id.hh"
+#include "broker/filter_type.hh"
+#include "broker/internal/fwd.hh"
+#include "broker/message.hh"
+#include "broker/network_info.hh"
+
+#include <caf/actor.hpp>
+#include <caf/async/spsc_buffer.hpp>
+#include <caf/fwd.hpp>
+#include <caf/scheduled_actor/flow.hpp>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace broker::internal {
+
+/// Serves a WebSocket client that uses the binary API. The client exchanges
+/// data messages in Broker's native binary format (see `broker/format/bin.hh`)
+/// instead of JSON. Otherwise, binary clients behave like JSON clients.
+class binary_client_state {
+public:
+  static inline const char* name = "broker.binary-client";
+
+  /// Input from the WebSocket. Each string holds the bytes of one frame.
+  using in_t = caf::async::consumer_resource<caf::cow_string>;
+
+  /// Output to the WebSocket. Each string holds the bytes of one frame.
+  using out_t = caf::async::producer_resource<caf::cow_string>;
+
+  binary_client_state(caf::event_based_actor* selfptr, endpoint_id this_node,
+                      caf::actor core, network_info addr, in_t in, out_t out);
+
+  ~binary_client_state();
+
+  /// Renders a data message as binary frame.
+  caf::cow_string render(const data_message& msg);
+
+  /// Renders an error as binary frame.
+  caf::cow_string render_error(std::string_view code,
+                               std::string_view context);
+
+  /// Renders the handshake ACK as binary frame.
+  caf::cow_string render_ack();
+
+  /// Parses a binary frame from the client.
+  std::optional<data_message> parse(const caf::cow_string& frame,
+                                    std::string& err);
+
+  void on_down_msg(const caf::down_msg& msg);
+
+  caf::event_based_actor* self;
+  endpoint_id id;
+  caf::actor core;
+  network_info addr;
+  std::vector<std::byte> buf;
+  std::vector<caf::disposable> subscriptions;
+  caf::flow::item_publisher<caf::cow_string> ctrl_msgs;
+
+  /// Counts all bytes that we send to the client.
+  caf::telemetry::int_counter* sent_bytes = nullptr;
+
+  /// Statistics of this client that the core reports in its status.
+  client_stats_ptr stats;
+
+  void init(const filter_type& filter, const out_t& out,
+            caf::async::consumer_resource<data_message> core_pull);
+};
+
+using binary_client_actor = caf::stateful_actor<binary_client_state>;
+
+} // namespace broker::internal
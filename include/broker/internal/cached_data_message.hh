@@ -0,0 +1,75 @@
+#pragma once
+
+#include "broker/endpoint_id.hh"
+#include "broker/internal/fwd.hh"
+#include "broker/message.hh"
+
+#include <caf/cow_string.hpp>
+
+#include <memory>
+#include <mutex>
+
+namespace broker::internal {
+
+/// A decoded data message that the core shares with all of its WebSocket
+/// clients. The core decodes each message only once and the clients render it
+/// at most once per format. Since clients run concurrently, the lazily
+/// rendered strings are guarded by a `std::once_flag` each.
+class cached_data_message {
+public:
+  cached_data_message(endpoint_id sender, data_message msg)
+    : sender_(sender), msg_(std::move(msg)) {
+    // nop
+  }
+
+  cached_data_message(const cached_data_message&) = delete;
+
+  cached_data_message& operator=(const cached_data_message&) = delete;
+
+  /// Returns the ID of the (last hop) sender of the message.
+  endpoint_id sender() const noexcept {
+    return sender_;
+  }
+
+  /// Returns the decoded message.
+  const data_message& msg() const noexcept {
+    return msg_;
+  }
+
+  /// Returns the topic of the message.
+  const topic& get_topic() const noexcept {
+    return broker::get_topic(msg_);
+  }
+
+  /// Returns the JSON rendering of the message. Calls `render` with the message
+  /// only if no other client has rendered the message before.
+  template <class Render>
+  const caf::cow_string& json(Render&& render) const {
+    std::call_once(json_flag_, [this, &render] { json_ = render(msg_); });
+    return json_;
+  }
+
+  /// Returns the binary rendering of the message. Calls `render` with the
+  /// message only if no other client has rendered the message before.
+  template <class Render>
+  const caf::cow_string& binary(Render&& render) const {
+    std::call_once(binary_flag_, [this, &render] { binary_ = render(msg_); });
+    return binary_;
+  }
+
+private:
+  endpoint_id sender_;
+  data_message msg_;
+  mutable std::once_flag json_flag_;
+  mutable caf::cow_string json_;
+  mutable std::once_flag binary_flag_;
+  mutable caf::cow_string binary_;
+};
+
+/// @relates cached_data_message
+inline cached_data_message_ptr make_cached_data_message(endpoint_id sender,
+                                                        data_message msg) {
+  return std::make_shared<cached_data_message>(sender, std::move(msg));
+}
+
+} // namespace broker::internal
@@ -13,6 +13,7 @@
 #include "broker/error.hh"
 #include "broker/internal/logger.hh"
 #include "broker/internal/metric_factory.hh"
+#include "broker/internal/probes.hh"
 #include "broker/lamport_timestamp.hh"
 #include "broker/none.hh"
 
@@ -302,10 +303,13 @@ public:
       }
       handle_ack(hdl, first - 1);
       for (auto seq : seqs) {
-        if (auto i = find_event(seq); i != buf_.end())
+        if (auto i = find_event(seq); i != buf_.end()) {
+          BROKER_PROBE(channel_retransmit, seq, 1);
           backend_->send(this, hdl, *i);
-        else
+        } else {
+          BROKER_PROBE(channel_retransmit, seq, 0);
           backend_->send(this, hdl, retransmit_failed{seq});
+        }
       }
     }
 
@@ -730,6 +734,7 @@ public:
         for (const auto& x : buf_)
           generate(x.seq);
         generate(last);
+        BROKER_PROBE(channel_nack, first, seqs.size());
         backend_->send(this, nack{std::move(seqs)});
         return;
       }
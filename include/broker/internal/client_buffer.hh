@@ -0,0 +1,342 @@
+#pragma once
+
+#include "broker/error.hh"
+#include "broker/internal/fwd.hh"
+#include "broker/internal/type_id.hh"
+
+#include <caf/disposable.hpp>
+#include <caf/flow/op/cold.hpp>
+#include <caf/scheduled_actor.hpp>
+#include <caf/telemetry/counter.hpp>
+#include <caf/telemetry/gauge.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+namespace broker::internal {
+
+/// Selects what happens to a client that falls behind.
+enum class overflow_policy {
+  /// Drops the oldest buffered message to make room for the new one.
+  drop_oldest,
+  /// Drops the new message and keeps the buffered ones.
+  drop_newest,
+  /// Closes the connection to the client.
+  disconnect,
+};
+
+/// @relates overflow_policy
+inline std::string_view to_string(overflow_policy x) noexcept {
+  switch (x) {
+    case overflow_policy::drop_oldest:
+      return "drop-oldest";
+    case overflow_policy::drop_newest:
+      return "drop-newest";
+    default:
+      return "disconnect";
+  }
+}
+
+/// @relates overflow_policy
+inline bool from_string(std::string_view str, overflow_policy& x) noexcept {
+  if (str == "drop-oldest") {
+    x = overflow_policy::drop_oldest;
+    return true;
+  } else if (str == "drop-newest") {
+    x = overflow_policy::drop_newest;
+    return true;
+  } else if (str == "disconnect") {
+    x = overflow_policy::disconnect;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+/// Statistics of a single client for the status snapshot. The core updates
+/// the buffer statistics while the client actor counts the sent bytes. Hence,
+/// all members are atomic.
+struct client_stats {
+  /// Number of messages that currently wait in the buffer of the client.
+  std::atomic<int64_t> queued{0};
+
+  /// Number of messages that the buffer has dropped due to overflows.
+  std::atomic<int64_t> dropped{0};
+
+  /// Number of bytes that Broker has sent to the client.
+  std::atomic<int64_t> sent_bytes{0};
+};
+
+/// Bundles the metric instances for a single client buffer.
+struct client_buffer_metrics {
+  /// Counts the messages that currently wait in the buffer.
+  caf::telemetry::int_gauge* queued = nullptr;
+
+  /// Counts the messages that the buffer has dropped due to overflows.
+  caf::telemetry::int_counter* dropped = nullptr;
+
+  /// Per-client statistics. May be `nullptr`.
+  client_stats_ptr stats;
+};
+
+/// Sits between a shared source and a client and decouples the two. The
+/// buffer always signals demand to the source. Hence, a slow client never
+/// throttles the source. Instead, the buffer applies its overflow policy once
+/// it holds `capacity` items.
+template <class Input>
+class client_buffer_sub : public caf::ref_counted,
+                          public caf::flow::observer_impl<Input>,
+                          public caf::flow::subscription_impl {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using input_type = Input;
+
+  using output_type = input_type;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  client_buffer_sub(caf::flow::coordinator* ctx,
+                    caf::flow::observer<output_type> out, size_t capacity,
+                    overflow_policy policy, client_buffer_metrics metrics)
+    : ctx_(ctx),
+      out_(std::move(out)),
+      capacity_(capacity > 0 ? capacity : 1),
+      policy_(policy),
+      metrics_(metrics) {
+    // nop
+  }
+
+  ~client_buffer_sub() override {
+    clear();
+  }
+
+  // -- ref counting -----------------------------------------------------------
+
+  void ref_disposable() const noexcept final {
+    this->ref();
+  }
+
+  void deref_disposable() const noexcept final {
+    this->deref();
+  }
+
+  void ref_coordinated() const noexcept final {
+    this->ref();
+  }
+
+  void deref_coordinated() const noexcept final {
+    this->deref();
+  }
+
+  friend void intrusive_ptr_add_ref(const client_buffer_sub* ptr) noexcept {
+    ptr->ref();
+  }
+
+  friend void intrusive_ptr_release(const client_buffer_sub* ptr) noexcept {
+    ptr->deref();
+  }
+
+  // -- implementation of observer_impl<Input> ---------------------------------
+
+  void on_next(const Input& item) override {
+    if (!out_)
+      return;
+    // Fast path: pass the item through if the client is keeping up.
+    if (demand_ > 0 && buf_.empty()) {
+      --demand_;
+      out_.on_next(item);
+    } else if (buf_.size() < capacity_) {
+      buf_.push_back(item);
+      add_queued(1);
+    } else {
+      switch (policy_) {
+        case overflow_policy::drop_oldest:
+          buf_.pop_front();
+          buf_.push_back(item);
+          add_dropped();
+          break;
+        case overflow_policy::drop_newest:
+          add_dropped();
+          break;
+        default: // overflow_policy::disconnect
+          abort(caf::make_error(ec::backpressure_overflow,
+                                "client exceeded its output buffer"));
+          return;
+      }
+    }
+    // Replenish the credit for the consumed item.
+    if (in_)
+      in_.request(1);
+  }
+
+  void on_complete() override {
+    in_ = nullptr;
+    // Deliver all pending items before completing.
+    completed_ = true;
+    drain();
+  }
+
+  void on_error(const caf::error& what) override {
+    in_ = nullptr;
+    clear();
+    if (out_) {
+      out_.on_error(what);
+      out_ = nullptr;
+    }
+  }
+
+  void on_subscribe(caf::flow::subscription in) override {
+    if (!in_ && out_ && !completed_) {
+      in_ = std::move(in);
+      in_.request(capacity_);
+    } else {
+      in.dispose();
+    }
+  }
+
+  // -- implementation of subscription_impl ------------------------------------
+
+  bool disposed() const noexcept override {
+    return !in_ && !out_;
+  }
+
+  void dispose() override {
+    clear();
+    if (out_) {
+      ctx_->delay_fn([out = std::move(out_)]() mutable { out.on_complete(); });
+    }
+    if (in_) {
+      in_.dispose();
+      in_ = nullptr;
+    }
+  }
+
+  void request(size_t n) override {
+    demand_ += n;
+    drain();
+  }
+
+private:
+  void drain() {
+    while (out_ && demand_ > 0 && !buf_.empty()) {
+      auto item = std::move(buf_.front());
+      buf_.pop_front();
+      add_queued(-1);
+      --demand_;
+      out_.on_next(item);
+    }
+    if (out_ && completed_ && buf_.empty()) {
+      out_.on_complete();
+      out_ = nullptr;
+    }
+  }
+
+  void abort(const caf::error& reason) {
+    if (in_) {
+      in_.dispose();
+      in_ = nullptr;
+    }
+    on_error(reason);
+  }
+
+  void clear() {
+    if (!buf_.empty()) {
+      add_queued(-static_cast<int64_t>(buf_.size()));
+      buf_.clear();
+    }
+  }
+
+  void add_queued(int64_t n) {
+    metrics_.queued->inc(n);
+    if (metrics_.stats)
+      metrics_.stats->queued += n;
+  }
+
+  void add_dropped() {
+    metrics_.dropped->inc();
+    if (metrics_.stats)
+      ++metrics_.stats->dropped;
+  }
+
+  caf::flow::coordinator* ctx_;
+  caf::flow::subscription in_;
+  caf::flow::observer<output_type> out_;
+  size_t capacity_;
+  overflow_policy policy_;
+  client_buffer_metrics metrics_;
+  std::deque<Input> buf_;
+  size_t demand_ = 0;
+  bool completed_ = false;
+};
+
+/// Decouples a client from a shared `observable` by adding a bounded buffer.
+template <class Input>
+class client_buffer : public caf::flow::op::cold<Input> {
+public:
+  using super = caf::flow::op::cold<Input>;
+
+  using decorated_type = caf::flow::observable<Input>;
+
+  client_buffer(decorated_type decorated, size_t capacity,
+                overflow_policy policy, client_buffer_metrics metrics)
+    : super(decorated.ctx()),
+      decorated_(std::move(decorated)),
+      capacity_(capacity),
+      policy_(policy),
+      metrics_(metrics) {
+    // nop
+  }
+
+  caf::disposable subscribe(caf::flow::observer<Input> out) override {
+    if (subscribed_) {
+      out.on_error(make_error(caf::sec::too_many_observers,
+                              "client_buffer may only be subscribed to once"));
+      return {};
+    }
+    subscribed_ = true;
+    using sub_t = client_buffer_sub<Input>;
+    auto sub = caf::make_counted<sub_t>(this->ctx(), out, capacity_, policy_,
+                                        metrics_);
+    out.on_subscribe(caf::flow::subscription{sub});
+    decorated_.subscribe(caf::flow::observer<Input>{sub});
+    return sub->as_disposable();
+  }
+
+private:
+  decorated_type decorated_;
+  size_t capacity_;
+  overflow_policy policy_;
+  client_buffer_metrics metrics_;
+  bool subscribed_ = false;
+};
+
+/// Utility class for injecting a client_buffer to an `observable` without
+/// "breaking the chain".
+class add_client_buffer_t {
+public:
+  add_client_buffer_t(size_t capacity, overflow_policy policy,
+                      client_buffer_metrics metrics)
+    : capacity_(capacity), policy_(policy), metrics_(metrics) {}
+
+  template <class Observable>
+  auto operator()(Observable&& input) {
+    using obs_t = typename std::decay_t<Observable>;
+    using val_t = typename obs_t::output_type;
+    using impl_t = client_buffer<val_t>;
+    auto obs = std::forward<Observable>(input).as_observable();
+    auto ptr = caf::make_counted<impl_t>(std::move(obs), capacity_, policy_,
+                                         metrics_);
+    return caf::flow::observable<val_t>{ptr};
+  }
+
+private:
+  size_t capacity_;
+  overflow_policy policy_;
+  client_buffer_metrics metrics_;
+};
+
+} // namespace broker::internal
@@ -1,11 +1,20 @@
 #pragma once
 
+#include "broker/detail/cycle_clock.hh"
+#include "broker/detail/sampler.hh"
 #include "broker/endpoint.hh"
+#include "broker/internal/client_buffer.hh"
 #include "broker/internal/connector.hh"
 #include "broker/internal/connector_adapter.hh"
+#include "broker/internal/flight_recorder.hh"
 #include "broker/internal/fwd.hh"
+#include "broker/internal/latency_stamps.hh"
+#include "broker/internal/metric_factory.hh"
 #include "broker/internal/peering.hh"
+#include "broker/internal/topic_statistics.hh"
+#include "broker/internal/trace_metrics.hh"
 #include "broker/lamport_timestamp.hh"
+#include "broker/telemetry/sharded.hh"
 
 #include <caf/disposable.hpp>
 #include <caf/flow/item_publisher.hpp>
@@ -13,7 +22,10 @@
 #include <caf/make_counted.hpp>
 #include <caf/telemetry/counter.hpp>
 #include <caf/telemetry/gauge.hpp>
+#include <caf/telemetry/histogram.hpp>
 
+#include <map>
+#include <memory>
 #include <optional>
 #include <string_view>
 #include <unordered_map>
@@ -29,18 +41,19 @@ public:
   using peer_state_map = std::unordered_map<endpoint_id, peering_ptr>;
 
   /// Bundles message-related metrics that have a label dimension for the type.
+  /// Uses sharded metrics, because the core updates them for each message.
   struct message_metrics_t {
     /// Counts how many messages were processed since starting the core.
-    caf::telemetry::int_counter* processed = nullptr;
+    std::unique_ptr<telemetry::sharded_int_counter> processed;
 
     /// Keeps track of how many messages are currently buffered at the core.
-    caf::telemetry::int_gauge* buffered = nullptr;
+    std::unique_ptr<telemetry::sharded_int_gauge> buffered;
+
+    /// Samples the payload size of messages.
+    caf::telemetry::int_histogram* payload_size = nullptr;
 
     void assign(caf::telemetry::int_counter* processed_instance,
-                caf::telemetry::int_gauge* buffered_instance) noexcept {
-      processed = processed_instance;
-      buffered = buffered_instance;
-    }
+                caf::telemetry::int_gauge* buffered_instance);
   };
 
   /// Bundles metrics for the core.
@@ -59,6 +72,29 @@ public:
     message_metrics_t& metrics_for(packed_message_type msg_type) {
       return message_metric_sets[static_cast<size_t>(msg_type)];
     }
+
+    /// Samples how long messages from local publishers take to reach the core.
+    caf::telemetry::dbl_histogram* publish_latency = nullptr;
+
+    /// Samples how long messages take from arriving at the core to the output
+    /// buffer of a peer.
+    caf::telemetry::dbl_histogram* forward_latency = nullptr;
+
+    /// Samples how long messages take from arriving at the core to the buffer
+    /// of a local subscriber.
+    caf::telemetry::dbl_histogram* deliver_latency = nullptr;
+
+    /// Exports the heaviest topics of messages from peers.
+    topic_metrics inbound_topics;
+
+    /// Exports the heaviest topics of messages to peers.
+    topic_metrics outbound_topics;
+
+    /// Aggregates the latencies of traced messages from peers.
+    trace_metrics traces;
+
+    /// Exports back-pressure indicators for peers and local clients.
+    metric_factory::core_t::flows_t flows;
   };
 
   // -- constants --------------------------------------------------------------
@@ -70,7 +106,8 @@ public:
   core_actor_state(caf::event_based_actor* self, endpoint_id this_peer,
                    filter_type initial_filter, endpoint::clock* clock = nullptr,
                    const domain_options* adaptation = nullptr,
-                   connector_ptr conn = nullptr);
+                   connector_ptr conn = nullptr,
+                   latency_stamps_ptr stamps = nullptr);
 
   ~core_actor_state();
 
@@ -127,9 +164,21 @@ public:
   /// Creates a snapshot for the status of local publishers.
   vector local_publisher_stats_snapshot() const;
 
+  /// Creates a snapshot for the heaviest topics.
+  table topic_stats_snapshot() const;
+
+  /// Creates a snapshot for the output buffers of WebSocket clients.
+  table client_stats_snapshot() const;
+
   /// Creates a snapshot that summarizes the current status of the core.
   table status_snapshot() const;
 
+  /// Updates the metrics for the flows of peers and local clients.
+  void update_flow_metrics();
+
+  /// Calls `update_flow_metrics` and `update_topic_metrics` periodically.
+  void schedule_flow_metrics_update();
+
   // -- callbacks --------------------------------------------------------------
 
   /// Called whenever the user tried to unpeer from an unknown peer.
@@ -175,7 +224,8 @@ public:
   /// merge point.
   caf::error init_new_client(const network_info& addr, const std::string& type,
                              filter_type filter, data_consumer_res in_res,
-                             data_producer_res out_res);
+                             cached_data_producer_res out_res,
+                             client_stats_ptr stats);
 
   // -- topic management -------------------------------------------------------
 
@@ -210,6 +260,10 @@ public:
   /// @returns `true` on success, `false` if no peering to `receiver` exists.
   void dispatch(endpoint_id receiver, const packed_message& msg);
 
+  /// Dispatches `msg` to `receiver` regardless of its subscriptions and
+  /// observes the publish latency if `msg` belongs to the sample.
+  void dispatch(endpoint_id receiver, const data_message& msg);
+
   /// Broadcasts the local subscriptions to all peers.
   void broadcast_subscriptions();
 
@@ -273,6 +327,69 @@ public:
   /// Pushes command messages into the flow.
   caf::flow::observable<command_message> command_outputs;
 
+  /// Pushes data messages for WebSocket clients into the flow. Each message
+  /// gets deserialized only once and then shared among all clients.
+  caf::flow::observable<cached_data_message_ptr> client_outputs;
+
+  /// Stores the subscriptions of all connected WebSocket clients.
+  std::unordered_map<endpoint_id, filter_type> client_filters;
+
+  /// The union of all filters in `client_filters`.
+  filter_type client_filter;
+
+  /// Describes a WebSocket client in status snapshots.
+  struct client_info {
+    network_info addr;
+    std::string type;
+    client_stats_ptr stats;
+  };
+
+  /// Stores address, type and statistics of all connected WebSocket clients.
+  std::unordered_map<endpoint_id, client_info> client_infos;
+
+  /// Tracks the heaviest topics of messages from all peers.
+  topic_statistics inbound_topics;
+
+  /// Tracks the heaviest topics of messages from individual peers.
+  std::unordered_map<endpoint_id, topic_statistics_ptr> peer_inbound_topics;
+
+  /// Tracks the heaviest topics of messages to all peers.
+  topic_statistics outbound_topics;
+
+  /// Number of topics in status snapshots and metrics.
+  size_t top_topics = defaults::topic_statistics::top_k;
+
+  /// Updates the metrics for the heaviest topics.
+  void update_topic_metrics();
+
+  /// Observes the delivery latency of `msg` if it belongs to the sample. When
+  /// delivering a message to multiple subscribers, only the first one counts.
+  void observe_delivery(const data_message& msg) {
+    if (auto stamp = stamps->take(msg); stamp != 0)
+      metrics.deliver_latency->observe(
+        detail::cycle_clock::seconds_since(stamp));
+  }
+
+  /// Stores the timestamps of messages for sampling the latency of each stage
+  /// in the pipeline. The core shares this table with the publishers and the
+  /// connections of its endpoint.
+  latency_stamps_ptr stamps;
+
+  /// Selects messages at the central merge point for the payload size metrics.
+  detail::sampler payload_sampler;
+
+  /// Selects messages from local publishers for tracing them across peers.
+  detail::sampler trace_sampler;
+
+  /// Records the metadata of recent messages for post-mortem analysis.
+  flight_recorder flights;
+
+  /// Maximum number of messages we buffer for a single WebSocket client.
+  size_t client_buffer_size = defaults::web_socket::max_buffered_messages;
+
+  /// Selects what happens to WebSocket clients that exceed their buffer.
+  overflow_policy client_overflow_policy = overflow_policy::disconnect;
+
   /// Handle to the background worker for establishing peering relations.
   std::unique_ptr<connector_adapter> adapter;
 
@@ -308,14 +425,18 @@ public:
   /// after the timeout.
   caf::disposable shutting_down_timeout;
 
-  /// Keeps track of statistics for local subscribers.
-  std::set<flow_scope_stats_ptr> local_subscriber_stats;
+  /// Periodically updates the flow metrics.
+  caf::disposable flow_metrics_timer;
+
+  /// Keeps track of statistics and filters for local subscribers.
+  std::map<flow_scope_stats_ptr, std::shared_ptr<filter_type>>
+    local_subscriber_stats;
 
   /// Returns a function object for adding instrumentation to flow that belongs
   /// to a local subscriber.
-  auto local_subscriber_scope_adder() {
+  auto local_subscriber_scope_adder(std::shared_ptr<filter_type> filter) {
     auto stats_ptr = std::make_shared<flow_scope_stats>();
-    local_subscriber_stats.emplace(stats_ptr);
+    local_subscriber_stats.emplace(stats_ptr, std::move(filter));
     return add_flow_scope_t{stats_ptr, [this](const flow_scope_stats_ptr& ptr) {
                               local_subscriber_stats.erase(ptr);
                             }};
@@ -14,6 +14,7 @@ namespace broker::internal {
 struct endpoint_context {
   configuration cfg;
   caf::actor_system sys;
+  latency_stamps_ptr stamps;
   explicit endpoint_context(configuration&& src);
 };
 
@@ -30,6 +31,8 @@ struct endpoint_access {
 
   endpoint_context_ptr ctx();
 
+  const latency_stamps_ptr& stamps();
+
   endpoint* ep;
 };
 
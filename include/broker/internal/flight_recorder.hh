@@ -0,0 +1,186 @@
+#pragma once
+
+#include "broker/endpoint_id.hh"
+#include "broker/message.hh"
+
+#include <caf/error.hpp>
+#include <caf/span.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace broker::internal {
+
+/// Identifies where in the core a @ref flight_record originated.
+enum class flight_stage : uint8_t {
+  /// The core received the message from a peer.
+  inbound = 1,
+  /// The message left the central merge point of the core.
+  dispatch,
+  /// The core enqueued the message for a peer.
+  outbound,
+};
+
+/// @relates flight_stage
+std::string_view to_string(flight_stage x) noexcept;
+
+/// Fixed-size metadata for a single message. The layout is part of the file
+/// format. Hence, all fields have a fixed size and the compiler may not add
+/// any padding.
+struct flight_record {
+  /// Wall clock time in nanoseconds since the UNIX epoch.
+  int64_t time;
+
+  /// FNV-1a hash of the topic, see @ref flight_recorder::topic_id.
+  uint64_t topic_id;
+
+  /// Size of the serialized payload in bytes.
+  uint32_t size;
+
+  /// The @ref packed_message_type of the message.
+  uint8_t type;
+
+  /// The @ref flight_stage of the record.
+  uint8_t stage;
+
+  /// Unused, always 0.
+  uint16_t reserved;
+
+  /// The endpoint that sent the message, i.e., the last hop.
+  endpoint_id::array_type sender;
+
+  /// The receiver of the message or all zeros if the message has none.
+  endpoint_id::array_type receiver;
+};
+
+static_assert(sizeof(flight_record) == 56);
+
+/// An always-on ring buffer for recording the metadata of recent messages.
+/// Recording a message takes a few nanoseconds and never allocates or locks.
+/// The buffer is either anonymous memory or a memory-mapped file. The latter
+/// keeps the records of the last messages on disk even if the process
+/// crashes.
+///
+/// The memory layout starts with a 64-byte header, followed by `capacity`
+/// slots of 64 bytes each. Each slot stores a sequence number followed by a
+/// @ref flight_record. The sequence number is 0 while writing to the slot.
+class flight_recorder {
+public:
+  // -- constants --------------------------------------------------------------
+
+  /// Identifies the file format.
+  static constexpr std::array<char, 8> magic = {'B', 'R', 'K', 'F',
+                                                'L', 'I', 'G', 'H'};
+
+  /// Version of the file format.
+  static constexpr uint32_t version = 1;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  flight_recorder() = default;
+
+  flight_recorder(const flight_recorder&) = delete;
+
+  flight_recorder& operator=(const flight_recorder&) = delete;
+
+  ~flight_recorder();
+
+  // -- initialization ---------------------------------------------------------
+
+  /// Allocates a ring buffer for `capacity` records (rounded up to the next
+  /// power of two). Maps `file_name` into memory if not empty. Fails if
+  /// another recorder already uses `file_name`.
+  caf::error open(size_t capacity, const std::string& file_name = {});
+
+  /// Writes all records to `file_name` when receiving signal `signo`. Only a
+  /// single recorder per process may install a handler.
+  caf::error dump_on_signal(int signo, std::string file_name);
+
+  // -- properties -------------------------------------------------------------
+
+  explicit operator bool() const noexcept {
+    return header_ != nullptr;
+  }
+
+  bool operator!() const noexcept {
+    return header_ == nullptr;
+  }
+
+  /// Returns the maximum number of records in the ring buffer.
+  size_t capacity() const noexcept {
+    return header_ ? mask_ + 1 : 0;
+  }
+
+  /// Returns the number of records since opening the recorder.
+  uint64_t total() const noexcept;
+
+  // -- recording --------------------------------------------------------------
+
+  /// Adds a new record for `msg`.
+  void record(flight_stage stage, const node_message& msg) {
+    if (header_)
+      record(stage, get_type(msg), get_topic(msg).string(),
+             get_payload(msg).size(), get_sender(msg), get_receiver(msg));
+  }
+
+  /// Adds a new record for `msg` with an explicit receiver.
+  void record(flight_stage stage, const node_message& msg,
+              const endpoint_id& receiver) {
+    if (header_)
+      record(stage, get_type(msg), get_topic(msg).string(),
+             get_payload(msg).size(), get_sender(msg), receiver);
+  }
+
+  /// Adds a new record.
+  void record(flight_stage stage, packed_message_type type,
+              std::string_view topic_str, size_t size,
+              const endpoint_id& sender, const endpoint_id& receiver) noexcept;
+
+  // -- serialization ----------------------------------------------------------
+
+  /// Returns a consistent copy of the ring buffer in the file format.
+  std::vector<std::byte> snapshot() const;
+
+  /// Extracts all valid records from `buf`, ordered from oldest to newest.
+  static caf::error decode(caf::span<const std::byte> buf,
+                           std::vector<flight_record>& result);
+
+  // -- utility ----------------------------------------------------------------
+
+  /// Computes the ID for a topic.
+  static constexpr uint64_t topic_id(std::string_view str) noexcept {
+    uint64_t result = 0xcbf29ce484222325ull;
+    for (auto ch : str) {
+      result ^= static_cast<uint8_t>(ch);
+      result *= 0x100000001b3ull;
+    }
+    return result;
+  }
+
+private:
+  struct header;
+
+  struct slot;
+
+  void close();
+
+  header* header_ = nullptr;
+
+  slot* slots_ = nullptr;
+
+  size_t mask_ = 0;
+
+  size_t mapped_size_ = 0;
+
+  bool mapped_ = false;
+
+  /// Holds the lock on the memory-mapped file or is -1.
+  int fd_ = -1;
+};
+
+} // namespace broker::internal
@@ -1,18 +1,78 @@
 #pragma once
 
+#include "broker/detail/cycle_clock.hh"
+
 #include <caf/disposable.hpp>
 #include <caf/flow/op/cold.hpp>
 #include <caf/scheduled_actor.hpp>
 #include <caf/telemetry/counter.hpp>
 
+#include <algorithm>
 #include <functional>
 
 namespace broker::internal {
 
 /// Bundles counters that give insight into how much data flows through a scope.
 struct flow_scope_stats {
+  /// Total number of items that the downstream observer requested.
   int64_t requested = 0;
+
+  /// Total number of items that the scope passed to the downstream observer.
   int64_t delivered = 0;
+
+  /// Largest open demand so far. Observers usually request as many items as
+  /// they can buffer. Hence, this approximates the capacity of the next stage.
+  int64_t max_demand = 0;
+
+  /// Largest value of `buffered()` so far.
+  int64_t high_water_mark = 0;
+
+  /// Accumulated time without demand, excluding the current stall.
+  uint64_t stall_ticks = 0;
+
+  /// Start of the current stall or 0 if the observer has open demand.
+  uint64_t stalled_since = 0;
+
+  /// Time of the last delivery or 0 if the scope delivered nothing yet.
+  uint64_t last_delivery = 0;
+
+  /// Returns the number of items the downstream observer may receive without
+  /// requesting more.
+  int64_t demand() const noexcept {
+    return requested - delivered;
+  }
+
+  /// Returns how many items the next stage holds but did not process yet,
+  /// i.e., items that did not translate back into new demand.
+  int64_t buffered() const noexcept {
+    return max_demand - demand();
+  }
+
+  /// Returns the total time without demand in ticks at time `now`.
+  uint64_t stall_time(uint64_t now) const noexcept {
+    if (stalled_since != 0 && now > stalled_since)
+      return stall_ticks + (now - stalled_since);
+    return stall_ticks;
+  }
+
+  void on_request(size_t n) noexcept {
+    requested += static_cast<int64_t>(n);
+    max_demand = std::max(max_demand, demand());
+    if (stalled_since != 0 && n > 0) {
+      auto now = detail::cycle_clock::now();
+      if (now > stalled_since)
+        stall_ticks += now - stalled_since;
+      stalled_since = 0;
+    }
+  }
+
+  void on_deliver() noexcept {
+    ++delivered;
+    last_delivery = detail::cycle_clock::now();
+    high_water_mark = std::max(high_water_mark, buffered());
+    if (demand() == 0)
+      stalled_since = last_delivery;
+  }
 };
 
 /// @relates flow_scope_stats
@@ -89,7 +149,7 @@ public:
 
   void on_next(const Input& item) override {
     if (out_) {
-      ++stats_->delivered;
+      stats_->on_deliver();
       out_.on_next(item);
     }
   }
@@ -139,7 +199,7 @@ public:
   }
 
   void request(size_t n) override {
-    stats_->requested += static_cast<int64_t>(n);
+    stats_->on_request(n);
     if (in_)
       in_.request(n);
     else
@@ -8,17 +8,27 @@ namespace broker::internal {
 
 enum class connector_event_id : uint64_t;
 
+struct client_stats;
 struct retry_state;
 
+class cached_data_message;
 class central_dispatcher;
 class flare_actor;
+class latency_stamps;
 class pending_connection;
 class unipath_manager;
 
+using cached_data_message_ptr = std::shared_ptr<const cached_data_message>;
+using cached_data_consumer_res =
+  caf::async::consumer_resource<cached_data_message_ptr>;
+using cached_data_producer_res =
+  caf::async::producer_resource<cached_data_message_ptr>;
+using client_stats_ptr = std::shared_ptr<client_stats>;
 using command_consumer_res = caf::async::consumer_resource<command_message>;
 using command_producer_res = caf::async::producer_resource<command_message>;
 using data_consumer_res = caf::async::consumer_resource<data_message>;
 using data_producer_res = caf::async::producer_resource<data_message>;
+using latency_stamps_ptr = std::shared_ptr<latency_stamps>;
 using node_consumer_res = caf::async::consumer_resource<node_message>;
 using node_producer_res = caf::async::producer_resource<node_message>;
 using pending_connection_ptr = std::shared_ptr<pending_connection>;
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "broker/defaults.hh"
 #include "broker/endpoint_id.hh"
 #include "broker/filter_type.hh"
+#include "broker/internal/fwd.hh"
 #include "broker/internal/json_type_mapper.hh"
 #include "broker/message.hh"
 #include "broker/network_info.hh"
+#include "broker/time.hh"
+#include "broker/topic.hh"
 
 #include <caf/actor.hpp>
 #include <caf/async/spsc_buffer.hpp>
@@ -14,11 +18,53 @@
 #include <caf/scheduled_actor/flow.hpp>
 #include <caf/scheduler/test_coordinator.hpp>
 
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace broker::internal {
 
+/// Configures how the server bundles multiple messages into a single frame.
+/// Clients may enable batching in the handshake.
+struct json_batch_options {
+  /// Selects how the server combines messages in a single frame.
+  enum class format_type {
+    /// Renders a batch as JSON array.
+    array,
+    /// Renders a batch as newline-delimited JSON.
+    ndjson,
+  };
+
+  format_type format = format_type::array;
+
+  /// Maximum number of messages in a single frame.
+  size_t max_count = defaults::web_socket::max_batch_count;
+
+  /// Maximum size of a single frame in bytes. The server emits a batch as soon
+  /// as it reaches this size, i.e., a batch may exceed this limit by the size
+  /// of its last message.
+  size_t max_bytes = defaults::web_socket::max_batch_bytes;
+
+  /// Maximum time a message may wait for more messages.
+  timespan max_linger = defaults::web_socket::max_batch_linger;
+};
+
+/// Selects parts of the data in messages on a topic. Each path is a list of
+/// indexes into nested vectors, e.g., `{2, 0}` selects the first argument of
+/// a Zeek event. Clients may define projections in the handshake.
+struct json_projection {
+  /// Topic prefix that selects the messages for this projection.
+  topic prefix;
+
+  /// Selects the parts of the data that the server sends to the client.
+  std::vector<std::vector<size_t>> paths;
+
+  /// Returns a vector with one entry per path. Paths that do not exist in `x`
+  /// produce `nil`.
+  data apply(const data& x) const;
+};
+
 class json_client_state {
 public:
   static inline const char* name = "broker.json-client";
@@ -58,6 +104,25 @@ public:
   std::vector<caf::disposable> subscriptions;
   caf::flow::item_publisher<caf::cow_string> ctrl_msgs;
 
+  /// Counts all bytes that we send to the client.
+  caf::telemetry::int_counter* sent_bytes = nullptr;
+
+  /// Statistics of this client that the core reports in its status.
+  client_stats_ptr stats;
+
+  /// Batching options, if enabled by the client during the handshake.
+  std::optional<json_batch_options> batching;
+
+  /// Emits the generation of a batch once its linger timeout expires.
+  caf::flow::item_publisher<size_t> flush_ticks;
+
+  /// Projections as requested by the client during the handshake.
+  std::vector<json_projection> projections;
+
+  /// Returns the projection with the longest prefix that matches `t` or
+  /// `nullptr` if no projection applies to `t`.
+  const json_projection* projection_for(const topic& t) const noexcept;
+
   static std::string_view default_serialization_failed_error();
 
   void init(const filter_type& filter, const out_t& out,
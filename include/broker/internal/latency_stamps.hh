@@ -0,0 +1,165 @@
+#pragma once
+
+#include "broker/message.hh"
+
+#include <caf/telemetry/counter.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+// Timestamps for sampling the latency of messages between the stages of the
+// pipeline. We keep the timestamps in a side table instead of the messages
+// themselves in order to leave the layout of the public message types intact.
+//
+// The table has a fixed number of slots and each slot holds a reference to its
+// message. Hence, no other message can re-use the address of a stamped message
+// while the table holds its stamp. Stamping a message evicts the previous
+// entry of its slot, i.e., the table may drop samples under collisions but
+// never reports the stamp of one message for another.
+
+namespace broker::internal {
+
+/// Side table with the timestamps of sampled messages. Each endpoint owns one
+/// table that its core actor shares with the publishers and connections of
+/// the endpoint.
+class latency_stamps {
+public:
+  /// Creates a table that selects one out of `sample_interval` messages in
+  /// @ref sample and counts evicted stamps in `collisions`.
+  explicit latency_stamps(size_t sample_interval = 0,
+                          caf::telemetry::int_counter* collisions = nullptr)
+    : sample_interval_(sample_interval), collisions_(collisions) {
+    // nop
+  }
+
+  latency_stamps(const latency_stamps&) = delete;
+
+  latency_stamps& operator=(const latency_stamps&) = delete;
+
+  /// Returns whether to sample the current message. Unlike
+  /// @ref detail::sampler, this function is safe to call from any thread.
+  bool sample() noexcept {
+    if (sample_interval_ == 0)
+      return false;
+    return count_.fetch_add(1, std::memory_order_relaxed) % sample_interval_
+           == sample_interval_ - 1;
+  }
+
+  /// Returns the timestamp of `msg` or 0 if `msg` is not part of the sample.
+  uint64_t get(const data_message& msg) {
+    return data_messages_.get(msg);
+  }
+
+  /// @copydoc get
+  uint64_t get(const node_message& msg) {
+    return node_messages_.get(msg);
+  }
+
+  /// Stamps `msg` with `value` for sampling latencies.
+  /// @pre `value != 0`
+  void set(const data_message& msg, uint64_t value) {
+    if (data_messages_.set(msg, value) && collisions_)
+      collisions_->inc();
+  }
+
+  /// @copydoc set
+  void set(const node_message& msg, uint64_t value) {
+    if (node_messages_.set(msg, value) && collisions_)
+      collisions_->inc();
+  }
+
+  /// Returns and removes the timestamp of `msg` or returns 0 if `msg` is not
+  /// part of the sample.
+  uint64_t take(const data_message& msg) {
+    return data_messages_.take(msg);
+  }
+
+  /// @copydoc take
+  uint64_t take(const node_message& msg) {
+    return node_messages_.take(msg);
+  }
+
+private:
+  template <class Message>
+  class table {
+  public:
+    static constexpr size_t num_slots = 64;
+
+    uint64_t get(const Message& msg) {
+      auto key = key_of(msg);
+      auto& x = slot_for(key);
+      // Fast path: messages that are not part of the sample never lock.
+      if (x.key.load(std::memory_order_acquire) != key)
+        return 0;
+      std::lock_guard<std::mutex> guard{x.mtx};
+      return x.key.load(std::memory_order_relaxed) == key ? x.stamp : 0;
+    }
+
+    /// Returns whether the new stamp evicted the stamp of another message.
+    bool set(const Message& msg, uint64_t value) {
+      auto key = key_of(msg);
+      auto& x = slot_for(key);
+      // Note: we release the evicted message after unlocking.
+      std::optional<Message> evicted;
+      std::lock_guard<std::mutex> guard{x.mtx};
+      auto prev = x.key.load(std::memory_order_relaxed);
+      evicted.swap(x.msg);
+      x.msg.emplace(msg);
+      x.stamp = value;
+      x.key.store(key, std::memory_order_release);
+      return prev != nullptr && prev != key;
+    }
+
+    uint64_t take(const Message& msg) {
+      auto key = key_of(msg);
+      auto& x = slot_for(key);
+      if (x.key.load(std::memory_order_acquire) != key)
+        return 0;
+      std::optional<Message> released;
+      std::lock_guard<std::mutex> guard{x.mtx};
+      if (x.key.load(std::memory_order_relaxed) != key)
+        return 0;
+      x.key.store(nullptr, std::memory_order_relaxed);
+      released.swap(x.msg);
+      return x.stamp;
+    }
+
+  private:
+    struct slot {
+      std::atomic<const void*> key{nullptr};
+      std::mutex mtx;
+      std::optional<Message> msg;
+      uint64_t stamp = 0;
+    };
+
+    static const void* key_of(const Message& msg) noexcept {
+      return &msg.data();
+    }
+
+    slot& slot_for(const void* key) noexcept {
+      // Fibonacci hashing, since the low bits of heap addresses are all zero.
+      auto x = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key));
+      return slots_[(x * UINT64_C(11400714819323198485)) >> 58];
+    }
+
+    static_assert(num_slots == 64, "slot_for assumes 64 slots");
+
+    std::array<slot, num_slots> slots_;
+  };
+
+  size_t sample_interval_;
+
+  std::atomic<size_t> count_{0};
+
+  caf::telemetry::int_counter* collisions_;
+
+  table<data_message> data_messages_;
+
+  table<node_message> node_messages_;
+};
+
+} // namespace broker::internal
@@ -2,7 +2,92 @@
 
 #include <caf/logger.hpp>
 
-#define BROKER_LOG(level, ...) CAF_LOG_IMPL("broker", level, __VA_ARGS__)
+// -- compile-time log levels --------------------------------------------------
+
+// Broker removes log statements above the compile-time level of their
+// component. Removed statements have no runtime cost at all: neither a level
+// check nor evaluating the arguments. For all other statements, Broker only
+// evaluates and formats the arguments after the logger accepted the level at
+// runtime. Hence, log arguments should refer to existing objects (e.g., via
+// BROKER_ARG) instead of creating copies.
+//
+// BROKER_LOG_LEVEL caps all components, whereas BROKER_LOG_LEVEL_<COMPONENT>
+// caps a single component. All levels use the CAF constants, e.g.,
+// `-DBROKER_LOG_LEVEL_CORE=CAF_LOG_LEVEL_INFO`.
+
+#ifndef BROKER_LOG_LEVEL
+#  ifdef CAF_LOG_LEVEL
+#    define BROKER_LOG_LEVEL CAF_LOG_LEVEL
+#  else
+#    define BROKER_LOG_LEVEL CAF_LOG_LEVEL_QUIET
+#  endif
+#endif
+
+#ifndef BROKER_LOG_LEVEL_ENDPOINT
+#  define BROKER_LOG_LEVEL_ENDPOINT BROKER_LOG_LEVEL
+#endif
+
+#ifndef BROKER_LOG_LEVEL_CORE
+#  define BROKER_LOG_LEVEL_CORE BROKER_LOG_LEVEL
+#endif
+
+#ifndef BROKER_LOG_LEVEL_STORE
+#  define BROKER_LOG_LEVEL_STORE BROKER_LOG_LEVEL
+#endif
+
+#ifndef BROKER_LOG_LEVEL_NETWORK
+#  define BROKER_LOG_LEVEL_NETWORK BROKER_LOG_LEVEL
+#endif
+
+namespace broker::internal {
+
+/// Groups log statements for selecting compile-time log levels.
+enum class log_component {
+  /// Default component for all log statements.
+  broker,
+  /// Public API of the endpoint, e.g., `endpoint::publish`.
+  endpoint,
+  /// The core actor and its message flows.
+  core,
+  /// Data store actors.
+  store,
+  /// Connection setup and handshakes.
+  network,
+};
+
+/// Returns the maximum log level for `x` that Broker compiles into the binary.
+constexpr unsigned max_log_level(log_component x) noexcept {
+  switch (x) {
+    case log_component::endpoint:
+      return BROKER_LOG_LEVEL_ENDPOINT;
+    case log_component::core:
+      return BROKER_LOG_LEVEL_CORE;
+    case log_component::store:
+      return BROKER_LOG_LEVEL_STORE;
+    case log_component::network:
+      return BROKER_LOG_LEVEL_NETWORK;
+    default:
+      return BROKER_LOG_LEVEL;
+  }
+}
+
+} // namespace broker::internal
+
+// Source files may select a different component by redefining this macro after
+// including all headers.
+#define BROKER_LOG_COMPONENT broker
+
+/// Checks at compile time whether the current component logs at `level`.
+#define BROKER_LOG_ENABLED(level)                                              \
+  (::broker::internal::max_log_level(                                          \
+     ::broker::internal::log_component::BROKER_LOG_COMPONENT)                  \
+   >= static_cast<unsigned>(level))
+
+#define BROKER_LOG(level, ...)                                                 \
+  do {                                                                         \
+    if constexpr (BROKER_LOG_ENABLED(level))                                   \
+      CAF_LOG_IMPL("broker", level, __VA_ARGS__);                              \
+  } while (false)
 
 #define BROKER_TRACE(...)                                                      \
   BROKER_LOG(CAF_LOG_LEVEL_TRACE, "ENTRY" << __VA_ARGS__);                     \
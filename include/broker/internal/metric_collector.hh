@@ -1,16 +1,18 @@
 #pragma once
 
+#include <cstddef>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
 #include <caf/span.hpp>
-#include <caf/telemetry/collector/prometheus.hpp>
 #include <caf/telemetry/label_view.hpp>
 #include <caf/telemetry/metric.hpp>
 #include <caf/telemetry/metric_family.hpp>
 #include <caf/telemetry/metric_type.hpp>
 
+#include "broker/config.hh"
 #include "broker/data.hh"
 #include "broker/detail/assert.hh"
 #include "broker/internal/metric_view.hh"
@@ -20,7 +22,9 @@
 namespace broker::internal {
 
 /// Subscribes to a topic for receiving remote metrics and makes them accessible
-/// in the Prometheus text format.
+/// in the Prometheus text format. The collector caches the rendered text and
+/// only re-renders metrics that changed since the last call to
+/// `prometheus_text`.
 class metric_collector {
 public:
   // -- member types -----------------------------------------------------------
@@ -43,10 +47,44 @@ public:
 
     virtual void update(metric_view mv) = 0;
 
-    virtual void append_to(caf::telemetry::collector::prometheus&) = 0;
+    /// Updates the value of this metric from a delta-encoded row.
+    virtual void update(const data& value) = 0;
+
+    /// Checks whether the value has changed since the last rendering.
+    bool dirty() const noexcept {
+      return dirty_;
+    }
+
+    /// Returns the samples of this metric in the Prometheus text format.
+    /// Renders the text only if the value has changed.
+    std::string_view prometheus_text();
 
   protected:
+    /// Appends all samples of this metric to `text_`.
+    virtual void render() = 0;
+
+    /// Appends a single sample to `text_`.
+    void append_sample(std::string_view suffix, integer value);
+
+    /// Appends a single sample to `text_`.
+    void append_sample(std::string_view suffix, real value);
+
     const caf::telemetry::metric_family* parent_;
+
+    /// The name of this metric in the Prometheus text format.
+    std::string name_;
+
+    /// The rendered labels without the closing brace.
+    std::string labels_;
+
+    /// Caches the rendered samples.
+    std::string text_;
+
+    bool dirty_ = true;
+
+  private:
+    template <class T>
+    void append_sample_impl(std::string_view suffix, T value);
   };
 
   // --- constructors and destructors ------------------------------------------
@@ -64,9 +102,19 @@ public:
   size_t insert_or_update(const std::string& endpoint_name, timestamp ts,
                           caf::span<const data> rows);
 
+  /// Decodes delta-encoded rows (see `metric_scraper::encode_delta`).
+  size_t insert_or_update(const std::string& endpoint_name, timestamp ts,
+                          timestamp epoch, caf::span<const data> rows);
+
   /// Returns the recorded metrics in the Prometheus text format.
   [[nodiscard]] std::string_view prometheus_text();
 
+#ifdef BROKER_HAS_ZLIB
+  /// Returns the recorded metrics in the Prometheus text format, compressed
+  /// with gzip. Returns an empty buffer if the compression failed.
+  [[nodiscard]] caf::span<const std::byte> prometheus_text_gzip();
+#endif
+
   void clear();
 
 private:
@@ -78,6 +126,8 @@ private:
 
   struct metric_scope {
     family_ptr family;
+    /// Contains the HELP and TYPE lines for the family.
+    std::string header;
     std::vector<instance_ptr> instances;
   };
 
@@ -85,6 +135,12 @@ private:
 
   using prefix_map = std::unordered_map<std::string, name_map>;
 
+  /// Maps the IDs of delta-encoded metrics to their instances.
+  struct delta_state {
+    timestamp epoch;
+    std::unordered_map<count, remote_metric*> metrics;
+  };
+
   // -- time management --------------------------------------------------------
 
   /// Tries to advance the last-seen-time for given endpoint.
@@ -113,8 +169,19 @@ private:
   /// Stores last-seen-times by endpoints.
   std::unordered_map<std::string, timestamp> last_seen_;
 
-  /// Generates Prometheus-formatted text.
-  caf::telemetry::collector::prometheus generator_;
+  /// Stores the state for decoding delta-encoded metrics by endpoints.
+  std::unordered_map<std::string, delta_state> delta_states_;
+
+  /// Caches the output of `prometheus_text`.
+  std::string text_;
+
+  /// Signals that `text_` is out of date.
+  bool changed_ = false;
+
+#ifdef BROKER_HAS_ZLIB
+  /// Caches the output of `prometheus_text_gzip`.
+  std::vector<std::byte> gzip_text_;
+#endif
 };
 
 } // namespace broker::internal
@@ -11,6 +11,7 @@
 #include <caf/stateful_actor.hpp>
 #include <caf/telemetry/importer/process.hpp>
 
+#include "broker/defaults.hh"
 #include "broker/detail/next_tick.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal/logger.hh"
@@ -28,6 +29,8 @@ struct metric_exporter_params {
   caf::timespan interval = caf::timespan{0};
   topic target;
   std::string id;
+  bool delta = false;
+  size_t full_refresh_interval = defaults::metrics::full_refresh_interval;
   static metric_exporter_params from(const caf::actor_system_config& cfg);
   [[nodiscard]] bool valid() const noexcept;
 };
@@ -57,7 +60,8 @@ public:
                             std::move(params.selected_prefixes),
                             params.interval, std::move(params.target),
                             std::move(params.id)) {
-    // nop
+    delta = params.delta;
+    impl.full_refresh_interval(params.full_refresh_interval);
   }
 
   caf::behavior make_behavior() {
@@ -77,7 +81,8 @@ public:
           proc_importer.update();
           impl.scrape(self->system().metrics());
           // Send nothing if we only have meta data (or nothing) to send.
-          if (const auto& rows = impl.rows(); rows.size() > 1)
+          if (const auto& rows = delta ? impl.encode_delta() : impl.rows();
+              rows.size() > 1)
             self->send(core, atom::publish_v, make_data_message(target, rows));
           auto t = detail::next_tick(tick_init, self->clock().now(), interval);
           self->scheduled_send(self, t, caf::tick_atom_v);
@@ -177,6 +182,9 @@ public:
   /// Configures the topic for periodically publishing scrape results to.
   topic target;
 
+  /// Configures whether the exporter only publishes changed metrics.
+  bool delta = false;
+
   /// Adds metrics for CPU and RAM usage.
   caf::telemetry::importer::process proc_importer;
 
@@ -96,6 +96,142 @@ public:
     /// Returns all instances of `broker.buffered-messages`.
     buffered_messages_t buffered_messages_instances();
 
+    /// Samples the payload size of messages per message type.
+    ///
+    /// Label dimensions: `type` ('data', 'command', 'routing-update', 'ping',
+    /// or 'pong').
+    int_histogram_family* payload_size_family();
+
+    struct payload_size_t {
+      int_histogram* data;
+      int_histogram* command;
+      int_histogram* routing_update;
+      int_histogram* ping;
+      int_histogram* pong;
+    };
+
+    /// Returns all instances of `broker.payload-size`.
+    payload_size_t payload_size_instances();
+
+    /// Samples how much time messages spend in the stages of the pipeline.
+    ///
+    /// Label dimensions: `stage` ('publish', 'forward', 'write', or
+    /// 'deliver').
+    dbl_histogram_family* stage_latency_family();
+
+    struct stage_latency_t {
+      /// From enqueueing at a local publisher or calling `endpoint::publish`
+      /// to arriving at the core.
+      dbl_histogram* publish;
+      /// From arriving at the core to the output buffer of a peer.
+      dbl_histogram* forward;
+      /// From the output buffer of a peer to writing to the socket.
+      dbl_histogram* write;
+      /// From arriving at the core to the buffer of a local subscriber.
+      dbl_histogram* deliver;
+    };
+
+    /// Returns all instances of `broker.stage-latency`.
+    stage_latency_t stage_latency_instances();
+
+    /// Counts how many sampled messages lost their timestamp, because stamping
+    /// another message evicted it from the side table.
+    int_counter* latency_stamp_collisions_instance();
+
+    /// Samples the time that traced messages take from their origin to this
+    /// endpoint.
+    ///
+    /// Label dimensions: `origin` (endpoint ID), `prefix` (first component of
+    /// the topic).
+    dbl_histogram_family* trace_one_way_latency_family();
+
+    /// Samples the time that traced messages take from the last hop to this
+    /// endpoint.
+    ///
+    /// Label dimensions: `origin` (endpoint ID), `prefix` (first component of
+    /// the topic).
+    dbl_histogram_family* trace_hop_latency_family();
+
+    /// Counts how many messages wait in the output buffers of WebSocket
+    /// clients.
+    ///
+    /// Label dimensions: `type` (type of the client).
+    int_gauge_family* web_socket_queued_messages_family();
+
+    /// Counts how many messages Broker has dropped for WebSocket clients
+    /// because the clients could not keep up.
+    ///
+    /// Label dimensions: `type` (type of the client).
+    int_counter_family* web_socket_dropped_messages_family();
+
+    /// Counts how many bytes Broker has sent to WebSocket clients.
+    ///
+    /// Label dimensions: `type` (type of the client).
+    int_counter_family* web_socket_sent_bytes_family();
+
+    struct web_socket_client_t {
+      int_gauge* queued_messages;
+      int_counter* dropped_messages;
+      int_counter* sent_bytes;
+    };
+
+    /// Returns the instances of all WebSocket client metrics for `type`.
+    /// Metric instances are never removed. Hence, all clients of the same
+    /// type share the instances to keep the number of series bounded.
+    web_socket_client_t web_socket_client_instances(std::string_view type);
+
+    /// Estimates how many messages Broker has received or sent on the
+    /// heaviest topics.
+    ///
+    /// Label dimensions: `direction` ('in' or 'out'), `topic`.
+    int_gauge_family* topic_messages_family();
+
+    /// Estimates how many bytes Broker has received or sent on the heaviest
+    /// topics.
+    ///
+    /// Label dimensions: `direction` ('in' or 'out'), `topic`.
+    int_gauge_family* topic_volume_family();
+
+    /// Reports how many messages the next stage of a flow holds without
+    /// processing them. Per flow type, the gauge shows the largest value of
+    /// all flows.
+    ///
+    /// Label dimensions: `flow` ('peer-input', 'peer-output',
+    /// 'local-subscriber', or 'local-publisher').
+    int_gauge_family* flow_buffered_messages_family();
+
+    /// Reports the largest high-water mark of `broker.flow-buffered-messages`.
+    ///
+    /// Label dimensions: `flow` (see above).
+    int_gauge_family* flow_high_water_mark_family();
+
+    /// Reports the largest accumulated time that a flow spent without demand.
+    ///
+    /// Label dimensions: `flow` (see above).
+    dbl_gauge_family* flow_stall_time_family();
+
+    /// Reports the largest time since a flow delivered its last message.
+    ///
+    /// Label dimensions: `flow` (see above).
+    dbl_gauge_family* flow_idle_time_family();
+
+    struct flow_t {
+      int_gauge* buffered_messages;
+      int_gauge* high_water_mark;
+      dbl_gauge* stall_time;
+      dbl_gauge* idle_time;
+    };
+
+    struct flows_t {
+      flow_t peer_input;
+      flow_t peer_output;
+      flow_t local_subscriber;
+      flow_t local_publisher;
+    };
+
+    /// Returns all instances of the flow metrics.
+    flows_t flow_instances();
+
   private:
     caf::telemetry::metric_registry* reg_;
   };
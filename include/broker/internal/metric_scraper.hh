@@ -1,10 +1,13 @@
 #pragma once
 
 #include "broker/data.hh"
+#include "broker/defaults.hh"
 #include "broker/topic.hh"
 
 #include <caf/telemetry/metric_registry.hpp>
 
+#include <unordered_map>
+
 namespace broker::internal {
 
 /// Scrapes local CAF metrics and encodes them into `data` objects (for
@@ -43,6 +46,16 @@ public:
     return rows_;
   }
 
+  [[nodiscard]] size_t full_refresh_interval() const noexcept {
+    return full_refresh_interval_;
+  }
+
+  /// Configures how many calls to `encode_delta` may pass before the scraper
+  /// sends all metrics again. A value of 0 disables periodic full refreshes.
+  void full_refresh_interval(size_t new_value) noexcept {
+    full_refresh_interval_ = new_value;
+  }
+
   /// Checks whether `selected_prefixes` is empty (an empty filter means *select
   /// all*) or `family->prefix()` is in `selected_prefixes`.
   bool selected(const caf::telemetry::metric_family* family);
@@ -53,6 +66,16 @@ public:
   /// data structure and stores the result in `rows`.
   void scrape(caf::telemetry::metric_registry& registry);
 
+  /// Encodes the result of the last scrape relative to the previous call to
+  /// this function. The first row contains the meta data (scraper ID,
+  /// timestamp, plus the epoch that identifies the current encoding state).
+  /// All other rows contain either a metric ID plus a full row (the definition
+  /// of a metric) or a metric ID plus a value. The scraper only includes
+  /// metrics with changed values, except on the first call and on periodic
+  /// full refreshes, where it includes the definitions of all metrics.
+  /// @pre `!rows().empty()`
+  const vector& encode_delta();
+
   void operator()(const caf::telemetry::metric_family* family,
                   const caf::telemetry::metric* instance,
                   const caf::telemetry::dbl_counter* counter);
@@ -88,8 +111,20 @@ private:
 
   /// Encodes a single metric as a row in our output vector.
   template <class T>
-  void add_row(const caf::telemetry::metric_family* family, std::string type,
-               table labels, T value);
+  void add_row(const caf::telemetry::metric_family* family,
+               const caf::telemetry::metric* instance, std::string type,
+               T value);
+
+  // -- member types -----------------------------------------------------------
+
+  /// Stores the state of a metric for the delta encoding.
+  struct interned_metric {
+    /// Identifies the metric in the delta-encoded rows.
+    count id;
+
+    /// The value that the scraper has sent last.
+    data value;
+  };
 
   // -- member variables -------------------------------------------------------
 
@@ -108,6 +143,27 @@ private:
   /// Contains the result for the last scraping run as data rows. The first row
   /// is reserved for meta data (scraper ID plus timestamp).
   vector rows_;
+
+  /// Stores the metric instance for each row in `rows_` (excluding the meta
+  /// data row).
+  std::vector<const caf::telemetry::metric*> instances_;
+
+  /// Maps metric instances to their ID and last sent value. CAF never removes
+  /// metric instances from the registry, so the pointers remain valid.
+  std::unordered_map<const caf::telemetry::metric*, interned_metric> interned_;
+
+  /// Contains the result of the last call to `encode_delta`.
+  vector delta_rows_;
+
+  /// Identifies the current state of `interned_`. Receivers drop all IDs from
+  /// a previous epoch.
+  timestamp epoch_;
+
+  /// Configures the number of calls to `encode_delta` between full refreshes.
+  size_t full_refresh_interval_ = defaults::metrics::full_refresh_interval;
+
+  /// Counts the calls to `encode_delta` since the last full refresh.
+  size_t encoded_since_refresh_ = 0;
 };
 
 } // namespace broker::internal
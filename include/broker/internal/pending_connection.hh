@@ -1,6 +1,7 @@
 #pragma once
 
 #include "broker/fwd.hh"
+#include "broker/internal/fwd.hh"
 
 #include <caf/async/fwd.hpp>
 #include <caf/fwd.hpp>
@@ -17,9 +18,11 @@ public:
 
   /// Acknowledges and runs the connection in the background.
   /// @param sys the actor system with the network manager.
+  /// @param stamps The side table for sampling latencies.
   /// @param pull The resource where the connection pulls data from.
   /// @param push The resource where the connection pushes data to.
   virtual caf::error run(caf::actor_system& sys,
+                         const latency_stamps_ptr& stamps,
                          caf::async::consumer_resource<node_message> pull,
                          caf::async::producer_resource<node_message> push) = 0;
 };
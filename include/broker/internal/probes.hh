@@ -0,0 +1,23 @@
+#pragma once
+
+#include "broker/config.hh"
+
+// Static tracepoints (USDT probes) for profiling Broker with tools such as
+// bpftrace or perf. Disabled probes compile to a single NOP instruction. On
+// platforms without <sys/sdt.h>, the probes compile to nothing.
+//
+// All probes belong to the provider `broker`. For example, the following
+// bpftrace script prints the payload size of each message that leaves the
+// central merge point of the core actor:
+//
+//   usdt:/path/to/libbroker.so:broker:central_merge_leave { printf("%d\n", arg1); }
+//
+// Note: the arguments of probes get evaluated even if no tool attached to the
+//       probe. Hence, probe arguments should be cheap to compute.
+
+#ifdef BROKER_HAS_SDT
+#  include <sys/sdt.h>
+#  define BROKER_PROBE(name, ...) STAP_PROBEV(broker, name, __VA_ARGS__)
+#else
+#  define BROKER_PROBE(name, ...) static_cast<void>(0)
+#endif
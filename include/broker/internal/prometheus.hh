@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -15,6 +16,10 @@
 
 namespace broker::internal {
 
+/// Checks whether the HTTP request `req` lists gzip in its Accept-Encoding
+/// header field with a non-zero weight, either explicitly or via '*'.
+bool accepts_gzip(std::string_view req);
+
 /// Makes local and remote metrics available to Prometheus via HTTP. The
 /// Prometheus actor collects and exports local metrics as well as imports
 /// remote metrics by subscribing to user-defined topics where other endpoints
@@ -49,13 +54,19 @@ public:
 private:
   void flush_and_close(caf::io::connection_handle hdl);
 
-  void on_metrics_request(caf::io::connection_handle hdl);
+  void on_metrics_request(caf::io::connection_handle hdl, std::string_view req);
 
   void on_status_request(caf::io::connection_handle hdl);
 
   void on_status_request_cb(caf::io::connection_handle hdl, uint64_t async_id,
                             const table& res);
 
+  void on_flight_recorder_request(caf::io::connection_handle hdl);
+
+  void on_flight_recorder_request_cb(caf::io::connection_handle hdl,
+                                     uint64_t async_id,
+                                     const std::vector<std::byte>& res);
+
   /// Caches input per open connection for parsing the HTTP header.
   std::unordered_map<caf::io::connection_handle, request_state> requests_;
 
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/defaults.hh"
+#include "broker/detail/space_saving.hh"
+#include "broker/topic.hh"
+
+#include <caf/telemetry/gauge.hpp>
+#include <caf/telemetry/metric_family_impl.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace broker::internal {
+
+/// Tracks the heaviest topics by number of messages and by number of bytes.
+/// Uses a fixed amount of memory regardless of the number of topics. To keep
+/// the per-message overhead low, only sampled messages update the summaries.
+/// Each sample accounts for all messages and bytes since the previous sample.
+/// The gaps between samples vary randomly around `sample_interval` to avoid
+/// aliasing with periodic traffic patterns.
+class topic_statistics {
+public:
+  explicit topic_statistics(
+    size_t capacity = defaults::topic_statistics::capacity,
+    size_t sample_interval = defaults::topic_statistics::sample_interval);
+
+  /// Adds a message on topic `t` with a payload of `num_bytes`.
+  void add(const topic& t, size_t num_bytes) {
+    total_messages_ += 1;
+    total_bytes_ += num_bytes;
+    pending_messages_ += 1;
+    pending_bytes_ += num_bytes;
+    if (pending_messages_ >= next_sample_)
+      add_sample(t.string());
+  }
+
+  /// Returns the summary for the number of messages per topic.
+  const detail::space_saving& messages() const noexcept {
+    return messages_;
+  }
+
+  /// Returns the summary for the number of bytes per topic.
+  const detail::space_saving& bytes() const noexcept {
+    return bytes_;
+  }
+
+  /// Renders the top `k` topics by number of messages and by number of bytes.
+  table snapshot(size_t k) const;
+
+private:
+  void add_sample(const std::string& key);
+
+  detail::space_saving messages_;
+  detail::space_saving bytes_;
+  uint64_t total_messages_ = 0;
+  uint64_t total_bytes_ = 0;
+  uint64_t pending_messages_ = 0;
+  uint64_t pending_bytes_ = 0;
+  uint64_t next_sample_ = 1;
+  std::uniform_int_distribution<uint64_t> gaps_;
+  std::minstd_rand rng_;
+};
+
+/// @relates topic_statistics
+using topic_statistics_ptr = std::shared_ptr<topic_statistics>;
+
+/// Exports the top topics of a @ref topic_statistics object as gauges with the
+/// topic as label. Since CAF never removes metric instances, this class stops
+/// adding new instances after exporting `max_topics` distinct topics. Topics
+/// that drop out of the top `k` remain at value 0.
+class topic_metrics {
+public:
+  using gauge_family = caf::telemetry::metric_family_impl<
+    caf::telemetry::int_gauge>;
+
+  topic_metrics(gauge_family* messages, gauge_family* bytes,
+                std::string direction,
+                size_t max_topics = defaults::topic_statistics::max_topics);
+
+  /// Sets the gauges to the current top `k` values of `stats`.
+  void update(const topic_statistics& stats, size_t k);
+
+private:
+  using gauge_map = std::unordered_map<std::string, caf::telemetry::int_gauge*>;
+
+  void update(gauge_family* family, gauge_map& gauges,
+              const detail::space_saving& summary, size_t k);
+
+  gauge_family* messages_family_;
+  gauge_family* bytes_family_;
+  std::string direction_;
+  size_t max_topics_;
+  gauge_map messages_;
+  gauge_map bytes_;
+};
+
+} // namespace broker::internal
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "broker/endpoint_id.hh"
+#include "broker/message.hh"
+#include "broker/time.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Traces of sampled node messages. Like the latency stamps, we keep the traces
+// in a side table instead of the messages themselves in order to leave the
+// layout of the public message types intact.
+//
+// The table is process-wide, because traces must follow messages between
+// endpoints that peer within the same process. Each entry holds a reference to
+// its message. Hence, no other message can re-use the address of a traced
+// message while the table holds its trace. The table has a fixed capacity and
+// evicts the oldest entry when running out of space, i.e., it drops traces of
+// messages that stay in a buffer for too long but never reports the trace of
+// one message for another.
+
+namespace broker::internal {
+
+/// A single hop of a traced message.
+struct trace_hop {
+  /// The endpoint that sent the message.
+  endpoint_id node;
+
+  /// The wall clock time at which `node` sent the message.
+  timestamp time;
+};
+
+/// Records the path of a sampled message through the network. The first hop
+/// is the origin of the message. Each endpoint that forwards the message
+/// appends itself to the list of hops.
+struct trace_header {
+  std::vector<trace_hop> hops;
+
+  /// Returns the origin of the message.
+  /// @pre `!hops.empty()`
+  const trace_hop& origin() const noexcept {
+    return hops.front();
+  }
+
+  /// Returns the last endpoint that forwarded the message.
+  /// @pre `!hops.empty()`
+  const trace_hop& last_hop() const noexcept {
+    return hops.back();
+  }
+};
+
+/// An immutable, reference-counted handle to a @ref trace_header.
+class trace_header_ptr {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  trace_header_ptr() noexcept = default;
+
+  explicit trace_header_ptr(std::vector<trace_hop> hops)
+    : ptr_(new impl{{std::move(hops)}}) {
+    // nop
+  }
+
+  trace_header_ptr(trace_header_ptr&& other) noexcept : ptr_(other.ptr_) {
+    other.ptr_ = nullptr;
+  }
+
+  trace_header_ptr(const trace_header_ptr& other) noexcept : ptr_(other.ptr_) {
+    if (ptr_)
+      ++ptr_->rc;
+  }
+
+  trace_header_ptr& operator=(trace_header_ptr other) noexcept {
+    std::swap(ptr_, other.ptr_);
+    return *this;
+  }
+
+  ~trace_header_ptr() noexcept {
+    if (ptr_ && --ptr_->rc == 0)
+      delete ptr_;
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  const trace_header* get() const noexcept {
+    return ptr_ ? &ptr_->header : nullptr;
+  }
+
+  const trace_header* operator->() const noexcept {
+    return get();
+  }
+
+  const trace_header& operator*() const noexcept {
+    return ptr_->header;
+  }
+
+  explicit operator bool() const noexcept {
+    return ptr_ != nullptr;
+  }
+
+  /// Returns a new trace with `hop` appended to the hops of this trace.
+  /// @pre `static_cast<bool>(*this)`
+  trace_header_ptr add_hop(trace_hop hop) const {
+    auto hops = ptr_->header.hops;
+    hops.emplace_back(std::move(hop));
+    return trace_header_ptr{std::move(hops)};
+  }
+
+private:
+  struct impl {
+    trace_header header;
+    std::atomic<size_t> rc{1};
+  };
+
+  impl* ptr_ = nullptr;
+};
+
+/// Returns the trace of `msg` or a null pointer if `msg` carries no trace.
+trace_header_ptr get_trace(const node_message& msg);
+
+/// Attaches `trace` to `msg`.
+void set_trace(const node_message& msg, trace_header_ptr trace);
+
+} // namespace broker::internal
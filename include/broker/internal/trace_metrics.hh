@@ -0,0 +1,57 @@
+#pragma once
+
+#include "broker/defaults.hh"
+#include "broker/endpoint_id.hh"
+#include "broker/internal/trace_header.hh"
+#include "broker/time.hh"
+#include "broker/topic.hh"
+
+#include <caf/telemetry/histogram.hpp>
+#include <caf/telemetry/metric_family_impl.hpp>
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace broker::internal {
+
+/// Aggregates the latencies of traced messages per origin and topic prefix,
+/// whereas the prefix is the first component of the topic. Since CAF never
+/// removes metric instances, this class adds at most `max_label_sets`
+/// combinations of origin and prefix and then falls back to the label value
+/// 'other' for both dimensions.
+class trace_metrics {
+public:
+  using histogram_family = caf::telemetry::metric_family_impl<
+    caf::telemetry::dbl_histogram>;
+
+  trace_metrics(histogram_family* one_way, histogram_family* hop,
+                size_t max_label_sets = defaults::tracing::max_label_sets);
+
+  /// Observes the latencies of a message on topic `t` that arrived at `now`.
+  /// @pre `!trace.hops.empty()`
+  void observe(const trace_header& trace, const topic& t, timestamp now);
+
+  /// Returns the topic prefix for `t`.
+  static std::string_view prefix_of(const topic& t) noexcept;
+
+private:
+  struct instances {
+    /// Time from the origin to this endpoint.
+    caf::telemetry::dbl_histogram* one_way;
+
+    /// Time from the last hop to this endpoint.
+    caf::telemetry::dbl_histogram* hop;
+  };
+
+  instances& instances_for(const endpoint_id& origin, std::string_view prefix);
+
+  histogram_family* one_way_family_;
+  histogram_family* hop_family_;
+  size_t max_label_sets_;
+  std::map<std::pair<endpoint_id, std::string>, instances> instances_;
+  instances other_;
+};
+
+} // namespace broker::internal
@@ -108,6 +108,7 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker_internal, caf::first_custom_type_id)
 
   // -- atoms for communciation with the core actor ----------------------------
 
+  BROKER_ADD_ATOM(flight_recorder)
   BROKER_ADD_ATOM(no_events)
   BROKER_ADD_ATOM(snapshot)
   BROKER_ADD_ATOM(subscriptions)
@@ -134,6 +135,8 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker_internal, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((broker::erase_command))
   BROKER_ADD_TYPE_ID((broker::expire_command))
   BROKER_ADD_TYPE_ID((broker::filter_type))
+  BROKER_ADD_TYPE_ID((broker::internal::cached_data_producer_res))
+  BROKER_ADD_TYPE_ID((broker::internal::client_stats_ptr))
   BROKER_ADD_TYPE_ID((broker::internal::command_consumer_res))
   BROKER_ADD_TYPE_ID((broker::internal::command_producer_res))
   BROKER_ADD_TYPE_ID((broker::internal::connector_event_id))
@@ -242,6 +245,8 @@ struct inspector_access<broker::cow_tuple<Ts...>> {
 #undef BROKER_ADD_TYPE_ID
 
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::detail::shared_store_state_ptr)
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::cached_data_producer_res)
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::client_stats_ptr)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::command_consumer_res)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::command_producer_res)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::data_consumer_res)
@@ -7,9 +7,18 @@
 #include <caf/fwd.hpp>
 
 #include <functional>
+#include <map>
+#include <string>
 
 namespace broker::internal::web_socket {
 
+/// Selects whether a WebSocket client exchanges text or binary frames. For
+/// binary frames, the strings in the buffers carry the raw bytes.
+enum class frame_type {
+  text,
+  binary,
+};
+
 using pull_t = caf::async::consumer_resource<caf::cow_string>;
 using push_t = caf::async::producer_resource<caf::cow_string>;
 
@@ -18,10 +27,20 @@ using connect_event_t = std::pair<pull_t, push_t>;
 using on_connect_t =
   std::function<void(const caf::settings&, connect_event_t&)>;
 
+/// Configures how the server handles clients on a particular path.
+struct route {
+  /// Selects the type of WebSocket frames for the client.
+  frame_type frames;
+
+  /// Called for each new client on this path.
+  on_connect_t on_connect;
+};
+
+/// Maps paths to their route.
+using route_map = std::map<std::string, route>;
+
 expected<uint16_t> launch(caf::actor_system& sys,
                           const openssl_options_ptr& ssl_cfg, std::string addr,
-                          uint16_t port, bool reuse_addr,
-                          const std::string& allowed_path,
-                          on_connect_t on_connect);
+                          uint16_t port, bool reuse_addr, route_map routes);
 
 } // namespace broker::internal::web_socket
@@ -1,14 +1,17 @@
 #pragma once
 
+#include "broker/detail/sampler.hh"
 #include "broker/endpoint_id.hh"
 #include "broker/error.hh"
 #include "broker/fwd.hh"
+#include "broker/internal/fwd.hh"
 #include "broker/message.hh"
 
 #include <caf/byte_buffer.hpp>
 #include <caf/byte_span.hpp>
 #include <caf/error.hpp>
 #include <caf/fwd.hpp>
+#include <caf/telemetry/histogram.hpp>
 
 // After establishing a transport channel (usually TCP/TLS), the Broker protocol
 // traverses three phases:
@@ -28,6 +31,11 @@ constexpr uint32_t magic_number = 0x5A45454B;
 /// The current version of the protocol.
 constexpr uint8_t protocol_version = 1;
 
+/// Marks node messages with a trace header. Broker sets this bit in the
+/// message type of phase 3 messages and then adds the trace after the TTL.
+/// Endpoints that do not support tracing reject these messages.
+constexpr uint8_t trace_flag = 0x80;
+
 // -- version-agnostic Broker messages -----------------------------------------
 
 /// Starts the handshake process. Sent by the Broker node that establishes the
@@ -238,6 +246,19 @@ inline originator_ack_msg make_originator_ack_msg() {
 /// representation.
 class trait {
 public:
+  trait() = default;
+
+  /// Creates a trait that stamps one out of `sample_interval` received
+  /// messages in `stamps` and observes the time until writing stamped messages
+  /// in `write_latency`.
+  trait(latency_stamps_ptr stamps, caf::telemetry::dbl_histogram* write_latency,
+        size_t sample_interval)
+    : stamps_(std::move(stamps)),
+      write_latency_(write_latency),
+      sampler_(sample_interval) {
+    // nop
+  }
+
   /// Serializes a @ref node_message to a sequence of bytes.
   bool convert(const node_message& msg, caf::byte_buffer& buf);
 
@@ -251,6 +272,15 @@ public:
 
 private:
   caf::error last_error_;
+
+  /// Stores the timestamps of sampled messages.
+  latency_stamps_ptr stamps_;
+
+  /// Samples how long it takes to write messages after leaving the core.
+  caf::telemetry::dbl_histogram* write_latency_ = nullptr;
+
+  /// Selects received messages for sampling latencies.
+  detail::sampler sampler_;
 };
 
 } // namespace v1
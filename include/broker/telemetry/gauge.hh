@@ -77,10 +77,14 @@ public:
   }
 
   /// Decrements the value by 1.
-  void dec() noexcept;
+  void dec() noexcept {
+    telemetry::dec(hdl_);
+  }
 
   /// Decrements the value by @p amount.
-  void dec(int64_t amount) noexcept;
+  void dec(T amount) noexcept {
+    telemetry::dec(hdl_, amount);
+  }
 
   /// Decrements the value by 1.
   /// @return The new value.
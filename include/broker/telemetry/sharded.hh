@@ -0,0 +1,131 @@
+#pragma once
+
+#include "broker/config.hh"
+#include "broker/telemetry/counter.hh"
+#include "broker/telemetry/gauge.hh"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace broker::telemetry {
+
+/// Number of shards per sharded metric.
+constexpr size_t num_metric_shards = 16;
+
+/// Returns the shard index for the calling thread. Threads receive their index
+/// round-robin on first use.
+size_t this_thread_shard() noexcept;
+
+/// Base type for metrics that spread updates over per-thread shards. Updating a
+/// sharded metric only touches a cache line of the calling thread. The shards
+/// get aggregated into the backing metric lazily by calling `flush_all`, which
+/// Broker does before scraping its metrics.
+class sharded_metric {
+public:
+  sharded_metric();
+
+  sharded_metric(const sharded_metric&) = delete;
+
+  sharded_metric& operator=(const sharded_metric&) = delete;
+
+  virtual ~sharded_metric();
+
+  /// Returns the sum over all shards.
+  int64_t value() const noexcept;
+
+  /// Adds pending updates of all sharded metrics to their backing metrics.
+  static void flush_all();
+
+protected:
+  /// Adds `amount` to the shard of the calling thread.
+  void add(int64_t amount) noexcept {
+    shards_[this_thread_shard()].value.fetch_add(amount,
+                                                 std::memory_order_relaxed);
+  }
+
+  /// Flushes pending updates and removes this metric from the list of metrics
+  /// that `flush_all` visits. Derived types must call this function in their
+  /// destructor.
+  void deregister() noexcept;
+
+private:
+  /// Adds `delta` to the backing metric.
+  virtual void flush(int64_t delta) noexcept = 0;
+
+  /// Pads each shard to a full cache line to avoid false sharing.
+  struct alignas(BROKER_CONSTRUCTIVE_INTERFERENCE_SIZE) shard {
+    std::atomic<int64_t> value{0};
+  };
+
+  std::array<shard, num_metric_shards> shards_;
+
+  /// The value at the last flush. Guarded by the mutex in `flush_all`.
+  int64_t flushed_ = 0;
+
+  bool registered_ = false;
+};
+
+/// A sharded version of @ref int_counter.
+class sharded_int_counter final : public sharded_metric {
+public:
+  explicit sharded_int_counter(int_counter backend) : backend_(backend) {
+    // nop
+  }
+
+  ~sharded_int_counter() override;
+
+  /// Increments the value by 1.
+  void inc() noexcept {
+    add(1);
+  }
+
+  /// Increments the value by @p amount.
+  /// @pre `amount >= 0`
+  void inc(int64_t amount) noexcept {
+    add(amount);
+  }
+
+private:
+  void flush(int64_t delta) noexcept override;
+
+  int_counter backend_;
+};
+
+/// A sharded version of @ref int_gauge.
+class sharded_int_gauge final : public sharded_metric {
+public:
+  explicit sharded_int_gauge(int_gauge backend) : backend_(backend) {
+    // nop
+  }
+
+  ~sharded_int_gauge() override;
+
+  /// Increments the value by 1.
+  void inc() noexcept {
+    add(1);
+  }
+
+  /// Increments the value by @p amount.
+  void inc(int64_t amount) noexcept {
+    add(amount);
+  }
+
+  /// Decrements the value by 1.
+  void dec() noexcept {
+    add(-1);
+  }
+
+  /// Decrements the value by @p amount.
+  void dec(int64_t amount) noexcept {
+    add(-amount);
+  }
+
+private:
+  void flush(int64_t delta) noexcept override;
+
+  int_gauge backend_;
+};
+
+} // namespace broker::telemetry
@@ -0,0 +1,134 @@
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <caf/span.hpp>
+
+#include "broker/configuration.hh"
+#include "broker/convert.hh"
+#include "broker/endpoint.hh"
+#include "broker/endpoint_id.hh"
+#include "broker/internal/flight_recorder.hh"
+#include "broker/message.hh"
+#include "broker/time.hh"
+
+using broker::internal::flight_record;
+using broker::internal::flight_recorder;
+using broker::internal::flight_stage;
+
+namespace {
+
+struct parameters {
+  std::string input;
+  std::string topics;
+  bool csv = false;
+};
+
+// Adds custom configuration options to the config object.
+void extend_config(parameters& param, broker::configuration& cfg) {
+  cfg.add_option(&param.input, "input,i",
+                 "flight recorder file or dump (required)");
+  cfg.add_option(&param.topics, "topics,t",
+                 "file with one topic per line for resolving topic IDs, "
+                 "e.g., topics.txt from the recording directory");
+  cfg.add_option(&param.csv, "csv,c", "print comma-separated values");
+}
+
+bool read_file(const std::string& file_name, std::vector<std::byte>& buf) {
+  std::ifstream in{file_name, std::ios::binary};
+  if (!in)
+    return false;
+  std::vector<char> tmp{std::istreambuf_iterator<char>{in},
+                        std::istreambuf_iterator<char>{}};
+  buf.resize(tmp.size());
+  if (!tmp.empty())
+    memcpy(buf.data(), tmp.data(), tmp.size());
+  return true;
+}
+
+std::string id_string(const broker::endpoint_id::array_type& bytes) {
+  broker::endpoint_id id{bytes};
+  return id ? to_string(id) : std::string{"-"};
+}
+
+std::string type_name(uint8_t type) {
+  broker::packed_message_type x;
+  if (broker::from_integer(type, x))
+    return to_string(x);
+  return std::to_string(type);
+}
+
+} // namespace
+
+int main(int argc, char** argv) try {
+  broker::endpoint::system_guard sys_guard;
+  // Parse CLI parameters using our config.
+  parameters params;
+  broker::configuration cfg{broker::skip_init};
+  extend_config(params, cfg);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << "*** error while reading config: " << ex.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed()) {
+    return EXIT_SUCCESS;
+  } else if (!cfg.remainder().empty()) {
+    std::cerr << "*** too many arguments\n\n";
+    return EXIT_FAILURE;
+  } else if (params.input.empty()) {
+    std::cerr << "*** missing input file (see --help)\n";
+    return EXIT_FAILURE;
+  }
+  // Map topic IDs back to their names if possible.
+  std::unordered_map<uint64_t, std::string> topics;
+  if (!params.topics.empty()) {
+    std::ifstream in{params.topics};
+    if (!in) {
+      std::cerr << "*** unable to open " << params.topics << '\n';
+      return EXIT_FAILURE;
+    }
+    std::string line;
+    while (std::getline(in, line))
+      topics.emplace(flight_recorder::topic_id(line), line);
+  }
+  // Read and decode the input.
+  std::vector<std::byte> buf;
+  if (!read_file(params.input, buf)) {
+    std::cerr << "*** unable to open " << params.input << '\n';
+    return EXIT_FAILURE;
+  }
+  std::vector<flight_record> records;
+  if (auto err = flight_recorder::decode(caf::make_span(buf), records)) {
+    std::cerr << "*** unable to decode " << params.input << ": "
+              << to_string(err) << '\n';
+    return EXIT_FAILURE;
+  }
+  // Print one line per record, from oldest to newest.
+  auto sep = params.csv ? "," : " ";
+  if (params.csv)
+    std::cout << "time,stage,type,topic,size,sender,receiver\n";
+  for (auto& rec : records) {
+    auto ts = broker::timestamp{broker::timespan{rec.time}};
+    std::cout << broker::to_string(ts) << sep
+              << to_string(static_cast<flight_stage>(rec.stage)) << sep
+              << type_name(rec.type) << sep;
+    if (auto i = topics.find(rec.topic_id); i != topics.end())
+      std::cout << i->second;
+    else
+      std::cout << "0x" << std::hex << rec.topic_id << std::dec;
+    std::cout << sep << rec.size << sep << id_string(rec.sender) << sep
+              << id_string(rec.receiver) << '\n';
+  }
+  return EXIT_SUCCESS;
+} catch (std::exception& ex) {
+  std::cerr << "*** exception: " << ex.what() << '\n';
+  return EXIT_FAILURE;
+}
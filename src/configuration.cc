@@ -122,10 +122,24 @@ struct configuration::impl : public caf::actor_system_config {
                    "maximum number of items we buffer per peer or publisher");
     opt_group{custom_options_, "broker.web-socket"} //
       .add<string>("address", "bind address for the WebSocket server socket")
-      .add<port>("port", "port for incoming WebSocket connections");
+      .add<port>("port", "port for incoming WebSocket connections")
+      .add<size_t>("max-buffered-messages",
+                   "maximum number of messages Broker buffers per client")
+      .add<string>("overflow-policy",
+                   "what to do with clients that exceed their buffer: "
+                   "drop-oldest, drop-newest, or disconnect");
     opt_group{custom_options_, "broker.metrics"}
       .add<port>("port", "port for incoming Prometheus (HTTP) requests")
       .add<string>("address", "bind address for the HTTP server socket")
+      .add<size_t>("latency-sample-interval",
+                   "samples one out of N messages for the latency and "
+                   "payload size metrics (0 disables sampling)")
+      .add<size_t>("trace-sample-interval",
+                   "traces one out of N messages from local publishers "
+                   "across peers (0 disables tracing)")
+      .add<size_t>("top-topics",
+                   "number of topics in the statistics for the heaviest "
+                   "topics")
       .add<string>(
         "endpoint-name",
         "name for this endpoint in metrics (when exporting: suffix of "
@@ -136,9 +150,22 @@ struct configuration::impl : public caf::actor_system_config {
       .add<caf::timespan>("interval",
                           "time between publishing metrics on the topic")
       .add<string_list>("prefixes",
-                        "selects metric prefixes to publish on the topic");
+                        "selects metric prefixes to publish on the topic")
+      .add<bool>("delta", "if true, publishes only metrics that changed since "
+                          "the last export")
+      .add<size_t>("full-refresh-interval",
+                   "number of exports between publishing all metrics in "
+                   "delta mode (0 disables periodic refreshes)");
     opt_group{custom_options_, "broker.metrics.import"} //
       .add<string_list>("topics", "topics for collecting remote metrics from");
+    opt_group{custom_options_, "broker.flight-recorder"}
+      .add<size_t>("capacity", "number of recent messages in the flight "
+                               "recorder (0 disables the recorder)")
+      .add<string>("file", "if set, maps the flight recorder to this file "
+                           "instead of anonymous memory")
+      .add<int>("dump-signal", "if set, dumps the flight recorder to "
+                               "dump-file when receiving this signal")
+      .add<string>("dump-file", "destination for signal-triggered dumps");
     opt_group{custom_options_, "broker.ssl"} //
       .add(ssl_options->certificate, "certificate",
            "path to the PEM-formatted certificate file")
@@ -0,0 +1,50 @@
+#include "broker/detail/alloc_stage.hh"
+
+namespace broker::detail {
+
+namespace {
+
+// Note: a trivial type with constant initialization makes sure that accessing
+//       the variable never allocates, because allocators call
+//       current_alloc_stage.
+thread_local alloc_stage current_stage = alloc_stage::none;
+
+} // namespace
+
+std::string_view to_string(alloc_stage x) noexcept {
+  switch (x) {
+    case alloc_stage::none:
+      return "none";
+    case alloc_stage::publish:
+      return "publish";
+    case alloc_stage::pack:
+      return "pack";
+    case alloc_stage::route:
+      return "route";
+    case alloc_stage::wire_encode:
+      return "wire-encode";
+    case alloc_stage::wire_decode:
+      return "wire-decode";
+    case alloc_stage::unpack:
+      return "unpack";
+    case alloc_stage::deliver:
+      return "deliver";
+    default:
+      return "???";
+  }
+}
+
+alloc_stage current_alloc_stage() noexcept {
+  return current_stage;
+}
+
+alloc_stage_scope::alloc_stage_scope(alloc_stage stage) noexcept
+  : prev_(current_stage) {
+  current_stage = stage;
+}
+
+alloc_stage_scope::~alloc_stage_scope() {
+  current_stage = prev_;
+}
+
+} // namespace broker::detail
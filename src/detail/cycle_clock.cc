@@ -0,0 +1,25 @@
+#include "broker/detail/cycle_clock.hh"
+
+namespace broker::detail {
+
+double cycle_clock::seconds_per_tick() noexcept {
+#ifdef BROKER_HAS_RDTSC
+  // Calibrate once by spinning for a short while against the steady clock.
+  static const double result = [] {
+    using std::chrono::steady_clock;
+    auto t0 = steady_clock::now();
+    auto c0 = now();
+    auto t1 = t0;
+    while (t1 - t0 < std::chrono::milliseconds{2})
+      t1 = steady_clock::now();
+    auto c1 = now();
+    auto secs = std::chrono::duration<double>{t1 - t0}.count();
+    return c1 > c0 ? secs / static_cast<double>(c1 - c0) : 1e-9;
+  }();
+  return result;
+#else
+  return 1e-9;
+#endif
+}
+
+} // namespace broker::detail
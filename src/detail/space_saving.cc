@@ -0,0 +1,79 @@
+#include "broker/detail/space_saving.hh"
+
+#include "broker/detail/assert.hh"
+
+#include <algorithm>
+
+namespace broker::detail {
+
+space_saving::space_saving(size_t capacity) : capacity_(capacity) {
+  BROKER_ASSERT(capacity > 0);
+  heap_.reserve(capacity);
+  index_.reserve(capacity);
+}
+
+void space_saving::add(const std::string& key, uint64_t weight) {
+  total_ += weight;
+  if (auto i = index_.find(key); i != index_.end()) {
+    auto pos = i->second;
+    heap_[pos].count += weight;
+    sift_down(pos);
+    return;
+  }
+  if (heap_.size() < capacity_) {
+    // Append the new entry and move it up to restore the heap property.
+    auto pos = heap_.size();
+    heap_.push_back(entry{key, weight, 0});
+    index_.emplace(key, pos);
+    while (pos > 0) {
+      auto parent = (pos - 1) / 2;
+      if (heap_[parent].count <= heap_[pos].count)
+        break;
+      std::swap(heap_[parent], heap_[pos]);
+      index_[heap_[pos].key] = pos;
+      index_[heap_[parent].key] = parent;
+      pos = parent;
+    }
+    return;
+  }
+  // Replace the entry with the smallest count.
+  auto& root = heap_.front();
+  index_.erase(root.key);
+  root.key = key;
+  root.error = root.count;
+  root.count += weight;
+  index_.emplace(key, 0);
+  sift_down(0);
+}
+
+std::vector<space_saving::entry> space_saving::top(size_t k) const {
+  auto result = heap_;
+  auto n = std::min(k, result.size());
+  auto greater = [](const entry& x, const entry& y) {
+    return x.count > y.count;
+  };
+  std::partial_sort(result.begin(), result.begin() + n, result.end(), greater);
+  result.resize(n);
+  return result;
+}
+
+void space_saving::sift_down(size_t pos) {
+  auto size = heap_.size();
+  for (;;) {
+    auto left = 2 * pos + 1;
+    auto right = left + 1;
+    auto smallest = pos;
+    if (left < size && heap_[left].count < heap_[smallest].count)
+      smallest = left;
+    if (right < size && heap_[right].count < heap_[smallest].count)
+      smallest = right;
+    if (smallest == pos)
+      return;
+    std::swap(heap_[pos], heap_[smallest]);
+    index_[heap_[pos].key] = pos;
+    index_[heap_[smallest].key] = smallest;
+    pos = smallest;
+  }
+}
+
+} // namespace broker::detail
@@ -2,15 +2,20 @@
 
 #include "broker/configuration.hh"
 #include "broker/defaults.hh"
+#include "broker/detail/alloc_stage.hh"
+#include "broker/detail/cycle_clock.hh"
 #include "broker/detail/die.hh"
 #include "broker/detail/filesystem.hh"
+#include "broker/internal/binary_client.hh"
 #include "broker/internal/configuration_access.hh"
 #include "broker/internal/core_actor.hh"
 #include "broker/internal/endpoint_access.hh"
 #include "broker/internal/json_client.hh"
 #include "broker/internal/json_type_mapper.hh"
+#include "broker/internal/latency_stamps.hh"
 #include "broker/internal/logger.hh"
 #include "broker/internal/metric_exporter.hh"
+#include "broker/internal/metric_factory.hh"
 #include "broker/internal/prometheus.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/internal/web_socket.hh"
@@ -63,6 +68,9 @@
 #  include "Winsock2.h"
 #endif
 
+#undef BROKER_LOG_COMPONENT
+#define BROKER_LOG_COMPONENT endpoint
+
 using namespace std::literals;
 
 namespace atom = broker::internal::atom;
@@ -560,10 +568,11 @@ endpoint::endpoint(configuration config, endpoint_id id) : id_(id) {
   if (auto sp = caf::get_as<std::string>(cfg, "caf.scheduler.policy");
       sp && *sp == "testing") {
     core = sys.spawn<core_t>(id_, filter_type{}, clock_.get(), &adaptation,
-                             std::move(conn_ptr));
+                             std::move(conn_ptr), ctx_->stamps);
   } else {
     core = sys.spawn<core_t, caf::detached>(id_, filter_type{}, clock_.get(),
-                                            &adaptation, std::move(conn_ptr));
+                                            &adaptation, std::move(conn_ptr),
+                                            ctx_->stamps);
   }
   core_ = facade(core);
   // Spin up a Prometheus actor if configured or an exporter.
@@ -765,23 +774,37 @@ std::vector<peer_info> endpoint::peers() const {
 
 uint16_t endpoint::web_socket_listen(const std::string& address, uint16_t port,
                                      error* err, bool reuse_addr) {
-  auto on_connect = [sp = &ctx_->sys, id = id_, core = native(core_)](
-                      const caf::settings& hdr,
-                      internal::web_socket::connect_event_t& ev) {
-    auto& [pull, push] = ev;
-    auto user_agent = caf::get_or(hdr, "web-socket.fields.User-Agent", "null");
-    auto addr =
-      network_info{caf::get_or(hdr, "web-socket.remote-address", "unknown"),
-                   caf::get_or(hdr, "web-socket.remote-port", uint16_t{0}), 0s};
-    BROKER_INFO("new JSON client with address" << addr << "and user agent"
-                                               << user_agent);
-    using impl_t = internal::json_client_actor;
-    sp->spawn<impl_t>(id, core, addr, std::move(pull), std::move(push));
+  // Returns a callback that spawns an actor of the tagged type per client.
+  auto spawner = [this](auto type_tag) {
+    using impl_t = typename decltype(type_tag)::type;
+    return [sp = &ctx_->sys, id = id_, core = native(core_)](
+             const caf::settings& hdr,
+             internal::web_socket::connect_event_t& ev) {
+      auto& [pull, push] = ev;
+      auto user_agent = caf::get_or(hdr, "web-socket.fields.User-Agent",
+                                    "null");
+      auto addr =
+        network_info{caf::get_or(hdr, "web-socket.remote-address", "unknown"),
+                     caf::get_or(hdr, "web-socket.remote-port", uint16_t{0}),
+                     0s};
+      BROKER_INFO("new WebSocket client with address"
+                  << addr << "and user agent" << user_agent << "on path"
+                  << caf::get_or(hdr, "web-socket.path", ""));
+      sp->spawn<impl_t>(id, core, addr, std::move(pull), std::move(push));
+    };
   };
+  using internal::web_socket::frame_type;
+  using internal::web_socket::route;
+  internal::web_socket::route_map routes;
+  routes.emplace("/v1/messages/json",
+                 route{frame_type::text,
+                       spawner(detail::tag<internal::json_client_actor>{})});
+  routes.emplace("/v1/messages/binary",
+                 route{frame_type::binary,
+                       spawner(detail::tag<internal::binary_client_actor>{})});
   auto ssl_cfg = ctx_->cfg.openssl_options();
   auto res = internal::web_socket::launch(ctx_->sys, ssl_cfg, address, port,
-                                          reuse_addr, "/v1/messages/json",
-                                          std::move(on_connect));
+                                          reuse_addr, std::move(routes));
   if (res) {
     return *res;
   } else {
@@ -809,25 +832,42 @@ void endpoint::forward(std::vector<topic> ts) {
   caf::anon_send(native(core_), atom::subscribe_v, std::move(ts));
 }
 
+namespace {
+
+/// Stamps `msg` if it belongs to the sample for the publish latency.
+void stamp(internal::endpoint_context& ctx, const data_message& msg) {
+  if (ctx.stamps->sample())
+    ctx.stamps->set(msg, detail::cycle_clock::now());
+}
+
+} // namespace
+
 void endpoint::publish(topic t, data d) {
-  BROKER_INFO("publishing" << std::make_pair(t, d));
-  caf::anon_send(native(core_), atom::publish_v,
-                 make_data_message(std::move(t), std::move(d)));
+  BROKER_ALLOC_STAGE(publish);
+  BROKER_DEBUG("publishing" << BROKER_ARG(t) << BROKER_ARG(d));
+  auto msg = make_data_message(std::move(t), std::move(d));
+  stamp(*ctx_, msg);
+  caf::anon_send(native(core_), atom::publish_v, std::move(msg));
 }
 
 void endpoint::publish(const endpoint_info& dst, topic t, data d) {
-  BROKER_INFO("publishing" << std::make_pair(t, d) << "to" << dst.node);
-  caf::anon_send(native(core_), atom::publish_v,
-                 make_data_message(std::move(t), std::move(d)), dst);
+  BROKER_ALLOC_STAGE(publish);
+  BROKER_DEBUG("publishing" << BROKER_ARG(t) << BROKER_ARG(d) << "to"
+                             << dst.node);
+  auto msg = make_data_message(std::move(t), std::move(d));
+  stamp(*ctx_, msg);
+  caf::anon_send(native(core_), atom::publish_v, std::move(msg), dst);
 }
 
 void endpoint::publish(data_message x) {
-  BROKER_INFO("publishing" << x);
+  BROKER_ALLOC_STAGE(publish);
+  BROKER_DEBUG("publishing" << x);
+  stamp(*ctx_, x);
   caf::anon_send(native(core_), atom::publish_v, std::move(x));
 }
 
 void endpoint::publish(std::vector<data_message> xs) {
-  BROKER_INFO("publishing" << xs.size() << "messages");
+  BROKER_DEBUG("publishing" << xs.size() << "messages");
   for (auto& x : xs)
     publish(std::move(x));
 }
@@ -870,7 +910,10 @@ worker endpoint::do_subscribe(filter_type&& filter,
     ->make_observable()
     .from_resource(con_res)
     .subscribe(caf::flow::make_observer(
-      [sink](const data_message& msg) { sink->on_next(msg); },
+      [sink](const data_message& msg) {
+        BROKER_ALLOC_STAGE(deliver);
+        sink->on_next(msg);
+      },
       [sink](const caf::error& err) { sink->on_cleanup(facade(err)); },
       [sink] {
         error no_error;
@@ -905,6 +948,7 @@ public:
 
   template <class Step, class... Steps>
   void pull(size_t n, Step& step, Steps&... steps) {
+    BROKER_ALLOC_STAGE(publish);
     // Stop when already at the end.
     if (driver_->at_end()) {
       step.on_complete(steps...);
@@ -1116,7 +1160,12 @@ namespace broker::internal {
 
 endpoint_context::endpoint_context(configuration&& src)
   : cfg(std::move(src)), sys(nat_cfg(cfg)) {
-  // nop
+  metric_factory factory{sys};
+  auto interval = caf::get_or(sys.config(),
+                              "broker.metrics.latency-sample-interval",
+                              defaults::metrics::latency_sample_interval);
+  stamps = std::make_shared<latency_stamps>(
+    interval, factory.core.latency_stamp_collisions_instance());
 }
 
 caf::actor_system& endpoint_access::sys() {
@@ -1131,4 +1180,8 @@ std::shared_ptr<endpoint_context> endpoint_access::ctx() {
   return ep->ctx_;
 }
 
+const latency_stamps_ptr& endpoint_access::stamps() {
+  return ep->ctx_->stamps;
+}
+
 } // namespace broker::internal
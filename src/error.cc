@@ -62,6 +62,7 @@ constexpr std::string_view ec_names[] = {
   "wrong_magic_number",
   "redundant_connection",
   "logic_error",
+  "backpressure_overflow",
 };
 
 template <class T, size_t N>
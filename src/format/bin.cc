@@ -0,0 +1,444 @@
+#include "broker/format/bin.hh"
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace broker::format::bin::v1 {
+
+namespace {
+
+// -- encoding utilities -------------------------------------------------------
+
+void encode_byte(uint8_t value, std::vector<std::byte>& buf) {
+  buf.push_back(static_cast<std::byte>(value));
+}
+
+// Writes integers in network byte order.
+template <class T>
+void encode_int(T value, std::vector<std::byte>& buf) {
+  static_assert(std::is_integral_v<T>);
+  using unsigned_type = std::make_unsigned_t<T>;
+  auto x = static_cast<unsigned_type>(value);
+  for (size_t i = sizeof(T); i > 0; --i)
+    buf.push_back(static_cast<std::byte>((x >> ((i - 1) * 8)) & 0xFF));
+}
+
+void encode_bytes(const uint8_t* first, size_t num_bytes,
+                  std::vector<std::byte>& buf) {
+  auto ptr = reinterpret_cast<const std::byte*>(first);
+  buf.insert(buf.end(), ptr, ptr + num_bytes);
+}
+
+// -- decoding utilities -------------------------------------------------------
+
+const std::byte* decode_byte(const std::byte* first, const std::byte* last,
+                             uint8_t& result) {
+  if (first == nullptr || first == last)
+    return nullptr;
+  result = static_cast<uint8_t>(*first);
+  return first + 1;
+}
+
+template <class T>
+const std::byte* decode_int(const std::byte* first, const std::byte* last,
+                            T& result) {
+  static_assert(std::is_integral_v<T>);
+  using unsigned_type = std::make_unsigned_t<T>;
+  if (first == nullptr || static_cast<size_t>(last - first) < sizeof(T))
+    return nullptr;
+  unsigned_type x = 0;
+  for (size_t i = 0; i < sizeof(T); ++i)
+    x = static_cast<unsigned_type>((x << 8) | static_cast<uint8_t>(first[i]));
+  result = static_cast<T>(x);
+  return first + sizeof(T);
+}
+
+// -- encoding and decoding of data values -------------------------------------
+
+const std::byte* decode_data(const std::byte* first, const std::byte* last,
+                             data& result, size_t depth);
+
+struct encoder {
+  std::vector<std::byte>& buf;
+
+  bool operator()(none) {
+    // Nothing to write.
+    return true;
+  }
+
+  bool operator()(boolean x) {
+    encode_byte(x ? 1 : 0, buf);
+    return true;
+  }
+
+  bool operator()(count x) {
+    encode_int(x, buf);
+    return true;
+  }
+
+  bool operator()(integer x) {
+    encode_int(x, buf);
+    return true;
+  }
+
+  bool operator()(real x) {
+    // Broker serializes floating point numbers in IEEE 754 format.
+    static_assert(sizeof(real) == sizeof(uint64_t));
+    uint64_t bits = 0;
+    memcpy(&bits, &x, sizeof(real));
+    encode_int(bits, buf);
+    return true;
+  }
+
+  bool operator()(const std::string& x) {
+    return encode(std::string_view{x}, buf);
+  }
+
+  bool operator()(const address& x) {
+    encode_bytes(x.bytes().data(), address::num_bytes, buf);
+    return true;
+  }
+
+  bool operator()(const subnet& x) {
+    // Subnets internally store the prefix length relative to the IPv6 address.
+    (*this)(x.network());
+    auto len = x.length();
+    encode_byte(x.network().is_v4() ? len + 96 : len, buf);
+    return true;
+  }
+
+  bool operator()(const port& x) {
+    encode_int(x.number(), buf);
+    encode_byte(static_cast<uint8_t>(x.type()), buf);
+    return true;
+  }
+
+  bool operator()(timestamp x) {
+    encode_int(x.time_since_epoch().count(), buf);
+    return true;
+  }
+
+  bool operator()(timespan x) {
+    encode_int(x.count(), buf);
+    return true;
+  }
+
+  bool operator()(const enum_value& x) {
+    return encode(std::string_view{x.name}, buf);
+  }
+
+  bool operator()(const broker::set& xs) {
+    if (!encode_varbyte(xs.size(), buf))
+      return false;
+    for (const auto& x : xs)
+      if (!encode(x, buf))
+        return false;
+    return true;
+  }
+
+  bool operator()(const table& xs) {
+    if (!encode_varbyte(xs.size(), buf))
+      return false;
+    for (const auto& [key, val] : xs)
+      if (!encode(key, buf) || !encode(val, buf))
+        return false;
+    return true;
+  }
+
+  bool operator()(const vector& xs) {
+    if (!encode_varbyte(xs.size(), buf))
+      return false;
+    for (const auto& x : xs)
+      if (!encode(x, buf))
+        return false;
+    return true;
+  }
+};
+
+template <class T>
+const std::byte* decode_value(const std::byte* first, const std::byte* last,
+                              data& result, [[maybe_unused]] size_t depth) {
+  if constexpr (std::is_same_v<T, none>) {
+    result = nil;
+    return first;
+  } else if constexpr (std::is_same_v<T, boolean>) {
+    uint8_t x = 0;
+    if (first = decode_byte(first, last, x); first == nullptr || x > 1)
+      return nullptr;
+    result = x == 1;
+    return first;
+  } else if constexpr (std::is_same_v<T, count>
+                       || std::is_same_v<T, integer>) {
+    T x = 0;
+    first = decode_int(first, last, x);
+    result = x;
+    return first;
+  } else if constexpr (std::is_same_v<T, real>) {
+    uint64_t bits = 0;
+    first = decode_int(first, last, bits);
+    real x = 0;
+    memcpy(&x, &bits, sizeof(real));
+    result = x;
+    return first;
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    std::string x;
+    first = decode(first, last, x);
+    result = std::move(x);
+    return first;
+  } else if constexpr (std::is_same_v<T, address>) {
+    if (first == nullptr
+        || static_cast<size_t>(last - first) < address::num_bytes)
+      return nullptr;
+    address x;
+    memcpy(x.bytes().data(), first, address::num_bytes);
+    result = x;
+    return first + address::num_bytes;
+  } else if constexpr (std::is_same_v<T, subnet>) {
+    data net;
+    uint8_t len = 0;
+    first = decode_value<address>(first, last, net, depth);
+    if (first = decode_byte(first, last, len); first == nullptr)
+      return nullptr;
+    auto& addr = get<address>(net);
+    if (addr.is_v4()) {
+      if (len < 96)
+        return nullptr;
+      len -= 96;
+    }
+    result = subnet{addr, len};
+    return first;
+  } else if constexpr (std::is_same_v<T, port>) {
+    uint16_t num = 0;
+    uint8_t proto = 0;
+    first = decode_int(first, last, num);
+    first = decode_byte(first, last, proto);
+    if (first == nullptr || proto > static_cast<uint8_t>(port::protocol::icmp))
+      return nullptr;
+    result = port{num, static_cast<port::protocol>(proto)};
+    return first;
+  } else if constexpr (std::is_same_v<T, timestamp>) {
+    int64_t x = 0;
+    first = decode_int(first, last, x);
+    result = timestamp{timespan{x}};
+    return first;
+  } else if constexpr (std::is_same_v<T, timespan>) {
+    int64_t x = 0;
+    first = decode_int(first, last, x);
+    result = timespan{x};
+    return first;
+  } else if constexpr (std::is_same_v<T, enum_value>) {
+    std::string x;
+    first = decode(first, last, x);
+    result = enum_value{std::move(x)};
+    return first;
+  } else {
+    // Container types.
+    size_t size = 0;
+    if (first = decode_varbyte(first, last, size); first == nullptr)
+      return nullptr;
+    T xs;
+    for (size_t i = 0; i < size; ++i) {
+      data x;
+      if (first = decode_data(first, last, x, depth + 1); first == nullptr)
+        return nullptr;
+      if constexpr (std::is_same_v<T, table>) {
+        data y;
+        if (first = decode_data(first, last, y, depth + 1); first == nullptr)
+          return nullptr;
+        if (!xs.emplace(std::move(x), std::move(y)).second)
+          return nullptr;
+      } else if constexpr (std::is_same_v<T, broker::set>) {
+        if (!xs.emplace(std::move(x)).second)
+          return nullptr;
+      } else {
+        static_assert(std::is_same_v<T, vector>);
+        xs.emplace_back(std::move(x));
+      }
+    }
+    result = std::move(xs);
+    return first;
+  }
+}
+
+template <size_t... Is>
+const std::byte* decode_dispatch(uint8_t index, const std::byte* first,
+                                 const std::byte* last, data& result,
+                                 size_t depth, std::index_sequence<Is...>) {
+  using fn_t = const std::byte* (*) (const std::byte*, const std::byte*, data&,
+                                     size_t);
+  static constexpr fn_t tbl[] = {
+    decode_value<std::variant_alternative_t<Is, data_variant>>...};
+  if (index >= sizeof...(Is))
+    return nullptr;
+  return tbl[index](first, last, result, depth);
+}
+
+// Decodes a data value, rejecting input that nests containers deeper than
+// `max_nesting_depth` to protect the stack against malicious input.
+const std::byte* decode_data(const std::byte* first, const std::byte* last,
+                             data& result, size_t depth) {
+  if (depth > max_nesting_depth)
+    return nullptr;
+  uint8_t index = 0;
+  if (first = decode_byte(first, last, index); first == nullptr)
+    return nullptr;
+  using indexes = std::make_index_sequence<std::variant_size_v<data_variant>>;
+  return decode_dispatch(index, first, last, result, depth, indexes{});
+}
+
+} // namespace
+
+// -- encoding -----------------------------------------------------------------
+
+bool encode_varbyte(size_t value, std::vector<std::byte>& buf) {
+  if (value > std::numeric_limits<uint32_t>::max())
+    return false;
+  auto x = static_cast<uint32_t>(value);
+  while (x > 0x7f) {
+    encode_byte(static_cast<uint8_t>((x & 0x7f) | 0x80), buf);
+    x >>= 7;
+  }
+  encode_byte(static_cast<uint8_t>(x & 0x7f), buf);
+  return true;
+}
+
+bool encode(std::string_view str, std::vector<std::byte>& buf) {
+  if (!encode_varbyte(str.size(), buf))
+    return false;
+  auto first = reinterpret_cast<const std::byte*>(str.data());
+  buf.insert(buf.end(), first, first + str.size());
+  return true;
+}
+
+bool encode(const data& x, std::vector<std::byte>& buf) {
+  encode_byte(static_cast<uint8_t>(x.get_type()), buf);
+  return std::visit(encoder{buf}, x.get_data());
+}
+
+bool encode(const filter_type& x, std::vector<std::byte>& buf) {
+  if (!encode_varbyte(x.size(), buf))
+    return false;
+  for (const auto& t : x)
+    if (!encode(std::string_view{t.string()}, buf))
+      return false;
+  return true;
+}
+
+bool encode_data_message(const topic& t, const data& d,
+                         std::vector<std::byte>& buf) {
+  encode_byte(static_cast<uint8_t>(frame_tag::data_message), buf);
+  return encode(std::string_view{t.string()}, buf) && encode(d, buf);
+}
+
+bool encode_ack(const endpoint_id& id, std::string_view version,
+                std::vector<std::byte>& buf) {
+  encode_byte(static_cast<uint8_t>(frame_tag::ack), buf);
+  buf.insert(buf.end(), id.bytes().begin(), id.bytes().end());
+  return encode(version, buf);
+}
+
+bool encode_error(std::string_view code, std::string_view context,
+                  std::vector<std::byte>& buf) {
+  encode_byte(static_cast<uint8_t>(frame_tag::error), buf);
+  return encode(code, buf) && encode(context, buf);
+}
+
+// -- decoding -----------------------------------------------------------------
+
+const std::byte* decode_varbyte(const std::byte* first, const std::byte* last,
+                                size_t& result) {
+  // Broker limits the varbyte encoding to 32 bit, i.e., at most 5 bytes.
+  uint32_t x = 0;
+  uint8_t low7 = 0;
+  int shift = 0;
+  do {
+    if (first == nullptr || first == last || shift > 28)
+      return nullptr;
+    low7 = static_cast<uint8_t>(*first++);
+    // The fifth byte may only contribute the upper 4 bits and must not have
+    // the continuation bit set.
+    if (shift == 28 && low7 > 0x0f)
+      return nullptr;
+    x |= static_cast<uint32_t>(low7 & 0x7f) << shift;
+    shift += 7;
+  } while (low7 & 0x80);
+  result = x;
+  return first;
+}
+
+const std::byte* decode(const std::byte* first, const std::byte* last,
+                        std::string& result) {
+  size_t size = 0;
+  if (first = decode_varbyte(first, last, size); first == nullptr)
+    return nullptr;
+  if (static_cast<size_t>(last - first) < size)
+    return nullptr;
+  result.assign(reinterpret_cast<const char*>(first), size);
+  return first + size;
+}
+
+const std::byte* decode(const std::byte* first, const std::byte* last,
+                        data& result) {
+  return decode_data(first, last, result, 0);
+}
+
+const std::byte* decode(const std::byte* first, const std::byte* last,
+                        filter_type& result) {
+  size_t size = 0;
+  if (first = decode_varbyte(first, last, size); first == nullptr)
+    return nullptr;
+  result.clear();
+  for (size_t i = 0; i < size; ++i) {
+    std::string str;
+    if (first = decode(first, last, str); first == nullptr)
+      return nullptr;
+    result.emplace_back(std::move(str));
+  }
+  return first;
+}
+
+std::optional<frame_tag> tag_of(const std::byte* first, const std::byte* last) {
+  uint8_t tag = 0;
+  if (decode_byte(first, last, tag) == nullptr || tag == 0
+      || tag > static_cast<uint8_t>(frame_tag::error))
+    return std::nullopt;
+  return static_cast<frame_tag>(tag);
+}
+
+bool decode_data_message(const std::byte* first, const std::byte* last,
+                         topic& t, data& d) {
+  if (tag_of(first, last) != frame_tag::data_message)
+    return false;
+  std::string str;
+  if (first = decode(first + 1, last, str); first == nullptr)
+    return false;
+  if (first = decode(first, last, d); first != last)
+    return false;
+  t = topic{std::move(str)};
+  return true;
+}
+
+bool decode_ack(const std::byte* first, const std::byte* last, endpoint_id& id,
+                std::string& version) {
+  if (tag_of(first, last) != frame_tag::ack)
+    return false;
+  ++first;
+  if (static_cast<size_t>(last - first) < endpoint_id::num_bytes)
+    return false;
+  endpoint_id::array_type bytes;
+  memcpy(bytes.data(), first, endpoint_id::num_bytes);
+  id = endpoint_id{bytes};
+  return decode(first + endpoint_id::num_bytes, last, version) == last;
+}
+
+bool decode_error(const std::byte* first, const std::byte* last,
+                  std::string& code, std::string& context) {
+  if (tag_of(first, last) != frame_tag::error)
+    return false;
+  if (first = decode(first + 1, last, code); first == nullptr)
+    return false;
+  return decode(first, last, context) == last;
+}
+
+} // namespace broker::format::bin::v1
@@ -0,0 +1,904 @@
+#include "broker/format/json.hh"
+
+#include "broker/config.hh"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <type_traits>
+
+#if defined(BROKER_USE_SSE2)
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
+#  define BROKER_USE_NEON
+#endif
+
+namespace broker::format::json::v1 {
+
+namespace {
+
+// -- constants ----------------------------------------------------------------
+
+/// Type names for the `@data-type` field, indexed by `data::type`.
+constexpr std::string_view type_names[] = {
+  "none",     "boolean",    "count", "integer", "real",
+  "string",   "address",    "subnet", "port",   "timestamp",
+  "timespan", "enum-value", "set",   "table",   "vector",
+};
+
+static_assert(std::size(type_names) == std::variant_size_v<data_variant>);
+
+/// Restricts the nesting depth of containers while decoding.
+constexpr int max_nesting_depth = 128;
+
+// -- scanning -----------------------------------------------------------------
+
+/// Checks whether `ch` must be escaped inside a JSON string.
+bool needs_escape(char ch) noexcept {
+  auto uch = static_cast<unsigned char>(ch);
+  return uch < 0x20 || ch == '"' || ch == '\\';
+}
+
+/// Returns a pointer to the first character in `[first, last)` that requires
+/// escaping in JSON, i.e., a quote, a backslash or a control character.
+const char* find_escape(const char* first, const char* last) noexcept {
+#if defined(BROKER_USE_SSE2)
+  auto quote = _mm_set1_epi8('"');
+  auto backslash = _mm_set1_epi8('\\');
+  auto max_ctrl = _mm_set1_epi8(0x1f);
+  while (last - first >= 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    // A byte is a control character if min(byte, 0x1f) == byte (unsigned).
+    auto ctrl = _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_ctrl), chunk);
+    auto hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                          _mm_cmpeq_epi8(chunk, backslash)),
+                             ctrl);
+    if (auto mask = _mm_movemask_epi8(hits); mask != 0)
+      return first + __builtin_ctz(static_cast<unsigned>(mask));
+    first += 16;
+  }
+#elif defined(BROKER_USE_NEON)
+  auto quote = vdupq_n_u8('"');
+  auto backslash = vdupq_n_u8('\\');
+  auto min_printable = vdupq_n_u8(0x20);
+  while (last - first >= 16) {
+    auto chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(first));
+    auto hits = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote),
+                                  vceqq_u8(chunk, backslash)),
+                         vcltq_u8(chunk, min_printable));
+    // Let the scalar loop below find the exact position in this chunk.
+    if (vmaxvq_u8(hits) != 0)
+      break;
+    first += 16;
+  }
+#endif
+  for (; first != last; ++first)
+    if (needs_escape(*first))
+      return first;
+  return last;
+}
+
+bool is_ws(char ch) noexcept {
+  return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+// -- encoding utilities -------------------------------------------------------
+
+template <class T>
+void encode_int(T value, std::string& out) {
+  char buf[24];
+  auto res = std::to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, res.ptr);
+}
+
+void encode_real(real value, std::string& out) {
+  // Same format as CAF: std::to_string without trailing zeros. Note that this
+  // format has a fixed precision of six digits after the decimal point.
+  auto str = std::to_string(value);
+  if (str.find('.') != std::string::npos) {
+    while (str.back() == '0')
+      str.pop_back();
+    if (str.back() == '.')
+      str.pop_back();
+  }
+  out += str;
+}
+
+void encode_timespan(timespan value, std::string& out) {
+  // Same format as CAF: uses the largest unit that has a value of at least 1
+  // and falls back to integer nanoseconds, e.g., for negative values.
+  namespace sc = std::chrono;
+  auto try_encode = [&out](auto x, std::string_view suffix) {
+    if (x.count() < 1)
+      return false;
+    encode_real(x.count(), out);
+    out += suffix;
+    return true;
+  };
+  out += '"';
+  if (value.count() == 0) {
+    out += "0s";
+  } else if (!try_encode(sc::duration<double, std::ratio<3600>>{value}, "h")
+             && !try_encode(sc::duration<double, std::ratio<60>>{value}, "min")
+             && !try_encode(sc::duration<double>{value}, "s")
+             && !try_encode(sc::duration<double, std::milli>{value}, "ms")
+             && !try_encode(sc::duration<double, std::micro>{value}, "us")) {
+    encode_int(value.count(), out);
+    out += "ns";
+  }
+  out += '"';
+}
+
+void encode_timestamp(timestamp value, std::string& out) {
+  // Same format as CAF: ISO 8601 in local time with millisecond resolution.
+  namespace sc = std::chrono;
+  auto since_epoch = value.time_since_epoch();
+  auto secs = sc::floor<sc::seconds>(since_epoch);
+  auto msecs = sc::duration_cast<sc::milliseconds>(since_epoch - secs).count();
+  auto tt = static_cast<time_t>(secs.count());
+  tm tm_buf;
+#ifdef _WIN32
+  localtime_s(&tm_buf, &tt);
+#else
+  localtime_r(&tt, &tm_buf);
+#endif
+  char buf[40];
+  auto len = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm_buf);
+  len += static_cast<size_t>(snprintf(buf + len, sizeof(buf) - len, ".%03d",
+                                      static_cast<int>(msecs)));
+  out += '"';
+  out.append(buf, len);
+  out += '"';
+}
+
+struct encoder {
+  std::string& out;
+
+  void operator()(none) {
+    out += "{}";
+  }
+
+  void operator()(boolean x) {
+    out += x ? "true" : "false";
+  }
+
+  void operator()(count x) {
+    encode_int(x, out);
+  }
+
+  void operator()(integer x) {
+    encode_int(x, out);
+  }
+
+  void operator()(real x) {
+    encode_real(x, out);
+  }
+
+  void operator()(const std::string& x) {
+    encode(std::string_view{x}, out);
+  }
+
+  template <class T>
+  std::enable_if_t<std::is_same_v<T, address> || std::is_same_v<T, subnet>
+                   || std::is_same_v<T, port>>
+  operator()(const T& x) {
+    std::string str;
+    convert(x, str);
+    encode(std::string_view{str}, out);
+  }
+
+  void operator()(timestamp x) {
+    encode_timestamp(x, out);
+  }
+
+  void operator()(timespan x) {
+    encode_timespan(x, out);
+  }
+
+  void operator()(const enum_value& x) {
+    encode(std::string_view{x.name}, out);
+  }
+
+  void operator()(const table& xs) {
+    out += '[';
+    auto first = true;
+    for (const auto& [key, val] : xs) {
+      if (!first)
+        out += ", ";
+      first = false;
+      out += "{\"key\": ";
+      encode(key, out);
+      out += ", \"value\": ";
+      encode(val, out);
+      out += '}';
+    }
+    out += ']';
+  }
+
+  template <class T>
+  std::enable_if_t<std::is_same_v<T, broker::set> || std::is_same_v<T, vector>>
+  operator()(const T& xs) {
+    out += '[';
+    auto first = true;
+    for (const auto& x : xs) {
+      if (!first)
+        out += ", ";
+      first = false;
+      encode(x, out);
+    }
+    out += ']';
+  }
+};
+
+// -- decoding utilities -------------------------------------------------------
+
+void append_utf8(uint32_t cp, std::string& out) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xc0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xe0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (cp & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (cp & 0x3f));
+  }
+}
+
+/// A minimal pull parser that operates directly on the input characters.
+struct reader {
+  const char* pos;
+  const char* end;
+
+  /// Scratch space for reading object keys.
+  std::string key;
+
+  reader(const char* first, const char* last) : pos(first), end(last) {
+    // nop
+  }
+
+  void skip_ws() noexcept {
+    while (pos != end && is_ws(*pos))
+      ++pos;
+  }
+
+  bool at_end() noexcept {
+    skip_ws();
+    return pos == end;
+  }
+
+  bool peek(char ch) noexcept {
+    skip_ws();
+    return pos != end && *pos == ch;
+  }
+
+  bool consume(char ch) noexcept {
+    if (peek(ch)) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool consume_literal(std::string_view lit) noexcept {
+    skip_ws();
+    if (static_cast<size_t>(end - pos) < lit.size()
+        || std::string_view{pos, lit.size()} != lit)
+      return false;
+    pos += lit.size();
+    return true;
+  }
+
+  bool read_hex4(uint32_t& result) noexcept {
+    if (end - pos < 4)
+      return false;
+    result = 0;
+    for (int i = 0; i < 4; ++i) {
+      auto ch = *pos++;
+      result <<= 4;
+      if (ch >= '0' && ch <= '9')
+        result |= static_cast<uint32_t>(ch - '0');
+      else if (ch >= 'a' && ch <= 'f')
+        result |= static_cast<uint32_t>(ch - 'a' + 10);
+      else if (ch >= 'A' && ch <= 'F')
+        result |= static_cast<uint32_t>(ch - 'A' + 10);
+      else
+        return false;
+    }
+    return true;
+  }
+
+  bool read_escape(std::string& out) {
+    if (pos == end)
+      return false;
+    switch (*pos++) {
+      case '"':
+        out += '"';
+        return true;
+      case '\\':
+        out += '\\';
+        return true;
+      case '/':
+        out += '/';
+        return true;
+      case 'b':
+        out += '\b';
+        return true;
+      case 'f':
+        out += '\f';
+        return true;
+      case 'n':
+        out += '\n';
+        return true;
+      case 'r':
+        out += '\r';
+        return true;
+      case 't':
+        out += '\t';
+        return true;
+      case 'u': {
+        uint32_t cp = 0;
+        if (!read_hex4(cp))
+          return false;
+        if (cp >= 0xd800 && cp <= 0xdbff) {
+          // High surrogate: must be followed by a low surrogate.
+          uint32_t low = 0;
+          if (end - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+            return false;
+          pos += 2;
+          if (!read_hex4(low) || low < 0xdc00 || low > 0xdfff)
+            return false;
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+        } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+          return false;
+        }
+        append_utf8(cp, out);
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+  bool read_string(std::string& out) {
+    if (!consume('"'))
+      return false;
+    for (;;) {
+      auto i = find_escape(pos, end);
+      out.append(pos, i);
+      pos = i;
+      if (pos == end)
+        return false;
+      auto ch = *pos++;
+      if (ch == '"')
+        return true;
+      if (ch != '\\' || !read_escape(out))
+        return false; // Unescaped control character or invalid escape.
+    }
+  }
+
+  bool skip_string() {
+    if (!consume('"'))
+      return false;
+    for (;;) {
+      pos = find_escape(pos, end);
+      if (pos == end)
+        return false;
+      auto ch = *pos++;
+      if (ch == '"')
+        return true;
+      if (ch != '\\' || pos == end)
+        return false;
+      ++pos; // Skip the escaped character. We do not validate \u sequences.
+    }
+  }
+
+  /// Returns the characters of a JSON number without validating them.
+  std::string_view number_token() noexcept {
+    skip_ws();
+    auto first = pos;
+    while (pos != end
+           && ((*pos >= '0' && *pos <= '9') || *pos == '-' || *pos == '+'
+               || *pos == '.' || *pos == 'e' || *pos == 'E'))
+      ++pos;
+    return {first, static_cast<size_t>(pos - first)};
+  }
+
+  template <class T>
+  bool read_int(T& result) noexcept {
+    auto str = number_token();
+    if (str.empty())
+      return false;
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(),
+                                     result);
+    return ec == std::errc{} && ptr == str.data() + str.size();
+  }
+
+  bool read_real(real& result) {
+    // Note: the fixed notation of large numbers such as 1e300 has more than
+    // 300 digits.
+    auto str = number_token();
+    if (str.empty() || str.size() > 512)
+      return false;
+    char buf[513];
+    memcpy(buf, str.data(), str.size());
+    buf[str.size()] = '\0';
+    char* ptr = nullptr;
+    result = strtod(buf, &ptr);
+    return ptr == buf + str.size();
+  }
+
+  bool skip_value(int depth) {
+    if (depth > max_nesting_depth)
+      return false;
+    skip_ws();
+    if (pos == end)
+      return false;
+    switch (*pos) {
+      case '"':
+        return skip_string();
+      case '{':
+        return read_object([this, depth](const std::string&) {
+          return skip_value(depth + 1);
+        });
+      case '[':
+        return read_array([this, depth] { return skip_value(depth + 1); });
+      case 't':
+        return consume_literal("true");
+      case 'f':
+        return consume_literal("false");
+      case 'n':
+        return consume_literal("null");
+      default:
+        return !number_token().empty();
+    }
+  }
+
+  /// Reads a JSON object and calls `f` for each key. The callback must consume
+  /// the value for the key.
+  template <class F>
+  bool read_object(F f) {
+    if (!consume('{'))
+      return false;
+    if (consume('}'))
+      return true;
+    do {
+      key.clear();
+      if (!read_string(key) || !consume(':'))
+        return false;
+      // Note: `f` may overwrite `key` when reading nested objects.
+      if (!f(key))
+        return false;
+    } while (consume(','));
+    return consume('}');
+  }
+
+  /// Reads a JSON array and calls `f` for each element.
+  template <class F>
+  bool read_array(F f) {
+    if (!consume('['))
+      return false;
+    if (consume(']'))
+      return true;
+    do {
+      if (!f())
+        return false;
+    } while (consume(','));
+    return consume(']');
+  }
+
+  bool read_timespan(timespan& result) {
+    // Accepts integers as well as fractional values such as "1.5s".
+    std::string str;
+    if (!read_string(str))
+      return false;
+    auto first = str.data();
+    auto last = first + str.size();
+    auto is_num = [](char ch) {
+      return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.'
+             || ch == 'e' || ch == 'E';
+    };
+    auto num_end = std::find_if_not(first, last, is_num);
+    auto suffix = std::string_view{num_end,
+                                   static_cast<size_t>(last - num_end)};
+    int64_t factor = 0;
+    if (suffix == "ns")
+      factor = 1;
+    else if (suffix == "us")
+      factor = 1'000;
+    else if (suffix == "ms")
+      factor = 1'000'000;
+    else if (suffix == "s")
+      factor = 1'000'000'000;
+    else if (suffix == "min")
+      factor = INT64_C(60'000'000'000);
+    else if (suffix == "h")
+      factor = INT64_C(3'600'000'000'000);
+    else if (suffix == "d")
+      factor = INT64_C(86'400'000'000'000);
+    else
+      return false;
+    int64_t value = 0;
+    if (auto [ptr, ec] = std::from_chars(first, num_end, value);
+        ec == std::errc{} && ptr == num_end) {
+      result = timespan{value * factor};
+      return true;
+    }
+    // Not an integer: parse as floating point number and round to the closest
+    // nanosecond.
+    std::string num{first, num_end};
+    char* ptr = nullptr;
+    auto fval = strtod(num.c_str(), &ptr);
+    if (num.empty() || ptr != num.c_str() + num.size())
+      return false;
+    auto ns = std::round(fval * static_cast<double>(factor));
+    if (!(ns >= -9.2e18 && ns <= 9.2e18))
+      return false;
+    result = timespan{static_cast<int64_t>(ns)};
+    return true;
+  }
+
+  bool read_timestamp(timestamp& result) {
+    // Parses the format `YYYY-MM-DDThh:mm:ss[.fraction]` in local time.
+    std::string str;
+    if (!read_string(str))
+      return false;
+    tm tm_buf;
+    memset(&tm_buf, 0, sizeof(tm_buf));
+    int consumed = 0;
+    if (sscanf(str.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%n", &tm_buf.tm_year,
+               &tm_buf.tm_mon, &tm_buf.tm_mday, &tm_buf.tm_hour,
+               &tm_buf.tm_min, &tm_buf.tm_sec, &consumed)
+          != 6
+        || consumed != 19)
+      return false;
+    tm_buf.tm_year -= 1900;
+    tm_buf.tm_mon -= 1;
+    tm_buf.tm_isdst = -1;
+    int64_t ns = 0;
+    if (str.size() > 19) {
+      if (str[19] != '.' || str.size() == 20 || str.size() > 29)
+        return false;
+      int64_t scale = 100'000'000;
+      for (size_t i = 20; i < str.size(); ++i) {
+        if (str[i] < '0' || str[i] > '9')
+          return false;
+        ns += (str[i] - '0') * scale;
+        scale /= 10;
+      }
+    }
+    auto secs = mktime(&tm_buf);
+    if (secs == -1)
+      return false;
+    result = timestamp{std::chrono::seconds{secs} + timespan{ns}};
+    return true;
+  }
+
+  template <class T>
+  bool read_converted(data& result) {
+    std::string str;
+    T value;
+    if (!read_string(str) || !convert(str, value))
+      return false;
+    result = std::move(value);
+    return true;
+  }
+
+  /// Reads the content of the `data` field for a value of the given type.
+  bool read_value(data::type type, data& result, int depth) {
+    switch (type) {
+      case data::type::none:
+        result = nil;
+        return consume('{') && consume('}');
+      case data::type::boolean:
+        if (consume_literal("true")) {
+          result = true;
+          return true;
+        } else if (consume_literal("false")) {
+          result = false;
+          return true;
+        }
+        return false;
+      case data::type::count: {
+        count value = 0;
+        if (!read_int(value))
+          return false;
+        result = value;
+        return true;
+      }
+      case data::type::integer: {
+        integer value = 0;
+        if (!read_int(value))
+          return false;
+        result = value;
+        return true;
+      }
+      case data::type::real: {
+        real value = 0;
+        if (!read_real(value))
+          return false;
+        result = value;
+        return true;
+      }
+      case data::type::string: {
+        std::string value;
+        if (!read_string(value))
+          return false;
+        result = std::move(value);
+        return true;
+      }
+      case data::type::address:
+        return read_converted<address>(result);
+      case data::type::subnet:
+        return read_converted<subnet>(result);
+      case data::type::port:
+        return read_converted<port>(result);
+      case data::type::timestamp: {
+        timestamp value;
+        if (!read_timestamp(value))
+          return false;
+        result = value;
+        return true;
+      }
+      case data::type::timespan: {
+        timespan value;
+        if (!read_timespan(value))
+          return false;
+        result = value;
+        return true;
+      }
+      case data::type::enum_value: {
+        std::string value;
+        if (!read_string(value))
+          return false;
+        result = enum_value{std::move(value)};
+        return true;
+      }
+      case data::type::set: {
+        broker::set xs;
+        auto ok = read_array([this, &xs, depth] {
+          data x;
+          return read_data(x, depth + 1) && xs.emplace(std::move(x)).second;
+        });
+        if (!ok)
+          return false;
+        result = std::move(xs);
+        return true;
+      }
+      case data::type::table: {
+        table xs;
+        auto ok = read_array([this, &xs, depth] {
+          data k;
+          data v;
+          bool has_key = false;
+          bool has_val = false;
+          auto ok = read_object([&](const std::string& field) {
+            if (field == "key")
+              return !std::exchange(has_key, true) && read_data(k, depth + 1);
+            if (field == "value")
+              return !std::exchange(has_val, true) && read_data(v, depth + 1);
+            return skip_value(depth + 1);
+          });
+          return ok && has_key && has_val
+                 && xs.emplace(std::move(k), std::move(v)).second;
+        });
+        if (!ok)
+          return false;
+        result = std::move(xs);
+        return true;
+      }
+      case data::type::vector: {
+        vector xs;
+        auto ok = read_array([this, &xs, depth] {
+          xs.emplace_back();
+          return read_data(xs.back(), depth + 1);
+        });
+        if (!ok)
+          return false;
+        result = std::move(xs);
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+  static bool type_from_name(std::string_view name, data::type& result) {
+    for (size_t index = 0; index < std::size(type_names); ++index) {
+      if (type_names[index] == name) {
+        result = static_cast<data::type>(index);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Reads a JSON object with the keys `@data-type` and `data`. Usually, the
+  /// type precedes the data. Otherwise, we remember the position of the data
+  /// and come back to it after reading the type.
+  bool read_data(data& result, int depth) {
+    if (depth > max_nesting_depth)
+      return false;
+    data::type type = data::type::none;
+    bool has_type = false;
+    bool has_data = false;
+    const char* deferred = nullptr;
+    auto ok = read_object([&](const std::string& field) {
+      if (field == "@data-type") {
+        std::string name;
+        return !std::exchange(has_type, true) && read_string(name)
+               && type_from_name(name, type);
+      } else if (field == "data") {
+        if (std::exchange(has_data, true))
+          return false;
+        if (has_type)
+          return read_value(type, result, depth);
+        skip_ws();
+        deferred = pos;
+        return skip_value(depth + 1);
+      } else {
+        return skip_value(depth + 1);
+      }
+    });
+    if (!ok || !has_type || !has_data)
+      return false;
+    if (deferred != nullptr) {
+      auto sub = reader{deferred, end};
+      return sub.read_value(type, result, depth);
+    }
+    return true;
+  }
+
+  /// Reads a data message, i.e., a JSON object with the keys `topic`,
+  /// `@data-type` and `data`. Also accepts the optional key `type`.
+  bool read_data_message(topic& t, data& d) {
+    // The layout for data messages is the same as for data, but with the
+    // additional keys `type` and `topic`. We collect the topic and pass the
+    // remaining fields to the same logic as `read_data`.
+    data::type type = data::type::none;
+    bool has_topic = false;
+    bool has_type = false;
+    bool has_data = false;
+    const char* deferred = nullptr;
+    std::string topic_str;
+    auto ok = read_object([&](const std::string& field) {
+      if (field == "topic") {
+        return !std::exchange(has_topic, true) && read_string(topic_str);
+      } else if (field == "type") {
+        std::string name;
+        return read_string(name) && name == "data-message";
+      } else if (field == "@data-type") {
+        std::string name;
+        return !std::exchange(has_type, true) && read_string(name)
+               && type_from_name(name, type);
+      } else if (field == "data") {
+        if (std::exchange(has_data, true))
+          return false;
+        if (has_type)
+          return read_value(type, d, 0);
+        skip_ws();
+        deferred = pos;
+        return skip_value(1);
+      } else {
+        return skip_value(1);
+      }
+    });
+    if (!ok || !has_topic || !has_type || !has_data)
+      return false;
+    if (deferred != nullptr) {
+      auto sub = reader{deferred, end};
+      if (!sub.read_value(type, d, 0))
+        return false;
+    }
+    t = topic{std::move(topic_str)};
+    return true;
+  }
+};
+
+} // namespace
+
+// -- encoding -----------------------------------------------------------------
+
+void encode(std::string_view str, std::string& out) {
+  static constexpr char hex[] = "0123456789abcdef";
+  out.reserve(out.size() + str.size() + 2);
+  out += '"';
+  auto first = str.data();
+  auto last = first + str.size();
+  for (;;) {
+    auto i = find_escape(first, last);
+    out.append(first, i);
+    if (i == last)
+      break;
+    switch (*i) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default: {
+        auto ch = static_cast<unsigned char>(*i);
+        out += "\\u00";
+        out += hex[ch >> 4];
+        out += hex[ch & 0x0f];
+      }
+    }
+    first = i + 1;
+  }
+  out += '"';
+}
+
+void encode(const data& x, std::string& out) {
+  out += "{\"@data-type\": \"";
+  out += type_names[static_cast<size_t>(x.get_type())];
+  out += "\", \"data\": ";
+  std::visit(encoder{out}, x.get_data());
+  out += '}';
+}
+
+void encode_data_message(const topic& t, const data& d, std::string& out) {
+  out += "{\"type\": \"data-message\", \"topic\": ";
+  encode(std::string_view{t.string()}, out);
+  out += ", \"@data-type\": \"";
+  out += type_names[static_cast<size_t>(d.get_type())];
+  out += "\", \"data\": ";
+  std::visit(encoder{out}, d.get_data());
+  out += '}';
+}
+
+// -- decoding -----------------------------------------------------------------
+
+bool decode(std::string_view input, data& result) {
+  reader rd{input.data(), input.data() + input.size()};
+  return rd.read_data(result, 0) && rd.at_end();
+}
+
+bool decode_data_message(std::string_view input, topic& t, data& d) {
+  reader rd{input.data(), input.data() + input.size()};
+  return rd.read_data_message(t, d) && rd.at_end();
+}
+
+bool decode_data_messages(std::string_view input,
+                          std::vector<std::pair<topic, data>>& result) {
+  reader rd{input.data(), input.data() + input.size()};
+  auto size = result.size();
+  auto read_one = [&rd, &result] {
+    auto& [t, d] = result.emplace_back();
+    return rd.read_data_message(t, d);
+  };
+  auto ok = rd.peek('[') ? rd.read_array(read_one) : read_one();
+  if (ok && rd.at_end())
+    return true;
+  result.resize(size);
+  return false;
+}
+
+} // namespace broker::format::json::v1
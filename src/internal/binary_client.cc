@@ -0,0 +1,234 @@
+#include "broker/internal/binary_client.hh"
+
+#include "broker/error.hh"
+#include "broker/format/bin.hh"
+#include "broker/internal/cached_data_message.hh"
+#include "broker/internal/client_buffer.hh"
+#include "broker/internal/metric_factory.hh"
+#include "broker/internal/type_id.hh"
+#include "broker/message.hh"
+#include "broker/version.hh"
+
+#include <caf/cow_string.hpp>
+#include <caf/event_based_actor.hpp>
+#include <caf/flow/merge.hpp>
+#include <caf/scheduled_actor/flow.hpp>
+
+using namespace std::literals;
+
+namespace broker::internal {
+
+namespace {
+
+std::pair<const std::byte*, const std::byte*>
+bytes_of(const caf::cow_string& frame) {
+  auto first = reinterpret_cast<const std::byte*>(frame.str().data());
+  return {first, first + frame.str().size()};
+}
+
+caf::cow_string to_cow_string(const std::vector<std::byte>& buf) {
+  auto first = reinterpret_cast<const char*>(buf.data());
+  return caf::cow_string{std::string{first, first + buf.size()}};
+}
+
+/// Reads the filter from the first frame and then calls `init` on the state.
+struct binary_handshake_step {
+  using input_type = caf::cow_string;
+
+  using output_type = caf::cow_string;
+
+  binary_client_state* state;
+
+  binary_client_state::out_t push_to_ws; // Our push handle to the WebSocket.
+
+  using pull_from_core_t = caf::async::consumer_resource<data_message>;
+
+  pull_from_core_t pull_from_core; // Allows the core to read our data.
+
+  bool initialized = false;
+
+  binary_handshake_step(binary_client_state* state_ptr,
+                        binary_client_state::out_t push_to_ws,
+                        pull_from_core_t pull_from_core)
+    : state(state_ptr),
+      push_to_ws(std::move(push_to_ws)),
+      pull_from_core(std::move(pull_from_core)) {
+    // nop
+  }
+
+  template <class Next, class... Steps>
+  bool on_next(const input_type& item, Next& next, Steps&... steps) {
+    if (initialized)
+      return next.on_next(item, steps...);
+    filter_type filter;
+    auto [first, last] = bytes_of(item);
+    if (format::bin::v1::decode(first, last, filter) != last) {
+      // Received malformed input: drop remaining input and quit.
+      auto err = caf::make_error(caf::sec::invalid_argument,
+                                 "first message must contain a filter");
+      next.on_error(err, steps...);
+      push_to_ws = nullptr;
+      pull_from_core = nullptr;
+      return false;
+    }
+    initialized = true;
+    // Ok, set up the actual pipeline and connect to the core.
+    state->init(filter, push_to_ws, std::move(pull_from_core));
+    return true;
+  }
+
+  template <class Next, class... Steps>
+  void on_complete(Next& next, Steps&... steps) {
+    next.on_complete(steps...);
+  }
+
+  template <class Next, class... Steps>
+  void on_error(const caf::error& what, Next& next, Steps&... steps) {
+    next.on_error(what, steps...);
+  }
+};
+
+} // namespace
+
+binary_client_state::binary_client_state(caf::event_based_actor* selfptr,
+                                         endpoint_id this_node,
+                                         caf::actor core_hdl,
+                                         network_info ws_addr, in_t in,
+                                         out_t out)
+  : self(selfptr),
+    id(this_node),
+    core(std::move(core_hdl)),
+    addr(std::move(ws_addr)),
+    ctrl_msgs(selfptr) {
+  self->monitor(core);
+  self->set_down_handler([this](const caf::down_msg& msg) { //
+    on_down_msg(msg);
+  });
+  // Connects us to the core.
+  using caf::async::make_spsc_buffer_resource;
+  // Count all bytes that we send to the client, including control messages.
+  metric_factory factory{self->system()};
+  sent_bytes =
+    factory.core.web_socket_client_instances("web-socket").sent_bytes;
+  stats = std::make_shared<client_stats>();
+  // Note: structured bindings with values confuses clang-tidy's leak checker.
+  auto resources = make_spsc_buffer_resource<data_message>();
+  auto& [core_pull, core_push] = resources;
+  // Read from the WebSocket, push to core (core_push).
+  self //
+    ->make_observable()
+    .from_resource(std::move(in)) // Read all input frames.
+    .transform(binary_handshake_step{this, std::move(out), core_pull})
+    .do_finally([this] { ctrl_msgs.close(); })
+    // Parse all frames coming in and forward them to the core.
+    .flat_map([this, n = 0](const caf::cow_string& frame) mutable {
+      ++n;
+      std::string err;
+      auto result = parse(frame, err);
+      if (!result) {
+        auto ctx = std::to_string(n);
+        ctx.insert(0, "input #");
+        ctx += " contained invalid data -> ";
+        ctx += err;
+        ctrl_msgs.push(render_error(enum_str(ec::deserialization_failed), ctx));
+      }
+      return result;
+    })
+    .subscribe(core_push);
+}
+
+binary_client_state::~binary_client_state() {
+  for (auto& sub : subscriptions)
+    sub.dispose();
+}
+
+caf::cow_string binary_client_state::render(const data_message& msg) {
+  buf.clear();
+  if (!format::bin::v1::encode_data_message(get_topic(msg), get_data(msg),
+                                            buf))
+    return render_error(enum_str(ec::serialization_failed),
+                        "message exceeds the size limits of the binary format");
+  return to_cow_string(buf);
+}
+
+caf::cow_string binary_client_state::render_error(std::string_view code,
+                                                  std::string_view context) {
+  buf.clear();
+  format::bin::v1::encode_error(code, context, buf);
+  return to_cow_string(buf);
+}
+
+caf::cow_string binary_client_state::render_ack() {
+  buf.clear();
+  format::bin::v1::encode_ack(id, version::string(), buf);
+  return to_cow_string(buf);
+}
+
+std::optional<data_message>
+binary_client_state::parse(const caf::cow_string& frame, std::string& err) {
+  using format::bin::v1::frame_tag;
+  auto [first, last] = bytes_of(frame);
+  topic t;
+  data d;
+  if (first == last) {
+    err = "empty frame";
+  } else if (format::bin::v1::tag_of(first, last) != frame_tag::data_message) {
+    err = "expected a data message";
+  } else if (!format::bin::v1::decode_data_message(first, last, t, d)) {
+    err = "malformed data message";
+  } else {
+    return make_data_message(std::move(t), std::move(d));
+  }
+  return std::nullopt;
+}
+
+void binary_client_state::init(
+  const filter_type& filter, const out_t& out,
+  caf::async::consumer_resource<data_message> core_pull1) {
+  using caf::async::make_spsc_buffer_resource;
+  auto count_bytes = [ptr = sent_bytes,
+                      st = stats](const caf::cow_string& str) {
+    auto num_bytes = static_cast<int64_t>(str.str().size());
+    ptr->inc(num_bytes);
+    st->sent_bytes += num_bytes;
+  };
+  // Pull data from the core and forward as binary frames.
+  if (!filter.empty()) {
+    // Note: structured bindings with values confuses clang-tidy's leak checker.
+    auto resources = make_spsc_buffer_resource<cached_data_message_ptr>();
+    auto& [core_pull2, core_push2] = resources;
+    auto core_bin = //
+      self->make_observable()
+        .from_resource(core_pull2)
+        .map([this](const cached_data_message_ptr& msg) {
+          // Only the first client renders the message.
+          return msg->binary(
+            [this](const data_message& dmsg) { return render(dmsg); });
+        })
+        .as_observable();
+    auto sub = ctrl_msgs.as_observable()
+                 .merge(core_bin)
+                 .do_on_next(count_bytes)
+                 .subscribe(out);
+    subscriptions.push_back(std::move(sub));
+    caf::anon_send(core, atom::attach_client_v, addr, "web-socket"s, filter,
+                   std::move(core_pull1), std::move(core_push2), stats);
+  } else {
+    auto sub = ctrl_msgs.as_observable().do_on_next(count_bytes).subscribe(out);
+    subscriptions.push_back(std::move(sub));
+    caf::anon_send(core, atom::attach_client_v, addr, "web-socket"s,
+                   filter_type{}, std::move(core_pull1),
+                   cached_data_producer_res{}, stats);
+  }
+  // Setup complete. Send ACK to the client.
+  ctrl_msgs.push(render_ack());
+}
+
+void binary_client_state::on_down_msg(const caf::down_msg&) {
+  for (auto& sub : subscriptions)
+    sub.dispose();
+  subscriptions.clear();
+  self->quit();
+}
+
+} // namespace broker::internal
@@ -7,6 +7,7 @@
 #include "broker/detail/assert.hh"
 #include "broker/error.hh"
 #include "broker/internal/logger.hh"
+#include "broker/internal/probes.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/store.hh"
 #include "broker/topic.hh"
@@ -25,6 +26,9 @@
 #include <chrono>
 #include <memory>
 
+#undef BROKER_LOG_COMPONENT
+#define BROKER_LOG_COMPONENT store
+
 using std::move;
 
 using namespace std::literals;
@@ -223,7 +227,9 @@ void clone_state::tick() {
 
 void clone_state::consume(consumer_type*, command_message& msg) {
   auto f = [this](auto& cmd) { consume(cmd); };
-  std::visit(f, get<1>(msg.unshared()).content);
+  auto& content = get<1>(msg.unshared()).content;
+  BROKER_PROBE(clone_apply, content.index());
+  std::visit(f, content);
 }
 
 void clone_state::consume(put_command& x) {
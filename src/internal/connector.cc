@@ -1,16 +1,20 @@
 #include "broker/internal/connector.hh"
 
+#include "broker/defaults.hh"
 #include "broker/detail/assert.hh"
 #include "broker/detail/overload.hh"
 #include "broker/endpoint.hh"
 #include "broker/error.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal/logger.hh"
+#include "broker/internal/metric_factory.hh"
+#include "broker/internal/probes.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/internal/wire_format.hh"
 #include "broker/lamport_timestamp.hh"
 #include "broker/message.hh"
 
+#include <caf/actor_system_config.hpp>
 #include <caf/async/spsc_buffer.hpp>
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
@@ -29,6 +33,9 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#undef BROKER_LOG_COMPONENT
+#define BROKER_LOG_COMPONENT network
+
 // -- platform setup -----------------------------------------------------------
 
 // clang-format off
@@ -266,6 +273,15 @@ namespace {
 
 // -- implementations for pending connections ----------------------------------
 
+wire_format::v1::trait make_trait(caf::actor_system& sys,
+                                  const latency_stamps_ptr& stamps) {
+  metric_factory factory{sys};
+  auto interval = caf::get_or(sys.config(),
+                              "broker.metrics.latency-sample-interval",
+                              defaults::metrics::latency_sample_interval);
+  return {stamps, factory.core.stage_latency_instances().write, interval};
+}
+
 class plain_pending_connection : public pending_connection {
 public:
   explicit plain_pending_connection(caf::net::stream_socket fd) : fd_(fd) {
@@ -276,18 +292,18 @@ public:
     caf::net::close(fd_);
   }
 
-  caf::error run(caf::actor_system& sys,
+  caf::error run(caf::actor_system& sys, const latency_stamps_ptr& stamps,
                  caf::async::consumer_resource<node_message> pull,
                  caf::async::producer_resource<node_message> push) override {
     BROKER_DEBUG("run pending connection" << BROKER_ARG2("fd", fd_.id)
                                           << "(no SSL)");
-    using trait_t = wire_format::v1::trait;
     if (fd_ != caf::net::invalid_socket) {
       using caf::net::run_with_length_prefix_framing;
       auto& mpx = sys.network_manager().mpx();
       auto res = run_with_length_prefix_framing(mpx, fd_, caf::settings{},
                                                 std::move(pull),
-                                                std::move(push), trait_t{});
+                                                std::move(push),
+                                                make_trait(sys, stamps));
       fd_.id = caf::net::invalid_socket_id;
       return res;
     } else {
@@ -311,18 +327,17 @@ public:
     caf::net::close(fd_);
   }
 
-  caf::error run(caf::actor_system& sys,
+  caf::error run(caf::actor_system& sys, const latency_stamps_ptr& stamps,
                  caf::async::consumer_resource<node_message> pull,
                  caf::async::producer_resource<node_message> push) override {
     BROKER_DEBUG("run pending connection" << BROKER_ARG2("fd", fd_.id)
                                           << "(SSL)");
-    using trait_t = wire_format::v1::trait;
     if (fd_ != caf::net::invalid_socket) {
       using caf::net::run_with_length_prefix_framing;
       auto& mpx = sys.network_manager().mpx();
       auto res = run_with_length_prefix_framing<caf::net::openssl_transport>(
-        mpx, fd_, caf::settings{}, std::move(pull), std::move(push), trait_t{},
-        std::move(policy_));
+        mpx, fd_, caf::settings{}, std::move(pull), std::move(push),
+        make_trait(sys, stamps), std::move(policy_));
       fd_.id = caf::net::invalid_socket_id;
       return res;
     } else {
@@ -841,6 +856,7 @@ public:
             transition(&connect_state::err);
             return read_result::stop;
           }
+          BROKER_PROBE(handshake_msg, msg.index(), payload_size);
           if (!(*this.*fn)(msg))
             return read_result::stop;
           payload_size = 0;
@@ -863,6 +879,7 @@ public:
   void transition(fn_t f) {
     fn = f;
     if (f == &connect_state::fin) {
+      BROKER_PROBE(handshake_done, 1);
       if (!redundant_connections.empty()) {
         auto msg = wire_format::make_drop_conn_msg(this_peer(),
                                                    ec::redundant_connection,
@@ -874,6 +891,7 @@ public:
         redundant_connections.clear();
       }
     } else if (f == &connect_state::err) {
+      BROKER_PROBE(handshake_done, 0);
       if (added_peer_status) {
         auto& psm = peer_statuses();
         BROKER_DEBUG(remote_id << "::" << psm.get(remote_id) << "-> ()");
@@ -21,14 +21,21 @@
 #include <caf/system_messages.hpp>
 #include <caf/unit.hpp>
 
+#include "broker/detail/alloc_stage.hh"
 #include "broker/detail/assert.hh"
 #include "broker/detail/make_backend.hh"
 #include "broker/detail/prefix_matcher.hh"
 #include "broker/domain_options.hh"
 #include "broker/filter_type.hh"
+#include "broker/internal/cached_data_message.hh"
 #include "broker/internal/clone_actor.hh"
 #include "broker/internal/killswitch.hh"
 #include "broker/internal/master_actor.hh"
+#include "broker/internal/metric_factory.hh"
+#include "broker/internal/probes.hh"
+
+#undef BROKER_LOG_COMPONENT
+#define BROKER_LOG_COMPONENT core
 
 using namespace std::literals;
 
@@ -116,7 +123,43 @@ using status_collector_actor = caf::stateful_actor<status_collector_state>;
 
 // -- constructors and destructors ---------------------------------------------
 
-core_actor_state::metrics_t::metrics_t(caf::actor_system& sys) {
+void core_actor_state::message_metrics_t::assign(
+  caf::telemetry::int_counter* processed_instance,
+  caf::telemetry::int_gauge* buffered_instance) {
+  // The Broker telemetry API wraps the CAF metrics with opaque handles.
+  using telemetry::int_counter_hdl;
+  using telemetry::int_gauge_hdl;
+  auto c = reinterpret_cast<int_counter_hdl*>(processed_instance);
+  auto g = reinterpret_cast<int_gauge_hdl*>(buffered_instance);
+  processed = std::make_unique<telemetry::sharded_int_counter>(
+    telemetry::int_counter{c});
+  buffered = std::make_unique<telemetry::sharded_int_gauge>(
+    telemetry::int_gauge{g});
+}
+
+namespace {
+
+topic_metrics make_topic_metrics(caf::actor_system& sys,
+                                 std::string direction) {
+  metric_factory factory{sys};
+  return topic_metrics{factory.core.topic_messages_family(),
+                       factory.core.topic_volume_family(),
+                       std::move(direction)};
+}
+
+trace_metrics make_trace_metrics(caf::actor_system& sys) {
+  metric_factory factory{sys};
+  return trace_metrics{factory.core.trace_one_way_latency_family(),
+                       factory.core.trace_hop_latency_family()};
+}
+
+} // namespace
+
+core_actor_state::metrics_t::metrics_t(caf::actor_system& sys)
+  : inbound_topics(make_topic_metrics(sys, "in")),
+    outbound_topics(make_topic_metrics(sys, "out")),
+    traces(make_trace_metrics(sys)),
+    flows(metric_factory{sys}.core.flow_instances()) {
   metric_factory factory{sys};
   // Initialize connection metrics.
   auto [native, ws] = factory.core.connections_instances();
@@ -130,6 +173,17 @@ core_actor_state::metrics_t::metrics_t(caf::actor_system& sys) {
   message_metric_sets[3].assign(proc.routing_update, buf.routing_update);
   message_metric_sets[4].assign(proc.ping, buf.ping);
   message_metric_sets[5].assign(proc.pong, buf.pong);
+  auto sizes = factory.core.payload_size_instances();
+  message_metric_sets[1].payload_size = sizes.data;
+  message_metric_sets[2].payload_size = sizes.command;
+  message_metric_sets[3].payload_size = sizes.routing_update;
+  message_metric_sets[4].payload_size = sizes.ping;
+  message_metric_sets[5].payload_size = sizes.pong;
+  // Initialize latency metrics.
+  auto latency = factory.core.stage_latency_instances();
+  publish_latency = latency.publish;
+  forward_latency = latency.forward;
+  deliver_latency = latency.deliver;
 }
 
 core_actor_state::core_actor_state(caf::event_based_actor* self,
@@ -137,7 +191,8 @@ core_actor_state::core_actor_state(caf::event_based_actor* self,
                                    filter_type initial_filter,
                                    endpoint::clock* clock,
                                    const domain_options* adaptation,
-                                   connector_ptr conn)
+                                   connector_ptr conn,
+                                   latency_stamps_ptr stamps)
   : self(self),
     id(this_peer),
     filter(std::make_shared<shared_filter_type>(std::move(initial_filter))),
@@ -147,6 +202,52 @@ core_actor_state::core_actor_state(caf::event_based_actor* self,
     flow_inputs(self) {
   // Read config and check for extra configuration parameters.
   ttl = caf::get_or(self->config(), "broker.ttl", defaults::ttl);
+  top_topics = caf::get_or(self->config(), "broker.metrics.top-topics",
+                           defaults::topic_statistics::top_k);
+  auto sample_interval = caf::get_or(self->config(),
+                                     "broker.metrics.latency-sample-interval",
+                                     defaults::metrics::latency_sample_interval);
+  payload_sampler = detail::sampler{sample_interval};
+  if (stamps) {
+    this->stamps = std::move(stamps);
+  } else {
+    metric_factory factory{self->system()};
+    this->stamps = std::make_shared<latency_stamps>(
+      sample_interval, factory.core.latency_stamp_collisions_instance());
+  }
+  trace_sampler = detail::sampler{
+    caf::get_or(self->config(), "broker.metrics.trace-sample-interval",
+                defaults::tracing::sample_interval)};
+  client_buffer_size = caf::get_or(self->config(),
+                                   "broker.web-socket.max-buffered-messages",
+                                   defaults::web_socket::max_buffered_messages);
+  if (auto str = caf::get_or(
+        self->config(), "broker.web-socket.overflow-policy",
+        caf::string_view{defaults::web_socket::overflow_policy});
+      !from_string(str, client_overflow_policy)) {
+    BROKER_ERROR("invalid value for broker.web-socket.overflow-policy:"
+                 << str << "-> fall back to"
+                 << defaults::web_socket::overflow_policy);
+  }
+  if (auto cap = caf::get_or(self->config(), "broker.flight-recorder.capacity",
+                             defaults::flight_recorder::capacity);
+      cap > 0) {
+    auto file = caf::get_or(self->config(), "broker.flight-recorder.file",
+                            caf::string_view{});
+    if (auto err = flights.open(cap, file)) {
+      BROKER_ERROR("failed to open the flight recorder:" << err);
+    } else if (auto signo = caf::get_or(self->config(),
+                                        "broker.flight-recorder.dump-signal",
+                                        0);
+               signo != 0) {
+      auto dump_file = caf::get_or(
+        self->config(), "broker.flight-recorder.dump-file",
+        caf::string_view{defaults::flight_recorder::dump_file});
+      if (auto err = flights.dump_on_signal(signo, std::move(dump_file)))
+        BROKER_ERROR("failed to install the flight recorder signal handler:"
+                     << err);
+    }
+  }
   if (adaptation && adaptation->disable_forwarding) {
     BROKER_INFO("disable forwarding on this peer");
     disable_forwarding = true;
@@ -179,6 +280,8 @@ core_actor_state::~core_actor_state() {
 caf::behavior core_actor_state::make_behavior() {
   // Create the central "bus" where everything flows through.
   central_merge = flow_inputs.as_observable().merge().share();
+  // Export back-pressure indicators of all flows.
+  schedule_flow_metrics_update();
   // Process control messages and add instrumentation for metrics.
   central_merge //
     .for_each([this](const node_message& msg) {
@@ -187,6 +290,12 @@ caf::behavior core_actor_state::make_behavior() {
       auto& metrics = metrics_for(get_type(msg));
       metrics.processed->inc();
       metrics.buffered->dec();
+      BROKER_PROBE(central_merge_leave, static_cast<int>(get_type(msg)),
+                   get_payload(msg).size());
+      flights.record(flight_stage::dispatch, msg);
+      if (payload_sampler())
+        metrics.payload_size->observe(
+          static_cast<int64_t>(get_payload(msg).size()));
       // Ignore our own outputs.
       if (sender == id)
         return;
@@ -237,7 +346,11 @@ caf::behavior core_actor_state::make_behavior() {
       })
       // Deserialize payload and wrap it into an actual data message.
       .flat_map([this](const node_message& msg) {
-        return unpack<data_message>(get_packed_message(msg));
+        auto result = unpack<data_message>(get_packed_message(msg));
+        // Carry over the timestamp for sampling the delivery latency.
+        if (auto stamp = stamps->get(msg); result && stamp != 0)
+          stamps->set(*result, stamp);
+        return result;
       })
       // Convert this blueprint to a *hot* observable.
       .share();
@@ -256,6 +369,24 @@ caf::behavior core_actor_state::make_behavior() {
       })
       // Convert this blueprint to a *hot* observable.
       .share();
+  client_outputs =
+    central_merge
+      // Drop everything but data messages that at least one client wants.
+      .filter([this](const node_message& msg) {
+        if (get_type(msg) != packed_message_type::data)
+          return false;
+        detail::prefix_matcher f;
+        return f(client_filter, get_topic(msg));
+      })
+      // Deserialize payload once for all clients.
+      .flat_map([this](const node_message& msg) {
+        std::optional<cached_data_message_ptr> result;
+        if (auto dmsg = unpack<data_message>(get_packed_message(msg)))
+          result = make_cached_data_message(get_sender(msg), std::move(*dmsg));
+        return result;
+      })
+      // Convert this blueprint to a *hot* observable.
+      .share();
   // Connect the unsafe inputs to the central merge point.
   flow_inputs.push(unsafe_inputs.as_observable());
   // Override the default exit handler to add logging.
@@ -314,10 +445,11 @@ caf::behavior core_actor_state::make_behavior() {
     // -- non-native clients, e.g., via WebSocket API --------------------------
     [this](atom::attach_client, const network_info& addr,
            const std::string& type, filter_type& filter,
-           data_consumer_res& in_res,
-           data_producer_res& out_res) -> caf::result<void> {
+           data_consumer_res& in_res, cached_data_producer_res& out_res,
+           client_stats_ptr& stats) -> caf::result<void> {
       if (auto err = init_new_client(addr, type, std::move(filter),
-                                     std::move(in_res), std::move(out_res)))
+                                     std::move(in_res), std::move(out_res),
+                                     std::move(stats)))
         return err;
       else
         return caf::unit;
@@ -339,19 +471,19 @@ caf::behavior core_actor_state::make_behavior() {
     // -- publishing of messages without going through a publisher -------------
     [this](atom::publish, const data_message& msg) {
       ++published_via_async_msg;
-      dispatch(endpoint_id::nil(), pack(msg));
+      dispatch(endpoint_id::nil(), msg);
     },
     [this](atom::publish, const data_message& msg, const endpoint_info& dst) {
       ++published_via_async_msg;
-      dispatch(dst.node, pack(msg));
+      dispatch(dst.node, msg);
     },
     [this](atom::publish, const data_message& msg, endpoint_id dst) {
       ++published_via_async_msg;
-      dispatch(dst, pack(msg));
+      dispatch(dst, msg);
     },
     [this](atom::publish, atom::local, const data_message& msg) {
       ++published_via_async_msg;
-      dispatch(id, pack(msg));
+      dispatch(id, msg);
     },
     [this](atom::publish, const command_message& msg) {
       dispatch(endpoint_id::nil(), pack(msg));
@@ -372,12 +504,15 @@ caf::behavior core_actor_state::make_behavior() {
     },
     [this](filter_type& filter, data_producer_res snk) {
       subscribe(filter);
+      auto scope = local_subscriber_scope_adder(
+        std::make_shared<filter_type>(filter));
       data_outputs
         .filter([xs = std::move(filter)](const data_message& msg) {
           detail::prefix_matcher f;
           return f(xs, msg);
         })
-        .compose(local_subscriber_scope_adder())
+        .do_on_next([this](const data_message& msg) { observe_delivery(msg); })
+        .compose(std::move(scope))
         .subscribe(std::move(snk));
     },
     [this](std::shared_ptr<filter_type> fptr, data_producer_res snk) {
@@ -386,12 +521,14 @@ caf::behavior core_actor_state::make_behavior() {
       // an update message. The filter itself is not thread-safe. Hence, the
       // publishers should never write to it directly.
       subscribe(*fptr);
+      auto scope = local_subscriber_scope_adder(fptr);
       data_outputs
         .filter([fptr = std::move(fptr)](const data_message& msg) {
           detail::prefix_matcher f;
           return f(*fptr, msg);
         })
-        .compose(local_subscriber_scope_adder())
+        .do_on_next([this](const data_message& msg) { observe_delivery(msg); })
+        .compose(std::move(scope))
         .subscribe(std::move(snk));
     },
     [this](std::shared_ptr<filter_type>& fptr, topic& x, bool add,
@@ -417,11 +554,24 @@ caf::behavior core_actor_state::make_behavior() {
         self
           ->make_observable() //
           .from_resource(std::move(src))
-          .do_on_next([this](const data_message&) {
+          .do_on_next([this](const data_message& msg) {
             metrics_for(packed_message_type::data).buffered->inc();
+            BROKER_PROBE(central_merge_enter,
+                         static_cast<int>(packed_message_type::data));
           })
           .map([this](const data_message& msg) {
-            return make_node_message(id, endpoint_id::nil(), pack(msg));
+            auto result = make_node_message(id, endpoint_id::nil(), pack(msg));
+            // Stamp sampled messages again for the next stage.
+            if (auto stamp = stamps->take(msg); stamp != 0) {
+              metrics.publish_latency->observe(
+                detail::cycle_clock::seconds_since(stamp));
+              stamps->set(result, detail::cycle_clock::now());
+            }
+            // Start a trace with this endpoint as origin.
+            if (trace_sampler())
+              set_trace(result,
+                        trace_header_ptr{{trace_hop{id, broker::now()}}});
+            return result;
           })
           .compose(local_publisher_scope_adder())
           .compose(add_killswitch_t{});
@@ -480,8 +630,9 @@ caf::behavior core_actor_state::make_behavior() {
                      detail::prefix_matcher f;
                      return f(*fptr, item);
                    })
-                   .compose(local_subscriber_scope_adder())
+                   .compose(local_subscriber_scope_adder(fptr))
                    .for_each([this, hdl](const data_message& msg) {
+                     observe_delivery(msg);
                      self->send(hdl, msg);
                    });
       legacy_subs.emplace(addr, legacy_subscriber{fptr, sub});
@@ -503,6 +654,9 @@ caf::behavior core_actor_state::make_behavior() {
         awaited_peers.emplace(peer_id, rp);
       return rp;
     },
+    [this](atom::get, atom::flight_recorder) { //
+      return flights.snapshot();
+    },
     [this](atom::get, atom::status) {
       if (masters.size() + clones.size() > 0) {
         auto worker = self->spawn<status_collector_actor>(masters, clones);
@@ -531,6 +685,8 @@ void core_actor_state::shutdown(shutdown_options options) {
   shutdown_stores();
   // We no longer add new input flows.
   flow_inputs.close();
+  // Stop updating the flow metrics.
+  flow_metrics_timer.dispose();
   // Cancel all subscriptions to local publishers.
   for (auto& sub : subscriptions)
     sub.dispose();
@@ -612,6 +768,7 @@ void core_actor_state::emit(Info&& ep, EnumConstant code, const char* msg) {
 
 template <class T>
 packed_message core_actor_state::pack(const T& msg) {
+  BROKER_ALLOC_STAGE(pack);
   buf.clear();
   caf::binary_serializer snk{nullptr, buf};
   if constexpr (std::is_same_v<T, data_message>) {
@@ -620,12 +777,16 @@ packed_message core_actor_state::pack(const T& msg) {
     static_assert(std::is_same_v<T, command_message>);
     std::ignore = snk.apply(get_command(msg));
   }
+  BROKER_PROBE(pack, static_cast<int>(packed_message_type_v<T>), buf.size());
   return make_packed_message(packed_message_type_v<T>, ttl, get_topic(msg),
                              buf);
 }
 
 template <class T>
 std::optional<T> core_actor_state::unpack(const packed_message& msg) {
+  BROKER_ALLOC_STAGE(unpack);
+  BROKER_PROBE(unpack, static_cast<int>(get_type(msg)),
+               get_payload(msg).size());
   caf::binary_deserializer src{nullptr, get_payload(msg)};
   if constexpr (std::is_same_v<T, data_message>) {
     data content;
@@ -679,21 +840,67 @@ table core_actor_state::message_metrics_snapshot() const {
 
 namespace {
 
-table to_vals(const flow_scope_stats& stats) {
+double ticks_to_seconds(uint64_t ticks) {
+  return static_cast<double>(ticks) * detail::cycle_clock::seconds_per_tick();
+}
+
+timespan ticks_to_timespan(uint64_t ticks) {
+  auto secs = fractional_seconds{ticks_to_seconds(ticks)};
+  return std::chrono::duration_cast<timespan>(secs);
+}
+
+table to_vals(const flow_scope_stats& stats, uint64_t now) {
   table vals;
   vals.emplace("requested"s, stats.requested);
   vals.emplace("delivered"s, stats.delivered);
+  vals.emplace("demand"s, stats.demand());
+  vals.emplace("buffered"s, stats.buffered());
+  vals.emplace("high-water-mark"s, stats.high_water_mark);
+  vals.emplace("stall-time"s, ticks_to_timespan(stats.stall_time(now)));
+  // Note: we always emit all keys to keep the layout of the status stable.
+  //       Until the first delivery, the time since the last delivery is nil.
+  if (stats.last_delivery == 0)
+    vals.emplace("time-since-last-delivery"s, data{});
+  else if (now > stats.last_delivery)
+    vals.emplace("time-since-last-delivery"s,
+                 ticks_to_timespan(now - stats.last_delivery));
+  else
+    vals.emplace("time-since-last-delivery"s, timespan{0});
   return vals;
 }
 
+// Aggregates flow statistics by keeping the largest value per field.
+struct flow_stats_max {
+  int64_t buffered = 0;
+  int64_t high_water_mark = 0;
+  uint64_t stall_time = 0;
+  uint64_t idle_time = 0;
+
+  void add(const flow_scope_stats& stats, uint64_t now) {
+    buffered = std::max(buffered, stats.buffered());
+    high_water_mark = std::max(high_water_mark, stats.high_water_mark);
+    stall_time = std::max(stall_time, stats.stall_time(now));
+    if (stats.last_delivery != 0 && now > stats.last_delivery)
+      idle_time = std::max(idle_time, now - stats.last_delivery);
+  }
+
+  void publish(metric_factory::core_t::flow_t& metrics) const {
+    metrics.buffered_messages->value(buffered);
+    metrics.high_water_mark->value(high_water_mark);
+    metrics.stall_time->value(ticks_to_seconds(stall_time));
+    metrics.idle_time->value(ticks_to_seconds(idle_time));
+  }
+};
+
 } // namespace
 
 table core_actor_state::peer_stats_snapshot() const {
   table result;
+  auto now = detail::cycle_clock::now();
   for (auto& [pid, state_ptr] : peers) {
     table entry;
-    entry.emplace("input", to_vals(*state_ptr->input_stats()));
-    entry.emplace("output", to_vals(*state_ptr->output_stats()));
+    entry.emplace("input", to_vals(*state_ptr->input_stats(), now));
+    entry.emplace("output", to_vals(*state_ptr->output_stats(), now));
     result.emplace(to_string(pid), std::move(entry));
   }
   return result;
@@ -701,15 +908,83 @@ table core_actor_state::peer_stats_snapshot() const {
 
 vector core_actor_state::local_subscriber_stats_snapshot() const {
   vector result;
-  for (auto& state_ptr : local_subscriber_stats)
-    result.emplace_back(to_vals(*state_ptr));
+  auto now = detail::cycle_clock::now();
+  for (auto& [state_ptr, filter_ptr] : local_subscriber_stats) {
+    auto vals = to_vals(*state_ptr, now);
+    vector topics;
+    if (filter_ptr)
+      for (auto& x : *filter_ptr)
+        topics.emplace_back(x.string());
+    vals.emplace("filter"s, std::move(topics));
+    result.emplace_back(std::move(vals));
+  }
   return result;
 }
 
 vector core_actor_state::local_publisher_stats_snapshot() const {
   vector result;
+  auto now = detail::cycle_clock::now();
   for (auto& state_ptr : local_publisher_stats)
-    result.emplace_back(to_vals(*state_ptr));
+    result.emplace_back(to_vals(*state_ptr, now));
+  return result;
+}
+
+table core_actor_state::topic_stats_snapshot() const {
+  table peer_vals;
+  for (auto& [pid, stats] : peer_inbound_topics)
+    peer_vals.emplace(to_string(pid), stats->snapshot(top_topics));
+  table result;
+  result.emplace("inbound"s, inbound_topics.snapshot(top_topics));
+  result.emplace("outbound"s, outbound_topics.snapshot(top_topics));
+  result.emplace("peers"s, std::move(peer_vals));
+  return result;
+}
+
+void core_actor_state::update_flow_metrics() {
+  auto now = detail::cycle_clock::now();
+  flow_stats_max peer_input;
+  flow_stats_max peer_output;
+  for (auto& kvp : peers) {
+    peer_input.add(*kvp.second->input_stats(), now);
+    peer_output.add(*kvp.second->output_stats(), now);
+  }
+  flow_stats_max subscribers;
+  for (auto& kvp : local_subscriber_stats)
+    subscribers.add(*kvp.first, now);
+  flow_stats_max publishers;
+  for (auto& ptr : local_publisher_stats)
+    publishers.add(*ptr, now);
+  peer_input.publish(metrics.flows.peer_input);
+  peer_output.publish(metrics.flows.peer_output);
+  subscribers.publish(metrics.flows.local_subscriber);
+  publishers.publish(metrics.flows.local_publisher);
+}
+
+void core_actor_state::schedule_flow_metrics_update() {
+  flow_metrics_timer = self->run_delayed(
+    defaults::metrics::flow_update_interval, [this] {
+      update_flow_metrics();
+      update_topic_metrics();
+      schedule_flow_metrics_update();
+    });
+}
+
+void core_actor_state::update_topic_metrics() {
+  metrics.inbound_topics.update(inbound_topics, top_topics);
+  metrics.outbound_topics.update(outbound_topics, top_topics);
+}
+
+table core_actor_state::client_stats_snapshot() const {
+  table result;
+  for (auto& [cid, info] : client_infos) {
+    table entry;
+    entry.emplace("address"s, to_string(info.addr));
+    entry.emplace("type"s, info.type);
+    entry.emplace("queued"s, info.stats->queued.load());
+    entry.emplace("dropped"s, info.stats->dropped.load());
+    entry.emplace("sent-bytes"s, info.stats->sent_bytes.load());
+    result.emplace(to_string(cid), std::move(entry));
+  }
   return result;
 }
 
@@ -729,8 +1004,10 @@ table core_actor_state::status_snapshot() const {
   add("time", caf::timestamp_to_string(caf::make_timestamp()));
   add("native-connections", metrics.native_connections->value());
   add("web-socket-connections", metrics.web_socket_connections->value());
+  add("web-socket-clients", client_stats_snapshot());
   add("message-metrics", message_metrics_snapshot());
   add("peerings", peer_stats_snapshot());
+  add("topics", topic_stats_snapshot());
   add("local-subscribers", local_subscriber_stats_snapshot());
   add("local-publishers", local_publisher_stats_snapshot());
   add("published-via-async-msg", published_via_async_msg);
@@ -888,23 +1165,54 @@ caf::error core_actor_state::init_new_peer(endpoint_id peer_id,
       // always reflects the last hop. Since we only need this
       // information to avoid forwarding loops, "sender" really just
       // means "last hop" right now.
-      .map([this](const node_message& msg) {
-        if (get_sender(msg) == id) {
+      .map([this, pid = peer_id](const node_message& msg) {
+        BROKER_ALLOC_STAGE(route);
+        BROKER_PROBE(peer_enqueue, static_cast<int>(get_type(msg)),
+                     get_payload(msg).size());
+        flights.record(flight_stage::outbound, msg, pid);
+        outbound_topics.add(get_topic(msg), get_payload(msg).size());
+        auto stamp = stamps->get(msg);
+        // Note: messages from local publishers already list this endpoint as
+        // origin of their trace.
+        if (get_sender(msg) == id && stamp == 0) {
           return msg;
         } else {
           using std::get;
           auto cpy = msg;
-          get<0>(cpy.unshared()) = id;
+          auto& fields = cpy.unshared();
+          get<0>(fields) = id;
+          // Record this endpoint as the next hop of forwarded traced messages.
+          if (auto trace = get_trace(msg)) {
+            if (get_sender(msg) != id && trace->hops.size() < 0xFF)
+              set_trace(cpy, trace.add_hop(trace_hop{id, broker::now()}));
+            else
+              set_trace(cpy, std::move(trace));
+          }
+          // For sampled messages, the copy carries a fresh timestamp for the
+          // next stage without affecting the other peers.
+          if (stamp != 0) {
+            metrics.forward_latency->observe(
+              detail::cycle_clock::seconds_since(stamp));
+            stamps->set(cpy, detail::cycle_clock::now());
+          }
           return cpy;
         }
       })
       .as_observable());
   // Push messages received from the peer into the central merge point.
+  auto peer_topics = std::make_shared<topic_statistics>();
+  peer_inbound_topics[peer_id] = peer_topics;
   flow_inputs.push( //
     in
       // Add instrumentation for metrics.
-      .do_on_next([this](const node_message& msg) {
+      .do_on_next([this, peer_topics](const node_message& msg) {
         metrics_for(get_type(msg)).buffered->inc();
+        BROKER_PROBE(central_merge_enter, static_cast<int>(get_type(msg)));
+        flights.record(flight_stage::inbound, msg);
+        peer_topics->add(get_topic(msg), get_payload(msg).size());
+        inbound_topics.add(get_topic(msg), get_payload(msg).size());
+        if (auto trace = get_trace(msg))
+          metrics.traces.observe(*trace, get_topic(msg), broker::now());
       })
       // Handle peer disconnect events.
       .do_on_complete([this, peer_id, ptr]() mutable {
@@ -921,6 +1229,7 @@ caf::error core_actor_state::init_new_peer(endpoint_id peer_id,
         }
         // Clean up state our local state.
         peers.erase(peer_id);
+        peer_inbound_topics.erase(peer_id);
         // Trigger a reconnect if we have initiated the peering and did not
         // disconnect this peer as a result of unpeering from it.
         if (!ptr->removed() && !ptr->addr().address.empty()
@@ -961,7 +1270,8 @@ caf::error core_actor_state::init_new_peer(endpoint_id peer,
   auto& [rd_1, wr_1] = resources1;
   auto resources2 = caf::async::make_spsc_buffer_resource<node_message>();
   auto& [rd_2, wr_2] = resources2;
-  if (auto err = ptr->run(self->system(), std::move(rd_1), std::move(wr_2))) {
+  if (auto err = ptr->run(self->system(), stamps, std::move(rd_1),
+                          std::move(wr_2))) {
     BROKER_DEBUG("failed to run pending connection:" << err);
     return err;
   } else {
@@ -974,7 +1284,8 @@ caf::error core_actor_state::init_new_client(const network_info& addr,
                                              const std::string& type,
                                              filter_type filter,
                                              data_consumer_res in_res,
-                                             data_producer_res out_res) {
+                                             cached_data_producer_res out_res,
+                                             client_stats_ptr stats) {
   BROKER_TRACE(BROKER_ARG(addr) << BROKER_ARG(filter));
   // Fail early when shutting down.
   if (shutting_down()) {
@@ -994,23 +1305,30 @@ caf::error core_actor_state::init_new_client(const network_info& addr,
   auto client_id = endpoint_id::random();
   // Emit status updates.
   client_added(client_id, addr, type);
-  // Hook into the central merge point for forwarding the data to the client.
+  if (!stats)
+    stats = std::make_shared<client_stats>();
+  client_infos.emplace(client_id, client_info{addr, type, stats});
+  // Hook into the shared client outputs for forwarding data to the client.
   if (out_res) {
-    auto sub = central_merge
+    client_filters.emplace(client_id, filter);
+    filter_extend(client_filter, filter);
+    metric_factory factory{self->system()};
+    auto ws = factory.core.web_socket_client_instances(type);
+    auto sub = client_outputs
                  // Select by subscription.
-                 .filter([this, filt = std::move(filter),
-                          client_id](const node_message& msg) {
-                   if (get_sender(msg) == client_id)
+                 .filter([filt = std::move(filter),
+                          client_id](const cached_data_message_ptr& msg) {
+                   if (msg->sender() == client_id)
                      return false;
                    detail::prefix_matcher f;
-                   return f(filt, get_topic(msg));
-                 })
-                 // Deserialize payload and wrap it into a data message.
-                 .flat_map([this](const node_message& msg) {
-                   // TODO: repeats deserialization in the core! Ideally, this
-                   //       would only happen exactly once per message.
-                   return unpack<data_message>(get_packed_message(msg));
+                   return f(filt, msg->get_topic());
                  })
+                 // Decouple the client from the other clients.
+                 .compose(add_client_buffer_t{client_buffer_size,
+                                              client_overflow_policy,
+                                              client_buffer_metrics{
+                                                ws.queued_messages,
+                                                ws.dropped_messages, stats}})
                  // Emit values to the producer resource.
                  .subscribe(std::move(out_res));
     subscriptions.emplace_back(sub);
@@ -1022,10 +1340,19 @@ caf::error core_actor_state::init_new_client(const network_info& addr,
                     .do_finally([this, client_id, addr, type] {
                       BROKER_DEBUG("client" << addr << "disconnected");
                       client_removed(client_id, addr, type);
+                      client_infos.erase(client_id);
                       metrics.web_socket_connections->dec();
+                      // Shrink the filter for the shared client outputs.
+                      if (client_filters.erase(client_id) > 0) {
+                        client_filter.clear();
+                        for (auto& kvp : client_filters)
+                          filter_extend(client_filter, kvp.second);
+                      }
                     })
                     .map([this, client_id](const data_message& msg) {
                       metrics_for(packed_message_type::data).buffered->inc();
+                      BROKER_PROBE(central_merge_enter,
+                                   static_cast<int>(packed_message_type::data));
                       return make_node_message(client_id, endpoint_id::nil(),
                                                pack(msg));
                     })
@@ -1109,6 +1436,8 @@ caf::result<caf::actor> core_actor_state::attach_master(const std::string& name,
               .from_resource(con2)
               .map([this](const command_message& msg) {
                 metrics_for(packed_message_type::command).buffered->inc();
+                BROKER_PROBE(central_merge_enter,
+                             static_cast<int>(packed_message_type::command));
                 return make_node_message(id, endpoint_id::nil(), pack(msg));
               })
               .as_observable();
@@ -1159,6 +1488,8 @@ core_actor_state::attach_clone(const std::string& name, double resync_interval,
               .from_resource(con2)
               .map([this](const command_message& msg) {
                 metrics_for(packed_message_type::command).buffered->inc();
+                BROKER_PROBE(central_merge_enter,
+                             static_cast<int>(packed_message_type::command));
                 return make_node_message(id, endpoint_id::nil(), pack(msg));
               })
               .as_observable();
@@ -1184,10 +1515,26 @@ void core_actor_state::shutdown_stores() {
 
 void core_actor_state::dispatch(endpoint_id receiver,
                                 const packed_message& msg) {
+  BROKER_ALLOC_STAGE(route);
   metrics_for(get_type(msg)).buffered->inc();
+  BROKER_PROBE(central_merge_enter, static_cast<int>(get_type(msg)));
   unsafe_inputs.push(make_node_message(id, receiver, msg));
 }
 
+void core_actor_state::dispatch(endpoint_id receiver, const data_message& msg) {
+  BROKER_ALLOC_STAGE(route);
+  metrics_for(packed_message_type::data).buffered->inc();
+  BROKER_PROBE(central_merge_enter,
+               static_cast<int>(packed_message_type::data));
+  auto result = make_node_message(id, receiver, pack(msg));
+  // Stamp sampled messages from endpoint::publish again for the next stage.
+  if (auto stamp = stamps->take(msg); stamp != 0) {
+    metrics.publish_latency->observe(detail::cycle_clock::seconds_since(stamp));
+    stamps->set(result, detail::cycle_clock::now());
+  }
+  unsafe_inputs.push(std::move(result));
+}
+
 void core_actor_state::broadcast_subscriptions() {
   // Serialize the filter.
   auto fs = filter->read();
@@ -1202,8 +1549,10 @@ void core_actor_state::broadcast_subscriptions() {
                                topic{std::string{topic::reserved}},
                                std::vector<std::byte>{first, last}};
   metrics_for(packed_message_type::routing_update).buffered->inc();
+  BROKER_PROBE(central_merge_enter,
+               static_cast<int>(packed_message_type::routing_update));
   for (auto& kvp : peers)
-    unsafe_inputs.push(node_message(id, kvp.first, packed));
+    unsafe_inputs.push(make_node_message(id, kvp.first, packed));
 }
 
 // -- unpeering ----------------------------------------------------------------
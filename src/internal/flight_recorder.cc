@@ -0,0 +1,376 @@
+#include "broker/internal/flight_recorder.hh"
+
+#include "broker/config.hh"
+#include "broker/detail/assert.hh"
+#include "broker/error.hh"
+#include "broker/internal/logger.hh"
+
+#include <caf/sec.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <utility>
+
+#ifndef BROKER_WINDOWS
+#  include <csignal>
+#  include <fcntl.h>
+#  include <sys/file.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+namespace broker::internal {
+
+// -- member types -------------------------------------------------------------
+
+struct flight_recorder::header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;
+  std::atomic<uint64_t> next;
+  std::array<uint64_t, 4> reserved;
+};
+
+struct flight_recorder::slot {
+  std::atomic<uint64_t> seq;
+  flight_record data;
+};
+
+namespace {
+
+// Plain versions of the header and slots for snapshots and decoding. Must have
+// the same memory layout as their counterparts with atomic members.
+
+struct plain_header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;
+  uint64_t next;
+  std::array<uint64_t, 4> reserved;
+};
+
+struct plain_slot {
+  uint64_t seq;
+  flight_record data;
+};
+
+static_assert(sizeof(plain_header) == 64);
+
+static_assert(sizeof(plain_slot) == 64);
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t));
+
+#ifndef BROKER_WINDOWS
+
+// State for dumping the records of a recorder in a signal handler. The handler
+// may only call async-signal-safe functions. Hence, we prepare the file name
+// in advance.
+
+std::atomic<const void*> signal_buf;
+
+std::atomic<size_t> signal_buf_size;
+
+// Counts how many threads currently run the signal handler. A recorder waits
+// until no handler reads from its memory before unmapping it.
+std::atomic<int> signal_handlers_active;
+
+char signal_file[4096];
+
+struct sigaction signal_prev_action;
+
+int signal_number = 0;
+
+extern "C" void flight_recorder_on_signal(int) {
+  // Note: we must announce the handler before reading signal_buf. Otherwise,
+  //       `close` could miss a handler that is about to read the buffer.
+  ++signal_handlers_active;
+  auto buf = static_cast<const char*>(signal_buf.load());
+  if (buf == nullptr) {
+    --signal_handlers_active;
+    return;
+  }
+  auto saved_errno = errno;
+  auto fd = ::open(signal_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    auto remaining = signal_buf_size.load();
+    while (remaining > 0) {
+      auto res = ::write(fd, buf, remaining);
+      if (res < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+      buf += res;
+      remaining -= static_cast<size_t>(res);
+    }
+    ::close(fd);
+  }
+  errno = saved_errno;
+  --signal_handlers_active;
+}
+
+#endif
+
+} // namespace
+
+std::string_view to_string(flight_stage x) noexcept {
+  switch (x) {
+    case flight_stage::inbound:
+      return "inbound";
+    case flight_stage::dispatch:
+      return "dispatch";
+    case flight_stage::outbound:
+      return "outbound";
+    default:
+      return "???";
+  }
+}
+
+// -- constructors, destructors, and assignment operators ----------------------
+
+flight_recorder::~flight_recorder() {
+  close();
+}
+
+// -- initialization -----------------------------------------------------------
+
+caf::error flight_recorder::open(size_t capacity,
+                                 const std::string& file_name) {
+  static_assert(sizeof(header) == sizeof(plain_header));
+  static_assert(sizeof(slot) == sizeof(plain_slot));
+  BROKER_ASSERT(capacity > 0);
+  close();
+  // Round up to the next power of two for cheap index calculation.
+  size_t cap = 1;
+  while (cap < capacity)
+    cap <<= 1;
+  auto size = sizeof(header) + cap * sizeof(slot);
+  void* ptr = nullptr;
+#ifndef BROKER_WINDOWS
+  if (file_name.empty()) {
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+      return caf::make_error(ec::cannot_open_resource,
+                             "failed to allocate flight recorder memory");
+  } else {
+    auto fd = ::open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+      return caf::make_error(ec::cannot_open_file, file_name);
+    // Only truncate the file after making sure that no other recorder, in
+    // this process or another one, writes to it. We hold the lock until
+    // closing the recorder.
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+      ::close(fd);
+      return caf::make_error(ec::cannot_open_file,
+                             "flight recorder file already in use: "
+                               + file_name);
+    }
+    if (ftruncate(fd, 0) != 0
+        || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      ::close(fd);
+      return caf::make_error(ec::cannot_write_file, file_name);
+    }
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      ::close(fd);
+      return caf::make_error(ec::cannot_open_file, file_name);
+    }
+    fd_ = fd;
+  }
+  mapped_ = true;
+#else
+  if (!file_name.empty())
+    return caf::make_error(caf::sec::unsupported_operation,
+                           "memory-mapped flight recorder files require POSIX");
+  ptr = std::calloc(size, 1);
+  if (ptr == nullptr)
+    return caf::make_error(ec::cannot_open_resource,
+                           "failed to allocate flight recorder memory");
+#endif
+  // Fresh memory is all zeros, i.e., all slots are empty.
+  header_ = new (ptr) header;
+  header_->magic = magic;
+  header_->version = version;
+  header_->record_size = sizeof(slot);
+  header_->capacity = cap;
+  header_->next = 0;
+  header_->reserved = {};
+  slots_ = reinterpret_cast<slot*>(header_ + 1);
+  mask_ = cap - 1;
+  mapped_size_ = size;
+  BROKER_DEBUG("opened flight recorder with" << cap << "slots"
+                                             << BROKER_ARG(file_name));
+  return caf::none;
+}
+
+caf::error flight_recorder::dump_on_signal(int signo, std::string file_name) {
+#ifndef BROKER_WINDOWS
+  if (!header_)
+    return caf::make_error(ec::logic_error, "flight recorder not open");
+  if (file_name.empty() || file_name.size() >= sizeof(signal_file))
+    return caf::make_error(caf::sec::invalid_argument, "invalid file name");
+  if (signal_buf.load() != nullptr || signal_number != 0)
+    return caf::make_error(ec::logic_error,
+                           "another flight recorder handles signals");
+  strncpy(signal_file, file_name.c_str(), sizeof(signal_file) - 1);
+  signal_buf_size = mapped_size_;
+  signal_buf = header_;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = flight_recorder_on_signal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(signo, &action, &signal_prev_action) != 0) {
+    signal_buf = nullptr;
+    return caf::make_error(caf::sec::invalid_argument, "invalid signal");
+  }
+  signal_number = signo;
+  return caf::none;
+#else
+  return caf::make_error(caf::sec::unsupported_operation,
+                         "signal handlers require POSIX");
+#endif
+}
+
+void flight_recorder::close() {
+  if (!header_)
+    return;
+#ifndef BROKER_WINDOWS
+  if (signal_buf.load() == header_) {
+    // Restore the previous handler and detach the buffer first. A handler
+    // that started before may still read from the buffer, so we wait for it
+    // to finish before unmapping.
+    sigaction(signal_number, &signal_prev_action, nullptr);
+    signal_number = 0;
+    signal_buf = nullptr;
+    while (signal_handlers_active.load() != 0)
+      std::this_thread::yield();
+  }
+  if (mapped_)
+    munmap(header_, mapped_size_);
+  if (fd_ >= 0) {
+    // Note: closing the file descriptor also releases the lock.
+    ::close(fd_);
+    fd_ = -1;
+  }
+#else
+  std::free(header_);
+#endif
+  header_ = nullptr;
+  slots_ = nullptr;
+  mask_ = 0;
+  mapped_size_ = 0;
+  mapped_ = false;
+}
+
+// -- properties ---------------------------------------------------------------
+
+uint64_t flight_recorder::total() const noexcept {
+  return header_ ? header_->next.load(std::memory_order_relaxed) : 0;
+}
+
+// -- recording ----------------------------------------------------------------
+
+void flight_recorder::record(flight_stage stage, packed_message_type type,
+                             std::string_view topic_str, size_t size,
+                             const endpoint_id& sender,
+                             const endpoint_id& receiver) noexcept {
+  if (!header_)
+    return;
+  using namespace std::chrono;
+  auto index = header_->next.fetch_add(1, std::memory_order_relaxed);
+  auto& dst = slots_[index & mask_];
+  // Works like a seqlock: readers discard slots with a sequence number of 0
+  // or with a sequence number that changed while reading.
+  dst.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  auto& rec = dst.data;
+  rec.time = duration_cast<nanoseconds>(system_clock::now().time_since_epoch())
+               .count();
+  rec.topic_id = topic_id(topic_str);
+  rec.size = static_cast<uint32_t>(std::min(size, size_t{UINT32_MAX}));
+  rec.type = static_cast<uint8_t>(type);
+  rec.stage = static_cast<uint8_t>(stage);
+  rec.reserved = 0;
+  rec.sender = sender.bytes();
+  rec.receiver = receiver.bytes();
+  dst.seq.store(index + 1, std::memory_order_release);
+}
+
+// -- serialization ------------------------------------------------------------
+
+std::vector<std::byte> flight_recorder::snapshot() const {
+  std::vector<std::byte> result;
+  if (!header_)
+    return result;
+  result.resize(mapped_size_);
+  plain_header hdr;
+  hdr.magic = header_->magic;
+  hdr.version = header_->version;
+  hdr.record_size = header_->record_size;
+  hdr.capacity = header_->capacity;
+  hdr.next = header_->next.load(std::memory_order_acquire);
+  hdr.reserved = {};
+  memcpy(result.data(), &hdr, sizeof(hdr));
+  auto out = result.data() + sizeof(hdr);
+  for (size_t index = 0; index <= mask_; ++index) {
+    auto& src = slots_[index];
+    plain_slot tmp;
+    tmp.seq = src.seq.load(std::memory_order_acquire);
+    memcpy(&tmp.data, &src.data, sizeof(flight_record));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (src.seq.load(std::memory_order_relaxed) != tmp.seq)
+      tmp.seq = 0;
+    memcpy(out, &tmp, sizeof(tmp));
+    out += sizeof(tmp);
+  }
+  return result;
+}
+
+caf::error flight_recorder::decode(caf::span<const std::byte> buf,
+                                   std::vector<flight_record>& result) {
+  plain_header hdr;
+  if (buf.size() < sizeof(hdr))
+    return caf::make_error(ec::end_of_file, "missing flight recorder header");
+  memcpy(&hdr, buf.data(), sizeof(hdr));
+  if (hdr.magic != magic)
+    return caf::make_error(ec::wrong_magic_number,
+                           "not a flight recorder file");
+  if (hdr.version != version)
+    return caf::make_error(ec::invalid_data,
+                           "unsupported flight recorder version");
+  if (hdr.record_size != sizeof(plain_slot))
+    return caf::make_error(ec::invalid_data, "unexpected record size");
+  if (hdr.capacity == 0 || (hdr.capacity & (hdr.capacity - 1)) != 0
+      || (buf.size() - sizeof(hdr)) / sizeof(plain_slot) < hdr.capacity)
+    return caf::make_error(ec::invalid_data, "invalid capacity");
+  std::vector<plain_slot> slots;
+  slots.reserve(std::min(hdr.capacity, hdr.next));
+  auto pos = buf.data() + sizeof(hdr);
+  for (uint64_t index = 0; index < hdr.capacity; ++index) {
+    plain_slot tmp;
+    memcpy(&tmp, pos, sizeof(tmp));
+    pos += sizeof(tmp);
+    if (tmp.seq != 0)
+      slots.emplace_back(tmp);
+  }
+  std::sort(slots.begin(), slots.end(),
+            [](const plain_slot& x, const plain_slot& y) {
+              return x.seq < y.seq;
+            });
+  result.clear();
+  result.reserve(slots.size());
+  for (auto& x : slots)
+    result.emplace_back(x.data);
+  return caf::none;
+}
+
+} // namespace broker::internal
@@ -1,6 +1,10 @@
 #include "broker/internal/json_client.hh"
 
 #include "broker/error.hh"
+#include "broker/format/json.hh"
+#include "broker/internal/cached_data_message.hh"
+#include "broker/internal/client_buffer.hh"
+#include "broker/internal/metric_factory.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/message.hh"
 #include "broker/version.hh"
@@ -12,6 +16,11 @@
 #include <caf/scheduled_actor/flow.hpp>
 #include <caf/unordered_flat_map.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <variant>
+
 using namespace std::literals;
 
 using string_map = caf::unordered_flat_map<std::string, std::string>;
@@ -26,6 +35,147 @@ constexpr std::string_view default_serialization_failed_error_str = R"_({
   "context": "internal JSON writer error"
 })_";
 
+/// Returns the first non-whitespace character in `str` or `'\0'` if `str`
+/// contains only whitespaces.
+char first_non_ws(std::string_view str) {
+  for (auto ch : str)
+    if (!isspace(static_cast<unsigned char>(ch)))
+      return ch;
+  return '\0';
+}
+
+/// Reports malformed input #`n` to the client.
+void report_malformed_input(json_client_state* state, size_t n) {
+  auto ctx = std::to_string(n);
+  ctx.insert(0, "input #");
+  ctx += " contained invalid data";
+  auto json = state->render_error(enum_str(ec::deserialization_failed), ctx);
+  state->ctrl_msgs.push(caf::cow_string{std::move(json)});
+}
+
+/// Batching options as sent by the client in the handshake.
+struct batching_config {
+  std::optional<std::string> format;
+  std::optional<int64_t> max_count;
+  std::optional<int64_t> max_bytes;
+  std::optional<int64_t> max_linger_ms;
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, batching_config& x) {
+  return f.object(x).fields(f.field("format", x.format),
+                            f.field("max-count", x.max_count),
+                            f.field("max-bytes", x.max_bytes),
+                            f.field("max-linger-ms", x.max_linger_ms));
+}
+
+/// A projection as sent by the client in the handshake.
+struct projection_config {
+  std::string topic;
+  std::vector<std::vector<size_t>> fields;
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, projection_config& x) {
+  return f.object(x).fields(f.field("topic", x.topic),
+                            f.field("fields", x.fields));
+}
+
+/// The handshake in object notation.
+struct handshake_config {
+  filter_type subscriptions;
+  std::optional<batching_config> batching;
+  std::optional<std::vector<projection_config>> projections;
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, handshake_config& x) {
+  return f.object(x).fields(f.field("subscriptions", x.subscriptions),
+                            f.field("batching", x.batching),
+                            f.field("projections", x.projections));
+}
+
+/// Parses the first message from the client. The handshake is either a JSON
+/// array with the subscriptions or a JSON object with the subscriptions plus
+/// additional options.
+caf::error parse_handshake(json_client_state* state, const caf::cow_string& str,
+                           filter_type& filter) {
+  auto& reader = state->reader;
+  if (!reader.load(str.str()))
+    return caf::make_error(caf::sec::invalid_argument,
+                           "first message must contain a filter");
+  if (first_non_ws(str.str()) != '{') {
+    if (!reader.apply(filter))
+      return caf::make_error(caf::sec::invalid_argument,
+                             "first message must contain a filter");
+    return caf::none;
+  }
+  handshake_config cfg;
+  if (!reader.apply(cfg))
+    return caf::make_error(caf::sec::invalid_argument,
+                           "malformed handshake object");
+  filter = std::move(cfg.subscriptions);
+  namespace wsd = defaults::web_socket;
+  if (cfg.projections) {
+    // Reject projections that exceed the limits instead of silently dropping
+    // parts of them. Otherwise, clients could make us perform arbitrary
+    // amounts of work for each message.
+    if (cfg.projections->size() > wsd::projection_count_limit)
+      return caf::make_error(caf::sec::invalid_argument,
+                             "too many projections");
+    for (auto& proj : *cfg.projections) {
+      if (proj.fields.empty())
+        return caf::make_error(caf::sec::invalid_argument,
+                               "a projection must select at least one field");
+      if (proj.fields.size() > wsd::projection_path_limit)
+        return caf::make_error(caf::sec::invalid_argument,
+                               "too many fields in a projection");
+      for (auto& path : proj.fields)
+        if (path.size() > wsd::projection_depth_limit)
+          return caf::make_error(caf::sec::invalid_argument,
+                                 "field path exceeds the maximum depth");
+      state->projections.push_back(
+        json_projection{topic{std::move(proj.topic)}, std::move(proj.fields)});
+    }
+  }
+  if (!cfg.batching)
+    return caf::none;
+  auto& bcfg = *cfg.batching;
+  json_batch_options opts;
+  if (bcfg.format) {
+    if (*bcfg.format == "array")
+      opts.format = json_batch_options::format_type::array;
+    else if (*bcfg.format == "ndjson")
+      opts.format = json_batch_options::format_type::ndjson;
+    else
+      return caf::make_error(caf::sec::invalid_argument,
+                             "invalid batch format; try array or ndjson");
+  }
+  if ((bcfg.max_count && *bcfg.max_count <= 0)
+      || (bcfg.max_bytes && *bcfg.max_bytes <= 0)
+      || (bcfg.max_linger_ms && *bcfg.max_linger_ms <= 0))
+    return caf::make_error(caf::sec::invalid_argument,
+                           "max-count, max-bytes and max-linger-ms must be "
+                           "positive");
+  // Clamp all values to the server-side limits. Otherwise, clients could make
+  // us buffer arbitrarily many messages for an arbitrary amount of time.
+  if (bcfg.max_count)
+    opts.max_count = std::min(static_cast<size_t>(*bcfg.max_count),
+                              wsd::batch_count_limit);
+  if (bcfg.max_bytes)
+    opts.max_bytes = std::min(static_cast<size_t>(*bcfg.max_bytes),
+                              wsd::batch_bytes_limit);
+  if (bcfg.max_linger_ms) {
+    auto max_linger_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      wsd::batch_linger_limit);
+    opts.max_linger = std::chrono::milliseconds{
+      std::min(*bcfg.max_linger_ms,
+               static_cast<int64_t>(max_linger_ms.count()))};
+  }
+  state->batching = opts;
+  return caf::none;
+}
+
 /// Catches errors by converting them into complete events instead.
 struct handshake_step {
   using input_type = caf::cow_string;
@@ -57,11 +207,8 @@ struct handshake_step {
       return next.on_next(item, steps...);
     } else {
       filter_type filter;
-      state->reader.load(item.str());
-      if (!state->reader.apply(filter)) {
+      if (auto err = parse_handshake(state, item, filter)) {
         // Received malformed input: drop remaining input and quit.
-        auto err = caf::make_error(caf::sec::invalid_argument,
-                                   "first message must contain a filter");
         next.on_error(err, steps...);
         push_to_ws = nullptr;
         pull_from_core = nullptr;
@@ -86,6 +233,141 @@ struct handshake_step {
   }
 };
 
+/// Parses JSON input from the client. Each input is either a single data
+/// message or a JSON array of data messages.
+struct parse_step {
+  using input_type = caf::cow_string;
+
+  using output_type = data_message;
+
+  json_client_state* state;
+
+  size_t n = 0;
+
+  /// Stores decoded messages. We either publish all or none of the messages
+  /// in a batch.
+  std::vector<std::pair<topic, data>> batch;
+
+  template <class Next, class... Steps>
+  bool on_next(const input_type& item, Next& next, Steps&... steps) {
+    ++n;
+    batch.clear();
+    if (!format::json::v1::decode_data_messages(item.str(), batch)) {
+      report_malformed_input(state, n);
+      return true;
+    }
+    for (auto& [t, d] : batch)
+      if (!next.on_next(make_data_message(std::move(t), std::move(d)),
+                        steps...))
+        return false;
+    return true;
+  }
+
+  template <class Next, class... Steps>
+  void on_complete(Next& next, Steps&... steps) {
+    next.on_complete(steps...);
+  }
+
+  template <class Next, class... Steps>
+  void on_error(const caf::error& what, Next& next, Steps&... steps) {
+    next.on_error(what, steps...);
+  }
+};
+
+/// Asks the batching step to emit the batch with the given generation.
+struct flush_tick {
+  size_t generation;
+};
+
+/// Input of the batching step: either a rendered message or a flush tick.
+using batch_input = std::variant<caf::cow_string, flush_tick>;
+
+/// Bundles rendered JSON messages into batches. A flush tick forces the step
+/// to emit the current batch unless the tick belongs to an earlier batch.
+struct batch_step {
+  using input_type = batch_input;
+
+  using output_type = caf::cow_string;
+
+  json_client_state* state;
+
+  json_batch_options opts;
+
+  std::string buf;
+
+  size_t count = 0;
+
+  /// Increases with each emitted batch. A timeout may fire after the step
+  /// already emitted its batch, because the flush tick travels through the
+  /// pipeline asynchronously. Comparing generations allows us to drop such
+  /// stale ticks instead of cutting the next batch short.
+  size_t generation = 0;
+
+  caf::disposable timeout;
+
+  batch_step(json_client_state* state_ptr, json_batch_options opts)
+    : state(state_ptr), opts(opts) {
+    // nop
+  }
+
+  bool is_array() const noexcept {
+    return opts.format == json_batch_options::format_type::array;
+  }
+
+  template <class Next, class... Steps>
+  bool flush(Next& next, Steps&... steps) {
+    timeout.dispose();
+    if (count == 0)
+      return true;
+    if (is_array())
+      buf += ']';
+    count = 0;
+    ++generation;
+    caf::cow_string frame{std::move(buf)};
+    buf = std::string{};
+    return next.on_next(frame, steps...);
+  }
+
+  template <class Next, class... Steps>
+  bool on_next(const input_type& input, Next& next, Steps&... steps) {
+    if (auto tick = std::get_if<flush_tick>(&input)) {
+      // Drop stale ticks for batches that we have emitted already.
+      if (tick->generation != generation)
+        return true;
+      return flush(next, steps...);
+    }
+    auto& item = std::get<caf::cow_string>(input);
+    if (count++ == 0) {
+      if (is_array())
+        buf += '[';
+      timeout = state->self->run_delayed(opts.max_linger,
+                                         [st = state, gen = generation] {
+                                           st->flush_ticks.push(gen);
+                                         });
+    } else if (is_array()) {
+      buf += ", ";
+    }
+    buf += item.str();
+    if (!is_array())
+      buf += '\n';
+    if (count >= opts.max_count || buf.size() >= opts.max_bytes)
+      return flush(next, steps...);
+    return true;
+  }
+
+  template <class Next, class... Steps>
+  void on_complete(Next& next, Steps&... steps) {
+    if (flush(next, steps...))
+      next.on_complete(steps...);
+  }
+
+  template <class Next, class... Steps>
+  void on_error(const caf::error& what, Next& next, Steps&... steps) {
+    timeout.dispose();
+    next.on_error(what, steps...);
+  }
+};
+
 } // namespace
 
 json_client_state::json_client_state(caf::event_based_actor* selfptr,
@@ -95,7 +377,8 @@ json_client_state::json_client_state(caf::event_based_actor* selfptr,
     id(this_node),
     core(std::move(core_hdl)),
     addr(std::move(ws_addr)),
-    ctrl_msgs(selfptr) {
+    ctrl_msgs(selfptr),
+    flush_ticks(selfptr) {
   reader.mapper(&mapper);
   writer.mapper(&mapper);
   writer.skip_object_type_annotation(true);
@@ -108,6 +391,11 @@ json_client_state::json_client_state(caf::event_based_actor* selfptr,
   });
   // Connects us to the core.
   using caf::async::make_spsc_buffer_resource;
+  // Count all bytes that we send to the client, including control messages.
+  metric_factory factory{self->system()};
+  sent_bytes =
+    factory.core.web_socket_client_instances("web-socket").sent_bytes;
+  stats = std::make_shared<client_stats>();
   // Note: structured bindings with values confuses clang-tidy's leak checker.
   auto resources = make_spsc_buffer_resource<data_message>();
   auto& [core_pull, core_push] = resources;
@@ -118,45 +406,47 @@ json_client_state::json_client_state(caf::event_based_actor* selfptr,
     .transform(handshake_step{this, std::move(out), core_pull}) // Calls init().
     .do_finally([this] { ctrl_msgs.close(); })
     // Parse all JSON coming in and forward them to the core.
-    .flat_map([this, n = 0](const caf::cow_string& str) mutable {
-      ++n;
-      std::optional<data_message> result;
-      reader.reset();
-      if (reader.load(str)) {
-        using std::get;
-        data_message msg;
-        auto decorator = decorated(msg);
-        if (reader.apply(decorator)) {
-          // Success: set the result to push it to the core actor.
-          result = std::move(msg);
-        } else {
-          // Failed to apply the JSON reader. Send error to client.
-          auto ctx = std::to_string(n);
-          ctx.insert(0, "input #");
-          ctx += " contained invalid data -> ";
-          ctx += to_string(reader.get_error());
-          auto json = render_error(enum_str(ec::deserialization_failed), ctx);
-          ctrl_msgs.push(caf::cow_string{std::move(json)});
-        }
-      } else {
-        // Failed to parse JSON.
-        auto ctx = std::to_string(n);
-        ctx.insert(0, "input #");
-        ctx += " contained malformed JSON -> ";
-        ctx += to_string(reader.get_error());
-        auto json = render_error(enum_str(ec::deserialization_failed), ctx);
-        ctrl_msgs.push(caf::cow_string{std::move(json)});
-      }
-      return result;
-    })
+    .transform(parse_step{this})
     .subscribe(core_push);
 }
 
+data json_projection::apply(const data& x) const {
+  vector result;
+  result.reserve(paths.size());
+  for (const auto& path : paths) {
+    auto ptr = &x;
+    for (auto index : path) {
+      auto vec = get_if<vector>(ptr);
+      if (!vec || index >= vec->size()) {
+        ptr = nullptr;
+        break;
+      }
+      ptr = &(*vec)[index];
+    }
+    if (ptr)
+      result.emplace_back(*ptr);
+    else
+      result.emplace_back(nil);
+  }
+  return data{std::move(result)};
+}
+
 json_client_state::~json_client_state() {
   for (auto& sub : subscriptions)
     sub.dispose();
 }
 
+const json_projection*
+json_client_state::projection_for(const topic& t) const noexcept {
+  const json_projection* result = nullptr;
+  for (const auto& proj : projections)
+    if (proj.prefix.prefix_of(t)
+        && (!result || proj.prefix.string().size()
+                         > result->prefix.string().size()))
+      result = &proj;
+  return result;
+}
+
 std::string json_client_state::render_error(std::string_view code,
                                             std::string_view context) {
   string_map obj;
@@ -176,71 +466,69 @@ std::string json_client_state::render_ack() {
   return render(obj);
 }
 
-struct const_data_message_decorator {
-  const topic& t;
-  const data& d;
-};
-
-const_data_message_decorator decorated(const data_message& msg) {
-  auto& [t, d] = msg.data();
-  return const_data_message_decorator{t, d};
-}
-
-template <class Inspector>
-bool inspect(Inspector& f, const_data_message_decorator& x) {
-  static_assert(!Inspector::is_loading);
-  auto do_inspect = [&f, &x](const auto& val) -> bool {
-    json_type_mapper tm;
-    using val_t = std::decay_t<decltype(val)>;
-    auto type = "data-message"s;
-    auto dtype = to_string(tm(caf::type_id_v<val_t>));
-    // Note: const_cast is safe since we assert that the inspector is saving.
-    return f.object(x).fields(f.field("type", type),
-                              f.field("topic", const_cast<topic&>(x.t)),
-                              f.field("@data-type", dtype),
-                              f.field("data", const_cast<val_t&>(val)));
-  };
-  return visit(do_inspect, x.d);
-}
-
 void json_client_state::init(
   const filter_type& filter, const out_t& out,
   caf::async::consumer_resource<data_message> core_pull1) {
   using caf::async::make_spsc_buffer_resource;
+  auto count_bytes = [ptr = sent_bytes,
+                      st = stats](const caf::cow_string& str) {
+    auto num_bytes = static_cast<int64_t>(str.str().size());
+    ptr->inc(num_bytes);
+    st->sent_bytes += num_bytes;
+  };
   // Pull data from the core and forward as JSON.
   if (!filter.empty()) {
     // Note: structured bindings with values confuses clang-tidy's leak checker.
-    auto resources = make_spsc_buffer_resource<data_message>();
+    auto resources = make_spsc_buffer_resource<cached_data_message_ptr>();
     auto& [core_pull2, core_push2] = resources;
     auto core_json = //
       self->make_observable()
         .from_resource(core_pull2)
-        .map([this](const data_message& msg) -> caf::cow_string {
-          writer.reset();
-          auto decorator = decorated(msg);
-          if (writer.apply(decorator)) {
-            // Serialization OK, forward message to client.
-            auto json = writer.str();
-            auto str = std::string{json.begin(), json.end()};
-            return caf::cow_string{std::move(str)};
-          } else {
-            // Report internal error to client.
-            auto ctx = to_string(writer.get_error().context());
-            auto str = render_error(enum_str(ec::serialization_failed), ctx);
+        .map([this](const cached_data_message_ptr& msg) -> caf::cow_string {
+          // Projected messages are specific to this client. Hence, we cannot
+          // use the cache for them.
+          if (auto proj = projection_for(msg->get_topic())) {
+            std::string str;
+            format::json::v1::encode_data_message(
+              msg->get_topic(), proj->apply(get_data(msg->msg())), str);
             return caf::cow_string{std::move(str)};
           }
+          // Only the first client renders the message, others re-use the
+          // cached JSON string.
+          return msg->json([](const data_message& dmsg) {
+            std::string str;
+            format::json::v1::encode_data_message(get_topic(dmsg),
+                                                  get_data(dmsg), str);
+            return caf::cow_string{std::move(str)};
+          });
         })
         .as_observable();
-    auto sub = ctrl_msgs.as_observable().merge(core_json).subscribe(out);
+    if (batching) {
+      // Bundle messages into batches, flushing partial batches on timeout.
+      auto to_tick = [](size_t gen) { return batch_input{flush_tick{gen}}; };
+      auto ticks = flush_ticks.as_observable().map(to_tick).as_observable();
+      core_json = core_json //
+                    .map([](const caf::cow_string& str) {
+                      return batch_input{str};
+                    })
+                    .do_finally([this] { flush_ticks.close(); })
+                    .merge(std::move(ticks))
+                    .transform(batch_step{this, *batching})
+                    .as_observable();
+    }
+    auto sub = ctrl_msgs.as_observable()
+                 .merge(core_json)
+                 .do_on_next(count_bytes)
+                 .subscribe(out);
     subscriptions.push_back(std::move(sub));
     caf::anon_send(core, atom::attach_client_v, addr, "web-socket"s, filter,
-                   std::move(core_pull1), std::move(core_push2));
+                   std::move(core_pull1), std::move(core_push2), stats);
   } else {
-    auto sub = ctrl_msgs.as_observable().subscribe(out);
+    auto sub = ctrl_msgs.as_observable().do_on_next(count_bytes).subscribe(out);
     subscriptions.push_back(std::move(sub));
     caf::anon_send(core, atom::attach_client_v, addr, "web-socket"s,
                    filter_type{}, std::move(core_pull1),
-                   caf::async::producer_resource<data_message>{});
+                   cached_data_producer_res{}, stats);
   }
   // Setup complete. Send ACK to the client.
   ctrl_msgs.push(caf::cow_string{render_ack()});
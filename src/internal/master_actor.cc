@@ -17,10 +17,14 @@
 #include "broker/detail/die.hh"
 #include "broker/internal/master_actor.hh"
 #include "broker/internal/metric_factory.hh"
+#include "broker/internal/probes.hh"
 #include "broker/store.hh"
 #include "broker/time.hh"
 #include "broker/topic.hh"
 
+#undef BROKER_LOG_COMPONENT
+#define BROKER_LOG_COMPONENT store
+
 using namespace std::literals;
 
 namespace broker::internal {
@@ -209,7 +213,9 @@ void master_state::set_expire_time(const data& key,
 
 void master_state::consume(consumer_type*, command_message& msg) {
   auto f = [this](auto& cmd) { consume(cmd); };
-  std::visit(f, get<1>(msg.unshared()).content);
+  auto& content = get<1>(msg.unshared()).content;
+  BROKER_PROBE(master_apply, content.index());
+  std::visit(f, content);
 }
 
 void master_state::consume(put_command& x) {
@@ -4,12 +4,87 @@
 
 #include "broker/internal/logger.hh"
 
+#include <charconv>
+#include <cmath>
+
+#ifdef BROKER_HAS_ZLIB
+#  include <zlib.h>
+#endif
+
 namespace ct = caf::telemetry;
 
 namespace broker::internal {
 
 namespace {
 
+void append_value(std::string& buf, integer value) {
+  char tmp[24];
+  auto res = std::to_chars(tmp, tmp + sizeof(tmp), value);
+  buf.append(tmp, res.ptr);
+}
+
+void append_value(std::string& buf, real value) {
+  if (std::isnan(value)) {
+    buf += "NaN";
+  } else if (std::isinf(value)) {
+    buf += value > 0 ? "+Inf" : "-Inf";
+  } else {
+    char tmp[32];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    buf.append(tmp, res.ptr);
+  }
+}
+
+// Escapes backslashes and newlines plus (optionally) double quotes.
+void append_escaped(std::string& buf, std::string_view str, bool quotes) {
+  for (auto ch : str) {
+    switch (ch) {
+      case '\\':
+        buf += "\\\\";
+        break;
+      case '\n':
+        buf += "\\n";
+        break;
+      case '"':
+        if (quotes)
+          buf += "\\\"";
+        else
+          buf += ch;
+        break;
+      default:
+        buf += ch;
+    }
+  }
+}
+
+// Renders the name of a metric family the same way CAF does.
+std::string prometheus_name(const ct::metric_family* family) {
+  std::string result;
+  result += family->prefix();
+  result += '_';
+  result += family->name();
+  if (family->unit() != "1") {
+    result += '_';
+    result += family->unit();
+  }
+  if (family->is_sum())
+    result += "_total";
+  return result;
+}
+
+std::string_view prometheus_type(ct::metric_type type) {
+  switch (type) {
+    case ct::metric_type::int_counter:
+    case ct::metric_type::dbl_counter:
+      return "counter";
+    case ct::metric_type::int_gauge:
+    case ct::metric_type::dbl_gauge:
+      return "gauge";
+    default:
+      return "histogram";
+  }
+}
+
 template <class T>
 class remote_counter : public metric_collector::remote_metric {
 public:
@@ -23,14 +98,26 @@ public:
 
   void update(metric_view mv) override {
     if (mv.type() == type_tag) {
-      value_ = get<T>(mv.value());
+      update(mv.value());
+    } else {
+      BROKER_ERROR("conflicting remote metric update received!");
+    }
+  }
+
+  void update(const data& value) override {
+    if (auto val = get_if<T>(value)) {
+      if (value_ != *val) {
+        value_ = *val;
+        dirty_ = true;
+      }
     } else {
       BROKER_ERROR("conflicting remote metric update received!");
     }
   }
 
-  void append_to(ct::collector::prometheus& f) override {
-    f.append_counter(this->parent_, this, value_);
+protected:
+  void render() override {
+    append_sample("", value_);
   }
 
 private:
@@ -50,14 +137,26 @@ public:
 
   void update(metric_view mv) override {
     if (mv.type() == type_tag) {
-      value_ = get<T>(mv.value());
+      update(mv.value());
+    } else {
+      BROKER_ERROR("conflicting remote metric update received!");
+    }
+  }
+
+  void update(const data& value) override {
+    if (auto val = get_if<T>(value)) {
+      if (value_ != *val) {
+        value_ = *val;
+        dirty_ = true;
+      }
     } else {
       BROKER_ERROR("conflicting remote metric update received!");
     }
   }
 
-  void append_to(ct::collector::prometheus& f) override {
-    f.append_gauge(this->parent_, this, value_);
+protected:
+  void render() override {
+    append_sample("", value_);
   }
 
 private:
@@ -75,41 +174,61 @@ public:
 
   using super::super;
 
-  using native_bucket = typename ct::histogram<T>::bucket_type;
-
   void update(metric_view mv) override {
     if (mv.type() == type_tag) {
-      auto& vals = get<vector>(mv.value());
-      BROKER_ASSERT(vals.size() >= 2);
-      buckets_.clear();
-      std::for_each(vals.begin(), vals.end() - 1, [this](const auto& kvp_data) {
-        auto& kvp = get<vector>(kvp_data);
-        buckets_.emplace_back(get<T>(kvp[0]), get<integer>(kvp[1]));
-      });
-      sum_ = get<T>(vals.back());
+      update(mv.value());
     } else {
       BROKER_ERROR("conflicting remote metric update received!");
     }
   }
 
-  void append_to(ct::collector::prometheus& f) override {
-    // The CAF collector expects histogram buckets, which have a `counter`
-    // member. Since we can't assign values to counters (only increase them), we
-    // work around this limitations by simply re-creating the "native" buckets
-    // each time.
-    std::unique_ptr<native_bucket[]> buf{new native_bucket[buckets_.size()]};
+  void update(const data& value) override {
+    auto vals = get_if<vector>(value);
+    if (vals == nullptr || vals->size() < 2) {
+      BROKER_ERROR("conflicting remote metric update received!");
+      return;
+    }
+    tmp_.clear();
+    std::for_each(vals->begin(), vals->end() - 1, [this](const auto& kvp_data) {
+      auto& kvp = get<vector>(kvp_data);
+      tmp_.emplace_back(get<T>(kvp[0]), get<integer>(kvp[1]));
+    });
+    auto sum = get<T>(vals->back());
+    if (tmp_ != buckets_ || sum != sum_) {
+      buckets_.swap(tmp_);
+      sum_ = sum;
+      dirty_ = true;
+    }
+  }
+
+protected:
+  void render() override {
+    // The buckets store the count per bucket, whereas Prometheus expects
+    // cumulative counts. The last bucket always represents +Inf.
+    integer total = 0;
     for (size_t index = 0; index < buckets_.size(); ++index) {
       auto [upper_bound, count] = buckets_[index];
-      buf[index].upper_bound = upper_bound;
-      if (count > 0)
-        buf[index].count.inc(count);
+      total += count;
+      text_ += name_;
+      text_ += "_bucket";
+      text_ += labels_;
+      text_ += labels_.empty() ? "{" : ",";
+      text_ += "le=\"";
+      if (index + 1 < buckets_.size())
+        append_value(text_, upper_bound);
+      else
+        text_ += "+Inf";
+      text_ += "\"} ";
+      append_value(text_, total);
+      text_ += '\n';
     }
-    auto buf_span = caf::make_span(buf.get(), buckets_.size());
-    f.append_histogram(this->parent_, this, buf_span, sum_);
+    append_sample("_sum", sum_);
+    append_sample("_count", total);
   }
 
 private:
   std::vector<std::pair<T, int64_t>> buckets_;
+  std::vector<std::pair<T, int64_t>> tmp_;
   T sum_ = 0;
 };
 
@@ -120,14 +239,57 @@ private:
 metric_collector::remote_metric::remote_metric(
   std::vector<caf::telemetry::label> labels,
   const caf::telemetry::metric_family* parent)
-  : super(std::move(labels)), parent_(parent) {
-  // nop
+  : super(std::move(labels)), parent_(parent), name_(prometheus_name(parent)) {
+  // Note: the histogram rendering relies on `labels_` not having the closing
+  //       brace in order to add the "le" label.
+  auto first = true;
+  for (const auto& lbl : this->labels()) {
+    labels_ += first ? '{' : ',';
+    first = false;
+    labels_ += lbl.name();
+    labels_ += "=\"";
+    append_escaped(labels_, lbl.value(), true);
+    labels_ += '"';
+  }
 }
 
 metric_collector::remote_metric::~remote_metric() {
   // nop
 }
 
+std::string_view metric_collector::remote_metric::prometheus_text() {
+  if (dirty_) {
+    text_.clear();
+    render();
+    dirty_ = false;
+  }
+  return text_;
+}
+
+template <class T>
+void metric_collector::remote_metric::append_sample_impl(
+  std::string_view suffix, T value) {
+  text_ += name_;
+  text_ += suffix;
+  if (!labels_.empty()) {
+    text_ += labels_;
+    text_ += '}';
+  }
+  text_ += ' ';
+  append_value(text_, value);
+  text_ += '\n';
+}
+
+void metric_collector::remote_metric::append_sample(std::string_view suffix,
+                                                    integer value) {
+  append_sample_impl(suffix, value);
+}
+
+void metric_collector::remote_metric::append_sample(std::string_view suffix,
+                                                    real value) {
+  append_sample_impl(suffix, value);
+}
+
 // --- constructors and destructors --------------------------------------------
 
 metric_collector::metric_collector() {
@@ -148,9 +310,13 @@ size_t metric_collector::insert_or_update(const data& content) {
 }
 
 size_t metric_collector::insert_or_update(const vector& vec) {
+  // The meta data consists of the endpoint name plus timestamp. Delta-encoded
+  // metrics add the epoch as third field.
   auto has_meta_data = [](const data& x) {
-    if (auto meta = get_if<vector>(x); meta && meta->size() == 2)
-      return is<std::string>((*meta)[0]) && is<timestamp>((*meta)[1]);
+    if (auto meta = get_if<vector>(x);
+        meta && (meta->size() == 2 || meta->size() == 3))
+      return is<std::string>((*meta)[0]) && is<timestamp>((*meta)[1])
+             && (meta->size() == 2 || is<timestamp>((*meta)[2]));
     else
       return false;
   };
@@ -158,8 +324,11 @@ size_t metric_collector::insert_or_update(const vector& vec) {
     auto& meta = get<vector>(vec[0]);
     auto& endpoint_name = get<std::string>(meta[0]);
     auto& ts = get<timestamp>(meta[1]);
-    return insert_or_update(endpoint_name, ts,
-                            caf::make_span(vec.data() + 1, vec.size() - 1));
+    auto rows = caf::make_span(vec.data() + 1, vec.size() - 1);
+    if (meta.size() == 3)
+      return insert_or_update(endpoint_name, ts, get<timestamp>(meta[2]),
+                              rows);
+    return insert_or_update(endpoint_name, ts, rows);
   } else {
     return 0;
   }
@@ -175,29 +344,109 @@ size_t metric_collector::insert_or_update(const std::string& endpoint_name,
       if (auto mv = metric_view{row_data})
         if (auto ptr = instance(endpoint_name, mv)) {
           ptr->update(mv);
+          changed_ |= ptr->dirty();
           ++res;
         }
   return res;
 }
 
+size_t metric_collector::insert_or_update(const std::string& endpoint_name,
+                                          timestamp ts, timestamp epoch,
+                                          caf::span<const data> rows) {
+  auto res = size_t{0};
+  if (!advance_time(endpoint_name, ts))
+    return res;
+  // A new epoch means that the sender has assigned new IDs to its metrics.
+  auto& state = delta_states_[endpoint_name];
+  if (state.epoch != epoch) {
+    state.epoch = epoch;
+    state.metrics.clear();
+  }
+  for (const auto& row_data : rows) {
+    auto row = get_if<vector>(row_data);
+    if (row == nullptr || row->size() != 2 || !is<count>((*row)[0]))
+      continue;
+    auto id = get<count>((*row)[0]);
+    if (auto mv = metric_view{(*row)[1]}) {
+      // The row contains the full definition of the metric.
+      if (auto ptr = instance(endpoint_name, mv)) {
+        ptr->update(mv);
+        changed_ |= ptr->dirty();
+        state.metrics[id] = ptr;
+        ++res;
+      }
+    } else if (auto i = state.metrics.find(id); i != state.metrics.end()) {
+      i->second->update((*row)[1]);
+      changed_ |= i->second->dirty();
+      ++res;
+    }
+    // Else: we have missed the definition for this ID. We will receive it
+    // again with the next full refresh.
+  }
+  return res;
+}
+
 std::string_view metric_collector::prometheus_text() {
-  if (generator_.begin_scrape()) {
-    for (auto& [prefix, names] : prefixes_)
-      for (auto& [name, scope] : names)
+  if (changed_) {
+    text_.clear();
+    for (auto& [prefix, names] : prefixes_) {
+      for (auto& [name, scope] : names) {
+        if (scope.instances.empty())
+          continue;
+        text_ += scope.header;
         for (auto& instance : scope.instances)
-          instance->append_to(generator_);
-    generator_.end_scrape();
+          text_ += instance->prometheus_text();
+      }
+    }
+    changed_ = false;
+#ifdef BROKER_HAS_ZLIB
+    gzip_text_.clear();
+#endif
   }
-  auto res = generator_.str();
-  return {res.data(), res.size()};
+  return text_;
 }
 
+#ifdef BROKER_HAS_ZLIB
+
+caf::span<const std::byte> metric_collector::prometheus_text_gzip() {
+  auto text = prometheus_text();
+  if (!gzip_text_.empty() || text.empty())
+    return gzip_text_;
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  // Adding 16 to the window bits selects the gzip format.
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY)
+      != Z_OK)
+    return gzip_text_;
+  gzip_text_.resize(deflateBound(&strm, static_cast<uLong>(text.size())));
+  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+  strm.avail_in = static_cast<uInt>(text.size());
+  strm.next_out = reinterpret_cast<Bytef*>(gzip_text_.data());
+  strm.avail_out = static_cast<uInt>(gzip_text_.size());
+  if (deflate(&strm, Z_FINISH) == Z_STREAM_END)
+    gzip_text_.resize(strm.total_out);
+  else
+    gzip_text_.clear();
+  deflateEnd(&strm);
+  return gzip_text_;
+}
+
+#endif // BROKER_HAS_ZLIB
+
 void metric_collector::clear() {
   labels_.clear();
   label_names_.clear();
   prefixes_.clear();
   last_seen_.clear();
-  generator_.reset();
+  delta_states_.clear();
+  text_.clear();
+  changed_ = false;
+#ifdef BROKER_HAS_ZLIB
+  gzip_text_.clear();
+#endif
 }
 
 // -- time management ----------------------------------------------------------
@@ -280,6 +529,16 @@ metric_collector::instance(const std::string& endpoint_name, metric_view mv) {
                                      owned(label_names_for(mv)), mv.helptext(),
                                      mv.unit(), mv.is_sum());
     scope.family.reset(ptr);
+    auto name = prometheus_name(ptr);
+    scope.header += "# HELP ";
+    scope.header += name;
+    scope.header += ' ';
+    append_escaped(scope.header, ptr->helptext(), false);
+    scope.header += "\n# TYPE ";
+    scope.header += name;
+    scope.header += ' ';
+    scope.header += prometheus_type(ptr->type());
+    scope.header += '\n';
   }
   auto* fptr = scope.family.get();
   auto labels = labels_for(endpoint_name, mv);
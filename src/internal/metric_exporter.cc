@@ -28,6 +28,9 @@ metric_exporter_params::from(const caf::actor_system_config& cfg) {
                                   defaults::metrics::export_interval);
     if (result.interval.count() == 0)
       result.interval = defaults::metrics::export_interval;
+    result.delta = caf::get_or(*dict, "delta", false);
+    result.full_refresh_interval = caf::get_or(
+      *dict, "full-refresh-interval", defaults::metrics::full_refresh_interval);
   }
   return result;
 }
@@ -1,6 +1,7 @@
 #include "broker/internal/metric_factory.hh"
 
 #include <caf/actor_system.hpp>
+#include <caf/span.hpp>
 
 namespace broker::internal {
 
@@ -79,6 +80,159 @@ core_t::buffered_messages_t core_t::buffered_messages_instances() {
   };
 }
 
+int_histogram_family* core_t::payload_size_family() {
+  static constexpr int64_t bounds[] = {64,    256,    1024,    4096,
+                                       16384, 65536, 262144, 1048576};
+  return reg_->histogram_family("broker", "payload-size", {"type"},
+                                caf::make_span(bounds),
+                                "Payload size of sampled messages.",
+                                "bytes");
+}
+
+core_t::payload_size_t core_t::payload_size_instances() {
+  auto fm = payload_size_family();
+  return {
+    fm->get_or_add({{"type", "data"}}),
+    fm->get_or_add({{"type", "command"}}),
+    fm->get_or_add({{"type", "routing-update"}}),
+    fm->get_or_add({{"type", "ping"}}),
+    fm->get_or_add({{"type", "pong"}}),
+  };
+}
+
+dbl_histogram_family* core_t::stage_latency_family() {
+  static constexpr double bounds[] = {0.00001, 0.0001, 0.001, 0.01, 0.1, 1.0};
+  return reg_->histogram_family<double>(
+    "broker", "stage-latency", {"stage"}, caf::make_span(bounds),
+    "Time that sampled messages spend in a stage of the pipeline.", "seconds");
+}
+
+core_t::stage_latency_t core_t::stage_latency_instances() {
+  auto fm = stage_latency_family();
+  return {
+    fm->get_or_add({{"stage", "publish"}}),
+    fm->get_or_add({{"stage", "forward"}}),
+    fm->get_or_add({{"stage", "write"}}),
+    fm->get_or_add({{"stage", "deliver"}}),
+  };
+}
+
+int_counter* core_t::latency_stamp_collisions_instance() {
+  return reg_->counter_singleton(
+    "broker", "latency-stamp-collisions",
+    "Number of sampled messages that lost their timestamp due to collisions.",
+    "1", true);
+}
+
+namespace {
+
+constexpr double trace_latency_bounds[] = {0.0001, 0.0005, 0.001, 0.005, 0.01,
+                                           0.05,   0.1,    0.5,   1.0};
+
+} // namespace
+
+dbl_histogram_family* core_t::trace_one_way_latency_family() {
+  return reg_->histogram_family<double>(
+    "broker", "trace-one-way-latency", {"origin", "prefix"},
+    caf::make_span(trace_latency_bounds),
+    "Time that traced messages take from their origin to this endpoint.",
+    "seconds");
+}
+
+dbl_histogram_family* core_t::trace_hop_latency_family() {
+  return reg_->histogram_family<double>(
+    "broker", "trace-hop-latency", {"origin", "prefix"},
+    caf::make_span(trace_latency_bounds),
+    "Time that traced messages take from the last hop to this endpoint.",
+    "seconds");
+}
+
+int_gauge_family* core_t::web_socket_queued_messages_family() {
+  return reg_->gauge_family(
+    "broker", "web-socket-queued-messages", {"type"},
+    "Number of messages in the output buffers of WebSocket clients.");
+}
+
+int_counter_family* core_t::web_socket_dropped_messages_family() {
+  return reg_->counter_family(
+    "broker", "web-socket-dropped-messages", {"type"},
+    "Total number of messages dropped for slow WebSocket clients.", "1",
+    true);
+}
+
+int_counter_family* core_t::web_socket_sent_bytes_family() {
+  return reg_->counter_family("broker", "web-socket-sent", {"type"},
+                              "Total number of bytes sent to WebSocket "
+                              "clients.",
+                              "bytes", true);
+}
+
+core_t::web_socket_client_t
+core_t::web_socket_client_instances(std::string_view type) {
+  return {
+    web_socket_queued_messages_family()->get_or_add({{"type", type}}),
+    web_socket_dropped_messages_family()->get_or_add({{"type", type}}),
+    web_socket_sent_bytes_family()->get_or_add({{"type", type}}),
+  };
+}
+
+int_gauge_family* core_t::topic_messages_family() {
+  return reg_->gauge_family(
+    "broker", "topic-messages", {"direction", "topic"},
+    "Estimated number of messages on the heaviest topics.");
+}
+
+int_gauge_family* core_t::topic_volume_family() {
+  return reg_->gauge_family("broker", "topic-volume", {"direction", "topic"},
+                            "Estimated number of bytes on the heaviest topics.",
+                            "bytes");
+}
+
+int_gauge_family* core_t::flow_buffered_messages_family() {
+  return reg_->gauge_family(
+    "broker", "flow-buffered-messages", {"flow"},
+    "Largest number of messages that wait in the next stage of a flow.");
+}
+
+int_gauge_family* core_t::flow_high_water_mark_family() {
+  return reg_->gauge_family(
+    "broker", "flow-high-water-mark", {"flow"},
+    "Largest number of messages that waited in the next stage of a flow.");
+}
+
+dbl_gauge_family* core_t::flow_stall_time_family() {
+  return reg_->gauge_family<double>(
+    "broker", "flow-stall-time", {"flow"},
+    "Largest accumulated time that a flow spent without demand.", "seconds");
+}
+
+dbl_gauge_family* core_t::flow_idle_time_family() {
+  return reg_->gauge_family<double>(
+    "broker", "flow-idle-time", {"flow"},
+    "Largest time since a flow delivered its last message.", "seconds");
+}
+
+core_t::flows_t core_t::flow_instances() {
+  auto buffered = flow_buffered_messages_family();
+  auto hwm = flow_high_water_mark_family();
+  auto stall = flow_stall_time_family();
+  auto idle = flow_idle_time_family();
+  auto get = [&](std::string_view flow) {
+    return flow_t{
+      buffered->get_or_add({{"flow", flow}}),
+      hwm->get_or_add({{"flow", flow}}),
+      stall->get_or_add({{"flow", flow}}),
+      idle->get_or_add({{"flow", flow}}),
+    };
+  };
+  return {
+    get("peer-input"),
+    get("peer-output"),
+    get("local-subscriber"),
+    get("local-publisher"),
+  };
+}
+
 // -- store metrics ------------------------------------------------------------
 
 using store_t = metric_factory::store_t;
@@ -12,6 +12,7 @@
 #include "broker/detail/next_tick.hh"
 #include "broker/internal/logger.hh"
 #include "broker/message.hh"
+#include "broker/telemetry/sharded.hh"
 
 namespace ct = caf::telemetry;
 
@@ -90,61 +91,105 @@ void metric_scraper::scrape(caf::telemetry::metric_registry& registry) {
     rows_.emplace_back(std::move(meta));
   }
   BROKER_ASSERT(rows_.size() == 1);
+  instances_.clear();
+  telemetry::sharded_metric::flush_all();
   registry.collect(*this);
 }
 
+const vector& metric_scraper::encode_delta() {
+  BROKER_ASSERT(!rows_.empty());
+  BROKER_ASSERT(rows_.size() == instances_.size() + 1);
+  // Start a new epoch whenever we start over with an empty state. This allows
+  // receivers to detect a restart of this scraper.
+  if (interned_.empty())
+    epoch_ = last_scrape_;
+  auto refresh = full_refresh_interval_ > 0
+                 && encoded_since_refresh_ >= full_refresh_interval_;
+  if (refresh)
+    encoded_since_refresh_ = 0;
+  ++encoded_since_refresh_;
+  delta_rows_.clear();
+  vector meta;
+  meta.reserve(3);
+  meta.emplace_back(id_);
+  meta.emplace_back(last_scrape_);
+  meta.emplace_back(epoch_);
+  delta_rows_.emplace_back(std::move(meta));
+  for (size_t index = 0; index < instances_.size(); ++index) {
+    const auto& row = get<vector>(rows_[index + 1]);
+    const auto& value = row.back();
+    auto [i, added] = interned_.try_emplace(instances_[index]);
+    auto& entry = i->second;
+    if (added) {
+      entry.id = interned_.size() - 1;
+      entry.value = value;
+      delta_rows_.emplace_back(vector{entry.id, row});
+    } else if (refresh) {
+      entry.value = value;
+      delta_rows_.emplace_back(vector{entry.id, row});
+    } else if (entry.value != value) {
+      entry.value = value;
+      delta_rows_.emplace_back(vector{entry.id, value});
+    }
+  }
+  return delta_rows_;
+}
+
 void metric_scraper::id(std::string new_id) {
   id_ = std::move(new_id);
   rows_.clear(); // Force re-creation of the meta information on next scrape.
+  // Receivers know our metrics only by the previous ID. Hence, we need to send
+  // all definitions again.
+  interned_.clear();
+  encoded_since_refresh_ = 0;
 }
 
 void metric_scraper::operator()(const ct::metric_family* family,
                                 const ct::metric* instance,
                                 const ct::dbl_counter* counter) {
   if (selected(family))
-    add_row(family, "counter", to_table(instance->labels()), counter->value());
+    add_row(family, instance, "counter", counter->value());
 }
 
 void metric_scraper::operator()(const ct::metric_family* family,
                                 const ct::metric* instance,
                                 const ct::int_counter* counter) {
   if (selected(family))
-    add_row(family, "counter", to_table(instance->labels()), counter->value());
+    add_row(family, instance, "counter", counter->value());
 }
 
 void metric_scraper::operator()(const ct::metric_family* family,
                                 const ct::metric* instance,
                                 const ct::dbl_gauge* gauge) {
   if (selected(family))
-    add_row(family, "gauge", to_table(instance->labels()), gauge->value());
+    add_row(family, instance, "gauge", gauge->value());
 }
 
 void metric_scraper::operator()(const ct::metric_family* family,
                                 const ct::metric* instance,
                                 const ct::int_gauge* gauge) {
   if (selected(family))
-    add_row(family, "gauge", to_table(instance->labels()), gauge->value());
+    add_row(family, instance, "gauge", gauge->value());
 }
 
 void metric_scraper::operator()(const ct::metric_family* family,
                                 const ct::metric* instance,
                                 const ct::dbl_histogram* histogram) {
   if (selected(family))
-    add_row(family, "histogram", to_table(instance->labels()),
-            pack_histogram(histogram));
+    add_row(family, instance, "histogram", pack_histogram(histogram));
 }
 
 void metric_scraper::operator()(const ct::metric_family* family,
                                 const ct::metric* instance,
                                 const ct::int_histogram* histogram) {
   if (selected(family))
-    add_row(family, "histogram", to_table(instance->labels()),
-            pack_histogram(histogram));
+    add_row(family, instance, "histogram", pack_histogram(histogram));
 }
 
 template <class T>
 void metric_scraper::add_row(const caf::telemetry::metric_family* family,
-                             std::string type, table labels, T value) {
+                             const caf::telemetry::metric* instance,
+                             std::string type, T value) {
   vector row;
   row.reserve(8);
   row.emplace_back(family->prefix());
@@ -153,9 +198,10 @@ void metric_scraper::add_row(const caf::telemetry::metric_family* family,
   row.emplace_back(family->unit());
   row.emplace_back(family->helptext());
   row.emplace_back(family->is_sum());
-  row.emplace_back(std::move(labels));
+  row.emplace_back(to_table(instance->labels()));
   row.emplace_back(std::move(value));
   rows_.emplace_back(std::move(row));
+  instances_.emplace_back(instance);
 }
 
 } // namespace broker::internal
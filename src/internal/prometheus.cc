@@ -1,6 +1,8 @@
 #include "broker/internal/prometheus.hh"
 
+#include <cctype>
 #include <memory>
+#include <optional>
 #include <string_view>
 
 #include <caf/actor_system_config.hpp>
@@ -27,6 +29,10 @@ constexpr string_view prom_request_start = "GET /metrics HTTP/1.";
 // A GET request for JSON-formatted status snapshots.
 constexpr string_view status_request_start = "GET /v1/status/json HTTP/1.";
 
+// A GET request for a binary dump of the flight recorder.
+constexpr string_view flight_recorder_request_start =
+  "GET /v1/flight-recorder HTTP/1.";
+
 // HTTP response for requests that exceed the size limit.
 constexpr string_view request_too_large =
   "HTTP/1.1 413 Request Entity Too Large\r\n"
@@ -41,13 +47,116 @@ constexpr string_view request_ok_text = "HTTP/1.1 200 OK\r\n"
                                         "Content-Type: text/plain\r\n"
                                         "Connection: Closed\r\n\r\n";
 
+// HTTP header when sending a gzip-compressed plain text.
+constexpr string_view request_ok_text_gzip = "HTTP/1.1 200 OK\r\n"
+                                             "Content-Type: text/plain\r\n"
+                                             "Content-Encoding: gzip\r\n"
+                                             "Connection: Closed\r\n\r\n";
+
+// HTTP response for requests to a disabled flight recorder.
+constexpr string_view request_not_found = "HTTP/1.1 404 Not Found\r\n"
+                                          "Connection: Closed\r\n\r\n";
+
+// HTTP header when sending binary data.
+constexpr string_view request_ok_binary =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: application/octet-stream\r\n"
+  "Connection: Closed\r\n\r\n";
+
 // HTTP header when sending a JSON.
 constexpr string_view request_ok_json = "HTTP/1.1 200 OK\r\n"
                                         "Content-Type: application/json\r\n"
                                         "Connection: Closed\r\n\r\n";
 
+// Compares `str` to the lowercase string `lower`, ignoring the case of `str`.
+bool icase_equal(string_view str, string_view lower) {
+  if (str.size() != lower.size())
+    return false;
+  for (size_t index = 0; index < str.size(); ++index)
+    if (std::tolower(static_cast<unsigned char>(str[index])) != lower[index])
+      return false;
+  return true;
+}
+
+// Removes leading and trailing whitespace from `str`.
+string_view trim(string_view str) {
+  auto is_space = [](char c) { return c == ' ' || c == '\t'; };
+  while (!str.empty() && is_space(str.front()))
+    str.remove_prefix(1);
+  while (!str.empty() && is_space(str.back()))
+    str.remove_suffix(1);
+  return str;
+}
+
+// Checks whether a qvalue (RFC 9110, Section 12.4.2) is zero, i.e., "0"
+// followed by an optional dot and only zeros.
+bool is_zero_qvalue(string_view str) {
+  if (str.empty() || str.front() != '0')
+    return false;
+  str.remove_prefix(1);
+  if (str.empty())
+    return true;
+  if (str.front() != '.')
+    return false;
+  str.remove_prefix(1);
+  return str.find_first_not_of('0') == string_view::npos;
+}
+
 } // namespace
 
+bool accepts_gzip(string_view req) {
+  // Stores whether the client listed gzip or '*' and whether it accepts them.
+  std::optional<bool> gzip;
+  std::optional<bool> any;
+  auto parse_field = [&](string_view value) {
+    while (!value.empty()) {
+      // Split off the next coding and its parameters.
+      auto sep = value.find(',');
+      auto item = value.substr(0, sep);
+      value = sep == string_view::npos ? string_view{} : value.substr(sep + 1);
+      auto params = string_view{};
+      if (auto semi = item.find(';'); semi != string_view::npos) {
+        params = item.substr(semi + 1);
+        item = item.substr(0, semi);
+      }
+      item = trim(item);
+      // Read the weight. A weight of 0 means "not acceptable".
+      auto acceptable = true;
+      while (!params.empty()) {
+        auto next = params.find(';');
+        auto param = params.substr(0, next);
+        params = next == string_view::npos ? string_view{}
+                                           : params.substr(next + 1);
+        auto eq = param.find('=');
+        if (eq != string_view::npos
+            && icase_equal(trim(param.substr(0, eq)), "q"sv))
+          acceptable = !is_zero_qvalue(trim(param.substr(eq + 1)));
+      }
+      if (icase_equal(item, "gzip"sv) || icase_equal(item, "x-gzip"sv))
+        gzip = acceptable;
+      else if (item == "*"sv)
+        any = acceptable;
+    }
+  };
+  // Skip the request line and stop at the end of the header. Clients may
+  // split the list of codings into multiple Accept-Encoding fields.
+  constexpr auto field_name = "accept-encoding:"sv;
+  auto pos = req.find("\r\n"sv);
+  while (pos != string_view::npos) {
+    req.remove_prefix(pos + 2);
+    pos = req.find("\r\n"sv);
+    auto line = req.substr(0, pos);
+    if (line.empty())
+      break;
+    if (line.size() >= field_name.size()
+        && icase_equal(line.substr(0, field_name.size()), field_name))
+      parse_field(line.substr(field_name.size()));
+  }
+  if (gzip)
+    return *gzip;
+  return any.value_or(false);
+}
+
 // -- constructors, destructors, and assignment operators ----------------------
 
 prometheus_actor::prometheus_actor(caf::actor_config& cfg,
@@ -107,7 +216,7 @@ caf::behavior prometheus_actor::make_behavior() {
       // Dispatch to a handler or send an error if nothing matches.
       if (caf::starts_with(req_str, prom_request_start)) {
         BROKER_DEBUG("serve HTTP request for /metrics");
-        on_metrics_request(msg.handle);
+        on_metrics_request(msg.handle, req_str);
         return;
       }
       if (caf::starts_with(req_str, status_request_start)) {
@@ -115,6 +224,11 @@ caf::behavior prometheus_actor::make_behavior() {
         on_status_request(msg.handle);
         return;
       }
+      if (caf::starts_with(req_str, flight_recorder_request_start)) {
+        BROKER_DEBUG("serve HTTP request for /v1/flight-recorder");
+        on_flight_recorder_request(msg.handle);
+        return;
+      }
       BROKER_DEBUG("reject unsupported HTTP request: "
                    << std::string{req_str.substr(0, req_str.find("\r\n"sv))});
       write(msg.handle, caf::as_bytes(caf::make_span(request_not_supported)));
@@ -159,22 +273,35 @@ void prometheus_actor::flush_and_close(caf::io::connection_handle hdl) {
     quit();
 };
 
-void prometheus_actor::on_metrics_request(caf::io::connection_handle hdl) {
+void prometheus_actor::on_metrics_request(caf::io::connection_handle hdl,
+                                          [[maybe_unused]] std::string_view req) {
   // Collect metrics, ship response, and close. If the user configured
   // neither Broker-side import nor export of metrics, we fall back to the
   // default CAF Prometheus export.
-  auto hdr = caf::as_bytes(caf::make_span(request_ok_text));
   BROKER_ASSERT(exporter_ != nullptr);
   if (!exporter_->running()) {
     exporter_->proc_importer.update();
     exporter_->impl.scrape(system().metrics());
   }
   collector_.insert_or_update(exporter_->impl.rows());
-  auto text = collector_.prometheus_text();
-  auto payload = caf::as_bytes(caf::make_span(text));
   auto& dst = wr_buf(hdl);
-  dst.insert(dst.end(), hdr.begin(), hdr.end());
-  dst.insert(dst.end(), payload.begin(), payload.end());
+  auto append = [&dst](caf::span<const std::byte> bytes) {
+    dst.insert(dst.end(), bytes.begin(), bytes.end());
+  };
+#ifdef BROKER_HAS_ZLIB
+  // The collector caches the compressed text until the metrics change.
+  if (accepts_gzip(req)) {
+    if (auto compressed = collector_.prometheus_text_gzip();
+        !compressed.empty()) {
+      append(caf::as_bytes(caf::make_span(request_ok_text_gzip)));
+      append(compressed);
+      flush_and_close(hdl);
+      return;
+    }
+  }
+#endif
+  append(caf::as_bytes(caf::make_span(request_ok_text)));
+  append(caf::as_bytes(caf::make_span(collector_.prometheus_text())));
   flush_and_close(hdl);
 }
 
@@ -193,6 +320,44 @@ void prometheus_actor::on_status_request(caf::io::connection_handle hdl) {
   requests_[hdl].async_id = aid;
 }
 
+void prometheus_actor::on_flight_recorder_request(
+  caf::io::connection_handle hdl) {
+  auto aid = new_u64_id();
+  request(core_, 5s, atom::get_v, atom::flight_recorder_v)
+    .then(
+      [this, hdl, aid](const std::vector<std::byte>& buf) {
+        on_flight_recorder_request_cb(hdl, aid, buf);
+      },
+      [this, hdl, aid](const caf::error& what) {
+        BROKER_WARNING("failed to dump the flight recorder:" << what);
+        on_flight_recorder_request_cb(hdl, aid, {});
+      });
+  requests_[hdl].async_id = aid;
+}
+
+void prometheus_actor::on_flight_recorder_request_cb(
+  caf::io::connection_handle hdl, uint64_t async_id,
+  const std::vector<std::byte>& res) {
+  // Sanity checking.
+  auto iter = requests_.find(hdl);
+  if (iter == requests_.end())
+    return;
+  auto& req = iter->second;
+  if (req.async_id != async_id)
+    return;
+  // Send the dump (or an error if the recorder is disabled) and close.
+  auto& dst = wr_buf(hdl);
+  if (res.empty()) {
+    auto hdr = caf::as_bytes(caf::make_span(request_not_found));
+    dst.insert(dst.end(), hdr.begin(), hdr.end());
+  } else {
+    auto hdr = caf::as_bytes(caf::make_span(request_ok_binary));
+    dst.insert(dst.end(), hdr.begin(), hdr.end());
+    dst.insert(dst.end(), res.begin(), res.end());
+  }
+  flush_and_close(hdl);
+}
+
 namespace {
 
 class jsonizer {
@@ -0,0 +1,94 @@
+#include "broker/internal/topic_statistics.hh"
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace std::literals;
+
+namespace broker::internal {
+
+namespace {
+
+vector to_vector(const std::vector<detail::space_saving::entry>& entries,
+                 const std::string& value_key) {
+  vector result;
+  result.reserve(entries.size());
+  for (const auto& x : entries) {
+    table row;
+    row.emplace("topic"s, x.key);
+    row.emplace(value_key, x.count);
+    row.emplace("error"s, x.error);
+    result.emplace_back(std::move(row));
+  }
+  return result;
+}
+
+} // namespace
+
+// -- topic_statistics ---------------------------------------------------------
+
+topic_statistics::topic_statistics(size_t capacity, size_t sample_interval)
+  : messages_(capacity),
+    bytes_(capacity),
+    gaps_(1, std::max<uint64_t>(2 * sample_interval, 2) - 1) {
+  next_sample_ = gaps_(rng_);
+}
+
+void topic_statistics::add_sample(const std::string& key) {
+  messages_.add(key, pending_messages_);
+  bytes_.add(key, pending_bytes_);
+  pending_messages_ = 0;
+  pending_bytes_ = 0;
+  next_sample_ = gaps_(rng_);
+}
+
+table topic_statistics::snapshot(size_t k) const {
+  table result;
+  result.emplace("total-messages"s, total_messages_);
+  result.emplace("total-bytes"s, total_bytes_);
+  result.emplace("by-messages"s, to_vector(messages_.top(k), "messages"s));
+  result.emplace("by-bytes"s, to_vector(bytes_.top(k), "bytes"s));
+  return result;
+}
+
+// -- topic_metrics ------------------------------------------------------------
+
+topic_metrics::topic_metrics(gauge_family* messages, gauge_family* bytes,
+                             std::string direction, size_t max_topics)
+  : messages_family_(messages),
+    bytes_family_(bytes),
+    direction_(std::move(direction)),
+    max_topics_(max_topics) {
+  // nop
+}
+
+void topic_metrics::update(const topic_statistics& stats, size_t k) {
+  update(messages_family_, messages_, stats.messages(), k);
+  update(bytes_family_, bytes_, stats.bytes(), k);
+}
+
+void topic_metrics::update(gauge_family* family, gauge_map& gauges,
+                           const detail::space_saving& summary, size_t k) {
+  auto set = [](caf::telemetry::int_gauge* gauge, int64_t value) {
+    gauge->inc(value - gauge->value());
+  };
+  std::unordered_set<std::string_view> current;
+  for (const auto& x : summary.top(k)) {
+    auto i = gauges.find(x.key);
+    if (i == gauges.end()) {
+      if (gauges.size() >= max_topics_)
+        continue;
+      auto gauge = family->get_or_add({{"direction", direction_},
+                                       {"topic", x.key}});
+      i = gauges.emplace(x.key, gauge).first;
+    }
+    set(i->second, static_cast<int64_t>(x.count));
+    current.emplace(i->first);
+  }
+  // Reset topics that dropped out of the top k.
+  for (auto& [key, gauge] : gauges)
+    if (current.count(key) == 0)
+      set(gauge, 0);
+}
+
+} // namespace broker::internal
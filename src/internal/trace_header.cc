@@ -0,0 +1,98 @@
+#include "broker/internal/trace_header.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace broker::internal {
+
+namespace {
+
+class trace_table {
+public:
+  static constexpr size_t capacity = 256;
+
+  static constexpr size_t num_filter_slots = 4096;
+
+  trace_header_ptr get(const node_message& msg) {
+    auto key = key_of(msg);
+    // Fast path: most messages have no trace and never lock.
+    if (filter_slot(key).load(std::memory_order_acquire) == 0)
+      return {};
+    std::lock_guard<std::mutex> guard{mtx_};
+    if (auto i = entries_.find(key); i != entries_.end())
+      return i->second.trace;
+    return {};
+  }
+
+  void set(const node_message& msg, trace_header_ptr trace) {
+    auto key = key_of(msg);
+    // Note: we release the evicted entry after unlocking.
+    std::optional<entry> evicted;
+    std::lock_guard<std::mutex> guard{mtx_};
+    if (auto i = entries_.find(key); i != entries_.end()) {
+      i->second.trace = std::move(trace);
+      return;
+    }
+    entries_.emplace(key, entry{msg, std::move(trace)});
+    filter_slot(key).fetch_add(1, std::memory_order_release);
+    order_.push_back(key);
+    if (order_.size() > capacity) {
+      auto oldest = order_.front();
+      order_.pop_front();
+      auto i = entries_.find(oldest);
+      evicted.emplace(std::move(i->second));
+      entries_.erase(i);
+      filter_slot(oldest).fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+private:
+  struct entry {
+    node_message msg;
+    trace_header_ptr trace;
+  };
+
+  static const void* key_of(const node_message& msg) noexcept {
+    return &msg.data();
+  }
+
+  std::atomic<uint32_t>& filter_slot(const void* key) noexcept {
+    // Fibonacci hashing, since the low bits of heap addresses are all zero.
+    auto x = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key));
+    return filter_[(x * UINT64_C(11400714819323198485)) >> 52];
+  }
+
+  static_assert(num_filter_slots == 4096, "filter_slot assumes 4096 slots");
+
+  /// Counts the entries per hash value. Allows `get` to skip the lock for
+  /// messages that have no trace.
+  std::array<std::atomic<uint32_t>, num_filter_slots> filter_{};
+
+  /// Guards `entries_` and `order_`.
+  std::mutex mtx_;
+
+  /// Maps the address of a message to its trace.
+  std::unordered_map<const void*, entry> entries_;
+
+  /// Stores the keys of `entries_` in insertion order.
+  std::deque<const void*> order_;
+};
+
+trace_table traces;
+
+} // namespace
+
+trace_header_ptr get_trace(const node_message& msg) {
+  return traces.get(msg);
+}
+
+void set_trace(const node_message& msg, trace_header_ptr trace) {
+  traces.set(msg, std::move(trace));
+}
+
+} // namespace broker::internal
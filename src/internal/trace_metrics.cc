@@ -0,0 +1,57 @@
+#include "broker/internal/trace_metrics.hh"
+
+#include <chrono>
+
+namespace broker::internal {
+
+namespace {
+
+double seconds_between(timestamp from, timestamp to) {
+  // Clocks across machines may be skewed. Clamp negative values.
+  if (to <= from)
+    return 0.0;
+  return std::chrono::duration<double>{to - from}.count();
+}
+
+} // namespace
+
+trace_metrics::trace_metrics(histogram_family* one_way, histogram_family* hop,
+                             size_t max_label_sets)
+  : one_way_family_(one_way), hop_family_(hop), max_label_sets_(max_label_sets) {
+  other_.one_way = one_way_family_->get_or_add({{"origin", "other"},
+                                                {"prefix", "other"}});
+  other_.hop = hop_family_->get_or_add({{"origin", "other"},
+                                        {"prefix", "other"}});
+}
+
+void trace_metrics::observe(const trace_header& trace, const topic& t,
+                            timestamp now) {
+  auto& hdl = instances_for(trace.origin().node, prefix_of(t));
+  hdl.one_way->observe(seconds_between(trace.origin().time, now));
+  hdl.hop->observe(seconds_between(trace.last_hop().time, now));
+}
+
+std::string_view trace_metrics::prefix_of(const topic& t) noexcept {
+  std::string_view str = t.string();
+  if (auto pos = str.find(topic::sep); pos != std::string_view::npos)
+    return str.substr(0, pos);
+  return str;
+}
+
+trace_metrics::instances&
+trace_metrics::instances_for(const endpoint_id& origin,
+                             std::string_view prefix) {
+  auto key = std::make_pair(origin, std::string{prefix});
+  if (auto i = instances_.find(key); i != instances_.end())
+    return i->second;
+  if (instances_.size() >= max_label_sets_)
+    return other_;
+  auto origin_str = to_string(origin);
+  auto labels = {caf::telemetry::label_view{"origin", origin_str},
+                 caf::telemetry::label_view{"prefix", prefix}};
+  instances hdl{one_way_family_->get_or_add(labels),
+                hop_family_->get_or_add(labels)};
+  return instances_.emplace(std::move(key), hdl).first->second;
+}
+
+} // namespace broker::internal
@@ -24,20 +24,31 @@ namespace broker::internal::web_socket {
 struct trait_t {
   using value_type = caf::cow_string;
 
+  frame_type frames = frame_type::text;
+
   caf::error init(const caf::settings&) {
     return caf::none;
   }
 
   bool converts_to_binary(const caf::cow_string&) {
-    return false; // We use text messages exclusively.
+    return frames == frame_type::binary;
   }
 
-  bool convert(const caf::cow_string&, caf::byte_buffer&) {
-    return false; // Never serialize to binary.
+  bool convert(const caf::cow_string& str, caf::byte_buffer& buf) {
+    if (frames != frame_type::binary)
+      return false; // Never serialize to binary on text routes.
+    auto first = reinterpret_cast<const std::byte*>(str.str().data());
+    buf.insert(buf.end(), first, first + str.str().size());
+    return true;
   }
 
-  bool convert(caf::const_byte_span, caf::cow_string&) {
-    return false; // Reject binary messages.
+  bool convert(caf::const_byte_span input, caf::cow_string& str) {
+    if (frames != frame_type::binary)
+      return false; // Reject binary messages on text routes.
+    auto& x = str.unshared();
+    auto first = reinterpret_cast<const char*>(input.data());
+    x.insert(x.end(), first, first + input.size());
+    return true;
   }
 
   bool convert(const caf::cow_string& str, std::vector<char>& buf) {
@@ -46,6 +57,8 @@ struct trait_t {
   }
 
   bool convert(caf::string_view input, caf::cow_string& str) {
+    if (frames != frame_type::text)
+      return false; // Reject text messages on binary routes.
     auto& x = str.unshared();
     x.insert(x.end(), input.begin(), input.end());
     return true;
@@ -111,12 +124,10 @@ void ssl_accept(caf::net::multiplexer& mpx, Socket fd,
 
 expected<uint16_t> launch(caf::actor_system& sys,
                           const openssl_options_ptr& ssl_cfg, std::string addr,
-                          uint16_t port, bool reuse_addr,
-                          const std::string& allowed_path,
-                          on_connect_t on_connect) {
+                          uint16_t port, bool reuse_addr, route_map routes) {
   BROKER_DEBUG("launch WebSocket server:"
-               << BROKER_ARG(addr) << BROKER_ARG(port) << BROKER_ARG(reuse_addr)
-               << BROKER_ARG(allowed_path));
+               << BROKER_ARG(addr) << BROKER_ARG(port)
+               << BROKER_ARG(reuse_addr));
   using namespace std::literals;
   // Open up the port.
   caf::uri::authority_type auth;
@@ -139,20 +150,23 @@ expected<uint16_t> launch(caf::actor_system& sys,
   using producer_res_t = caf::async::producer_resource<caf::cow_string>;
   using res_t =
     caf::expected<std::tuple<consumer_res_t, producer_res_t, trait_t>>;
-  auto on_request = [cb = std::move(on_connect),
-                     allowed_path](const caf::settings& hdr) {
+  auto on_request = [rs = std::move(routes)](const caf::settings& hdr) {
     auto path = caf::get_or(hdr, "web-socket.path", "");
-    if (path == allowed_path) {
+    if (auto i = rs.find(path); i != rs.end()) {
       using caf::async::make_spsc_buffer_resource;
       auto [pull1, push1] = make_spsc_buffer_resource<caf::cow_string>();
       auto [pull2, push2] = make_spsc_buffer_resource<caf::cow_string>();
       connect_event_t ev{std::move(pull2), std::move(push1)};
-      cb(hdr, ev);
-      return res_t{std::make_tuple(pull1, push2, trait_t{})};
+      i->second.on_connect(hdr, ev);
+      return res_t{std::make_tuple(pull1, push2, trait_t{i->second.frames})};
     } else {
-      BROKER_INFO("rejected JSON client on invalid path" << path);
-      return res_t{caf::make_error(caf::sec::invalid_argument,
-                                   "invalid path; try " + allowed_path)};
+      BROKER_INFO("rejected WebSocket client on invalid path" << path);
+      std::string msg = "invalid path; try";
+      for (auto& kvp : rs) {
+        msg += ' ';
+        msg += kvp.first;
+      }
+      return res_t{caf::make_error(caf::sec::invalid_argument, std::move(msg))};
     }
   };
   // Launch the WebSocket and dispatch to on_connect.
@@ -1,6 +1,11 @@
 #include "broker/internal/wire_format.hh"
 
+#include "broker/detail/alloc_stage.hh"
+#include "broker/detail/cycle_clock.hh"
+#include "broker/internal/latency_stamps.hh"
 #include "broker/internal/logger.hh"
+#include "broker/internal/probes.hh"
+#include "broker/internal/trace_header.hh"
 #include "broker/message.hh"
 
 #include <caf/binary_deserializer.hpp>
@@ -66,6 +71,8 @@ std::pair<ec, std::string_view> check(const drop_conn_msg& x) {
 namespace v1 {
 
 bool trait::convert(const node_message& msg, caf::byte_buffer& buf) {
+  BROKER_ALLOC_STAGE(wire_encode);
+  auto offset = buf.size();
   caf::binary_serializer sink{nullptr, buf};
   auto write_bytes = [&sink](caf::const_byte_span bytes) {
     sink.buf().insert(sink.buf().end(), bytes.begin(), bytes.end());
@@ -84,30 +91,88 @@ bool trait::convert(const node_message& msg, caf::byte_buffer& buf) {
   };
   const auto& [sender, receiver, content] = msg.data();
   const auto& [msg_type, ttl, msg_topic, payload] = content.data();
+  auto trace = get_trace(msg);
+  auto tag = static_cast<uint8_t>(msg_type);
+  if (trace)
+    tag |= trace_flag;
+  auto write_trace = [&] {
+    if (!trace)
+      return true;
+    const auto& hops = trace->hops;
+    if (hops.size() > 0xFF) {
+      sink.emplace_error(caf::sec::invalid_argument,
+                         "trace exceeds maximum size of 255 hops");
+      return false;
+    }
+    if (!sink.apply(static_cast<uint8_t>(hops.size())))
+      return false;
+    for (const auto& hop : hops)
+      if (!sink.apply(hop.node) || !sink.apply(hop.time.time_since_epoch()))
+        return false;
+    return true;
+  };
   auto ok = sink.apply(sender)                                      //
             && sink.apply(receiver)                                 //
-            && sink.apply(msg_type)                                 //
+            && sink.apply(tag)                                      //
             && sink.apply(ttl)                                      //
+            && write_trace()                                        //
             && write_topic(msg_topic)                               //
             && write_bytes(caf::as_bytes(caf::make_span(payload))); //
+  BROKER_PROBE(wire_encode, static_cast<int>(msg_type), buf.size() - offset,
+               static_cast<int>(ok));
   if (!ok)
     last_error_ = sink.get_error();
+  else if (auto stamp = stamps_ ? stamps_->take(msg) : 0;
+           stamp != 0 && write_latency_)
+    write_latency_->observe(detail::cycle_clock::seconds_since(stamp));
   return ok;
 }
 
 bool trait::convert(caf::const_byte_span bytes, node_message& msg) {
+  BROKER_ALLOC_STAGE(wire_decode);
   caf::binary_deserializer source{nullptr, bytes};
   auto& [sender, receiver, content] = msg.unshared();
   auto& [msg_type, ttl, msg_topic, payload] = content.unshared();
   // Extract sender, receiver, type and TTL.
+  uint8_t tag = 0;
   if (!source.apply(sender)      //
       || !source.apply(receiver) //
-      || !source.apply(msg_type) //
+      || !source.apply(tag)      //
       || !source.apply(ttl)) {
     last_error_ = source.get_error();
     BROKER_DEBUG("failed to parse node message fields:" << last_error_);
     return false;
   }
+  if (!from_integer(static_cast<uint8_t>(tag & ~trace_flag), msg_type)) {
+    last_error_ = caf::make_error(caf::sec::runtime_error,
+                                  "invalid message type in node message");
+    BROKER_DEBUG("found invalid message type in node message");
+    return false;
+  }
+  // Extract the optional trace.
+  trace_header_ptr trace;
+  if ((tag & trace_flag) != 0) {
+    uint8_t num_hops = 0;
+    if (!source.apply(num_hops)) {
+      last_error_ = source.get_error();
+      BROKER_DEBUG("failed to parse trace length:" << last_error_);
+      return false;
+    }
+    std::vector<trace_hop> hops;
+    hops.reserve(num_hops);
+    for (uint8_t i = 0; i < num_hops; ++i) {
+      auto& hop = hops.emplace_back();
+      timespan since_epoch;
+      if (!source.apply(hop.node) || !source.apply(since_epoch)) {
+        last_error_ = source.get_error();
+        BROKER_DEBUG("failed to parse trace:" << last_error_);
+        return false;
+      }
+      hop.time = timestamp{since_epoch};
+    }
+    if (!hops.empty())
+      trace = trace_header_ptr{std::move(hops)};
+  }
   // Extract topic.
   uint16_t topic_len = 0;
   if (!source.apply(topic_len)) {
@@ -132,6 +197,11 @@ bool trait::convert(caf::const_byte_span bytes, node_message& msg) {
   auto first = reinterpret_cast<const std::byte*>(remainder.data());
   auto last = first + remainder.size();
   payload.assign(first, last);
+  if (trace)
+    set_trace(msg, std::move(trace));
+  if (stamps_ && sampler_())
+    stamps_->set(msg, detail::cycle_clock::now());
+  BROKER_PROBE(wire_decode, static_cast<int>(msg_type), bytes.size());
   return true;
 }
 
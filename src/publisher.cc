@@ -3,16 +3,22 @@
 #include <future>
 #include <numeric>
 
+#include <caf/actor_system_config.hpp>
 #include <caf/flow/merge.hpp>
 #include <caf/flow/observable.hpp>
 #include <caf/scheduled_actor/flow.hpp>
 #include <caf/send.hpp>
 
 #include "broker/data.hh"
+#include "broker/defaults.hh"
+#include "broker/detail/alloc_stage.hh"
 #include "broker/detail/assert.hh"
+#include "broker/detail/cycle_clock.hh"
 #include "broker/detail/flare.hh"
+#include "broker/detail/sampler.hh"
 #include "broker/endpoint.hh"
 #include "broker/internal/endpoint_access.hh"
+#include "broker/internal/latency_stamps.hh"
 #include "broker/internal/logger.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/message.hh"
@@ -35,7 +41,11 @@ public:
 
   using guard_type = std::unique_lock<std::mutex>;
 
-  explicit publisher_queue(buffer_ptr buf) : buf_(std::move(buf)) {
+  publisher_queue(buffer_ptr buf, internal::latency_stamps_ptr stamps,
+                  size_t sample_interval)
+    : buf_(std::move(buf)),
+      stamps_(std::move(stamps)),
+      sampler_(sample_interval) {
     // nop
   }
 
@@ -111,17 +121,28 @@ public:
     if (items.size() < demand_) {
       demand_ -= items.size();
       guard.unlock();
+      stamp(items);
       buf_->push(items);
     } else {
       auto n = demand_;
       demand_ = 0;
       fx_.extinguish();
       guard.unlock();
+      stamp(items.subspan(0, n));
       buf_->push(items.subspan(0, n));
       push(items.subspan(n));
     }
   }
 
+  /// Stamps sampled items for measuring how long they take to reach the core.
+  void stamp(caf::span<const value_type> items) {
+    if (sampler_.interval() == 0)
+      return;
+    for (const auto& item : items)
+      if (sampler_())
+        stamps_->set(item, cycle_clock::now());
+  }
+
   friend void intrusive_ptr_add_ref(const publisher_queue* ptr) noexcept {
     ptr->ref();
   }
@@ -145,6 +166,12 @@ private:
 
   /// Stores whether the consumer stopped receiving data.
   bool cancelled_ = false;
+
+  /// Stores the timestamps of sampled messages.
+  internal::latency_stamps_ptr stamps_;
+
+  /// Selects messages for sampling latencies.
+  detail::sampler sampler_;
 };
 
 namespace {
@@ -189,7 +216,12 @@ publisher publisher::make(endpoint& ep, topic t) {
   caf::anon_send(native(ep.core()), std::move(cons_res));
   auto buf = prod_res.try_open();
   BROKER_ASSERT(buf != nullptr);
-  auto qptr = caf::make_counted<detail::publisher_queue>(buf);
+  internal::endpoint_access access{&ep};
+  auto interval = caf::get_or(access.cfg(),
+                              "broker.metrics.latency-sample-interval",
+                              defaults::metrics::latency_sample_interval);
+  auto qptr = caf::make_counted<detail::publisher_queue>(buf, access.stamps(),
+                                                         interval);
   buf->set_producer(qptr);
   return publisher{detail::make_opaque(std::move(qptr)), std::move(t)};
 }
@@ -221,12 +253,14 @@ void publisher::drop_all_on_destruction() {
 }
 
 void publisher::publish(data x) {
+  BROKER_ALLOC_STAGE(publish);
   auto msg = make_data_message(topic_, std::move(x));
   BROKER_DEBUG("publishing" << msg);
   dptr(queue_)->push(caf::make_span(&msg, 1));
 }
 
 void publisher::publish(std::vector<data> xs) {
+  BROKER_ALLOC_STAGE(publish);
   std::vector<data_message> msgs;
   msgs.reserve(xs.size());
   for (auto& x : xs)
@@ -14,6 +14,7 @@
 #include <caf/send.hpp>
 #include <caf/stateful_actor.hpp>
 
+#include "broker/detail/alloc_stage.hh"
 #include "broker/detail/assert.hh"
 #include "broker/detail/flare.hh"
 #include "broker/endpoint.hh"
@@ -262,6 +263,7 @@ std::vector<data_message> subscriber::do_get(size_t num,
 void subscriber::do_get(std::vector<data_message>& buf, size_t num,
                         timestamp abs_timeout) {
   BROKER_TRACE(BROKER_ARG(num) << BROKER_ARG(abs_timeout));
+  BROKER_ALLOC_STAGE(deliver);
   auto q = dptr(queue_);
   buf.clear();
   buf.reserve(num);
@@ -272,6 +274,7 @@ void subscriber::do_get(std::vector<data_message>& buf, size_t num,
 
 std::vector<data_message> subscriber::poll() {
   BROKER_TRACE("");
+  BROKER_ALLOC_STAGE(deliver);
   // The Queue may return a capacity of 0 if the producer has closed the flow.
   std::vector<data_message> buf;
   auto q = dptr(queue_);
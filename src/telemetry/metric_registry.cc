@@ -4,6 +4,7 @@
 
 #include "broker/internal/endpoint_access.hh"
 #include "broker/internal/with_native_labels.hh"
+#include "broker/telemetry/sharded.hh"
 
 #include <caf/actor_system.hpp>
 #include <caf/telemetry/metric_family.hpp>
@@ -227,7 +228,7 @@ public:
       extract_labels(instance, labels_vec);
       collector(opaque(family), opaque(obj), labels_vec);
     };
-
+    sharded_metric::flush_all();
     reg_->collect(fn);
   }
 
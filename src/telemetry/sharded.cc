@@ -0,0 +1,97 @@
+#include "broker/telemetry/sharded.hh"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace broker::telemetry {
+
+namespace {
+
+std::atomic<size_t> next_shard;
+
+/// Guards the list of sharded metrics and their `flushed_` members.
+std::mutex& registry_mtx() {
+  static std::mutex instance;
+  return instance;
+}
+
+/// Lists all sharded metrics of this process.
+std::vector<sharded_metric*>& registry() {
+  static std::vector<sharded_metric*> instance;
+  return instance;
+}
+
+} // namespace
+
+size_t this_thread_shard() noexcept {
+  thread_local size_t index = next_shard++ % num_metric_shards;
+  return index;
+}
+
+// -- sharded_metric -----------------------------------------------------------
+
+sharded_metric::sharded_metric() {
+  std::unique_lock guard{registry_mtx()};
+  registry().push_back(this);
+  registered_ = true;
+}
+
+sharded_metric::~sharded_metric() {
+  deregister();
+}
+
+int64_t sharded_metric::value() const noexcept {
+  int64_t result = 0;
+  for (const auto& x : shards_)
+    result += x.value.load(std::memory_order_relaxed);
+  return result;
+}
+
+void sharded_metric::flush_all() {
+  std::unique_lock guard{registry_mtx()};
+  for (auto ptr : registry()) {
+    auto current = ptr->value();
+    if (auto delta = current - ptr->flushed_; delta != 0) {
+      ptr->flush(delta);
+      ptr->flushed_ = current;
+    }
+  }
+}
+
+void sharded_metric::deregister() noexcept {
+  if (!registered_)
+    return;
+  std::unique_lock guard{registry_mtx()};
+  // Make sure to not lose any pending updates.
+  if (auto delta = value() - flushed_; delta != 0)
+    flush(delta);
+  auto& xs = registry();
+  xs.erase(std::remove(xs.begin(), xs.end(), this), xs.end());
+  registered_ = false;
+}
+
+// -- sharded_int_counter ------------------------------------------------------
+
+sharded_int_counter::~sharded_int_counter() {
+  deregister();
+}
+
+void sharded_int_counter::flush(int64_t delta) noexcept {
+  backend_.inc(delta);
+}
+
+// -- sharded_int_gauge --------------------------------------------------------
+
+sharded_int_gauge::~sharded_int_gauge() {
+  deregister();
+}
+
+void sharded_int_gauge::flush(int64_t delta) noexcept {
+  if (delta > 0)
+    backend_.inc(delta);
+  else
+    backend_.dec(-delta);
+}
+
+} // namespace broker::telemetry
@@ -0,0 +1,364 @@
+#include "alloc-tracker.hh"
+
+#include "broker/config.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+#ifdef BROKER_WINDOWS
+#  include <malloc.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+using broker::detail::alloc_stage;
+
+namespace {
+
+constexpr size_t num_stages = static_cast<size_t>(alloc_stage::num_stages);
+
+struct stage_counters {
+  std::atomic<uint64_t> allocations;
+  std::atomic<uint64_t> bytes;
+};
+
+// Note: zero-initialized before any dynamic initialization runs, i.e., before
+//       the first allocation.
+stage_counters counters[num_stages];
+
+} // namespace
+
+#ifdef BROKER_ENABLE_ALLOC_TRACKING
+
+namespace {
+
+void record(size_t size) noexcept {
+  auto index = static_cast<size_t>(broker::detail::current_alloc_stage());
+  auto& entry = counters[index < num_stages ? index : 0];
+  entry.allocations.fetch_add(1, std::memory_order_relaxed);
+  entry.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace
+
+// With glibc, we replace malloc and friends to also count allocations in C
+// code and in containers that bypass operator new. The replacements forward
+// to the internal glibc functions.
+#  ifdef __GLIBC__
+
+extern "C" {
+
+void* __libc_malloc(size_t) noexcept;
+void* __libc_calloc(size_t, size_t) noexcept;
+void* __libc_realloc(void*, size_t) noexcept;
+void* __libc_memalign(size_t, size_t) noexcept;
+void __libc_free(void*) noexcept;
+
+void* malloc(size_t size) noexcept {
+  record(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) noexcept {
+  record(num * size);
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+  if (size > 0)
+    record(size);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) noexcept {
+  __libc_free(ptr);
+}
+
+} // extern "C"
+
+namespace {
+
+void* do_malloc(size_t size) noexcept {
+  record(size);
+  return __libc_malloc(size);
+}
+
+void* do_aligned_alloc(size_t size, size_t alignment) noexcept {
+  record(size);
+  return __libc_memalign(alignment, size);
+}
+
+void do_free(void* ptr) noexcept {
+  __libc_free(ptr);
+}
+
+void do_aligned_free(void* ptr) noexcept {
+  __libc_free(ptr);
+}
+
+} // namespace
+
+#  elif defined(BROKER_WINDOWS)
+
+namespace {
+
+void* do_malloc(size_t size) noexcept {
+  record(size);
+  return std::malloc(size);
+}
+
+void* do_aligned_alloc(size_t size, size_t alignment) noexcept {
+  record(size);
+  return _aligned_malloc(size, alignment);
+}
+
+void do_free(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void do_aligned_free(void* ptr) noexcept {
+  _aligned_free(ptr);
+}
+
+} // namespace
+
+#  else // __GLIBC__
+
+namespace {
+
+void* do_malloc(size_t size) noexcept {
+  record(size);
+  return std::malloc(size);
+}
+
+void* do_aligned_alloc(size_t size, size_t alignment) noexcept {
+  record(size);
+  // std::aligned_alloc requires a multiple of the alignment.
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+}
+
+void do_free(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void do_aligned_free(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+} // namespace
+
+#  endif // __GLIBC__
+
+namespace {
+
+template <class Allocate>
+void* new_impl(size_t size, Allocate allocate) {
+  if (size == 0)
+    size = 1;
+  for (;;) {
+    if (auto ptr = allocate(size))
+      return ptr;
+    if (auto handler = std::get_new_handler())
+      handler();
+    else
+      throw std::bad_alloc{};
+  }
+}
+
+void* new_impl(size_t size) {
+  return new_impl(size, do_malloc);
+}
+
+void* new_impl(size_t size, std::align_val_t alignment) {
+  auto allocate = [alignment](size_t n) {
+    return do_aligned_alloc(n, static_cast<size_t>(alignment));
+  };
+  return new_impl(size, allocate);
+}
+
+template <class... Ts>
+void* nothrow_new_impl(size_t size, Ts... xs) noexcept {
+  try {
+    return new_impl(size, xs...);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+  return new_impl(size);
+}
+
+void* operator new[](size_t size) {
+  return new_impl(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return nothrow_new_impl(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return nothrow_new_impl(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  return new_impl(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return new_impl(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return nothrow_new_impl(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return nothrow_new_impl(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+  do_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  do_free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  do_free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  do_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  do_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  do_free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  do_aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  do_aligned_free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  do_aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  do_aligned_free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  do_aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  do_aligned_free(ptr);
+}
+
+bool alloc_tracking_enabled() noexcept {
+  return true;
+}
+
+#else // BROKER_ENABLE_ALLOC_TRACKING
+
+bool alloc_tracking_enabled() noexcept {
+  return false;
+}
+
+#endif // BROKER_ENABLE_ALLOC_TRACKING
+
+alloc_snapshot alloc_counters_snapshot() noexcept {
+  alloc_snapshot result;
+  for (size_t index = 0; index < num_stages; ++index) {
+    auto& entry = counters[index];
+    result[index].allocations =
+      entry.allocations.load(std::memory_order_relaxed);
+    result[index].bytes = entry.bytes.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+alloc_snapshot operator-(const alloc_snapshot& after,
+                         const alloc_snapshot& before) noexcept {
+  alloc_snapshot result;
+  for (size_t index = 0; index < num_stages; ++index) {
+    result[index].allocations =
+      after[index].allocations - before[index].allocations;
+    result[index].bytes = after[index].bytes - before[index].bytes;
+  }
+  return result;
+}
+
+alloc_counters total(const alloc_snapshot& xs) noexcept {
+  alloc_counters result;
+  for (auto& x : xs) {
+    result.allocations += x.allocations;
+    result.bytes += x.bytes;
+  }
+  return result;
+}
+
+size_t peak_rss() noexcept {
+#ifndef BROKER_WINDOWS
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#  ifdef BROKER_APPLE
+  // macOS reports ru_maxrss in bytes, all other systems in kilobytes.
+  return static_cast<size_t>(usage.ru_maxrss);
+#  else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#  endif
+#else
+  return 0;
+#endif
+}
+
+void print_alloc_report(std::ostream& out, const alloc_snapshot& xs,
+                        uint64_t messages) {
+  if (!alloc_tracking_enabled())
+    return;
+  auto n = static_cast<double>(messages > 0 ? messages : 1);
+  auto print_line = [&](const char* name, auto get) {
+    auto sum = total(xs);
+    out << name << ": total=" << static_cast<double>(get(sum)) / n;
+    for (size_t index = 0; index < num_stages; ++index) {
+      auto stage = static_cast<alloc_stage>(index);
+      // Allocations outside of the instrumented stages, e.g., for actor
+      // messages and flow buffers.
+      auto label = stage == alloc_stage::none ? "other" : to_string(stage);
+      out << ' ' << label << '=' << static_cast<double>(get(xs[index])) / n;
+    }
+    out << '\n';
+  };
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(2);
+  print_line("allocations-per-message",
+             [](const alloc_counters& x) { return x.allocations; });
+  print_line("allocated-bytes-per-message",
+             [](const alloc_counters& x) { return x.bytes; });
+  out.flags(flags);
+  out.precision(precision);
+  out << "peak-rss: " << peak_rss() << '\n';
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "broker/detail/alloc_stage.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// Counts heap allocations per stage of the message pipeline. Linking
+// alloc-tracker.cc into a program replaces the global operator new and, with
+// glibc, also malloc and friends. The tracker only counts allocations when
+// building Broker with BROKER_ENABLE_ALLOC_TRACKING, since the library marks
+// the pipeline stages only in this case.
+
+/// Number of allocations and allocated bytes.
+struct alloc_counters {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+
+/// Counters for each pipeline stage, indexed by `alloc_stage`.
+using alloc_snapshot = std::array<
+  alloc_counters, static_cast<size_t>(broker::detail::alloc_stage::num_stages)>;
+
+/// Returns whether the program counts allocations.
+bool alloc_tracking_enabled() noexcept;
+
+/// Returns the current counters of all stages. Taking the difference of two
+/// snapshots gives the allocations in between.
+alloc_snapshot alloc_counters_snapshot() noexcept;
+
+/// Returns the counters of `after` minus the counters of `before`.
+alloc_snapshot operator-(const alloc_snapshot& after,
+                         const alloc_snapshot& before) noexcept;
+
+/// Returns the sum of the counters for all stages.
+alloc_counters total(const alloc_snapshot& xs) noexcept;
+
+/// Returns the peak resident set size of the process in bytes or 0 if unknown.
+size_t peak_rss() noexcept;
+
+/// Prints the allocations and allocated bytes per message for each stage plus
+/// the peak RSS of the process. Prints nothing if `alloc_tracking_enabled()`
+/// returns `false`.
+void print_alloc_report(std::ostream& out, const alloc_snapshot& xs,
+                        uint64_t messages);
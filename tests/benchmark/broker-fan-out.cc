@@ -2,15 +2,26 @@
 #include "broker/endpoint.hh"
 #include "broker/message.hh"
 
+#include "alloc-tracker.hh"
+#include "hdr-histogram.hh"
+
+#ifndef BROKER_WINDOWS
+#  include "impairment-proxy.hh"
+#endif
+
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <string>
 #include <string_view>
+#include <thread>
 
 #ifndef BROKER_WINDOWS
-#  include <cstdio>
 #  include <unistd.h>
 #endif
 
@@ -49,6 +60,9 @@ constexpr uint64_t default_message_count = 10'000'000;
 
 constexpr uint64_t default_payload_size = 1'000;
 
+/// Latencies above one hour count as one hour.
+constexpr int64_t max_latency = 3'600'000'000'000;
+
 std::string_view tty_codes[] = {
   "\033[0m",  // reset
   "\033[30m", // black
@@ -95,7 +109,11 @@ struct parameters {
   uint64_t message_count = default_message_count;
   uint64_t payload_size = default_payload_size;
   uint64_t seed = std::random_device{}();
+  uint64_t rate = 0;
   bool naive_publish = false;
+  std::string link_delay = "0";
+  std::string link_jitter = "0";
+  uint64_t link_bandwidth = 0;
 };
 
 // -- I/O utility --------------------------------------------------------------
@@ -187,6 +205,16 @@ void add_options(configuration& cfg, parameters& ps) {
                  "enables more console output");
   cfg.add_option(&ps.naive_publish, "naive-publish",
                  "publish data via endpoint::publish instead of publish_all");
+  cfg.add_option(&ps.rate, "rate,r",
+                 "publish at a fixed rate (messages per second)");
+#ifndef BROKER_WINDOWS
+  cfg.add_option(&ps.link_delay, "link-delay",
+                 "one-way delay between publisher and subscribers, e.g., 20ms");
+  cfg.add_option(&ps.link_jitter, "link-jitter",
+                 "maximum random delay on top of the link delay");
+  cfg.add_option(&ps.link_bandwidth, "link-bandwidth",
+                 "bytes per second per subscriber and direction");
+#endif
   ;
 }
 
@@ -199,12 +227,41 @@ struct generator {
   parameters params;
   std::minstd_rand rng;
 
+  /// Returns a new message with the content `[ts, payload]`. Subscribers use
+  /// the timestamp to measure the end-to-end latency.
+  data_message next(timestamp ts) {
+    vector content;
+    content.reserve(2);
+    content.emplace_back(ts);
+    content.emplace_back(random_string(rng, params.payload_size));
+    return make_data_message("/benchmark/fan-out"s, data{std::move(content)});
+  }
+
   data_message next() {
-    return make_data_message("/benchmark/fan-out"s,
-                             data{random_string(rng, params.payload_size)});
+    return next(broker::now());
   }
 };
 
+void record_latency(hdr_histogram& hist, const data_message& msg) {
+  auto now = broker::now();
+  auto content = get_if<vector>(get_data(msg));
+  if (!content || content->size() != 2)
+    return;
+  if (auto ts = get_if<timestamp>(content->front()))
+    hist.record((now - *ts).count());
+}
+
+void print_latencies(const hdr_histogram& hist) {
+  auto us = [](int64_t ns) { return static_cast<double>(ns) / 1000.0; };
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "n=%llu p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus",
+           static_cast<unsigned long long>(hist.total_count()),
+           us(hist.value_at_percentile(50)), us(hist.value_at_percentile(99)),
+           us(hist.value_at_percentile(99.9)), us(hist.max()));
+  out::println("latency: ", buf);
+}
+
 class barrier {
 public:
   explicit barrier(ptrdiff_t num_threads)
@@ -235,8 +292,9 @@ struct padded_id {
 
 // -- actual program logic -----------------------------------------------------
 
-void run_subscriber(barrier* sync, padded_id* id_slot, uint16_t port,
-                    parameters ps, size_t index) {
+void run_subscriber(barrier* sync, padded_id* id_slot, hdr_histogram* hist,
+                    std::string host, uint16_t port, parameters ps,
+                    size_t index) {
   barrier worker_sync{2};
   endpoint ep;
   id_slot->id = ep.node_id();
@@ -246,7 +304,9 @@ void run_subscriber(barrier* sync, padded_id* id_slot, uint16_t port,
     [] {
       // Init: nop.
     },
-    [&worker_sync, ps, index, n = 0u, &ep](const data_message&) mutable {
+    [&worker_sync, hist, ps, index, n = 0u,
+     &ep](const data_message& msg) mutable {
+      record_latency(*hist, msg);
       ++n;
       if (index == 0 && n % 1000 == 0)
         verbose::println("subscriber 1 received ", n, " items ...");
@@ -259,7 +319,7 @@ void run_subscriber(barrier* sync, padded_id* id_slot, uint16_t port,
     [](const error&) {
       // Cleanup: nop.
     });
-  if (!ep.peer("localhost", port)) {
+  if (!ep.peer(host, port)) {
     std::cerr << "ep.peer failed!\n";
     abort();
   }
@@ -267,8 +327,30 @@ void run_subscriber(barrier* sync, padded_id* id_slot, uint16_t port,
   worker_sync.arrive_and_wait();
 }
 
+// Publishes messages at a fixed rate without waiting for the subscribers. Each
+// message carries the time at which it *should* have been sent. Hence, stalls
+// in the system show up as latency instead of silently lowering the sending
+// rate (coordinated omission).
+void run_paced_publisher(endpoint& ep, parameters ps) {
+  using fractional_seconds = std::chrono::duration<double>;
+  generator gen{ps};
+  auto interval = std::chrono::duration_cast<timespan>(
+    fractional_seconds{1.0 / static_cast<double>(ps.rate)});
+  auto start = std::chrono::steady_clock::now();
+  auto wall_start = broker::now();
+  for (size_t i = 0; i < ps.message_count; ++i) {
+    auto offset = interval * static_cast<int64_t>(i);
+    std::this_thread::sleep_until(start + offset);
+    ep.publish(gen.next(wall_start + offset));
+    if (i % 1000 == 0)
+      verbose::println("publisher emitted ", i, " items ...");
+  }
+}
+
 void run_publisher(endpoint& ep, parameters ps) {
-  if (ps.naive_publish) {
+  if (ps.rate > 0) {
+    run_paced_publisher(ep, ps);
+  } else if (ps.naive_publish) {
     generator gen{ps};
     for (size_t i = 0; i < ps.message_count; ++i) {
       ep.publish(gen.next());
@@ -316,14 +398,40 @@ int main(int argc, char** argv) {
   endpoint ep{std::move(cfg)};
   auto port = ep.listen();
   verbose::println("started publisher endpoint: ", ep.node_id());
+  std::string host = "localhost";
+#ifndef BROKER_WINDOWS
+  // Route all peerings through a local proxy for emulating wide-area links.
+  impairment link;
+  link.bandwidth = params.link_bandwidth;
+  link.seed = params.seed;
+  if (!parse_duration(params.link_delay, link.delay)
+      || !parse_duration(params.link_jitter, link.jitter)) {
+    std::cerr << "*** invalid duration (expected e.g. 1.5s or 20ms)\n\n";
+    return EXIT_FAILURE;
+  }
+  std::unique_ptr<impairment_proxy> proxy;
+  if (link.delay.count() > 0 || link.jitter.count() > 0 || link.bandwidth > 0) {
+    proxy = std::make_unique<impairment_proxy>(link, "127.0.0.1", port);
+    host = "127.0.0.1";
+    port = proxy->start();
+    if (port == 0) {
+      std::cerr << "*** unable to start the impairment proxy\n";
+      return EXIT_FAILURE;
+    }
+    verbose::println("subscribers connect via impairment proxy at port ", port);
+  }
+#endif
   // Spin up N peers, as requested and wait for all of them to connect.
   barrier sync{static_cast<ptrdiff_t>(params.peer_count + 1)};
   std::vector<padded_id> ls;
   ls.resize(params.peer_count);
+  std::vector<hdr_histogram> latencies;
+  latencies.resize(params.peer_count, hdr_histogram{max_latency});
   std::vector<std::thread> threads;
   threads.resize(params.peer_count);
   for (size_t i = 0; i < params.peer_count; ++i)
-    threads[i] = std::thread{run_subscriber, &sync, &ls[i], port, params, i};
+    threads[i] = std::thread{run_subscriber, &sync, &ls[i], &latencies[i],
+                             host, port, params, i};
   sync.arrive_and_wait();
   verbose::println("started ", params.peer_count, " subscriber endpoints");
   // Wait for all peers to complete their handshake.
@@ -335,10 +443,18 @@ int main(int argc, char** argv) {
   }
   verbose::println("received all ", params.peer_count, " handshakes -> run!");
   // Light, camera, action!
+  auto allocs_before = alloc_counters_snapshot();
   run_publisher(ep, params);
   // Tear down.
   verbose::println("tear down -> wait for ", params.peer_count, " threads");
   for (auto& thread : threads)
     thread.join();
+  // All subscribers received all messages once their threads terminated.
+  print_alloc_report(std::cout, alloc_counters_snapshot() - allocs_before,
+                     params.message_count);
+  for (size_t i = 1; i < latencies.size(); ++i)
+    latencies[0].merge(latencies[i]);
+  if (!latencies.empty())
+    print_latencies(latencies[0]);
   verbose::println("all threads have terminated, bye");
 }
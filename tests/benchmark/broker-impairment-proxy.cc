@@ -0,0 +1,121 @@
+#include "broker/configuration.hh"
+
+#include "impairment-proxy.hh"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+std::atomic<bool> shutdown_flag;
+
+void on_signal(int) {
+  shutdown_flag = true;
+}
+
+struct parameters {
+  std::string listen_addr = "127.0.0.1";
+  uint64_t listen_port = 0;
+  std::string target_host = "127.0.0.1";
+  uint64_t target_port = 0;
+  std::string delay = "0";
+  std::string jitter = "0";
+  uint64_t bandwidth = 0;
+  std::string reset_interval = "0";
+  uint64_t buffer_size = 4 * 1024 * 1024;
+  uint64_t seed = 0;
+  bool verbose = false;
+};
+
+void add_options(configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.listen_addr, "listen-addr",
+                 "address for accepting connections");
+  cfg.add_option(&ps.listen_port, "listen-port,l",
+                 "port for accepting connections (0 = random)");
+  cfg.add_option(&ps.target_host, "target-host", "host of the real endpoint");
+  cfg.add_option(&ps.target_port, "target-port,t",
+                 "port of the real endpoint");
+  cfg.add_option(&ps.delay, "delay,d",
+                 "one-way delay per direction, e.g., 20ms");
+  cfg.add_option(&ps.jitter, "jitter,j",
+                 "maximum random delay on top of the delay");
+  cfg.add_option(&ps.bandwidth, "bandwidth,b",
+                 "bytes per second per direction (0 = unlimited)");
+  cfg.add_option(&ps.reset_interval, "reset-interval,r",
+                 "mean time between connection resets (0 = never)");
+  cfg.add_option(&ps.buffer_size, "buffer-size",
+                 "maximum number of bytes in flight per direction");
+  cfg.add_option(&ps.seed, "seed", "seed for the random-number generators");
+  cfg.add_option(&ps.verbose, "verbose", "enables more console output");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  // Parse CLI / config file.
+  configuration cfg{skip_init};
+  parameters params;
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg.remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.target_port == 0 || params.target_port > 65535
+      || params.listen_port > 65535) {
+    std::cerr << "*** invalid or missing port\n\n";
+    return EXIT_FAILURE;
+  }
+  impairment imp;
+  imp.bandwidth = params.bandwidth;
+  imp.buffer_size = params.buffer_size;
+  imp.seed = params.seed;
+  if (!parse_duration(params.delay, imp.delay)
+      || !parse_duration(params.jitter, imp.jitter)
+      || !parse_duration(params.reset_interval, imp.reset_interval)) {
+    std::cerr << "*** invalid duration (expected e.g. 1.5s or 20ms)\n\n";
+    return EXIT_FAILURE;
+  }
+  // Run the proxy until receiving SIGINT or SIGTERM.
+  impairment_proxy proxy{imp, params.target_host,
+                         static_cast<uint16_t>(params.target_port)};
+  auto port = proxy.start(params.listen_addr,
+                          static_cast<uint16_t>(params.listen_port));
+  if (port == 0) {
+    std::cerr << "*** unable to open a port at " << params.listen_addr << "\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "forwarding " << params.listen_addr << ':' << port << " to "
+            << params.target_host << ':' << params.target_port << std::endl;
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  size_t connections = 0;
+  size_t resets = 0;
+  while (!shutdown_flag) {
+    std::this_thread::sleep_for(100ms);
+    if (params.verbose
+        && (proxy.connections() != connections || proxy.resets() != resets)) {
+      connections = proxy.connections();
+      resets = proxy.resets();
+      std::cout << "connections: " << connections << ", resets: " << resets
+                << std::endl;
+    }
+  }
+  proxy.stop();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,463 @@
+#include "broker/config.hh"
+#include "broker/configuration.hh"
+#include "broker/endpoint.hh"
+#include "broker/message.hh"
+#include "broker/store.hh"
+#include "broker/store_event.hh"
+#include "broker/topic.hh"
+
+#include "alloc-tracker.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef BROKER_WINDOWS
+#  include <sys/resource.h>
+#  include <unistd.h>
+#endif
+
+using namespace broker;
+using namespace std::literals;
+
+using steady_clock = std::chrono::steady_clock;
+
+// -- parameters ---------------------------------------------------------------
+
+namespace {
+
+constexpr std::string_view store_name = "broker-store-benchmark";
+
+struct parameters {
+  uint64_t clone_count = 4;
+  std::string backend_type = "memory";
+  std::string sqlite_path = "broker-store-benchmark.db";
+  uint64_t preload = 100'000;
+  uint64_t key_count = 100'000;
+  std::string key_distribution = "uniform";
+  double zipf_exponent = 1.0;
+  uint64_t value_size = 64;
+  double expiry = 0;
+  double rate = 10'000;
+  double duration = 10;
+  double restart_interval = 0;
+  uint64_t seed = 42;
+  bool verbose = false;
+};
+
+void add_options(configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.clone_count, "clone-count,c", "number of clones");
+  cfg.add_option(&ps.backend_type, "backend,b",
+                 "backend of the master: memory or sqlite");
+  cfg.add_option(&ps.sqlite_path, "sqlite-path",
+                 "database file for the sqlite backend");
+  cfg.add_option(&ps.preload, "preload,p",
+                 "number of entries before starting the clones");
+  cfg.add_option(&ps.key_count, "key-count,k",
+                 "number of distinct keys for the write workload");
+  cfg.add_option(&ps.key_distribution, "key-distribution",
+                 "distribution of written keys: uniform or zipf");
+  cfg.add_option(&ps.zipf_exponent, "zipf-exponent",
+                 "exponent for the zipf distribution");
+  cfg.add_option(&ps.value_size, "value-size,s", "bytes per value");
+  cfg.add_option(&ps.expiry, "expiry,e",
+                 "expiry of written entries in seconds (0 = never)");
+  cfg.add_option(&ps.rate, "rate,r", "writes per second");
+  cfg.add_option(&ps.duration, "duration,d",
+                 "runtime of the write workload in seconds");
+  cfg.add_option(&ps.restart_interval, "restart-interval",
+                 "seconds between killing and restarting a clone (0 = never)");
+  cfg.add_option(&ps.seed, "seed", "seed for the random-number generator");
+  cfg.add_option(&ps.verbose, "verbose", "enables more console output");
+}
+
+// -- utility ------------------------------------------------------------------
+
+std::mutex ostream_mtx;
+
+template <class... Ts>
+void verbose_println(const parameters& ps, Ts&&... xs) {
+  if (ps.verbose) {
+    std::unique_lock<std::mutex> guard{ostream_mtx};
+    (std::clog << ... << xs) << '\n';
+  }
+}
+
+std::string make_key(uint64_t index) {
+  return "key-" + std::to_string(index);
+}
+
+template <class RandomEngine>
+std::string random_string(RandomEngine& rng, size_t size) {
+  std::string_view charset = "0123456789"
+                             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                             "abcdefghijklmnopqrstuvwxyz";
+  auto dis = std::uniform_int_distribution<size_t>{0, charset.size() - 1};
+  std::string result;
+  result.reserve(size);
+  for (size_t i = 0; i < size; ++i)
+    result.push_back(charset[dis(rng)]);
+  return result;
+}
+
+// Returns the CPU time of the process, i.e., of all endpoints.
+timespan cpu_time() {
+#ifndef BROKER_WINDOWS
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return timespan{0};
+  auto to_timespan = [](const timeval& tv) {
+    return std::chrono::duration_cast<timespan>(
+      std::chrono::seconds{tv.tv_sec} + std::chrono::microseconds{tv.tv_usec});
+  };
+  return to_timespan(usage.ru_utime) + to_timespan(usage.ru_stime);
+#else
+  return timespan{0};
+#endif
+}
+
+// Returns the resident set size of the process in bytes or 0 if unknown.
+size_t resident_set_size() {
+#ifdef BROKER_LINUX
+  std::ifstream in{"/proc/self/statm"};
+  size_t total = 0;
+  size_t resident = 0;
+  if (in >> total >> resident)
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+  return 0;
+}
+
+// Samples the resident set size in the background to capture the peak memory
+// usage, e.g., while the master serializes snapshots for new clones.
+class rss_sampler {
+public:
+  rss_sampler() : peak_(resident_set_size()) {
+    thread_ = std::thread{[this] {
+      while (running_) {
+        auto rss = resident_set_size();
+        if (rss > peak_)
+          peak_ = rss;
+        std::this_thread::sleep_for(5ms);
+      }
+    }};
+  }
+
+  ~rss_sampler() {
+    running_ = false;
+    thread_.join();
+  }
+
+  size_t peak() const noexcept {
+    return peak_;
+  }
+
+private:
+  std::atomic<bool> running_ = true;
+  std::atomic<size_t> peak_;
+  std::thread thread_;
+};
+
+// Prints min, percentiles and max for a list of durations in milliseconds.
+void print_distribution(std::string_view name, std::vector<timespan> xs) {
+  std::cout << name << ':';
+  if (xs.empty()) {
+    std::cout << " none\n";
+    return;
+  }
+  std::sort(xs.begin(), xs.end());
+  auto at = [&xs](double p) {
+    auto index = static_cast<size_t>(p * static_cast<double>(xs.size() - 1));
+    std::chrono::duration<double, std::milli> ms = xs[index];
+    return ms.count();
+  };
+  std::cout << std::fixed << std::setprecision(3) << " n=" << xs.size()
+            << " min=" << at(0) << "ms p50=" << at(0.5) << "ms p90=" << at(0.9)
+            << "ms p99=" << at(0.99) << "ms p99.9=" << at(0.999)
+            << "ms max=" << at(1) << "ms\n";
+}
+
+// -- clones -------------------------------------------------------------------
+
+// A clone in its own endpoint. Killing the clone shuts down the endpoint.
+class clone_node {
+public:
+  ~clone_node() {
+    kill();
+  }
+
+  // Starts the clone and blocks until it received the state from the master.
+  // Returns the time from starting the endpoint until the clone has its state.
+  std::optional<timespan> start(uint16_t port, entity_id writer) {
+    auto t0 = steady_clock::now();
+    ep_ = std::make_unique<endpoint>();
+    ep_->subscribe({topic::store_events() / std::string{store_name}},
+                   [this, writer](const data_message& msg) {
+                     on_event(get_data(msg), writer);
+                   });
+    if (!ep_->peer("127.0.0.1", port))
+      return std::nullopt;
+    auto res = ep_->attach_clone(std::string{store_name});
+    if (!res)
+      return std::nullopt;
+    st_ = std::move(*res);
+    // The clone only responds to queries after receiving the snapshot.
+    if (!st_.exists(data{make_key(0)}))
+      return std::nullopt;
+    return std::chrono::duration_cast<timespan>(steady_clock::now() - t0);
+  }
+
+  void kill() {
+    st_.reset();
+    ep_.reset();
+  }
+
+  std::vector<timespan> lags() {
+    std::unique_lock<std::mutex> guard{mtx_};
+    return lags_;
+  }
+
+private:
+  // Computes the replication lag for writes of the benchmark. Ignores events
+  // from snapshots, since these have the master as publisher.
+  void on_event(const data& x, const entity_id& writer) {
+    auto record = [this, &writer](const data& value, entity_id publisher) {
+      if (publisher != writer)
+        return;
+      auto xs = get_if<vector>(value);
+      if (!xs || xs->empty())
+        return;
+      if (auto ts = get_if<timestamp>(xs->front())) {
+        auto lag = broker::now() - *ts;
+        std::unique_lock<std::mutex> guard{mtx_};
+        lags_.emplace_back(lag);
+      }
+    };
+    if (auto ev = store_event::insert::make(x))
+      record(ev.value(), ev.publisher());
+    else if (auto ev = store_event::update::make(x))
+      record(ev.new_value(), ev.publisher());
+  }
+
+  std::mutex mtx_;
+  std::vector<timespan> lags_;
+  std::unique_ptr<endpoint> ep_;
+  store st_;
+};
+
+// -- workload -----------------------------------------------------------------
+
+class key_generator {
+public:
+  explicit key_generator(const parameters& ps)
+    : rng_(static_cast<uint32_t>(ps.seed)), uniform_(0, ps.key_count - 1) {
+    if (ps.key_distribution == "zipf") {
+      std::vector<double> weights;
+      weights.reserve(ps.key_count);
+      for (uint64_t i = 1; i <= ps.key_count; ++i)
+        weights.emplace_back(1.0 / std::pow(static_cast<double>(i),
+                                            ps.zipf_exponent));
+      zipf_.emplace(weights.begin(), weights.end());
+    }
+  }
+
+  uint64_t next() {
+    if (zipf_)
+      return (*zipf_)(rng_);
+    return uniform_(rng_);
+  }
+
+  std::minstd_rand& rng() noexcept {
+    return rng_;
+  }
+
+private:
+  std::minstd_rand rng_;
+  std::uniform_int_distribution<uint64_t> uniform_;
+  std::optional<std::discrete_distribution<uint64_t>> zipf_;
+};
+
+// Writes to the master at the configured rate and returns the number of
+// writes.
+uint64_t run_writer(store& master, const parameters& ps) {
+  key_generator keys{ps};
+  std::optional<timespan> expiry;
+  if (ps.expiry > 0)
+    expiry = std::chrono::duration_cast<timespan>(
+      std::chrono::duration<double>{ps.expiry});
+  auto payload = random_string(keys.rng(), ps.value_size);
+  auto t0 = steady_clock::now();
+  auto stop = t0 + std::chrono::duration_cast<timespan>(
+                     std::chrono::duration<double>{ps.duration});
+  uint64_t count = 0;
+  for (auto now = t0; now < stop; now = steady_clock::now()) {
+    std::chrono::duration<double> elapsed = now - t0;
+    auto due = static_cast<uint64_t>(elapsed.count() * ps.rate);
+    for (; count < due; ++count)
+      master.put(make_key(keys.next()), vector{broker::now(), payload}, expiry);
+    std::this_thread::sleep_for(1ms);
+  }
+  return count;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  // Parse CLI / config file.
+  configuration cfg{skip_init};
+  parameters params;
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg.remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.key_count == 0 || params.rate <= 0) {
+    std::cerr << "*** key-count and rate must be positive\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.key_distribution != "uniform"
+      && params.key_distribution != "zipf") {
+    std::cerr << "*** invalid key distribution: " << params.key_distribution
+              << "\n\n";
+    return EXIT_FAILURE;
+  }
+  // Spin up the master.
+  endpoint ep{std::move(cfg)};
+  auto port = ep.listen("127.0.0.1", 0);
+  if (port == 0) {
+    std::cerr << "*** unable to open a local port\n";
+    return EXIT_FAILURE;
+  }
+  backend_options opts;
+  auto type = backend::memory;
+  if (params.backend_type == "sqlite") {
+    type = backend::sqlite;
+    opts["path"] = params.sqlite_path;
+  } else if (params.backend_type != "memory") {
+    std::cerr << "*** invalid backend: " << params.backend_type << "\n\n";
+    return EXIT_FAILURE;
+  }
+  auto master = ep.attach_master(std::string{store_name}, type, opts);
+  if (!master) {
+    std::cerr << "*** unable to attach master: " << to_string(master.error())
+              << '\n';
+    return EXIT_FAILURE;
+  }
+  // Fill the master before starting the clones to get realistic snapshots.
+  {
+    std::minstd_rand rng{static_cast<uint32_t>(params.seed)};
+    auto payload = random_string(rng, params.value_size);
+    for (uint64_t i = 0; i < params.preload; ++i)
+      master->put(make_key(i), payload);
+    if (!master->await_idle()) {
+      std::cerr << "*** master did not become idle after preloading\n";
+      return EXIT_FAILURE;
+    }
+    verbose_println(params, "preloaded ", params.preload, " entries");
+  }
+  auto writer = master->frontend_id();
+  // Start all clones and measure how long they need for the initial handshake
+  // and snapshot.
+  auto rss_before = resident_set_size();
+  size_t rss_peak = 0;
+  std::vector<timespan> sync_times;
+  std::vector<std::unique_ptr<clone_node>> clones;
+  {
+    rss_sampler sampler;
+    std::vector<std::thread> threads;
+    std::vector<std::optional<timespan>> results(params.clone_count);
+    for (size_t i = 0; i < params.clone_count; ++i) {
+      clones.emplace_back(std::make_unique<clone_node>());
+      threads.emplace_back(
+        [&, i] { results[i] = clones[i]->start(port, writer); });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    rss_peak = sampler.peak();
+    for (auto& res : results) {
+      if (!res) {
+        std::cerr << "*** clone failed to synchronize with the master\n";
+        return EXIT_FAILURE;
+      }
+      sync_times.emplace_back(*res);
+    }
+  }
+  verbose_println(params, "started ", params.clone_count, " clones");
+  // Kill and restart clones in the background if requested.
+  std::atomic<bool> done = false;
+  std::vector<timespan> resync_times;
+  std::thread restarter;
+  if (params.restart_interval > 0 && !clones.empty()) {
+    restarter = std::thread{[&] {
+      auto interval = std::chrono::duration_cast<timespan>(
+        std::chrono::duration<double>{params.restart_interval});
+      size_t index = 0;
+      while (!done) {
+        std::this_thread::sleep_for(interval);
+        if (done)
+          break;
+        auto& node = *clones[index++ % clones.size()];
+        node.kill();
+        if (auto res = node.start(port, writer)) {
+          resync_times.emplace_back(*res);
+          verbose_println(params, "restarted a clone");
+        } else {
+          std::cerr << "*** clone failed to resynchronize with the master\n";
+        }
+      }
+    }};
+  }
+  // Run the workload.
+  auto cpu_before = cpu_time();
+  auto allocs_before = alloc_counters_snapshot();
+  auto writes = run_writer(*master, params);
+  std::ignore = master->await_idle();
+  auto cpu_used = cpu_time() - cpu_before;
+  auto allocs = alloc_counters_snapshot() - allocs_before;
+  done = true;
+  if (restarter.joinable())
+    restarter.join();
+  // Give the clones a moment to catch up before collecting the results.
+  std::this_thread::sleep_for(1s);
+  std::vector<timespan> lags;
+  for (auto& node : clones) {
+    auto xs = node->lags();
+    lags.insert(lags.end(), xs.begin(), xs.end());
+  }
+  // Print results.
+  std::chrono::duration<double> cpu_secs = cpu_used;
+  std::cout << "writes: " << writes << '\n'
+            << "updates-received: " << lags.size() << '\n'
+            << std::fixed << std::setprecision(3)
+            << "cpu-time: " << cpu_secs.count() << "s\n"
+            << "cpu-utilization: " << cpu_secs.count() / params.duration
+            << '\n'
+            << "rss-before-sync: " << rss_before << '\n'
+            << "rss-peak-during-sync: " << rss_peak << '\n';
+  print_distribution("replication-lag", std::move(lags));
+  print_distribution("initial-sync", std::move(sync_times));
+  print_distribution("resync", std::move(resync_times));
+  print_alloc_report(std::cout, allocs, writes);
+  clones.clear();
+  return EXIT_SUCCESS;
+}
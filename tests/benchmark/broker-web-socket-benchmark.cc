@@ -0,0 +1,474 @@
+#include "broker/configuration.hh"
+#include "broker/endpoint.hh"
+#include "broker/error.hh"
+#include "broker/format/json.hh"
+#include "broker/message.hh"
+#include "broker/subscriber.hh"
+#include "broker/topic.hh"
+
+#include "hdr-histogram.hh"
+#include "web-socket-client.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <time.h>
+
+using namespace broker;
+using namespace std::literals;
+
+using steady_clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::string_view benchmark_topic = "/benchmark/web-socket";
+
+/// Upper bound for latency measurements (1h in nanoseconds).
+constexpr int64_t max_latency = 3'600'000'000'000;
+
+// -- parameters ---------------------------------------------------------------
+
+struct parameters {
+  std::string clients = "1,10,100";
+  std::string mode = "mixed";
+  double rate = 100;
+  uint64_t payload_size = 64;
+  double duration = 10;
+  std::string batching = "none";
+  bool verbose = false;
+};
+
+void add_options(configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.clients, "clients,c",
+                 "comma-separated list of client counts, e.g., 1,10,100");
+  cfg.add_option(&ps.mode, "mode,m",
+                 "publish (clients only publish), subscribe (clients only "
+                 "receive), or mixed (clients publish and receive)");
+  cfg.add_option(&ps.rate, "rate,r",
+                 "messages per second per client (or for the endpoint in "
+                 "subscribe mode)");
+  cfg.add_option(&ps.payload_size, "payload-size,s",
+                 "size of the string payload in each message");
+  cfg.add_option(&ps.duration, "duration,d",
+                 "runtime per client count in seconds");
+  cfg.add_option(&ps.batching, "batching,b",
+                 "batching of messages to clients: none, array, or ndjson");
+  cfg.add_option(&ps.verbose, "verbose", "enables more console output");
+}
+
+// -- utility ------------------------------------------------------------------
+
+// Returns the CPU time of the whole process.
+timespan process_cpu_time() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return timespan{0};
+  auto to_timespan = [](const timeval& tv) {
+    return std::chrono::duration_cast<timespan>(
+      std::chrono::seconds{tv.tv_sec} + std::chrono::microseconds{tv.tv_usec});
+  };
+  return to_timespan(usage.ru_utime) + to_timespan(usage.ru_stime);
+}
+
+// Returns the CPU time of the calling thread.
+timespan thread_cpu_time() {
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    return timespan{0};
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           steady_clock::now().time_since_epoch())
+    .count();
+}
+
+std::vector<size_t> parse_client_counts(const std::string& str) {
+  std::vector<size_t> result;
+  size_t pos = 0;
+  while (pos < str.size()) {
+    auto next = str.find(',', pos);
+    if (next == std::string::npos)
+      next = str.size();
+    try {
+      auto n = std::stoul(str.substr(pos, next - pos));
+      if (n == 0)
+        return {};
+      result.push_back(n);
+    } catch (...) {
+      return {};
+    }
+    pos = next + 1;
+  }
+  return result;
+}
+
+// Creates a message with the current time and the payload.
+data make_message(const std::string& payload) {
+  return vector{count{static_cast<uint64_t>(now_ns())}, payload};
+}
+
+// Returns the latency for a message from `make_message` or -1 if `x` has an
+// unexpected format.
+int64_t latency_of(const data& x) {
+  auto xs = get_if<vector>(x);
+  if (xs == nullptr || xs->empty())
+    return -1;
+  auto ts = get_if<count>((*xs)[0]);
+  if (ts == nullptr)
+    return -1;
+  return now_ns() - static_cast<int64_t>(*ts);
+}
+
+// -- load generation ----------------------------------------------------------
+
+/// Counters for a load-generating thread. Each thread fills its own instance
+/// and merges it into the totals after the run.
+struct load_stats {
+  uint64_t sent = 0;
+  uint64_t received = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t bytes_received = 0;
+  uint64_t disconnects = 0;
+  uint64_t decode_errors = 0;
+  timespan cpu{0};
+  hdr_histogram latencies{max_latency};
+
+  void merge(const load_stats& other) {
+    sent += other.sent;
+    received += other.received;
+    bytes_sent += other.bytes_sent;
+    bytes_received += other.bytes_received;
+    disconnects += other.disconnects;
+    decode_errors += other.decode_errors;
+    cpu += other.cpu;
+    latencies.merge(other.latencies);
+  }
+};
+
+/// Synchronizes all threads of a single run.
+struct run_state {
+  std::atomic<size_t> ready = 0;
+  std::atomic<size_t> failed = 0;
+  std::atomic<bool> running = false;
+  std::atomic<bool> done = false;
+  std::mutex mtx;
+  load_stats totals;
+
+  void merge(const load_stats& stats) {
+    std::unique_lock<std::mutex> guard{mtx};
+    totals.merge(stats);
+  }
+
+  // Blocks until the run starts. Returns `false` if the run was aborted.
+  bool await_start() {
+    while (!running && !done)
+      std::this_thread::sleep_for(1ms);
+    return !done;
+  }
+};
+
+std::string make_handshake(const parameters& ps, bool subscribe) {
+  std::string filter = "[]";
+  if (subscribe) {
+    filter = "[\"";
+    filter += benchmark_topic;
+    filter += "\"]";
+  }
+  if (ps.batching == "none")
+    return filter;
+  std::string result = "{\"subscriptions\": ";
+  result += filter;
+  result += ", \"batching\": {\"format\": \"";
+  result += ps.batching;
+  result += "\"}}";
+  return result;
+}
+
+// Decodes all messages in a frame and records their latency.
+void process_frame(const std::string& frame, bool ndjson, load_stats& stats,
+                   std::vector<std::pair<topic, data>>& buf) {
+  stats.bytes_received += frame.size();
+  buf.clear();
+  auto ok = true;
+  if (ndjson) {
+    std::string_view str = frame;
+    while (ok && !str.empty()) {
+      auto line = str.substr(0, str.find('\n'));
+      str.remove_prefix(std::min(line.size() + 1, str.size()));
+      if (!line.empty()) {
+        auto& [t, d] = buf.emplace_back();
+        ok = format::json::v1::decode_data_message(line, t, d);
+      }
+    }
+  } else {
+    ok = format::json::v1::decode_data_messages(frame, buf);
+  }
+  if (!ok) {
+    ++stats.decode_errors;
+    return;
+  }
+  for (auto& [t, d] : buf) {
+    ++stats.received;
+    if (auto latency = latency_of(d); latency >= 0)
+      stats.latencies.record(latency);
+  }
+}
+
+// Runs a single WebSocket client.
+void run_client(const parameters& ps, uint16_t port, SSL_CTX* ctx,
+                bool publish, bool subscribe, size_t index, size_t num_clients,
+                run_state& st) {
+  web_socket_client ws;
+  std::string frame;
+  if (!ws.connect("127.0.0.1", port, "/v1/messages/json", ctx)
+      || !ws.send_text(make_handshake(ps, subscribe))
+      || ws.read(frame, 10s) != web_socket_client::read_result::message
+      || frame.find("\"ack\"") == std::string::npos) {
+    if (ps.verbose)
+      std::cerr << "client " << index << " failed to connect: "
+                << (ws.last_error().empty() ? frame : ws.last_error()) << '\n';
+    ++st.failed;
+    return;
+  }
+  ++st.ready;
+  if (!st.await_start())
+    return;
+  load_stats stats;
+  auto cpu_start = thread_cpu_time();
+  auto ndjson = ps.batching == "ndjson";
+  auto payload = std::string(ps.payload_size, 'x');
+  std::string msg;
+  std::vector<std::pair<topic, data>> buf;
+  auto interval = std::chrono::duration_cast<steady_clock::duration>(
+    std::chrono::duration<double>{1.0 / ps.rate});
+  // Spread the clients evenly over the first interval to avoid bursts.
+  auto next_send = steady_clock::now() + interval * index / num_clients;
+  auto connected = true;
+  while (connected && !st.done) {
+    auto now = steady_clock::now();
+    if (publish && now >= next_send) {
+      msg.clear();
+      format::json::v1::encode_data_message(topic{std::string{benchmark_topic}},
+                                            make_message(payload), msg);
+      if (!ws.send_text(msg)) {
+        connected = false;
+        break;
+      }
+      ++stats.sent;
+      stats.bytes_sent += msg.size();
+      next_send += interval;
+      continue;
+    }
+    auto timeout = 10ms;
+    if (publish)
+      timeout = std::min(timeout,
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                           next_send - now));
+    switch (ws.read(frame, timeout)) {
+      case web_socket_client::read_result::message:
+        process_frame(frame, ndjson, stats, buf);
+        break;
+      case web_socket_client::read_result::closed:
+        connected = false;
+        break;
+      default:
+        break;
+    }
+  }
+  if (!connected)
+    ++stats.disconnects;
+  stats.cpu = thread_cpu_time() - cpu_start;
+  st.merge(stats);
+}
+
+// Publishes from the endpoint for the subscribe mode.
+void run_local_publisher(const parameters& ps, endpoint& ep, run_state& st) {
+  if (!st.await_start())
+    return;
+  load_stats stats;
+  auto cpu_start = thread_cpu_time();
+  auto payload = std::string(ps.payload_size, 'x');
+  auto interval = std::chrono::duration_cast<steady_clock::duration>(
+    std::chrono::duration<double>{1.0 / ps.rate});
+  auto next_send = steady_clock::now();
+  auto t = topic{std::string{benchmark_topic}};
+  while (!st.done) {
+    std::this_thread::sleep_until(next_send);
+    ep.publish(t, make_message(payload));
+    ++stats.sent;
+    next_send += interval;
+  }
+  stats.cpu = thread_cpu_time() - cpu_start;
+  st.merge(stats);
+}
+
+// Receives at the endpoint for the publish mode.
+void run_local_subscriber(endpoint& ep, run_state& st) {
+  auto sub = ep.make_subscriber({topic{std::string{benchmark_topic}}});
+  if (!st.await_start())
+    return;
+  load_stats stats;
+  auto cpu_start = thread_cpu_time();
+  while (!st.done) {
+    for (auto& msg : sub.get(100, 10ms)) {
+      ++stats.received;
+      if (auto latency = latency_of(get_data(msg)); latency >= 0)
+        stats.latencies.record(latency);
+    }
+  }
+  stats.cpu = thread_cpu_time() - cpu_start;
+  st.merge(stats);
+}
+
+// Runs the benchmark for a single client count and prints the results.
+bool run(const parameters& ps, endpoint& ep, uint16_t port, SSL_CTX* ctx,
+         size_t num_clients) {
+  auto publish = ps.mode != "subscribe";
+  auto subscribe = ps.mode != "publish";
+  run_state st;
+  std::vector<std::thread> threads;
+  if (!publish)
+    threads.emplace_back([&] { run_local_publisher(ps, ep, st); });
+  if (!subscribe)
+    threads.emplace_back([&] { run_local_subscriber(ep, st); });
+  for (size_t i = 0; i < num_clients; ++i)
+    threads.emplace_back([&, i] {
+      run_client(ps, port, ctx, publish, subscribe, i, num_clients, st);
+    });
+  // Wait until all clients completed the handshake.
+  auto deadline = steady_clock::now() + 30s;
+  while (st.ready + st.failed < num_clients && steady_clock::now() < deadline)
+    std::this_thread::sleep_for(1ms);
+  auto ok = st.ready == num_clients;
+  if (ok) {
+    if (ps.verbose)
+      std::cerr << num_clients << " clients connected, start measuring\n";
+    // Give the endpoint time to propagate the subscriptions.
+    std::this_thread::sleep_for(100ms);
+    auto cpu_start = process_cpu_time();
+    auto start = steady_clock::now();
+    st.running = true;
+    std::this_thread::sleep_for(std::chrono::duration<double>{ps.duration});
+    st.done = true;
+    auto elapsed = std::chrono::duration<double>{steady_clock::now() - start};
+    auto cpu_used = process_cpu_time() - cpu_start;
+    for (auto& thread : threads)
+      thread.join();
+    // The server CPU time is the process CPU time minus the CPU time of our
+    // load-generating threads.
+    auto& totals = st.totals;
+    auto server_cpu = std::chrono::duration<double>{cpu_used - totals.cpu};
+    auto secs = elapsed.count();
+    auto& hist = totals.latencies;
+    auto us = [&hist](double p) {
+      return static_cast<double>(hist.value_at_percentile(p)) / 1e3;
+    };
+    std::cout << std::fixed << std::setprecision(1) //
+              << "clients: " << num_clients << '\n'
+              << "sent-per-second: " << totals.sent / secs << '\n'
+              << "received-per-second: " << totals.received / secs << '\n'
+              << "sent-bytes-per-second: " << totals.bytes_sent / secs << '\n'
+              << "received-bytes-per-second: " << totals.bytes_received / secs
+              << '\n'
+              << "latency-us: p50=" << us(50) << " p99=" << us(99)
+              << " p99.9=" << us(99.9)
+              << " max=" << static_cast<double>(hist.max()) / 1e3 << '\n'
+              << std::setprecision(3)
+              << "server-cpu-utilization: " << server_cpu.count() / secs
+              << '\n'
+              << "server-cpu-per-client: "
+              << server_cpu.count() / secs / num_clients << '\n'
+              << "disconnects: " << totals.disconnects << '\n'
+              << "decode-errors: " << totals.decode_errors << "\n\n";
+  } else {
+    std::cerr << "*** " << st.failed << " of " << num_clients
+              << " clients failed to connect\n";
+    st.done = true;
+    for (auto& thread : threads)
+      thread.join();
+  }
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  // Parse CLI / config file.
+  configuration cfg{skip_init};
+  parameters params;
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg.remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  auto client_counts = parse_client_counts(params.clients);
+  if (client_counts.empty()) {
+    std::cerr << "*** invalid client counts: " << params.clients << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.mode != "publish" && params.mode != "subscribe"
+      && params.mode != "mixed") {
+    std::cerr << "*** invalid mode: " << params.mode << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.batching != "none" && params.batching != "array"
+      && params.batching != "ndjson") {
+    std::cerr << "*** invalid batching: " << params.batching << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.rate <= 0 || params.duration <= 0) {
+    std::cerr << "*** rate and duration must be positive\n\n";
+    return EXIT_FAILURE;
+  }
+  // Clients use TLS unless the user passes --disable-ssl.
+  std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> ctx{nullptr,
+                                                        SSL_CTX_free};
+  if (auto ssl = cfg.openssl_options()) {
+    ctx.reset(make_client_ssl_context(ssl->certificate, ssl->key,
+                                      ssl->passphrase, ssl->cafile));
+    if (!ctx) {
+      std::cerr << "*** unable to create the SSL context for the clients\n";
+      return EXIT_FAILURE;
+    }
+  }
+  // Spin up the endpoint.
+  endpoint ep{std::move(cfg)};
+  error err;
+  auto port = ep.web_socket_listen("127.0.0.1", 0, &err);
+  if (port == 0) {
+    std::cerr << "*** unable to open a WebSocket port: " << to_string(err)
+              << '\n';
+    return EXIT_FAILURE;
+  }
+  if (params.verbose)
+    std::cerr << "WebSocket server listens on port " << port
+              << (ctx ? " (TLS)\n" : " (plain)\n");
+  std::cout << "mode: " << params.mode << '\n'
+            << "tls: " << (ctx ? "yes" : "no") << '\n'
+            << "batching: " << params.batching << "\n\n";
+  for (auto n : client_counts)
+    if (!run(params, ep, port, ctx.get(), n))
+      return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
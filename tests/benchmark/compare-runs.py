@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Compares two result files from run-suite.py and flags regressions.
+
+A metric regresses if its median changes in the wrong direction by more than
+the threshold and the Mann-Whitney U test considers the difference between
+the samples significant. Only metrics with a known direction ("higher" or
+"lower" is better) may regress.
+
+Usage:
+
+    compare-runs.py baseline.json candidate.json
+
+Exits with status 1 if at least one metric regressed.
+"""
+
+import argparse
+import json
+import math
+import statistics
+import sys
+
+
+def exact_p_value(u, n1, n2):
+    """
+    Computes the two-sided p-value for the U statistic from the exact
+    distribution. Only valid for samples without ties.
+    """
+    # counts[i][j][k]: number of orderings of i plus j values with U = k.
+    max_u = n1 * n2
+    counts = [[None] * (n2 + 1) for _ in range(n1 + 1)]
+    for i in range(n1 + 1):
+        for j in range(n2 + 1):
+            if i == 0 or j == 0:
+                counts[i][j] = [1] + [0] * max_u
+                continue
+            row = [0] * (max_u + 1)
+            # The largest value is either from the first sample (adding j to
+            # U) or from the second sample.
+            for k in range(max_u + 1):
+                if k >= j:
+                    row[k] += counts[i - 1][j][k - j]
+                row[k] += counts[i][j - 1][k]
+            counts[i][j] = row
+    dist = counts[n1][n2]
+    total = sum(dist)
+    lower = sum(dist[:int(u) + 1]) / total
+    upper = sum(dist[int(math.ceil(u)):]) / total
+    return min(1.0, 2 * min(lower, upper))
+
+
+def mann_whitney_u(xs, ys):
+    """
+    Returns the two-sided p-value of the Mann-Whitney U test for the samples
+    `xs` and `ys`.
+    """
+    n1, n2 = len(xs), len(ys)
+    values = sorted([(x, 0) for x in xs] + [(y, 1) for y in ys])
+    # Assign ranks, using the average rank for ties.
+    ranks = [0.0] * len(values)
+    tie_sum = 0
+    i = 0
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        tie_sum += (j - i + 1) ** 3 - (j - i + 1)
+        i = j + 1
+    rank_sum = sum(r for r, (_, group) in zip(ranks, values) if group == 0)
+    u = rank_sum - n1 * (n1 + 1) / 2
+    if tie_sum == 0 and n1 <= 20 and n2 <= 20:
+        return exact_p_value(u, n1, n2)
+    # Normal approximation with tie correction.
+    n = n1 + n2
+    mean = n1 * n2 / 2
+    var = n1 * n2 / 12 * ((n + 1) - tie_sum / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (abs(u - mean) - 0.5) / math.sqrt(var)
+    return min(1.0, math.erfc(max(z, 0) / math.sqrt(2)))
+
+
+def compare(baseline, candidate, alpha, threshold):
+    """
+    Returns a list of (benchmark, metric, old, new, change, p, verdict) tuples.
+    """
+    result = []
+    for name, bench in sorted(candidate['benchmarks'].items()):
+        if name not in baseline['benchmarks']:
+            continue
+        old_metrics = baseline['benchmarks'][name]['metrics']
+        for metric, entry in sorted(bench['metrics'].items()):
+            if metric not in old_metrics:
+                continue
+            xs = old_metrics[metric]['samples']
+            ys = entry['samples']
+            old = statistics.median(xs)
+            new = statistics.median(ys)
+            if old != 0:
+                change = (new - old) / abs(old)
+            else:
+                change = 0.0 if new == 0 else math.inf
+            better = entry.get('better')
+            p = mann_whitney_u(xs, ys) if len(xs) > 1 and len(ys) > 1 else None
+            verdict = ''
+            if better in ('higher', 'lower') and p is not None and p < alpha \
+                    and abs(change) > threshold:
+                worse = change < 0 if better == 'higher' else change > 0
+                verdict = 'regression' if worse else 'improvement'
+            result.append((name, metric, old, new, change, p, verdict))
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compares two benchmark runs.')
+    parser.add_argument('baseline', help='results of the baseline')
+    parser.add_argument('candidate', help='results of the candidate')
+    parser.add_argument('--alpha', type=float, default=0.05,
+                        help='significance level (default: 0.05)')
+    parser.add_argument('--threshold', type=float, default=0.05,
+                        help='minimum relative change (default: 0.05)')
+    parser.add_argument('--all', action='store_true',
+                        help='print all metrics instead of only changes')
+    args = parser.parse_args()
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    with open(args.candidate) as f:
+        candidate = json.load(f)
+    rows = compare(baseline, candidate, args.alpha, args.threshold)
+    header = ('benchmark', 'metric', 'baseline', 'candidate', 'change',
+              'p-value', 'verdict')
+    lines = [header]
+    for name, metric, old, new, change, p, verdict in rows:
+        if not args.all and not verdict:
+            continue
+        lines.append((name, metric, '{:.6g}'.format(old),
+                      '{:.6g}'.format(new), '{:+.1%}'.format(change),
+                      '-' if p is None else '{:.4f}'.format(p), verdict))
+    regressions = sum(1 for row in rows if row[-1] == 'regression')
+    improvements = sum(1 for row in rows if row[-1] == 'improvement')
+    if len(lines) > 1:
+        widths = [max(len(line[i]) for line in lines)
+                  for i in range(len(header))]
+        for line in lines:
+            print('  '.join(col.ljust(w) for col, w in zip(line, widths))
+                  .rstrip())
+        print()
+    print('{} metrics compared, {} regressions, {} improvements'.format(
+        len(rows), regressions, improvements))
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,132 @@
+#include "hdr-histogram.hh"
+
+#include "broker/detail/assert.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Returns the position of the highest bit in `x`.
+// @pre `x > 0`
+int floor_log2(uint64_t x) noexcept {
+  int result = 0;
+  while (x >>= 1)
+    ++result;
+  return result;
+}
+
+} // namespace
+
+hdr_histogram::hdr_histogram(int64_t highest_trackable_value,
+                             int significant_digits)
+  : highest_trackable_value_(highest_trackable_value),
+    significant_digits_(significant_digits) {
+  BROKER_ASSERT(highest_trackable_value >= 2);
+  BROKER_ASSERT(significant_digits >= 1 && significant_digits <= 5);
+  // Each bucket needs enough sub-buckets to tell apart values that differ in
+  // the last significant digit.
+  auto single_unit_resolution = 2 * std::pow(10.0, significant_digits);
+  auto magnitude = static_cast<int>(
+    std::ceil(std::log2(single_unit_resolution)));
+  sub_bucket_half_count_magnitude_ = std::max(magnitude, 1) - 1;
+  sub_bucket_count_ = int64_t{1} << (sub_bucket_half_count_magnitude_ + 1);
+  sub_bucket_half_count_ = sub_bucket_count_ / 2;
+  sub_bucket_mask_ = sub_bucket_count_ - 1;
+  // Each additional bucket doubles the range of trackable values.
+  int64_t smallest_untrackable_value = sub_bucket_count_;
+  size_t bucket_count = 1;
+  while (smallest_untrackable_value <= highest_trackable_value) {
+    ++bucket_count;
+    if (smallest_untrackable_value > std::numeric_limits<int64_t>::max() / 2)
+      break;
+    smallest_untrackable_value <<= 1;
+  }
+  counts_.resize((bucket_count + 1)
+                 * static_cast<size_t>(sub_bucket_half_count_));
+}
+
+void hdr_histogram::record(int64_t value, uint64_t count) noexcept {
+  value = std::clamp(value, int64_t{0}, highest_trackable_value_);
+  counts_[index_of(value)] += count;
+  if (total_count_ == 0 || value < min_)
+    min_ = value;
+  if (value > max_)
+    max_ = value;
+  total_count_ += count;
+  sum_ += static_cast<double>(value) * static_cast<double>(count);
+}
+
+void hdr_histogram::merge(const hdr_histogram& other) {
+  BROKER_ASSERT(counts_.size() == other.counts_.size());
+  BROKER_ASSERT(significant_digits_ == other.significant_digits_);
+  if (other.total_count_ == 0)
+    return;
+  for (size_t index = 0; index < counts_.size(); ++index)
+    counts_[index] += other.counts_[index];
+  if (total_count_ == 0 || other.min_ < min_)
+    min_ = other.min_;
+  max_ = std::max(max_, other.max_);
+  total_count_ += other.total_count_;
+  sum_ += other.sum_;
+}
+
+void hdr_histogram::reset() noexcept {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  total_count_ = 0;
+  min_ = 0;
+  max_ = 0;
+  sum_ = 0;
+}
+
+int64_t hdr_histogram::value_at_percentile(double p) const noexcept {
+  if (total_count_ == 0)
+    return 0;
+  p = std::clamp(p, 0.0, 100.0);
+  auto target = static_cast<uint64_t>(
+    std::ceil(p / 100.0 * static_cast<double>(total_count_)));
+  target = std::max(target, uint64_t{1});
+  uint64_t running_count = 0;
+  for (size_t index = 0; index < counts_.size(); ++index) {
+    running_count += counts_[index];
+    if (running_count >= target)
+      return std::min(highest_equivalent_value(value_from_index(index)), max_);
+  }
+  return max_;
+}
+
+double hdr_histogram::mean() const noexcept {
+  if (total_count_ == 0)
+    return 0;
+  return sum_ / static_cast<double>(total_count_);
+}
+
+size_t hdr_histogram::index_of(int64_t value) const noexcept {
+  auto x = static_cast<uint64_t>(value | sub_bucket_mask_);
+  auto bucket_index = floor_log2(x) - sub_bucket_half_count_magnitude_;
+  auto sub_bucket_index = value >> bucket_index;
+  auto bucket_base_index = int64_t{bucket_index + 1}
+                           << sub_bucket_half_count_magnitude_;
+  return static_cast<size_t>(bucket_base_index + sub_bucket_index
+                             - sub_bucket_half_count_);
+}
+
+int64_t hdr_histogram::value_from_index(size_t index) const noexcept {
+  auto i = static_cast<int64_t>(index);
+  auto bucket_index = (i >> sub_bucket_half_count_magnitude_) - 1;
+  auto sub_bucket_index = (i & (sub_bucket_half_count_ - 1))
+                          + sub_bucket_half_count_;
+  if (bucket_index < 0) {
+    sub_bucket_index -= sub_bucket_half_count_;
+    bucket_index = 0;
+  }
+  return sub_bucket_index << bucket_index;
+}
+
+int64_t hdr_histogram::highest_equivalent_value(int64_t value) const noexcept {
+  auto x = static_cast<uint64_t>(value | sub_bucket_mask_);
+  auto bucket_index = floor_log2(x) - sub_bucket_half_count_magnitude_;
+  auto lowest_equivalent_value = (value >> bucket_index) << bucket_index;
+  return lowest_equivalent_value + (int64_t{1} << bucket_index) - 1;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Benchmark-only utility for reporting latency percentiles. Not part of the
+// library, since Broker itself exports latencies via Prometheus histograms.
+
+/// Records integer values such as latencies in nanoseconds with a fixed
+/// relative precision, based on the HdrHistogram by Gil Tene. The histogram
+/// uses exponentially growing buckets that each consist of linear
+/// sub-buckets. Hence, memory usage depends only on the range of values and the
+/// number of significant digits, but not on the number of recorded values.
+class hdr_histogram {
+public:
+  /// @param highest_trackable_value The largest value to record. Larger values
+  ///                                count as `highest_trackable_value`.
+  /// @param significant_digits Decimal digits of precision, between 1 and 5.
+  /// @pre `highest_trackable_value >= 2`
+  /// @pre `significant_digits >= 1 && significant_digits <= 5`
+  explicit hdr_histogram(int64_t highest_trackable_value,
+                         int significant_digits = 3);
+
+  /// Adds `count` occurrences of `value`. Negative values count as 0.
+  void record(int64_t value, uint64_t count = 1) noexcept;
+
+  /// Adds all values from `other`.
+  /// @pre `other` uses the same range and precision.
+  void merge(const hdr_histogram& other);
+
+  /// Removes all values.
+  void reset() noexcept;
+
+  /// Returns the value at percentile `p` (0 to 100), i.e., the highest value
+  /// that is equivalent to the recorded values at `p` within the precision of
+  /// the histogram. Returns 0 for an empty histogram.
+  int64_t value_at_percentile(double p) const noexcept;
+
+  /// Returns the number of recorded values.
+  uint64_t total_count() const noexcept {
+    return total_count_;
+  }
+
+  /// Returns the smallest recorded value or 0 for an empty histogram.
+  int64_t min() const noexcept {
+    return total_count_ > 0 ? min_ : 0;
+  }
+
+  /// Returns the largest recorded value or 0 for an empty histogram.
+  int64_t max() const noexcept {
+    return max_;
+  }
+
+  /// Returns the arithmetic mean of all recorded values.
+  double mean() const noexcept;
+
+  /// Returns the largest value that the histogram can record.
+  int64_t highest_trackable_value() const noexcept {
+    return highest_trackable_value_;
+  }
+
+  /// Returns the number of decimal digits of precision.
+  int significant_digits() const noexcept {
+    return significant_digits_;
+  }
+
+private:
+  size_t index_of(int64_t value) const noexcept;
+
+  int64_t value_from_index(size_t index) const noexcept;
+
+  int64_t highest_equivalent_value(int64_t value) const noexcept;
+
+  int64_t highest_trackable_value_;
+
+  int significant_digits_;
+
+  int sub_bucket_half_count_magnitude_;
+
+  int64_t sub_bucket_count_;
+
+  int64_t sub_bucket_half_count_;
+
+  int64_t sub_bucket_mask_;
+
+  uint64_t total_count_ = 0;
+
+  int64_t min_ = 0;
+
+  int64_t max_ = 0;
+
+  double sum_ = 0;
+
+  std::vector<uint64_t> counts_;
+};
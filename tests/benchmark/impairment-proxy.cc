@@ -0,0 +1,343 @@
+#include "impairment-proxy.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <random>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std::literals;
+
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t read_buffer_size = 64 * 1024;
+
+void set_nodelay(int fd) {
+  int flag = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+int connect_to(const std::string& host, uint16_t port) {
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addrs = nullptr;
+  auto port_str = std::to_string(port);
+  if (getaddrinfo(host.c_str(), port_str.c_str(), &hints, &addrs) != 0)
+    return -1;
+  int result = -1;
+  for (auto addr = addrs; addr != nullptr; addr = addr->ai_next) {
+    auto fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd < 0)
+      continue;
+    if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+      result = fd;
+      break;
+    }
+    close(fd);
+  }
+  freeaddrinfo(addrs);
+  if (result >= 0)
+    set_nodelay(result);
+  return result;
+}
+
+bool send_all(int fd, const char* buf, size_t size) {
+  while (size > 0) {
+    auto n = send(fd, buf, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    buf += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+} // namespace
+
+// -- connection ---------------------------------------------------------------
+
+// Forwards data between a client and the target. Each direction uses a reader
+// thread that assigns a release time to each chunk and a writer thread that
+// sends the chunks at their release time.
+class impairment_proxy::connection {
+public:
+  connection(impairment_proxy* parent, int client, int server, uint64_t seed)
+    : parent_(parent), client_(client), server_(server), rng_(seed) {
+    if (auto mean = parent->cfg_.reset_interval; mean.count() > 0) {
+      std::exponential_distribution<double> dist{
+        1.0 / static_cast<double>(mean.count())};
+      reset_at_ = clock_type::now() + broker::timespan{
+                    static_cast<int64_t>(dist(rng_))};
+    }
+    threads_.emplace_back([this] { read_loop(client_, upstream_, 1); });
+    threads_.emplace_back([this] { write_loop(server_, upstream_); });
+    threads_.emplace_back([this] { read_loop(server_, downstream_, 2); });
+    threads_.emplace_back([this] { write_loop(client_, downstream_); });
+    threads_.emplace_back([this] { watchdog(); });
+  }
+
+  ~connection() {
+    close(false);
+    for (auto& thread : threads_)
+      thread.join();
+    ::close(client_);
+    ::close(server_);
+  }
+
+  // Closes both sockets. Sends a TCP RST instead of a FIN if `reset` is true.
+  void close(bool reset) {
+    if (closed_.exchange(true))
+      return;
+    if (reset) {
+      linger opt{1, 0};
+      setsockopt(client_, SOL_SOCKET, SO_LINGER, &opt, sizeof(opt));
+      setsockopt(server_, SOL_SOCKET, SO_LINGER, &opt, sizeof(opt));
+    }
+    shutdown(client_, SHUT_RDWR);
+    shutdown(server_, SHUT_RDWR);
+    for (auto dir : {&upstream_, &downstream_}) {
+      std::unique_lock<std::mutex> guard{dir->mtx};
+      dir->cv.notify_all();
+    }
+    std::unique_lock<std::mutex> guard{watchdog_mtx_};
+    watchdog_cv_.notify_all();
+  }
+
+private:
+  struct chunk {
+    clock_type::time_point release;
+    std::vector<char> bytes; // Empty for signaling EOF.
+  };
+
+  struct direction {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<chunk> queue;
+    size_t buffered = 0;
+    clock_type::time_point last_release;
+  };
+
+  void read_loop(int src, direction& dir, uint64_t seed_offset) {
+    const auto& cfg = parent_->cfg_;
+    std::minstd_rand rng{static_cast<uint32_t>(cfg.seed + seed_offset)};
+    std::uniform_int_distribution<int64_t> jitter{0, cfg.jitter.count()};
+    std::vector<char> buf(read_buffer_size);
+    for (;;) {
+      auto n = recv(src, buf.data(), buf.size(), 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      auto release = clock_type::now() + cfg.delay
+                     + broker::timespan{jitter(rng)};
+      std::unique_lock<std::mutex> guard{dir.mtx};
+      if (n <= 0) {
+        // Forward the EOF after all pending data.
+        dir.queue.push_back(chunk{std::max(release, dir.last_release), {}});
+        dir.cv.notify_all();
+        return;
+      }
+      dir.cv.wait(guard, [&] {
+        return closed_ || dir.buffered < cfg.buffer_size;
+      });
+      if (closed_)
+        return;
+      // Chunks may not overtake each other in a byte stream.
+      release = std::max(release, dir.last_release);
+      dir.last_release = release;
+      dir.buffered += static_cast<size_t>(n);
+      dir.queue.push_back(chunk{release, {buf.begin(), buf.begin() + n}});
+      dir.cv.notify_all();
+    }
+  }
+
+  void write_loop(int dst, direction& dir) {
+    const auto& cfg = parent_->cfg_;
+    // Sends at most 10ms worth of data at once when limiting the bandwidth.
+    auto slice_size = cfg.bandwidth > 0
+                        ? std::max(cfg.bandwidth / 100, uint64_t{1})
+                        : uint64_t{read_buffer_size};
+    auto next_send = clock_type::now();
+    for (;;) {
+      chunk x;
+      {
+        std::unique_lock<std::mutex> guard{dir.mtx};
+        dir.cv.wait(guard, [&] { return closed_ || !dir.queue.empty(); });
+        if (closed_)
+          return;
+        x = std::move(dir.queue.front());
+        dir.queue.pop_front();
+        if (dir.cv.wait_until(guard, x.release, [this] { return !!closed_; }))
+          return;
+      }
+      if (x.bytes.empty()) {
+        shutdown(dst, SHUT_WR);
+        return;
+      }
+      size_t offset = 0;
+      while (offset < x.bytes.size()) {
+        auto n = std::min(x.bytes.size() - offset, size_t{slice_size});
+        if (cfg.bandwidth > 0) {
+          next_send = std::max(next_send, clock_type::now());
+          std::this_thread::sleep_until(next_send);
+          next_send += std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>{
+              static_cast<double>(n) / static_cast<double>(cfg.bandwidth)});
+        }
+        if (!send_all(dst, x.bytes.data() + offset, n)) {
+          close(false);
+          return;
+        }
+        offset += n;
+      }
+      std::unique_lock<std::mutex> guard{dir.mtx};
+      dir.buffered -= x.bytes.size();
+      dir.cv.notify_all();
+    }
+  }
+
+  void watchdog() {
+    std::unique_lock<std::mutex> guard{watchdog_mtx_};
+    if (!reset_at_) {
+      watchdog_cv_.wait(guard, [this] { return !!closed_; });
+      return;
+    }
+    if (!watchdog_cv_.wait_until(guard, *reset_at_,
+                                 [this] { return !!closed_; })) {
+      guard.unlock();
+      ++parent_->resets_;
+      close(true);
+    }
+  }
+
+  impairment_proxy* parent_;
+  int client_;
+  int server_;
+  std::minstd_rand rng_;
+  std::optional<clock_type::time_point> reset_at_;
+  std::atomic<bool> closed_ = false;
+  direction upstream_;
+  direction downstream_;
+  std::mutex watchdog_mtx_;
+  std::condition_variable watchdog_cv_;
+  std::vector<std::thread> threads_;
+};
+
+// -- impairment_proxy ---------------------------------------------------------
+
+impairment_proxy::impairment_proxy(impairment cfg, std::string target_host,
+                                   uint16_t target_port)
+  : cfg_(cfg),
+    target_host_(std::move(target_host)),
+    target_port_(target_port) {
+  // nop
+}
+
+impairment_proxy::~impairment_proxy() {
+  stop();
+}
+
+uint16_t impairment_proxy::start(const std::string& addr, uint16_t port) {
+  if (running_)
+    return 0;
+  sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  if (inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) != 1)
+    return 0;
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0)
+    return 0;
+  int flag = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  socklen_t len = sizeof(sa);
+  if (bind(fd_, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0
+      || listen(fd_, SOMAXCONN) != 0
+      || getsockname(fd_, reinterpret_cast<sockaddr*>(&sa), &len) != 0) {
+    ::close(fd_);
+    fd_ = -1;
+    return 0;
+  }
+  running_ = true;
+  acceptor_ = std::thread{[this] { run(); }};
+  return ntohs(sa.sin_port);
+}
+
+void impairment_proxy::stop() {
+  if (!running_.exchange(false))
+    return;
+  acceptor_.join();
+  ::close(fd_);
+  fd_ = -1;
+  std::unique_lock<std::mutex> guard{mtx_};
+  open_.clear();
+}
+
+void impairment_proxy::run() {
+  pollfd pfd{fd_, POLLIN, 0};
+  while (running_) {
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+    auto client = accept(fd_, nullptr, nullptr);
+    if (client < 0)
+      continue;
+    set_nodelay(client);
+    auto server = connect_to(target_host_, target_port_);
+    if (server < 0) {
+      ::close(client);
+      continue;
+    }
+    auto n = ++connections_;
+    std::unique_lock<std::mutex> guard{mtx_};
+    open_.emplace_back(
+      std::make_unique<connection>(this, client, server, cfg_.seed + n));
+  }
+}
+
+// -- utility ------------------------------------------------------------------
+
+bool parse_duration(const std::string& str, broker::timespan& result) {
+  size_t pos = 0;
+  double value = 0;
+  try {
+    value = std::stod(str, &pos);
+  } catch (...) {
+    return false;
+  }
+  auto unit = str.substr(pos);
+  double factor = 0;
+  if (unit.empty() || unit == "s")
+    factor = 1e9;
+  else if (unit == "ms")
+    factor = 1e6;
+  else if (unit == "us")
+    factor = 1e3;
+  else if (unit == "ns")
+    factor = 1;
+  else if (unit == "min")
+    factor = 60e9;
+  else
+    return false;
+  if (value < 0)
+    return false;
+  result = broker::timespan{static_cast<int64_t>(value * factor)};
+  return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "broker/time.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Configures how an @ref impairment_proxy degrades a link.
+struct impairment {
+  /// Delay for each chunk of data in either direction.
+  broker::timespan delay{0};
+
+  /// Maximum random delay on top of `delay`. Chunks never overtake each other.
+  broker::timespan jitter{0};
+
+  /// Maximum throughput per direction in bytes per second or 0 for no limit.
+  uint64_t bandwidth = 0;
+
+  /// Mean time between resets of a connection or 0 for never resetting
+  /// connections. The actual time between resets is exponentially
+  /// distributed.
+  broker::timespan reset_interval{0};
+
+  /// Maximum number of bytes in flight per direction, similar to the window
+  /// of a TCP connection. The proxy stops reading once reaching this limit.
+  uint64_t buffer_size = 4 * 1024 * 1024;
+
+  /// Seed for the random-number generators.
+  uint64_t seed = 0;
+};
+
+/// A userspace TCP proxy that forwards all connections to a target while
+/// injecting delay, jitter, bandwidth limits, and connection resets. Since
+/// the proxy operates on a byte stream, it cannot drop packets. However,
+/// delay and jitter have a similar effect on the endpoints as retransmits.
+class impairment_proxy {
+public:
+  impairment_proxy(impairment cfg, std::string target_host,
+                   uint16_t target_port);
+
+  impairment_proxy(const impairment_proxy&) = delete;
+
+  impairment_proxy& operator=(const impairment_proxy&) = delete;
+
+  ~impairment_proxy();
+
+  /// Starts accepting connections at `addr` on `port`. Passing 0 for `port`
+  /// picks a random free port.
+  /// @returns the port of the proxy or 0 on error.
+  uint16_t start(const std::string& addr = "127.0.0.1", uint16_t port = 0);
+
+  /// Stops accepting new connections and closes all open connections.
+  void stop();
+
+  /// Returns the number of accepted connections.
+  size_t connections() const noexcept {
+    return connections_;
+  }
+
+  /// Returns the number of connections that the proxy reset.
+  size_t resets() const noexcept {
+    return resets_;
+  }
+
+private:
+  class connection;
+
+  void run();
+
+  impairment cfg_;
+
+  std::string target_host_;
+
+  uint16_t target_port_;
+
+  int fd_ = -1;
+
+  std::atomic<bool> running_ = false;
+
+  std::atomic<size_t> connections_ = 0;
+
+  std::atomic<size_t> resets_ = 0;
+
+  std::thread acceptor_;
+
+  std::mutex mtx_;
+
+  std::vector<std::unique_ptr<connection>> open_;
+};
+
+/// Parses a duration such as "20ms" or "1.5s". Plain numbers are seconds.
+/// @returns `false` if `str` is not a valid duration.
+bool parse_duration(const std::string& str, broker::timespan& result);
@@ -0,0 +1,277 @@
+#!/usr/bin/env python3
+"""
+Runs a suite of Broker benchmarks and stores the results as JSON.
+
+The suite file (see suite.json) lists the benchmarks. Each benchmark has:
+
+- name: unique name of the benchmark
+- command: the program and its arguments
+- server: optional program that runs in the background during the benchmark
+- format: how to parse the output: none (default), key-value, or
+          google-benchmark
+- group-by: for key-value output, a key that starts a new group of metrics
+- messages: optional number of messages for computing the throughput
+- better: maps metric patterns (fnmatch syntax) to "higher" or "lower"
+- timeout: maximum runtime of a single repetition in seconds
+
+Arguments may contain the placeholder {port}, which the runner replaces with a
+free local port. Besides the metrics from the output, the runner records the
+wall time, the CPU time, and the peak RSS of the benchmark process as
+process.wall-time, process.cpu-time, and process.max-rss.
+
+Usage:
+
+    run-suite.py --bindir=build/bin --output=results.json [suite.json]
+"""
+
+import argparse
+import datetime
+import fnmatch
+import json
+import os
+import platform
+import re
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+# Metrics that the runner records for every benchmark.
+builtin_metrics = {
+    'process.wall-time': 'lower',
+    'process.cpu-time': 'lower',
+    'process.max-rss': 'lower',
+    'process.messages-per-second': 'higher',
+}
+
+# Matches a number with an optional unit suffix such as "ms" or "us".
+number_rx = re.compile(
+    r'^(-?[0-9]+(?:\.[0-9]+)?(?:[eE][-+]?[0-9]+)?)([a-zA-Z%]*)$')
+
+
+def parse_number(text):
+    match = number_rx.match(text.strip())
+    if not match:
+        return None
+    return float(match.group(1))
+
+
+def parse_key_value(output, group_by=None):
+    """
+    Parses lines in the format "key: value" or "key: k1=v1 k2=v2 ...". The
+    latter produces the metrics "key.k1", "key.k2", and so on. If `group_by`
+    is set, the value of that key becomes a prefix for all following keys.
+    """
+    result = {}
+    prefix = ''
+    for line in output.splitlines():
+        key, sep, value = line.partition(': ')
+        if not sep:
+            continue
+        key = key.strip()
+        if key == group_by:
+            prefix = '{}={}/'.format(key, value.strip())
+            continue
+        number = parse_number(value)
+        if number is not None:
+            result[prefix + key] = number
+            continue
+        for token in value.split():
+            field, sep, field_value = token.partition('=')
+            if sep and parse_number(field_value) is not None:
+                result['{}{}.{}'.format(prefix, key, field)] = \
+                    parse_number(field_value)
+    return result
+
+
+# Numeric fields in the output of Google Benchmark that are not metrics.
+google_benchmark_meta_fields = {
+    'family_index', 'per_family_instance_index', 'repetitions',
+    'repetition_index', 'threads', 'iterations',
+}
+
+
+def parse_google_benchmark(output):
+    """
+    Parses the JSON output of Google Benchmark and returns the time and the
+    counters of each benchmark. Times are in nanoseconds.
+    """
+    scale = {'ns': 1, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+    result = {}
+    for entry in json.loads(output).get('benchmarks', []):
+        if entry.get('run_type') == 'aggregate' \
+                or entry.get('error_occurred'):
+            continue
+        name = entry['name']
+        factor = scale.get(entry.get('time_unit', 'ns'), 1)
+        for field, value in entry.items():
+            if field in google_benchmark_meta_fields \
+                    or isinstance(value, bool) \
+                    or not isinstance(value, (int, float)):
+                continue
+            if field in ('real_time', 'cpu_time'):
+                value *= factor
+            result['{}.{}'.format(name, field)] = value
+    return result
+
+
+def free_port():
+    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as sock:
+        sock.bind(('127.0.0.1', 0))
+        return sock.getsockname()[1]
+
+
+def resolve(args, bindir, port):
+    result = [arg.replace('{port}', str(port)) for arg in args]
+    if bindir:
+        path = os.path.join(bindir, result[0])
+        if os.path.isfile(path):
+            result[0] = path
+    if shutil.which(result[0]) is None:
+        raise FileNotFoundError('no such program: ' + result[0])
+    return result
+
+
+def run_once(bench, bindir):
+    """
+    Runs a benchmark once and returns its metrics.
+    """
+    port = free_port()
+    server = None
+    if 'server' in bench:
+        server = subprocess.Popen(resolve(bench['server'], bindir, port),
+                                  stdout=subprocess.DEVNULL,
+                                  stderr=subprocess.DEVNULL)
+        # Give the server some time to open its port.
+        time.sleep(1)
+    args = resolve(bench['command'], bindir, port)
+    fmt = bench.get('format', 'none')
+    if fmt == 'google-benchmark':
+        args.append('--benchmark_format=json')
+    try:
+        with tempfile.TemporaryFile(mode='w+') as out:
+            start = time.monotonic()
+            proc = subprocess.Popen(args, stdout=out,
+                                    stderr=subprocess.DEVNULL)
+            # Use wait4 instead of proc.wait to get the resource usage of the
+            # benchmark process.
+            deadline = start + bench.get('timeout', 600)
+            while True:
+                pid, status, usage = os.wait4(proc.pid, os.WNOHANG)
+                if pid != 0:
+                    break
+                if time.monotonic() > deadline:
+                    proc.kill()
+                    os.wait4(proc.pid, 0)
+                    raise TimeoutError('{} timed out'.format(bench['name']))
+                time.sleep(0.01)
+            wall_time = time.monotonic() - start
+            proc.returncode = os.waitstatus_to_exitcode(status)
+            if proc.returncode != 0:
+                raise RuntimeError('{} failed with exit code {}'.format(
+                    bench['name'], proc.returncode))
+            out.seek(0)
+            output = out.read()
+    finally:
+        if server:
+            server.terminate()
+            server.wait()
+    if fmt == 'key-value':
+        metrics = parse_key_value(output, bench.get('group-by'))
+    elif fmt == 'google-benchmark':
+        metrics = parse_google_benchmark(output)
+    else:
+        metrics = {}
+    metrics['process.wall-time'] = wall_time
+    metrics['process.cpu-time'] = usage.ru_utime + usage.ru_stime
+    # Linux reports ru_maxrss in kilobytes, macOS in bytes.
+    rss_factor = 1 if sys.platform == 'darwin' else 1024
+    metrics['process.max-rss'] = usage.ru_maxrss * rss_factor
+    if 'messages' in bench:
+        metrics['process.messages-per-second'] = bench['messages'] / wall_time
+    return metrics
+
+
+def direction_of(bench, metric):
+    for pattern, better in bench.get('better', {}).items():
+        if fnmatch.fnmatchcase(metric, pattern):
+            return better
+    return builtin_metrics.get(metric)
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(['git', 'rev-parse', 'HEAD'],
+                                       stderr=subprocess.DEVNULL,
+                                       text=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    default_suite = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                 'suite.json')
+    parser = argparse.ArgumentParser(description='Runs Broker benchmarks.')
+    parser.add_argument('suite', nargs='?', default=default_suite,
+                        help='suite definition (default: suite.json)')
+    parser.add_argument('--bindir', default='',
+                        help='directory with the benchmark programs')
+    parser.add_argument('--output', '-o', default='-',
+                        help='output file for the JSON results')
+    parser.add_argument('--repetitions', '-r', type=int,
+                        help='overrides the repetitions in the suite')
+    parser.add_argument('--filter', '-f', default='*',
+                        help='only run benchmarks matching this pattern')
+    args = parser.parse_args()
+    with open(args.suite) as f:
+        suite = json.load(f)
+    repetitions = args.repetitions or suite.get('repetitions', 5)
+    result = {
+        'version': 1,
+        'date': datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        'revision': git_revision(),
+        'host': {
+            'system': platform.system(),
+            'machine': platform.machine(),
+            'node': platform.node(),
+            'cpus': os.cpu_count(),
+        },
+        'repetitions': repetitions,
+        'benchmarks': {},
+    }
+    failed = False
+    for bench in suite['benchmarks']:
+        name = bench['name']
+        if not fnmatch.fnmatchcase(name, args.filter):
+            continue
+        samples = {}
+        try:
+            for i in range(repetitions):
+                print('{} ({}/{})'.format(name, i + 1, repetitions),
+                      file=sys.stderr)
+                for key, value in run_once(bench, args.bindir).items():
+                    samples.setdefault(key, []).append(value)
+        except (OSError, RuntimeError, TimeoutError, ValueError) as ex:
+            print('*** {}'.format(ex), file=sys.stderr)
+            failed = True
+            continue
+        result['benchmarks'][name] = {
+            'command': bench['command'],
+            'metrics': {
+                key: {'better': direction_of(bench, key), 'samples': values}
+                for key, values in sorted(samples.items())
+            },
+        }
+    if args.output == '-':
+        json.dump(result, sys.stdout, indent=2)
+        print()
+    else:
+        with open(args.output, 'w') as f:
+            json.dump(result, f, indent=2)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,344 @@
+#include "web-socket-client.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t read_buffer_size = 64 * 1024;
+
+constexpr uint8_t continuation_frame = 0x0;
+constexpr uint8_t text_frame = 0x1;
+constexpr uint8_t binary_frame = 0x2;
+constexpr uint8_t close_frame = 0x8;
+constexpr uint8_t ping_frame = 0x9;
+constexpr uint8_t pong_frame = 0xA;
+
+// The sample nonce from RFC 6455. The key only needs to be unique for
+// defeating caching proxies, which do not exist in our setup.
+constexpr std::string_view handshake_key = "dGhlIHNhbXBsZSBub25jZQ==";
+
+std::string ssl_error_string() {
+  char buf[256];
+  ERR_error_string_n(ERR_get_error(), buf, sizeof(buf));
+  return buf;
+}
+
+} // namespace
+
+web_socket_client::~web_socket_client() {
+  close();
+}
+
+bool web_socket_client::fail(std::string what) {
+  last_error_ = std::move(what);
+  if (ssl_ != nullptr) {
+    SSL_free(ssl_);
+    ssl_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  return false;
+}
+
+bool web_socket_client::connect(const std::string& host, uint16_t port,
+                                const std::string& path, SSL_CTX* ctx) {
+  // Open the TCP connection.
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addrs = nullptr;
+  auto port_str = std::to_string(port);
+  if (getaddrinfo(host.c_str(), port_str.c_str(), &hints, &addrs) != 0)
+    return fail("unable to resolve " + host);
+  for (auto addr = addrs; addr != nullptr; addr = addr->ai_next) {
+    fd_ = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd_ < 0)
+      continue;
+    if (::connect(fd_, addr->ai_addr, addr->ai_addrlen) == 0)
+      break;
+    ::close(fd_);
+    fd_ = -1;
+  }
+  freeaddrinfo(addrs);
+  if (fd_ < 0)
+    return fail("unable to connect to " + host + ":" + port_str);
+  int flag = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  // Run the TLS handshake.
+  if (ctx != nullptr) {
+    ssl_ = SSL_new(ctx);
+    if (ssl_ == nullptr || SSL_set_fd(ssl_, fd_) != 1
+        || SSL_connect(ssl_) != 1)
+      return fail("TLS handshake failed: " + ssl_error_string());
+  }
+  // Run the WebSocket handshake.
+  std::string req;
+  req += "GET ";
+  req += path;
+  req += " HTTP/1.1\r\nHost: ";
+  req += host;
+  req += ':';
+  req += port_str;
+  req += "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n";
+  req += "Sec-WebSocket-Version: 13\r\nSec-WebSocket-Key: ";
+  req += handshake_key;
+  req += "\r\n\r\n";
+  if (!write_all(req.data(), req.size()))
+    return fail("unable to send the WebSocket handshake");
+  constexpr std::string_view eoh = "\r\n\r\n";
+  for (;;) {
+    auto i = std::search(buf_.begin(), buf_.end(), eoh.begin(), eoh.end());
+    if (i != buf_.end()) {
+      std::string_view status{buf_.data(),
+                              static_cast<size_t>(i - buf_.begin())};
+      status = status.substr(0, status.find("\r\n"));
+      if (status.compare(0, 12, "HTTP/1.1 101") != 0)
+        return fail("WebSocket handshake failed: " + std::string{status});
+      pos_ = static_cast<size_t>(i - buf_.begin()) + eoh.size();
+      return true;
+    }
+    if (fill(std::chrono::seconds{5}) <= 0)
+      return fail("no response to the WebSocket handshake");
+  }
+}
+
+bool web_socket_client::send_text(std::string_view payload) {
+  return send_frame(text_frame, payload);
+}
+
+web_socket_client::read_result
+web_socket_client::read(std::string& payload,
+                        std::chrono::milliseconds timeout) {
+  auto deadline = clock_type::now() + timeout;
+  for (;;) {
+    // Try to parse the next frame from the buffer.
+    auto bytes = reinterpret_cast<const uint8_t*>(buf_.data() + pos_);
+    auto size = buf_.size() - pos_;
+    if (size >= 2) {
+      auto fin = (bytes[0] & 0x80) != 0;
+      auto opcode = static_cast<uint8_t>(bytes[0] & 0x0F);
+      auto masked = (bytes[1] & 0x80) != 0;
+      uint64_t len = bytes[1] & 0x7F;
+      size_t hdr_size = 2;
+      if (len == 126) {
+        hdr_size = 4;
+        if (size >= hdr_size)
+          len = (uint64_t{bytes[2]} << 8) | bytes[3];
+      } else if (len == 127) {
+        hdr_size = 10;
+        if (size >= hdr_size) {
+          len = 0;
+          for (size_t i = 2; i < 10; ++i)
+            len = (len << 8) | bytes[i];
+        }
+      }
+      if (masked)
+        hdr_size += 4;
+      if (size >= hdr_size && size - hdr_size >= len) {
+        auto first = buf_.data() + pos_ + hdr_size;
+        std::string data{first, first + len};
+        if (masked) {
+          auto key = bytes + hdr_size - 4;
+          for (size_t i = 0; i < data.size(); ++i)
+            data[i] ^= static_cast<char>(key[i % 4]);
+        }
+        pos_ += hdr_size + len;
+        switch (opcode) {
+          case continuation_frame:
+            fragments_ += data;
+            if (fin) {
+              payload = std::move(fragments_);
+              fragments_.clear();
+              return read_result::message;
+            }
+            break;
+          case text_frame:
+          case binary_frame:
+            if (fin) {
+              payload = std::move(data);
+              return read_result::message;
+            }
+            fragments_ = std::move(data);
+            break;
+          case close_frame:
+            close();
+            return read_result::closed;
+          case ping_frame:
+            if (!send_frame(pong_frame, data))
+              return read_result::closed;
+            break;
+          default:
+            // Ignore pongs and unknown control frames.
+            break;
+        }
+        continue;
+      }
+    }
+    // Wait for more data.
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - clock_type::now());
+    switch (fill(std::max(remaining, std::chrono::milliseconds{0}))) {
+      case 0:
+        return read_result::timeout;
+      case -1:
+        return read_result::closed;
+      default:
+        break;
+    }
+  }
+}
+
+void web_socket_client::close() {
+  if (fd_ < 0)
+    return;
+  // Status code 1000: normal closure.
+  send_frame(close_frame, std::string_view{"\x03\xE8", 2});
+  if (ssl_ != nullptr) {
+    SSL_shutdown(ssl_);
+    SSL_free(ssl_);
+    ssl_ = nullptr;
+  }
+  ::close(fd_);
+  fd_ = -1;
+}
+
+bool web_socket_client::write_all(const char* buf, size_t size) {
+  while (size > 0) {
+    ssize_t n;
+    if (ssl_ != nullptr)
+      n = SSL_write(ssl_, buf, static_cast<int>(size));
+    else
+      n = send(fd_, buf, size, MSG_NOSIGNAL);
+    if (n <= 0) {
+      if (ssl_ == nullptr && n < 0 && errno == EINTR)
+        continue;
+      return false;
+    }
+    buf += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+int web_socket_client::fill(std::chrono::milliseconds timeout) {
+  if (fd_ < 0)
+    return -1;
+  // OpenSSL may have buffered decrypted data that poll cannot see.
+  if (ssl_ == nullptr || SSL_pending(ssl_) == 0) {
+    pollfd pfd{fd_, POLLIN, 0};
+    auto res = poll(&pfd, 1, static_cast<int>(timeout.count()));
+    if (res == 0 || (res < 0 && errno == EINTR))
+      return 0;
+    if (res < 0)
+      return -1;
+  }
+  // Drop processed bytes before reading more.
+  if (pos_ > 0) {
+    buf_.erase(buf_.begin(), buf_.begin() + pos_);
+    pos_ = 0;
+  }
+  auto offset = buf_.size();
+  buf_.resize(offset + read_buffer_size);
+  ssize_t n;
+  if (ssl_ != nullptr)
+    n = SSL_read(ssl_, buf_.data() + offset, read_buffer_size);
+  else
+    n = recv(fd_, buf_.data() + offset, read_buffer_size, 0);
+  buf_.resize(offset + static_cast<size_t>(std::max(n, ssize_t{0})));
+  return n > 0 ? 1 : -1;
+}
+
+bool web_socket_client::send_frame(uint8_t opcode, std::string_view payload) {
+  if (fd_ < 0)
+    return false;
+  frame_.clear();
+  frame_.push_back(static_cast<char>(0x80 | opcode));
+  // Clients must set the mask bit.
+  auto len = payload.size();
+  if (len < 126) {
+    frame_.push_back(static_cast<char>(0x80 | len));
+  } else if (len <= 0xFFFF) {
+    frame_.push_back(static_cast<char>(0x80 | 126));
+    frame_.push_back(static_cast<char>(len >> 8));
+    frame_.push_back(static_cast<char>(len));
+  } else {
+    frame_.push_back(static_cast<char>(0x80 | 127));
+    for (int shift = 56; shift >= 0; shift -= 8)
+      frame_.push_back(static_cast<char>(uint64_t{len} >> shift));
+  }
+  // Masking only needs to be unpredictable for browsers, so a simple xorshift
+  // generator suffices.
+  mask_seed_ ^= mask_seed_ << 13;
+  mask_seed_ ^= mask_seed_ >> 17;
+  mask_seed_ ^= mask_seed_ << 5;
+  char key[4];
+  memcpy(key, &mask_seed_, 4);
+  frame_.insert(frame_.end(), key, key + 4);
+  auto offset = frame_.size();
+  frame_.insert(frame_.end(), payload.begin(), payload.end());
+  for (size_t i = 0; i < len; ++i)
+    frame_[offset + i] ^= key[i % 4];
+  return write_all(frame_.data(), frame_.size());
+}
+
+SSL_CTX* make_client_ssl_context(const std::string& certificate,
+                                 const std::string& key,
+                                 const std::string& passphrase,
+                                 const std::string& cafile) {
+  auto ctx = SSL_CTX_new(TLS_client_method());
+  if (ctx == nullptr)
+    return nullptr;
+  auto fail = [ctx] {
+    SSL_CTX_free(ctx);
+    return nullptr;
+  };
+  if (certificate.empty()) {
+    // Anonymous ciphers do not exist in TLS 1.3.
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    if (SSL_CTX_set_cipher_list(ctx, "AECDH-AES256-SHA@SECLEVEL=0") != 1)
+      return fail();
+    return ctx;
+  }
+  auto pem_passwd_cb = [](char* buf, int size, int, void* ptr) -> int {
+    auto str = static_cast<const std::string*>(ptr);
+    auto n = std::min(str->size(), static_cast<size_t>(size - 1));
+    memcpy(buf, str->data(), n);
+    buf[n] = '\0';
+    return static_cast<int>(n);
+  };
+  SSL_CTX_set_default_passwd_cb(ctx, pem_passwd_cb);
+  SSL_CTX_set_default_passwd_cb_userdata(ctx, const_cast<std::string*>(
+                                                &passphrase));
+  auto key_file = key.empty() ? certificate : key;
+  auto ok = SSL_CTX_use_certificate_chain_file(ctx, certificate.c_str()) == 1
+            && SSL_CTX_use_PrivateKey_file(ctx, key_file.c_str(),
+                                           SSL_FILETYPE_PEM)
+                 == 1;
+  // The passphrase only needs to be valid while loading the key.
+  SSL_CTX_set_default_passwd_cb_userdata(ctx, nullptr);
+  if (!ok)
+    return fail();
+  if (!cafile.empty()) {
+    if (SSL_CTX_load_verify_locations(ctx, cafile.c_str(), nullptr) != 1)
+      return fail();
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+  }
+  return ctx;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <openssl/ssl.h>
+
+/// A minimal, blocking WebSocket client for generating load on Broker's
+/// WebSocket API. Supports text frames over plain TCP or TLS. Each instance
+/// must be used by only one thread at a time.
+class web_socket_client {
+public:
+  /// Outcome of @ref read.
+  enum class read_result {
+    /// Received a complete text or binary message.
+    message,
+    /// Received no message before the timeout.
+    timeout,
+    /// The server closed the connection or an error occurred.
+    closed,
+  };
+
+  web_socket_client() = default;
+
+  web_socket_client(const web_socket_client&) = delete;
+
+  web_socket_client& operator=(const web_socket_client&) = delete;
+
+  ~web_socket_client();
+
+  /// Connects to `host` on `port` and performs the WebSocket handshake for
+  /// `path`. Uses TLS if `ctx` is not `nullptr`.
+  /// @returns `true` on success, `false` otherwise. Stores a description of
+  ///          the error in @ref last_error on failure.
+  bool connect(const std::string& host, uint16_t port, const std::string& path,
+               SSL_CTX* ctx = nullptr);
+
+  /// Sends `payload` as a single text frame.
+  bool send_text(std::string_view payload);
+
+  /// Waits up to `timeout` for the next message and stores its payload in
+  /// `payload`. Answers pings from the server transparently.
+  read_result read(std::string& payload, std::chrono::milliseconds timeout);
+
+  /// Sends a close frame and closes the connection.
+  void close();
+
+  /// Returns a description of the last error.
+  const std::string& last_error() const noexcept {
+    return last_error_;
+  }
+
+private:
+  bool fail(std::string what);
+
+  // Writes all of `buf` to the socket.
+  bool write_all(const char* buf, size_t size);
+
+  // Reads at least one byte into `buf_`. Returns 0 on timeout, -1 on error.
+  int fill(std::chrono::milliseconds timeout);
+
+  bool send_frame(uint8_t opcode, std::string_view payload);
+
+  int fd_ = -1;
+
+  SSL* ssl_ = nullptr;
+
+  uint32_t mask_seed_ = 0x9e3779b9;
+
+  // Received bytes. Bytes before `pos_` have been processed already.
+  std::vector<char> buf_;
+
+  size_t pos_ = 0;
+
+  // Payload of a fragmented message.
+  std::string fragments_;
+
+  // Serialized frame for sending.
+  std::vector<char> frame_;
+
+  std::string last_error_;
+};
+
+/// Creates an SSL context for @ref web_socket_client that matches Broker's
+/// server configuration: without a certificate, the client uses the same
+/// anonymous cipher as Broker. Otherwise, the client authenticates with
+/// `certificate` and verifies the server against `cafile`.
+/// @returns the new context or `nullptr` on error.
+SSL_CTX* make_client_ssl_context(const std::string& certificate,
+                                 const std::string& key,
+                                 const std::string& passphrase,
+                                 const std::string& cafile);
@@ -0,0 +1,126 @@
+# @TEST-GROUP: web-socket
+#
+# @TEST-PORT: BROKER_WEB_SOCKET_PORT
+#
+# @TEST-EXEC: btest-bg-run node "broker-node --config-file=../node.cfg"
+# @TEST-EXEC: btest-bg-run recv "python3 ../recv.py >recv.out"
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/ready 15 || (btest-bg-wait -k 1 && false)
+#
+# @TEST-EXEC: btest-bg-run send "python3 ../send.py"
+#
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/done 30 || (btest-bg-wait -k 1 && false)
+# @TEST-EXEC: btest-diff recv/recv.out
+#
+# @TEST-EXEC: btest-bg-wait -k 1
+
+# Checks that the server flushes batches when reaching the maximum count, the
+# maximum size, or the linger timeout and that it clamps client-provided
+# limits. With a linger timeout of 1 billion milliseconds, the last client would
+# never receive its batch without clamping.
+
+@TEST-START-FILE node.cfg
+
+broker {
+  disable-ssl = true
+}
+topics = ["/test"]
+verbose = true
+
+@TEST-END-FILE
+
+@TEST-START-FILE recv.py
+
+import asyncio, websockets, os, time, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+ws_url = f'ws://localhost:{ws_port}/v1/messages/json'
+
+async def subscribe(batching):
+    ws = await websockets.connect(ws_url)
+    await ws.send(json.dumps({'subscriptions': ['/test'],
+                              'batching': batching}))
+    ack = json.loads(await ws.recv())
+    if not 'type' in ack or ack['type'] != 'ack':
+        print('*** unexpected ACK from server:')
+        print(ack)
+        sys.exit()
+    return ws
+
+async def dump(name, ws, num_messages):
+    while num_messages > 0:
+        frame = await asyncio.wait_for(ws.recv(), 10)
+        if name.startswith('ndjson'):
+            if not frame.endswith('\n'):
+                print(f'*** missing newline at the end of: {frame}')
+            msgs = [json.loads(line) for line in frame.splitlines()]
+        else:
+            msgs = json.loads(frame)
+        print(f'{name}: {[msg["data"] for msg in msgs]}')
+        num_messages -= len(msgs)
+
+async def do_run():
+    # Try up to 30 times.
+    connected  = False
+    for i in range(30):
+        try:
+            by_count = await subscribe({'format': 'array', 'max-count': 3,
+                                        'max-linger-ms': 500})
+            connected  = True
+            by_size = await subscribe({'format': 'ndjson', 'max-bytes': 100,
+                                       'max-linger-ms': 500})
+            clamped = await subscribe({'max-count': 1000000000,
+                                       'max-linger-ms': 1000000000})
+            # tell btest to start the sender now
+            with open('ready', 'w') as f:
+                f.write('ready')
+            # dump batches to stdout (redirected to recv.out)
+            await dump('array', by_count, 7)
+            await dump('ndjson', by_size, 7)
+            await dump('clamped', clamped, 7)
+            # tell btest we're done
+            with open('done', 'w') as f:
+                f.write('done')
+            for ws in [by_count, by_size, clamped]:
+                await ws.close()
+            sys.exit()
+        except:
+            if not connected:
+                print(f'failed to connect to {ws_url}, try again', file=sys.stderr)
+                time.sleep(1)
+            else:
+                sys.exit()
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
+
+@TEST-START-FILE send.py
+
+import asyncio, websockets, os, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+ws_url = f'ws://localhost:{ws_port}/v1/messages/json'
+
+msg = {
+    'type': 'data-message',
+    'topic': '/test',
+    '@data-type': "count",
+    "data": 0
+}
+
+async def do_run():
+    async with websockets.connect(ws_url) as ws:
+      await ws.send('[]')
+      await ws.recv() # wait for ACK
+      for i in range(7):
+          msg['data'] += 1
+          await ws.send(json.dumps(msg))
+      await ws.close()
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
@@ -0,0 +1,111 @@
+# @TEST-GROUP: web-socket
+#
+# @TEST-PORT: BROKER_WEB_SOCKET_PORT
+#
+# @TEST-EXEC: btest-bg-run node "broker-node --config-file=../node.cfg"
+# @TEST-EXEC: btest-bg-run recv "python3 ../recv.py >recv.out"
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/ready 15 || (btest-bg-wait -k 1 && false)
+#
+# @TEST-EXEC: btest-bg-run send "python3 ../send.py"
+#
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/done 30 || (btest-bg-wait -k 1 && false)
+# @TEST-EXEC: btest-diff recv/recv.out
+#
+# @TEST-EXEC: btest-bg-wait -k 1
+
+# Checks that clients with different filters receive the right messages when
+# the server decodes and renders each message only once for all clients.
+
+@TEST-START-FILE node.cfg
+
+broker {
+  disable-ssl = true
+}
+topics = ["/test"]
+verbose = true
+
+@TEST-END-FILE
+
+@TEST-START-FILE recv.py
+
+import asyncio, websockets, os, time, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+ws_url = f'ws://localhost:{ws_port}/v1/messages/json'
+
+async def subscribe(filter):
+    ws = await websockets.connect(ws_url)
+    await ws.send(json.dumps(filter))
+    ack = json.loads(await ws.recv())
+    if not 'type' in ack or ack['type'] != 'ack':
+        print('*** unexpected ACK from server:')
+        print(ack)
+        sys.exit()
+    return ws
+
+async def dump(name, ws, num):
+    for i in range(num):
+        msg = json.loads(await ws.recv())
+        print(f'{name}: {msg["topic"]} -> {msg["data"]}')
+
+async def do_run():
+    # Try up to 30 times.
+    connected  = False
+    for i in range(30):
+        try:
+            all = await subscribe(['/test'])
+            connected  = True
+            only_a = await subscribe(['/test/a'])
+            also_a = await subscribe(['/test/a'])
+            # tell btest to start the sender now
+            with open('ready', 'w') as f:
+                f.write('ready')
+            # dump messages to stdout (redirected to recv.out)
+            await dump('all', all, 6)
+            await dump('only-a', only_a, 3)
+            await dump('also-a', also_a, 3)
+            # tell btest we're done
+            with open('done', 'w') as f:
+                f.write('done')
+            for ws in [all, only_a, also_a]:
+                await ws.close()
+            sys.exit()
+        except:
+            if not connected:
+                print(f'failed to connect to {ws_url}, try again', file=sys.stderr)
+                time.sleep(1)
+            else:
+                sys.exit()
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
+
+@TEST-START-FILE send.py
+
+import asyncio, websockets, os, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+ws_url = f'ws://localhost:{ws_port}/v1/messages/json'
+
+async def do_run():
+    async with websockets.connect(ws_url) as ws:
+      await ws.send('[]')
+      await ws.recv() # wait for ACK
+      for i in range(1, 7):
+          msg = {
+              'type': 'data-message',
+              'topic': '/test/a' if i % 2 == 1 else '/test/b',
+              '@data-type': "count",
+              "data": i
+          }
+          await ws.send(json.dumps(msg))
+      await ws.close()
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
@@ -0,0 +1,142 @@
+# @TEST-GROUP: web-socket
+#
+# @TEST-PORT: BROKER_WEB_SOCKET_PORT
+#
+# @TEST-EXEC: btest-bg-run node "broker-node --config-file=../node.cfg"
+# @TEST-EXEC: btest-bg-run recv "python3 ../recv.py >recv.out"
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/ready 15 || (btest-bg-wait -k 1 && false)
+#
+# @TEST-EXEC: btest-bg-run send "python3 ../send.py"
+#
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/done 30 || (btest-bg-wait -k 1 && false)
+# @TEST-EXEC: btest-diff recv/recv.out
+#
+# @TEST-EXEC: btest-bg-wait -k 1
+
+# Checks that the server applies the projection with the longest matching
+# prefix, sends nil for paths that do not exist, and rejects handshakes that
+# exceed the limits for projections.
+
+@TEST-START-FILE node.cfg
+
+broker {
+  disable-ssl = true
+}
+topics = ["/test"]
+verbose = true
+
+@TEST-END-FILE
+
+@TEST-START-FILE recv.py
+
+import asyncio, websockets, os, time, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+ws_url = f'ws://localhost:{ws_port}/v1/messages/json'
+
+# Converts Broker's JSON representation to plain Python values.
+def simplify(x):
+    if x['@data-type'] == 'none':
+        return None
+    if x['@data-type'] == 'vector':
+        return [simplify(y) for y in x['data']]
+    return x['data']
+
+async def handshake(projections):
+    ws = await websockets.connect(ws_url)
+    await ws.send(json.dumps({'subscriptions': ['/test'],
+                              'projections': projections}))
+    return ws
+
+async def expect_rejected(name, projections):
+    ws = await handshake(projections)
+    try:
+        msg = json.loads(await asyncio.wait_for(ws.recv(), 10))
+        if msg['type'] == 'error':
+            print(f'{name}: rejected')
+        else:
+            print(f'{name}: *** accepted')
+    except websockets.exceptions.ConnectionClosed:
+        print(f'{name}: rejected')
+
+async def do_run():
+    # Try up to 30 times.
+    connected  = False
+    for i in range(30):
+        try:
+            ws = await handshake([{'topic': '/test', 'fields': [[0]]},
+                                  {'topic': '/test/a',
+                                   'fields': [[1], [1, 0], [5]]}])
+            connected  = True
+            ack = json.loads(await ws.recv())
+            if not 'type' in ack or ack['type'] != 'ack':
+                print('*** unexpected ACK from server:')
+                print(ack)
+                sys.exit()
+            # tell btest to start the sender now
+            with open('ready', 'w') as f:
+                f.write('ready')
+            # dump messages to stdout (redirected to recv.out)
+            for i in range(3):
+                msg = json.loads(await ws.recv())
+                print(f'{msg["topic"]}: {simplify(msg)}')
+            await ws.close()
+            # check the limits
+            await expect_rejected('too many projections',
+                                  [{'topic': '/test', 'fields': [[0]]}] * 65)
+            await expect_rejected('too many fields',
+                                  [{'topic': '/test', 'fields': [[0]] * 65}])
+            await expect_rejected('path too deep',
+                                  [{'topic': '/test', 'fields': [[0] * 33]}])
+            # tell btest we're done
+            with open('done', 'w') as f:
+                f.write('done')
+            sys.exit()
+        except:
+            if not connected:
+                print(f'failed to connect to {ws_url}, try again', file=sys.stderr)
+                time.sleep(1)
+            else:
+                sys.exit()
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
+
+@TEST-START-FILE send.py
+
+import asyncio, websockets, os, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+ws_url = f'ws://localhost:{ws_port}/v1/messages/json'
+
+def count(x):
+    return {'@data-type': 'count', 'data': x}
+
+def vector(*xs):
+    return {'@data-type': 'vector', 'data': list(xs)}
+
+def string(x):
+    return {'@data-type': 'string', 'data': x}
+
+def message(topic, x):
+    return json.dumps({'type': 'data-message', 'topic': topic, **x})
+
+async def do_run():
+    async with websockets.connect(ws_url) as ws:
+      await ws.send('[]')
+      await ws.recv() # wait for ACK
+      await ws.send(message('/test/a/x', vector(count(1),
+                                                vector(count(2), count(3)),
+                                                string('x'))))
+      await ws.send(message('/test/b', vector(count(10), count(20))))
+      await ws.send(message('/test/c', count(7)))
+      await ws.close()
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
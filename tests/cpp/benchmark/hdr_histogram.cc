@@ -0,0 +1,68 @@
+#define SUITE benchmark.hdr_histogram
+
+#include "hdr-histogram.hh"
+
+#include "test.hh"
+
+#include <cstdint>
+
+TEST(an empty histogram returns 0 for all statistics) {
+  hdr_histogram uut{1'000'000};
+  CHECK_EQUAL(uut.total_count(), 0u);
+  CHECK_EQUAL(uut.min(), 0);
+  CHECK_EQUAL(uut.max(), 0);
+  CHECK_EQUAL(uut.value_at_percentile(50), 0);
+}
+
+TEST(small values have exact percentiles) {
+  hdr_histogram uut{1'000'000};
+  for (int64_t i = 1; i <= 100; ++i)
+    uut.record(i);
+  CHECK_EQUAL(uut.total_count(), 100u);
+  CHECK_EQUAL(uut.min(), 1);
+  CHECK_EQUAL(uut.max(), 100);
+  CHECK_EQUAL(uut.value_at_percentile(50), 50);
+  CHECK_EQUAL(uut.value_at_percentile(99), 99);
+  CHECK_EQUAL(uut.value_at_percentile(100), 100);
+  CHECK_EQUAL(uut.mean(), 50.5);
+}
+
+TEST(large values have a bounded relative error) {
+  hdr_histogram uut{3'600'000'000'000, 3};
+  for (int64_t i = 1; i <= 100'000; ++i)
+    uut.record(i * 1000);
+  auto within = [](int64_t value, int64_t expected) {
+    auto delta = value > expected ? value - expected : expected - value;
+    return delta <= expected / 1000;
+  };
+  CHECK(within(uut.value_at_percentile(50), 50'000'000));
+  CHECK(within(uut.value_at_percentile(99), 99'000'000));
+  CHECK(within(uut.value_at_percentile(99.9), 99'900'000));
+  CHECK_EQUAL(uut.value_at_percentile(100), 100'000'000);
+}
+
+TEST(values above the trackable range count as the highest value) {
+  hdr_histogram uut{1000};
+  uut.record(5000);
+  uut.record(-1);
+  CHECK_EQUAL(uut.total_count(), 2u);
+  CHECK_EQUAL(uut.min(), 0);
+  CHECK_EQUAL(uut.max(), 1000);
+}
+
+TEST(merging adds all values from another histogram) {
+  hdr_histogram xs{1'000'000};
+  hdr_histogram ys{1'000'000};
+  for (int64_t i = 1; i <= 50; ++i) {
+    xs.record(i);
+    ys.record(i + 50);
+  }
+  xs.merge(ys);
+  CHECK_EQUAL(xs.total_count(), 100u);
+  CHECK_EQUAL(xs.min(), 1);
+  CHECK_EQUAL(xs.max(), 100);
+  CHECK_EQUAL(xs.value_at_percentile(50), 50);
+  xs.reset();
+  CHECK_EQUAL(xs.total_count(), 0u);
+  CHECK_EQUAL(xs.value_at_percentile(50), 0);
+}
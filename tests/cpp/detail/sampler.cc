@@ -0,0 +1,33 @@
+#define SUITE detail.sampler
+
+#include "broker/detail/sampler.hh"
+
+#include "test.hh"
+
+#include "broker/detail/cycle_clock.hh"
+
+#include <vector>
+
+using namespace broker;
+
+TEST(a sampler selects every n-th event) {
+  detail::sampler uut{4};
+  std::vector<bool> xs;
+  for (int i = 0; i < 8; ++i)
+    xs.push_back(uut());
+  CHECK_EQUAL(xs, std::vector<bool>({false, false, false, true, false, false,
+                                     false, true}));
+}
+
+TEST(a sampler with interval 0 never selects any event) {
+  detail::sampler uut;
+  for (int i = 0; i < 100; ++i)
+    CHECK(!uut());
+}
+
+TEST(the cycle clock measures elapsed time) {
+  auto start = detail::cycle_clock::now();
+  CHECK_NOT_EQUAL(start, 0u);
+  CHECK_GREATER(detail::cycle_clock::seconds_per_tick(), 0.0);
+  CHECK_GREATER_EQUAL(detail::cycle_clock::seconds_since(start), 0.0);
+}
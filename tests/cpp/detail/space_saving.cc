@@ -0,0 +1,50 @@
+#define SUITE detail.space_saving
+
+#include "broker/detail/space_saving.hh"
+
+#include "test.hh"
+
+#include <string>
+
+using namespace broker;
+
+TEST(the summary counts keys exactly while below capacity) {
+  detail::space_saving uut{4};
+  uut.add("a");
+  uut.add("b", 3);
+  uut.add("a");
+  uut.add("c", 5);
+  CHECK_EQUAL(uut.size(), 3u);
+  CHECK_EQUAL(uut.total(), 10u);
+  auto xs = uut.top(2);
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(xs[0].key, "c");
+  CHECK_EQUAL(xs[0].count, 5u);
+  CHECK_EQUAL(xs[0].error, 0u);
+  CHECK_EQUAL(xs[1].key, "b");
+  CHECK_EQUAL(xs[1].count, 3u);
+}
+
+TEST(the summary never exceeds its capacity) {
+  detail::space_saving uut{8};
+  for (int i = 0; i < 1000; ++i)
+    uut.add(std::to_string(i));
+  CHECK_EQUAL(uut.size(), 8u);
+  CHECK_EQUAL(uut.total(), 1000u);
+}
+
+TEST(the summary finds heavy hitters in a long tail) {
+  detail::space_saving uut{16};
+  for (int i = 0; i < 1000; ++i) {
+    uut.add("heavy-1", 10);
+    uut.add("heavy-2", 5);
+    uut.add("tail-" + std::to_string(i));
+  }
+  auto xs = uut.top(2);
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(xs[0].key, "heavy-1");
+  CHECK_EQUAL(xs[1].key, "heavy-2");
+  // Estimates never undercount and overcount by at most `error`.
+  CHECK_GREATER_EQUAL(xs[0].count, 10000u);
+  CHECK_LESS_EQUAL(xs[0].count - xs[0].error, 10000u);
+}
@@ -0,0 +1,164 @@
+#define SUITE format.bin
+
+#include "broker/format/bin.hh"
+
+#include "test.hh"
+
+#include <caf/binary_serializer.hpp>
+#include <caf/byte_buffer.hpp>
+
+#include <limits>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace bin_v1 = broker::format::bin::v1;
+
+namespace {
+
+// A data value that has one of everything.
+data native() {
+  address addr_v6;
+  convert("2001:db8::"s, addr_v6);
+  address addr_v4;
+  convert("255.255.255.0"s, addr_v4);
+  vector xs;
+  xs.emplace_back(nil);
+  xs.emplace_back(true);
+  xs.emplace_back(count{42u});
+  xs.emplace_back(integer{-23});
+  xs.emplace_back(12.48);
+  xs.emplace_back("this is a string"s);
+  xs.emplace_back(addr_v6);
+  xs.emplace_back(subnet{addr_v4, 24});
+  xs.emplace_back(subnet{addr_v6, 32});
+  xs.emplace_back(port{8080, port::protocol::tcp});
+  xs.emplace_back(timestamp{timespan{1649606820000000000}});
+  xs.emplace_back(timespan{23s});
+  xs.emplace_back(enum_value{"foo"s});
+  xs.emplace_back(set{data{1}, data{2}, data{3}});
+  table john_doe;
+  john_doe["first-name"s] = "John"s;
+  john_doe["last-name"s] = "Doe"s;
+  xs.emplace_back(std::move(john_doe));
+  xs.emplace_back(vector(200, data{count{1}}));
+  return data{std::move(xs)};
+}
+
+template <class T>
+std::vector<std::byte> caf_serialized(const T& x) {
+  caf::byte_buffer buf;
+  caf::binary_serializer sink{nullptr, buf};
+  if (!sink.apply(x))
+    FAIL("caf::binary_serializer failed: " << sink.get_error());
+  return buf;
+}
+
+// Returns the binary representation of `depth` nested vectors.
+std::vector<std::byte> nested_vectors(size_t depth) {
+  std::vector<std::byte> buf;
+  for (size_t i = 0; i < depth; ++i) {
+    buf.push_back(static_cast<std::byte>(data::type::vector));
+    buf.push_back(std::byte{i + 1 < depth ? 1 : 0});
+  }
+  return buf;
+}
+
+} // namespace
+
+TEST(the codec produces the same output as the native serializer) {
+  auto x = native();
+  std::vector<std::byte> buf;
+  bin_v1::encode(x, buf);
+  CHECK_EQUAL(buf, caf_serialized(x));
+  auto filter = filter_type{"/foo/bar"_t, "/baz"_t};
+  buf.clear();
+  bin_v1::encode(filter, buf);
+  CHECK_EQUAL(buf, caf_serialized(filter));
+}
+
+TEST(the codec restores values from their native representation) {
+  auto x = native();
+  auto buf = caf_serialized(x);
+  data y;
+  auto last = buf.data() + buf.size();
+  CHECK(bin_v1::decode(buf.data(), last, y) == last);
+  CHECK_EQUAL(x, y);
+}
+
+TEST(data messages are tagged frames with topic and data) {
+  auto x = native();
+  std::vector<std::byte> buf;
+  bin_v1::encode_data_message("/foo/bar"_t, x, buf);
+  REQUIRE(!buf.empty());
+  auto first = buf.data();
+  auto last = first + buf.size();
+  CHECK(bin_v1::tag_of(first, last) == bin_v1::frame_tag::data_message);
+  topic t;
+  data y;
+  if (CHECK(bin_v1::decode_data_message(first, last, t, y))) {
+    CHECK_EQUAL(t, "/foo/bar"_t);
+    CHECK_EQUAL(x, y);
+  }
+  // Any truncated frame must fail to decode.
+  for (auto i = first; i != last; ++i)
+    CHECK(!bin_v1::decode_data_message(first, i, t, y));
+}
+
+TEST(ack and error frames carry metadata) {
+  auto id = endpoint_id::random(42);
+  std::vector<std::byte> buf;
+  bin_v1::encode_ack(id, "2.2.0", buf);
+  endpoint_id id2;
+  std::string version;
+  if (CHECK(bin_v1::decode_ack(buf.data(), buf.data() + buf.size(), id2,
+                               version))) {
+    CHECK_EQUAL(id, id2);
+    CHECK_EQUAL(version, "2.2.0");
+  }
+  buf.clear();
+  bin_v1::encode_error("deserialization_failed", "oops", buf);
+  std::string code;
+  std::string context;
+  if (CHECK(bin_v1::decode_error(buf.data(), buf.data() + buf.size(), code,
+                                 context))) {
+    CHECK_EQUAL(code, "deserialization_failed");
+    CHECK_EQUAL(context, "oops");
+  }
+}
+
+TEST(the decoder rejects values that nest containers too deeply) {
+  auto decodes = [](const std::vector<std::byte>& buf) {
+    data x;
+    auto last = buf.data() + buf.size();
+    return bin_v1::decode(buf.data(), last, x) == last;
+  };
+  CHECK(decodes(nested_vectors(bin_v1::max_nesting_depth + 1)));
+  CHECK(!decodes(nested_vectors(bin_v1::max_nesting_depth + 2)));
+  // Must fail with an error rather than exhausting the stack.
+  CHECK(!decodes(nested_vectors(50'000)));
+}
+
+TEST(varbyte sizes are limited to 32 bit) {
+  auto max_size = size_t{std::numeric_limits<uint32_t>::max()};
+  std::vector<std::byte> buf;
+  CHECK(bin_v1::encode_varbyte(max_size, buf));
+  CHECK_EQUAL(buf, (std::vector<std::byte>{std::byte{0xff}, std::byte{0xff},
+                                           std::byte{0xff}, std::byte{0xff},
+                                           std::byte{0x0f}}));
+  size_t size = 0;
+  auto last = buf.data() + buf.size();
+  CHECK(bin_v1::decode_varbyte(buf.data(), last, size) == last);
+  CHECK_EQUAL(size, max_size);
+  // The fifth byte must not overflow 32 bits or set the continuation bit.
+  buf.back() = std::byte{0x10};
+  CHECK(bin_v1::decode_varbyte(buf.data(), last, size) == nullptr);
+  buf.back() = std::byte{0x8f};
+  buf.push_back(std::byte{0x00});
+  last = buf.data() + buf.size();
+  CHECK(bin_v1::decode_varbyte(buf.data(), last, size) == nullptr);
+  if constexpr (sizeof(size_t) > sizeof(uint32_t)) {
+    buf.clear();
+    CHECK(!bin_v1::encode_varbyte(max_size + 1, buf));
+  }
+}
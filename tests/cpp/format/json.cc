@@ -0,0 +1,204 @@
+#define SUITE format.json
+
+#include "broker/format/json.hh"
+
+#include "test.hh"
+
+#include "broker/internal/json_type_mapper.hh"
+#include "broker/message.hh"
+
+#include <caf/json_reader.hpp>
+#include <caf/json_writer.hpp>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace json_v1 = broker::format::json::v1;
+
+namespace {
+
+// A data value that has one of everything.
+data native() {
+  address addr_v6;
+  convert("2001:db8::"s, addr_v6);
+  address addr_v4;
+  convert("255.255.255.0"s, addr_v4);
+  vector xs;
+  xs.emplace_back(nil);
+  xs.emplace_back(true);
+  xs.emplace_back(count{42u});
+  xs.emplace_back(integer{-23});
+  xs.emplace_back(12.48);
+  xs.emplace_back(2.0);
+  xs.emplace_back("this is a \"string\" with\nescape sequences"s);
+  xs.emplace_back(addr_v6);
+  xs.emplace_back(subnet{addr_v4, 24});
+  xs.emplace_back(port{8080, port::protocol::tcp});
+  xs.emplace_back(timestamp{std::chrono::milliseconds{1649606820123}});
+  xs.emplace_back(timespan{23s});
+  xs.emplace_back(timespan{1500ms});
+  xs.emplace_back(timespan{1234});
+  xs.emplace_back(enum_value{"foo"s});
+  xs.emplace_back(set{data{1}, data{2}, data{3}});
+  table john_doe;
+  john_doe["first-name"s] = "John"s;
+  john_doe["last-name"s] = "Doe"s;
+  xs.emplace_back(std::move(john_doe));
+  xs.emplace_back(vector(20, data{count{1}}));
+  return data{std::move(xs)};
+}
+
+// Renders `x` with the CAF JSON writer in the same way as `json_v1::encode`.
+std::string caf_encode(const data& x) {
+  auto msg = make_data_message("/foo"s, x);
+  internal::json_type_mapper mapper;
+  caf::json_writer writer;
+  writer.mapper(&mapper);
+  writer.skip_object_type_annotation(true);
+  auto decorator = decorated(msg);
+  if (!writer.apply(decorator))
+    FAIL("caf::json_writer failed: " << writer.get_error());
+  // Strip the topic, since `json_v1::encode` renders only the data.
+  auto prefix = R"_({"topic": "/foo", )_"sv;
+  auto str = std::string{writer.str()};
+  if (str.compare(0, prefix.size(), prefix) != 0)
+    FAIL("unexpected output of caf::json_writer: " << str);
+  str.erase(1, prefix.size() - 1);
+  return str;
+}
+
+} // namespace
+
+TEST(the codec produces the same bytes as the CAF JSON writer) {
+  auto xs = std::vector<data>{
+    data{timespan{1500ms}},
+    data{timespan{-1500ms}},
+    data{timespan{23s}},
+    data{timespan{1234}},
+    data{timespan{0}},
+    data{0.1},
+    data{1e300},
+    data{-7.5},
+    data{2.0},
+    data{timestamp{std::chrono::milliseconds{1649606820123}}},
+    native(),
+  };
+  for (const auto& x : xs) {
+    std::string str;
+    json_v1::encode(x, str);
+    CHECK_EQ(str, caf_encode(x));
+  }
+}
+
+TEST(the codec accepts fractional timespans) {
+  auto decode = [](std::string_view str) {
+    auto input = R"_({"@data-type": "timespan", "data": ")_"s;
+    input += str;
+    input += "\"}";
+    data x;
+    if (!json_v1::decode(input, x) || !is<timespan>(x))
+      return timespan{-1};
+    return get<timespan>(x);
+  };
+  CHECK_EQ(decode("1.5s"), timespan{1500ms});
+  CHECK_EQ(decode("1500ms"), timespan{1500ms});
+  CHECK_EQ(decode("1.234us"), timespan{1234});
+  CHECK_EQ(decode("-1500000000ns"), timespan{-1500ms});
+  CHECK_EQ(decode("0.5min"), timespan{30s});
+  CHECK_EQ(decode("1.5"), timespan{-1});
+  CHECK_EQ(decode("s"), timespan{-1});
+}
+
+TEST(data messages round trip) {
+  auto x = native();
+  std::string str;
+  json_v1::encode_data_message("/foo/bar"s, x, str);
+  topic t;
+  data y;
+  if (CHECK(json_v1::decode_data_message(str, t, y))) {
+    CHECK_EQ(t, "/foo/bar"s);
+    CHECK_EQ(x, y);
+  }
+}
+
+TEST(the codec renders data messages like the CAF JSON writer) {
+  std::string str;
+  json_v1::encode_data_message("/foo"s, data{vector{data{count{1}}, data{}}},
+                               str);
+  CHECK_EQ(str, R"_({"type": "data-message", "topic": "/foo", )_"
+                R"_("@data-type": "vector", "data": [{"@data-type": )_"
+                R"_("count", "data": 1}, {"@data-type": "none", )_"
+                R"_("data": {}}]})_"s);
+}
+
+TEST(the CAF JSON reader accepts the output of the codec) {
+  auto x = native();
+  std::string str;
+  json_v1::encode_data_message("/foo/bar"s, x, str);
+  internal::json_type_mapper mapper;
+  caf::json_reader reader;
+  reader.mapper(&mapper);
+  if (CHECK(reader.load(str))) {
+    data_message msg;
+    auto decorator = decorated(msg);
+    if (CHECK(reader.apply(decorator))) {
+      CHECK_EQ(get_topic(msg), "/foo/bar"s);
+      CHECK_EQ(get_data(msg), x);
+    }
+  }
+}
+
+TEST(the codec accepts any order of keys and whitespace) {
+  auto str = R"_(
+    {
+      "data": [ { "data": 1, "@data-type": "count" } ],
+      "topic": "/foo",
+      "@data-type": "vector",
+      "type": "data-message"
+    }
+  )_"sv;
+  topic t;
+  data x;
+  if (CHECK(json_v1::decode_data_message(str, t, x))) {
+    CHECK_EQ(t, "/foo"s);
+    CHECK_EQ(x, data{vector{data{count{1}}}});
+  }
+}
+
+TEST(the codec decodes unicode escape sequences) {
+  auto str = R"_({"@data-type": "string", "data": "ü😀"})_"sv;
+  data x;
+  if (CHECK(json_v1::decode(str, x)))
+    CHECK_EQ(x, data{"\xc3\xbc\xf0\x9f\x98\x80"s});
+}
+
+TEST(the codec rejects invalid input) {
+  topic t;
+  data x;
+  auto decode = [&](std::string_view str) {
+    return json_v1::decode_data_message(str, t, x);
+  };
+  CHECK(!decode(R"_({"topic": "/x", "@data-type": "count", "data": -1})_"));
+  CHECK(!decode(R"_({"topic": "/x", "@data-type": "count", "data": 1.0})_"));
+  CHECK(!decode(R"_({"topic": "/x", "@data-type": "foo", "data": 1})_"));
+  CHECK(!decode(R"_({"topic": "/x", "@data-type": "count"})_"));
+  CHECK(!decode(R"_({"@data-type": "count", "data": 1})_"));
+  CHECK(!decode(R"_({"topic": "/x", "@data-type": "count", "data": 1} x)_"));
+  MESSAGE("every truncated data message is invalid");
+  std::string str;
+  json_v1::encode_data_message("/foo/bar"s, native(), str);
+  for (size_t i = 0; i < str.size(); ++i)
+    CHECK(!decode(std::string_view{str}.substr(0, i)));
+}
+
+TEST(batches contain either all or no messages) {
+  std::string msg;
+  json_v1::encode_data_message("/foo"s, data{count{1}}, msg);
+  std::vector<std::pair<topic, data>> xs;
+  CHECK(json_v1::decode_data_messages(msg, xs));
+  CHECK_EQ(xs.size(), 1u);
+  CHECK(json_v1::decode_data_messages("[" + msg + ", " + msg + "]", xs));
+  CHECK_EQ(xs.size(), 3u);
+  CHECK(!json_v1::decode_data_messages("[" + msg + ", {}]", xs));
+  CHECK_EQ(xs.size(), 3u);
+}
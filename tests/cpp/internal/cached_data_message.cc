@@ -0,0 +1,76 @@
+#define SUITE internal.cached_data_message
+
+#include "broker/internal/cached_data_message.hh"
+
+#include "test.hh"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+struct fixture {
+  endpoint_id sender = endpoint_id::random(1);
+
+  internal::cached_data_message_ptr msg =
+    internal::make_cached_data_message(sender, make_data_message("/foo/bar"s,
+                                                                 data{42}));
+
+  std::atomic<int> json_calls{0};
+
+  std::atomic<int> binary_calls{0};
+
+  caf::cow_string render_json(const data_message&) {
+    ++json_calls;
+    return caf::cow_string{"json"s};
+  }
+
+  caf::cow_string render_binary(const data_message&) {
+    ++binary_calls;
+    return caf::cow_string{"binary"s};
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(cached_data_message_tests, fixture)
+
+TEST(cached messages provide access to the decoded message) {
+  CHECK_EQUAL(msg->sender(), sender);
+  CHECK_EQUAL(msg->get_topic(), "/foo/bar"_t);
+  CHECK_EQUAL(get_data(msg->msg()), data{42});
+}
+
+TEST(clients render each format at most once) {
+  auto json = [this](const data_message& x) { return render_json(x); };
+  auto binary = [this](const data_message& x) { return render_binary(x); };
+  CHECK_EQUAL(msg->json(json).str(), "json");
+  CHECK_EQUAL(msg->json(json).str(), "json");
+  CHECK_EQUAL(json_calls.load(), 1);
+  CHECK_EQUAL(binary_calls.load(), 0);
+  CHECK_EQUAL(msg->binary(binary).str(), "binary");
+  CHECK_EQUAL(msg->binary(binary).str(), "binary");
+  CHECK_EQUAL(json_calls.load(), 1);
+  CHECK_EQUAL(binary_calls.load(), 1);
+}
+
+TEST(concurrent clients share a single rendering) {
+  auto json = [this](const data_message& x) { return render_json(x); };
+  std::vector<std::thread> clients;
+  std::atomic<int> mismatches{0};
+  for (int i = 0; i < 8; ++i)
+    clients.emplace_back([&] {
+      if (msg->json(json).str() != "json")
+        ++mismatches;
+    });
+  for (auto& client : clients)
+    client.join();
+  CHECK_EQUAL(json_calls.load(), 1);
+  CHECK_EQUAL(mismatches.load(), 0);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,100 @@
+#define SUITE internal.client_buffer
+
+#include "broker/internal/client_buffer.hh"
+
+#include "test.hh"
+
+#include <caf/async/spsc_buffer.hpp>
+#include <caf/scheduled_actor/flow.hpp>
+#include <caf/telemetry/metric_registry.hpp>
+
+using namespace broker;
+using namespace broker::internal;
+
+namespace {
+
+struct fixture : base_fixture {
+  caf::telemetry::metric_registry reg;
+
+  client_buffer_metrics metrics;
+
+  std::vector<int> received;
+
+  caf::error err;
+
+  fixture() {
+    metrics.queued = reg.gauge_singleton("test", "queued", "Queued items.");
+    metrics.dropped = reg.counter_singleton("test", "dropped", "Drops.");
+    metrics.stats = std::make_shared<client_stats>();
+  }
+
+  size_t num_dropped() {
+    return static_cast<size_t>(metrics.dropped->value());
+  }
+
+  // Pushes the integers 1 to 10 into a client buffer of size 3 and only starts
+  // to consume them after the buffer has overflown.
+  void run_with(overflow_policy policy) {
+    auto [con, prod] = caf::async::make_spsc_buffer_resource<int>();
+    sys.spawn([this, policy, prod{prod}](caf::event_based_actor* self) {
+      self->make_observable()
+        .iota(1)
+        .take(10)
+        .compose(add_client_buffer_t{3, policy, metrics})
+        .subscribe(prod);
+    });
+    run();
+    sys.spawn([this, con{con}](caf::event_based_actor* self) {
+      self->make_observable().from_resource(con).for_each(
+        [this](int x) { received.push_back(x); },
+        [this](const caf::error& what) { err = what; });
+    });
+    run();
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(client_buffer_tests, fixture)
+
+TEST(dropping the newest items keeps the oldest ones) {
+  run_with(overflow_policy::drop_newest);
+  CHECK_EQ(metrics.queued->value(), 0);
+  CHECK_EQ(received.size() + num_dropped(), 10u);
+  MESSAGE("the per-client statistics match the metrics");
+  CHECK_EQ(metrics.stats->queued.load(), 0);
+  CHECK_EQ(metrics.stats->dropped.load(), metrics.dropped->value());
+  if (CHECK(!received.empty()))
+    CHECK_EQ(received.front(), 1);
+  CHECK(!err);
+}
+
+TEST(dropping the oldest items keeps the newest ones) {
+  run_with(overflow_policy::drop_oldest);
+  CHECK_EQ(metrics.queued->value(), 0);
+  CHECK_EQ(received.size() + num_dropped(), 10u);
+  if (CHECK(!received.empty()))
+    CHECK_EQ(received.back(), 10);
+  CHECK(!err);
+}
+
+TEST(disconnect aborts the flow on overflow) {
+  run_with(overflow_policy::disconnect);
+  CHECK_EQ(metrics.queued->value(), 0);
+  CHECK_EQ(metrics.dropped->value(), 0);
+  CHECK(err == ec::backpressure_overflow);
+}
+
+TEST(overflow policies have a string representation) {
+  for (auto policy : {overflow_policy::drop_oldest,
+                      overflow_policy::drop_newest,
+                      overflow_policy::disconnect}) {
+    auto tmp = overflow_policy::disconnect;
+    if (CHECK(from_string(to_string(policy), tmp)))
+      CHECK(tmp == policy);
+  }
+  auto tmp = overflow_policy::disconnect;
+  CHECK(!from_string("drop-all", tmp));
+}
+
+FIXTURE_SCOPE_END()
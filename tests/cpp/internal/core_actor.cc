@@ -5,6 +5,7 @@
 #include "test.hh"
 
 #include <caf/scheduled_actor/flow.hpp>
+#include <caf/stateful_actor.hpp>
 
 #include "broker/configuration.hh"
 #include "broker/endpoint.hh"
@@ -18,9 +19,17 @@ struct config : public caf::actor_system_config {
   config() {
     set("caf.logger.file.verbosity", "trace");
     // set("caf.logger.console.verbosity", "trace");
+    // Note: only affects messages from publishers, not `push_data`.
+    set("broker.metrics.trace-sample-interval", 1);
   }
 };
 
+struct tap_state {
+  static inline const char* name = "broker.test.tap";
+};
+
+using tap_actor = caf::stateful_actor<tap_state>;
+
 struct fixture : test_coordinator_fixture<config> {
   using endpoint_state = base_fixture::endpoint_state;
 
@@ -89,6 +98,56 @@ struct fixture : test_coordinator_fixture<config> {
     base_fixture::push_data(ep.hdl, xs);
   }
 
+  // Publishes `xs` on `ep` via a publisher flow, like `endpoint::publish_all`.
+  void publish_data(const endpoint_state& ep, data_message_list xs) {
+    auto [con, prod] = caf::async::make_spsc_buffer_resource<data_message>();
+    auto [self, launch] = sys.spawn_inactive<tap_actor>();
+    self->make_observable().from_container(std::move(xs)).subscribe(prod);
+    launch();
+    caf::anon_send(ep.hdl, internal::data_consumer_res{std::move(con)});
+  }
+
+  // Like `bridge`, but also records all messages from `left` to `right`.
+  std::shared_ptr<std::vector<node_message>>
+  tapped_bridge(const endpoint_state& left, const endpoint_state& right) {
+    using caf::async::make_spsc_buffer_resource;
+    auto buf = std::make_shared<std::vector<node_message>>();
+    auto [self, launch] = sys.spawn_inactive<tap_actor>();
+    auto [con1, prod1] = make_spsc_buffer_resource<node_message>();
+    auto [con2, prod2] = make_spsc_buffer_resource<node_message>();
+    caf::anon_send(left.hdl, atom::peer_v, right.id,
+                   network_info{to_string(right.id), 42}, right.filter, con1,
+                   prod2);
+    auto [con3, prod3] = make_spsc_buffer_resource<node_message>();
+    auto [con4, prod4] = make_spsc_buffer_resource<node_message>();
+    caf::anon_send(right.hdl, atom::peer_v, left.id,
+                   network_info{to_string(left.id), 42}, left.filter, con3,
+                   prod4);
+    self->make_observable()
+      .from_resource(con2)
+      .do_on_next([buf](const node_message& msg) { buf->emplace_back(msg); })
+      .subscribe(prod3);
+    self->make_observable().from_resource(con4).subscribe(prod1);
+    bridges.emplace_back(self);
+    launch();
+    return buf;
+  }
+
+  // Returns the nodes of the hops of all traced data messages in `xs`.
+  static std::vector<std::vector<endpoint_id>>
+  traced_paths(const std::vector<node_message>& xs) {
+    std::vector<std::vector<endpoint_id>> result;
+    for (const auto& x : xs) {
+      auto trace = internal::get_trace(x);
+      if (get_type(x) != packed_message_type::data || !trace)
+        continue;
+      auto& path = result.emplace_back();
+      for (const auto& hop : trace->hops)
+        path.emplace_back(hop.node);
+    }
+    return result;
+  }
+
   auto& state(caf::actor hdl) {
     return deref<internal::core_actor>(hdl).state;
   }
@@ -155,4 +214,32 @@ TEST(peers forward local data to any peer with forwarding paths) {
   CHECK_EQUAL(*buf, test_data);
 }
 
+TEST(traces list each endpoint on the path exactly once) {
+  MESSAGE("spin up ep1, ep2 and ep3");
+  auto abc = filter_type{"a", "b", "c"};
+  ep1.filter = abc;
+  ep2.filter = abc;
+  ep3.filter = abc;
+  spin_up(ep1, ep2, ep3);
+  auto ep1_to_ep2 = tapped_bridge(ep1, ep2);
+  auto ep2_to_ep3 = tapped_bridge(ep2, ep3);
+  run();
+  MESSAGE("subscribe to data messages on ep3");
+  auto buf = collect_data(ep3, abc);
+  MESSAGE("publish data on ep1 with tracing enabled for each message");
+  publish_data(ep1, test_data);
+  run();
+  CHECK_EQUAL(*buf, test_data);
+  MESSAGE("ep1 is the only hop when leaving ep1");
+  auto paths1 = traced_paths(*ep1_to_ep2);
+  CHECK_EQUAL(paths1.size(), test_data.size());
+  for (const auto& path : paths1)
+    CHECK_EQUAL(path, ids(ep1.id));
+  MESSAGE("ep2 adds itself once when forwarding to ep3");
+  auto paths2 = traced_paths(*ep2_to_ep3);
+  CHECK_EQUAL(paths2.size(), test_data.size());
+  for (const auto& path : paths2)
+    CHECK_EQUAL(path, ids(ep1.id, ep2.id));
+}
+
 FIXTURE_SCOPE_END()
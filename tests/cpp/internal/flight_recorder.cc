@@ -0,0 +1,108 @@
+#define SUITE internal.flight_recorder
+
+#include "broker/internal/flight_recorder.hh"
+
+#include "test.hh"
+
+#include "broker/config.hh"
+#include "broker/detail/filesystem.hh"
+
+#include <string>
+#include <vector>
+
+using namespace broker;
+using namespace broker::internal;
+
+namespace {
+
+struct fixture {
+  endpoint_id alice = endpoint_id::random(1);
+
+  endpoint_id bob = endpoint_id::random(2);
+
+  std::vector<flight_record> decode(const flight_recorder& rec) {
+    std::vector<flight_record> result;
+    auto buf = rec.snapshot();
+    if (auto err = flight_recorder::decode(caf::make_span(buf), result))
+      FAIL("failed to decode the snapshot: " << err);
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(flight_recorder_tests, fixture)
+
+TEST(a closed recorder ignores all records) {
+  flight_recorder rec;
+  CHECK(!rec);
+  CHECK_EQ(rec.capacity(), 0u);
+  rec.record(flight_stage::dispatch, packed_message_type::data, "/foo", 42,
+             alice, bob);
+  CHECK_EQ(rec.total(), 0u);
+  CHECK(rec.snapshot().empty());
+}
+
+TEST(the recorder keeps the most recent records) {
+  flight_recorder rec;
+  if (auto err = rec.open(5))
+    FAIL("failed to open the recorder: " << err);
+  CHECK_EQ(rec.capacity(), 8u);
+  for (size_t index = 0; index < 3; ++index)
+    rec.record(flight_stage::inbound, packed_message_type::data, "/foo", index,
+               alice, bob);
+  auto xs = decode(rec);
+  CHECK_EQ(xs.size(), 3u);
+  MESSAGE("overwrite the oldest records after reaching the capacity");
+  for (size_t index = 3; index < 11; ++index)
+    rec.record(flight_stage::outbound, packed_message_type::command, "/bar",
+               index, bob, endpoint_id{});
+  CHECK_EQ(rec.total(), 11u);
+  xs = decode(rec);
+  if (CHECK_EQ(xs.size(), 8u)) {
+    for (size_t index = 0; index < 8; ++index)
+      CHECK_EQ(xs[index].size, index + 3);
+    auto& x = xs.back();
+    CHECK_EQ(x.topic_id, flight_recorder::topic_id("/bar"));
+    CHECK_EQ(x.type, static_cast<uint8_t>(packed_message_type::command));
+    CHECK_EQ(x.stage, static_cast<uint8_t>(flight_stage::outbound));
+    CHECK_EQ(endpoint_id{x.sender}, bob);
+    CHECK_EQ(endpoint_id{x.receiver}, endpoint_id{});
+  }
+}
+
+#ifndef BROKER_WINDOWS
+
+TEST(only one recorder at a time may use a file) {
+  auto file_name = detail::make_temp_file_name();
+  {
+    flight_recorder rec1;
+    if (auto err = rec1.open(8, file_name))
+      FAIL("failed to open the recorder: " << err);
+    rec1.record(flight_stage::inbound, packed_message_type::data, "/foo", 42,
+                alice, bob);
+    MESSAGE("a second recorder neither opens nor truncates the file");
+    flight_recorder rec2;
+    CHECK(rec2.open(8, file_name));
+    CHECK(!rec2);
+    auto xs = decode(rec1);
+    CHECK_EQ(xs.size(), 1u);
+    MESSAGE("closing the first recorder releases the file");
+  }
+  flight_recorder rec3;
+  CHECK(!rec3.open(8, file_name));
+  CHECK(rec3);
+  detail::remove(file_name);
+}
+
+#endif
+
+TEST(decode rejects invalid input) {
+  std::vector<flight_record> xs;
+  std::vector<std::byte> buf;
+  CHECK(flight_recorder::decode(caf::make_span(buf), xs));
+  buf.resize(128);
+  CHECK(flight_recorder::decode(caf::make_span(buf), xs));
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,41 @@
+#define SUITE internal.flow_scope
+
+#include "broker/internal/flow_scope.hh"
+
+#include "test.hh"
+
+using namespace broker;
+using namespace broker::internal;
+
+TEST(flow scope stats track demand and buffered items) {
+  flow_scope_stats stats;
+  stats.on_request(10);
+  CHECK_EQ(stats.demand(), 10);
+  CHECK_EQ(stats.buffered(), 0);
+  for (int i = 0; i < 4; ++i)
+    stats.on_deliver();
+  CHECK_EQ(stats.demand(), 6);
+  CHECK_EQ(stats.buffered(), 4);
+  CHECK_EQ(stats.high_water_mark, 4);
+  CHECK_NE(stats.last_delivery, 0u);
+  MESSAGE("new demand drains the buffer but keeps the high-water mark");
+  stats.on_request(3);
+  CHECK_EQ(stats.buffered(), 1);
+  CHECK_EQ(stats.high_water_mark, 4);
+}
+
+TEST(flow scope stats track stalls) {
+  flow_scope_stats stats;
+  stats.on_request(2);
+  stats.on_deliver();
+  CHECK_EQ(stats.stalled_since, 0u);
+  stats.on_deliver();
+  CHECK_EQ(stats.demand(), 0);
+  CHECK_NE(stats.stalled_since, 0u);
+  auto later = stats.stalled_since + 100;
+  CHECK_EQ(stats.stall_time(later), 100u);
+  MESSAGE("new demand ends the stall");
+  stats.on_request(1);
+  CHECK_EQ(stats.stalled_since, 0u);
+  CHECK_EQ(stats.stall_time(later + 1000), stats.stall_ticks);
+}
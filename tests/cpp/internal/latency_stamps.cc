@@ -0,0 +1,91 @@
+#define SUITE internal.latency_stamps
+
+#include "broker/internal/latency_stamps.hh"
+
+#include "test.hh"
+
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+TEST(messages are not part of the sample by default) {
+  internal::latency_stamps stamps;
+  auto msg = make_data_message("/foo"s, data{count{1}});
+  CHECK_EQUAL(stamps.get(msg), 0u);
+  CHECK_EQUAL(stamps.take(msg), 0u);
+}
+
+TEST(the side table keeps stamps until taking them) {
+  internal::latency_stamps stamps;
+  auto msg = make_data_message("/foo"s, data{count{1}});
+  auto other = make_data_message("/foo"s, data{count{1}});
+  stamps.set(msg, 42);
+  CHECK_EQUAL(stamps.get(msg), 42u);
+  CHECK_EQUAL(stamps.get(other), 0u);
+  MESSAGE("the table holds a reference while the message carries a stamp");
+  CHECK(!msg.unique());
+  CHECK_EQUAL(stamps.take(msg), 42u);
+  CHECK(msg.unique());
+  CHECK_EQUAL(stamps.get(msg), 0u);
+}
+
+TEST(copies of a message share its stamp) {
+  internal::latency_stamps stamps;
+  auto pm = make_packed_message(packed_message_type::data, 1, "/foo"s,
+                                std::vector<std::byte>{});
+  auto msg = make_node_message(endpoint_id::random(), std::move(pm));
+  auto cpy = msg;
+  stamps.set(msg, 23);
+  CHECK_EQUAL(stamps.get(cpy), 23u);
+  CHECK_EQUAL(stamps.take(cpy), 23u);
+  CHECK_EQUAL(stamps.get(msg), 0u);
+}
+
+TEST(each table has its own stamps) {
+  internal::latency_stamps stamps1;
+  internal::latency_stamps stamps2;
+  auto msg = make_data_message("/foo"s, data{count{1}});
+  stamps1.set(msg, 42);
+  CHECK_EQUAL(stamps1.get(msg), 42u);
+  CHECK_EQUAL(stamps2.get(msg), 0u);
+  CHECK_EQUAL(stamps1.take(msg), 42u);
+}
+
+TEST(the table counts evicted stamps as collisions) {
+  caf::telemetry::int_counter collisions;
+  internal::latency_stamps stamps{0, &collisions};
+  // With more messages than slots, at least one stamp evicts another.
+  std::vector<data_message> msgs;
+  for (uint64_t i = 0; i <= 64; ++i) {
+    msgs.emplace_back(make_data_message("/foo"s, data{count{i}}));
+    stamps.set(msgs.back(), i + 1);
+  }
+  CHECK_GREATER_EQUAL(collisions.value(), 1);
+  MESSAGE("stamping a message again does not count as collision");
+  auto before = collisions.value();
+  stamps.set(msgs.back(), 100);
+  CHECK_EQUAL(collisions.value(), before);
+  MESSAGE("evicted messages lose their stamp but never get another one");
+  size_t evicted = 0;
+  for (uint64_t i = 0; i < 64; ++i) {
+    auto stamp = stamps.get(msgs[i]);
+    if (stamp == 0)
+      ++evicted;
+    else
+      CHECK_EQUAL(stamp, i + 1);
+  }
+  CHECK_EQUAL(static_cast<int64_t>(evicted), collisions.value());
+}
+
+TEST(the table samples one out of n messages) {
+  internal::latency_stamps never;
+  internal::latency_stamps every_third{3};
+  std::vector<bool> selected;
+  for (int i = 0; i < 6; ++i) {
+    CHECK(!never.sample());
+    selected.push_back(every_third.sample());
+  }
+  CHECK_EQUAL(selected,
+              std::vector<bool>({false, false, true, false, false, true}));
+}
@@ -5,6 +5,7 @@
 #include "test.hh"
 
 #include "broker/internal/metric_exporter.hh"
+#include "broker/internal/metric_scraper.hh"
 
 namespace atom = broker::internal::atom;
 
@@ -108,4 +109,71 @@ TEST(a collector consumes the output of an exporter) {
     R"(foo_h2_seconds_count{endpoint="exporter-1",sys="broker"} 1)");
 }
 
+TEST(a collector consumes delta-encoded metrics) {
+  internal::metric_scraper scraper{{"foo"}, "exporter-2"};
+  auto publish = [this, &scraper] {
+    scraper.scrape(sys.metrics());
+    return collector.insert_or_update(scraper.encode_delta());
+  };
+  MESSAGE("the first export contains the definitions for all metrics");
+  foo_g1->inc(1);
+  CHECK_EQUAL(publish(), 6u);
+  MESSAGE("subsequent exports only contain metrics with changed values");
+  CHECK_EQUAL(publish(), 0u);
+  foo_g1->inc(2);
+  foo_h1->observe(4);
+  CHECK_EQUAL(publish(), 2u);
+  CHECK_EQUAL(scraper.encode_delta().size(), 1u);
+  auto prom_txt = collector.prometheus_text();
+  PROM_CONTAINS(R"(foo_g1{endpoint="exporter-2"} 3)");
+  PROM_CONTAINS(
+    R"(foo_h1_seconds_count{endpoint="exporter-2",sys="broker"} 1)");
+  MESSAGE("full refreshes contain the definitions for all metrics again");
+  scraper.full_refresh_interval(1);
+  CHECK_EQUAL(publish(), 6u);
+  MESSAGE("the collector ignores updates for unknown IDs");
+  collector.clear();
+  scraper.full_refresh_interval(0);
+  foo_g1->inc(1);
+  CHECK_EQUAL(publish(), 0u);
+}
+
+TEST(the collector only re-renders its output after changes) {
+  internal::metric_scraper scraper{{"foo"}, "exporter-3"};
+  auto publish = [this, &scraper] {
+    scraper.scrape(sys.metrics());
+    return collector.insert_or_update(scraper.rows());
+  };
+  foo_g1->inc(1);
+  CHECK_EQUAL(publish(), 6u);
+  auto prom_txt = std::string{collector.prometheus_text()};
+  PROM_CONTAINS("# HELP foo_g1 Int Gauge!\n# TYPE foo_g1 gauge\n");
+  PROM_CONTAINS(R"(foo_g1{endpoint="exporter-3"} 1)");
+  PROM_CONTAINS(R"(foo_h1_seconds_bucket{endpoint="exporter-3",sys="broker",)"
+                R"(le="+Inf"} 0)");
+  MESSAGE("unchanged metrics produce the same output");
+  CHECK_EQUAL(publish(), 6u);
+  CHECK_EQUAL(collector.prometheus_text(), prom_txt);
+  MESSAGE("changed metrics show up in the output");
+  foo_g1->inc(1);
+  foo_h1->observe(10);
+  CHECK_EQUAL(publish(), 6u);
+  prom_txt = std::string{collector.prometheus_text()};
+  PROM_CONTAINS(R"(foo_g1{endpoint="exporter-3"} 2)");
+  PROM_CONTAINS(R"(foo_h1_seconds_bucket{endpoint="exporter-3",sys="broker",)"
+                R"(le="8"} 0)");
+  PROM_CONTAINS(R"(foo_h1_seconds_bucket{endpoint="exporter-3",sys="broker",)"
+                R"(le="16"} 1)");
+  PROM_CONTAINS(R"(foo_h1_seconds_bucket{endpoint="exporter-3",sys="broker",)"
+                R"(le="+Inf"} 1)");
+#ifdef BROKER_HAS_ZLIB
+  MESSAGE("the collector optionally compresses its output with gzip");
+  auto compressed = collector.prometheus_text_gzip();
+  if (CHECK_GREATER(compressed.size(), 2u)) {
+    CHECK(compressed[0] == std::byte{0x1f});
+    CHECK(compressed[1] == std::byte{0x8b});
+  }
+#endif
+}
+
 FIXTURE_SCOPE_END()
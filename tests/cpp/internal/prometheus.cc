@@ -0,0 +1,58 @@
+#define SUITE internal.prometheus
+
+#include "broker/internal/prometheus.hh"
+
+#include "test.hh"
+
+#include <string>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+bool accepts_gzip(std::string_view fields) {
+  auto req = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n"s;
+  req += fields;
+  req += "\r\n";
+  return internal::accepts_gzip(req);
+}
+
+} // namespace
+
+TEST(clients without encoding preferences receive plain text) {
+  CHECK(!accepts_gzip(""));
+  CHECK(!accepts_gzip("Accept: text/plain\r\n"));
+}
+
+TEST(clients may list gzip among other codings) {
+  CHECK(accepts_gzip("Accept-Encoding: gzip\r\n"));
+  CHECK(accepts_gzip("accept-encoding: deflate, GZIP, br\r\n"));
+  CHECK(accepts_gzip("Accept-Encoding: br;q=1.0, gzip;q=0.5\r\n"));
+  CHECK(accepts_gzip("Accept-Encoding: x-gzip\r\n"));
+  CHECK(accepts_gzip("Accept-Encoding: deflate\r\n"
+                     "Accept-Encoding: gzip\r\n"));
+}
+
+TEST(codings must match exactly) {
+  CHECK(!accepts_gzip("Accept-Encoding: deflate, br\r\n"));
+  CHECK(!accepts_gzip("Accept-Encoding: gzipped\r\n"));
+  CHECK(!accepts_gzip("Accept-Encoding: x-gzip-foo\r\n"));
+}
+
+TEST(a weight of zero rejects a coding) {
+  CHECK(!accepts_gzip("Accept-Encoding: gzip;q=0\r\n"));
+  CHECK(!accepts_gzip("Accept-Encoding: deflate, gzip; q=0.000\r\n"));
+  CHECK(!accepts_gzip("Accept-Encoding: *, gzip;q=0\r\n"));
+  CHECK(accepts_gzip("Accept-Encoding: gzip;q=0.001\r\n"));
+}
+
+TEST(the wildcard accepts gzip unless listed otherwise) {
+  CHECK(accepts_gzip("Accept-Encoding: *\r\n"));
+  CHECK(!accepts_gzip("Accept-Encoding: *;q=0\r\n"));
+  CHECK(accepts_gzip("Accept-Encoding: *;q=0, gzip\r\n"));
+}
+
+TEST(fields after the header belong to the body) {
+  CHECK(!accepts_gzip("\r\nAccept-Encoding: gzip\r\n"));
+}
@@ -0,0 +1,42 @@
+#define SUITE internal.topic_statistics
+
+#include "broker/internal/topic_statistics.hh"
+
+#include "test.hh"
+
+#include <string>
+
+using namespace broker;
+using namespace std::literals;
+
+TEST(an interval of 1 counts every message) {
+  internal::topic_statistics uut{8, 1};
+  for (int i = 0; i < 10; ++i)
+    uut.add("/foo"s, 100);
+  uut.add("/bar"s, 1);
+  auto xs = uut.messages().top(2);
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(xs[0].key, "/foo");
+  CHECK_EQUAL(xs[0].count, 10u);
+  CHECK_EQUAL(xs[1].key, "/bar");
+  CHECK_EQUAL(xs[1].count, 1u);
+  CHECK_EQUAL(uut.bytes().top(1)[0].count, 1000u);
+}
+
+TEST(sampling keeps exact totals and finds the heavy hitters) {
+  internal::topic_statistics uut{8, 16};
+  for (int i = 0; i < 10'000; ++i) {
+    uut.add("/heavy"s, 10);
+    if (i % 10 == 0)
+      uut.add("/light"s, 10);
+  }
+  auto snapshot = uut.snapshot(2);
+  CHECK_EQUAL(snapshot["total-messages"s], data{count{11'000}});
+  CHECK_EQUAL(snapshot["total-bytes"s], data{count{110'000}});
+  auto xs = uut.messages().top(2);
+  REQUIRE_GREATER_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0].key, "/heavy");
+  // Samples account for all messages since the previous sample.
+  CHECK_LESS_EQUAL(uut.messages().total(), 11'000u);
+  CHECK_GREATER(uut.messages().total(), 11'000u - 32u);
+}
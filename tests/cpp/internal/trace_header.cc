@@ -0,0 +1,72 @@
+#define SUITE internal.trace_header
+
+#include "broker/internal/trace_header.hh"
+
+#include "test.hh"
+
+#include <vector>
+
+using namespace broker;
+using namespace broker::internal;
+using namespace std::literals;
+
+namespace {
+
+struct fixture {
+  endpoint_id ep1 = endpoint_id::random();
+
+  endpoint_id ep2 = endpoint_id::random();
+
+  node_message make_msg() {
+    auto content = make_packed_message(packed_message_type::data, 1, "/foo"s,
+                                       std::vector<std::byte>{});
+    return make_node_message(ep1, std::move(content));
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(trace_header_tests, fixture)
+
+TEST(messages carry no trace by default) {
+  CHECK(!get_trace(make_msg()));
+}
+
+TEST(copies of a message share its trace) {
+  auto msg = make_msg();
+  auto cpy = msg;
+  set_trace(msg, trace_header_ptr{{{ep1, timestamp{timespan{1000}}}}});
+  auto trace = get_trace(cpy);
+  REQUIRE(trace);
+  CHECK_EQUAL(trace->origin().node, ep1);
+  MESSAGE("modifying a copy detaches it from the trace");
+  using std::get;
+  get<0>(cpy.unshared()) = ep2;
+  CHECK(!get_trace(cpy));
+  CHECK(get_trace(msg));
+}
+
+TEST(adding a hop leaves the original trace unchanged) {
+  auto trace = trace_header_ptr{{{ep1, timestamp{timespan{1000}}}}};
+  auto next = trace.add_hop(trace_hop{ep2, timestamp{timespan{2000}}});
+  CHECK_EQUAL(trace->hops.size(), 1u);
+  REQUIRE_EQUAL(next->hops.size(), 2u);
+  CHECK_EQUAL(next->origin().node, ep1);
+  CHECK_EQUAL(next->last_hop().node, ep2);
+}
+
+TEST(the side table drops the oldest traces when running out of space) {
+  std::vector<node_message> msgs;
+  for (int i = 0; i < 1000; ++i) {
+    auto& msg = msgs.emplace_back(make_msg());
+    set_trace(msg, trace_header_ptr{{{ep1, timestamp{timespan{i}}}}});
+  }
+  CHECK(!get_trace(msgs.front()));
+  for (int i = 900; i < 1000; ++i) {
+    auto trace = get_trace(msgs[i]);
+    if (CHECK(trace))
+      CHECK_EQUAL(trace->origin().time, timestamp{timespan{i}});
+  }
+}
+
+FIXTURE_SCOPE_END()
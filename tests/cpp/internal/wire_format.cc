@@ -0,0 +1,71 @@
+#define SUITE internal.wire_format
+
+#include "broker/internal/wire_format.hh"
+
+#include "test.hh"
+
+#include "broker/internal/trace_header.hh"
+
+#include <caf/byte_buffer.hpp>
+
+using namespace broker;
+using namespace broker::internal;
+
+namespace {
+
+struct fixture {
+  endpoint_id ep1 = endpoint_id::random();
+
+  endpoint_id ep2 = endpoint_id::random();
+
+  wire_format::v1::trait trait;
+
+  node_message make_msg(trace_header_ptr trace = {}) {
+    auto bytes = std::vector<std::byte>{std::byte{1}, std::byte{2}};
+    auto content = make_packed_message(packed_message_type::data, 10,
+                                       topic{"foo/bar"}, bytes);
+    auto result = node_message{ep1, ep2, content};
+    if (trace)
+      set_trace(result, std::move(trace));
+    return result;
+  }
+
+  node_message roundtrip(const node_message& msg) {
+    caf::byte_buffer buf;
+    if (!trait.convert(msg, buf))
+      FAIL("failed to serialize: " << trait.last_error());
+    node_message result;
+    if (!trait.convert(buf, result))
+      FAIL("failed to deserialize: " << trait.last_error());
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(wire_format_tests, fixture)
+
+TEST(node messages without trace survive a roundtrip) {
+  auto msg = make_msg();
+  auto result = roundtrip(msg);
+  CHECK_EQUAL(result, msg);
+  CHECK(!get_trace(result));
+}
+
+TEST(node messages with trace survive a roundtrip) {
+  auto t0 = timestamp{timespan{1000}};
+  auto t1 = timestamp{timespan{2000}};
+  auto msg = make_msg(trace_header_ptr{{{ep1, t0}, {ep2, t1}}});
+  auto result = roundtrip(msg);
+  CHECK_EQUAL(result, msg);
+  auto trace = get_trace(result);
+  REQUIRE(trace);
+  const auto& hops = trace->hops;
+  REQUIRE_EQUAL(hops.size(), 2u);
+  CHECK_EQUAL(hops[0].node, ep1);
+  CHECK_EQUAL(hops[0].time, t0);
+  CHECK_EQUAL(hops[1].node, ep2);
+  CHECK_EQUAL(hops[1].time, t1);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,85 @@
+#define SUITE telemetry.sharded
+
+#include "broker/telemetry/sharded.hh"
+
+#include "test.hh"
+
+#include "broker/telemetry/metric_registry.hh"
+
+#include <thread>
+#include <vector>
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  telemetry::metric_registry reg
+    = telemetry::metric_registry::pre_init_instance();
+
+  telemetry::int_counter counter(std::string_view name) {
+    auto hdl = reg.counter_family("test", "sharded-counter", {"name"}, "test");
+    return telemetry::int_counter_family{hdl}.get_or_add({{"name", name}});
+  }
+
+  telemetry::int_gauge gauge(std::string_view name) {
+    auto hdl = reg.gauge_family("test", "sharded-gauge", {"name"}, "test");
+    return telemetry::int_gauge_family{hdl}.get_or_add({{"name", name}});
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(sharded_tests, fixture)
+
+TEST(sharded counters aggregate lazily) {
+  auto backend = counter("lazy");
+  telemetry::sharded_int_counter uut{backend};
+  uut.inc();
+  uut.inc(2);
+  CHECK_EQ(uut.value(), 3);
+  CHECK_EQ(backend.value(), 0);
+  telemetry::sharded_metric::flush_all();
+  CHECK_EQ(backend.value(), 3);
+  MESSAGE("flushing again has no effect without new updates");
+  telemetry::sharded_metric::flush_all();
+  CHECK_EQ(backend.value(), 3);
+}
+
+TEST(sharded gauges propagate increments and decrements) {
+  auto backend = gauge("inc-dec");
+  telemetry::sharded_int_gauge uut{backend};
+  uut.inc(5);
+  telemetry::sharded_metric::flush_all();
+  CHECK_EQ(backend.value(), 5);
+  uut.dec(7);
+  CHECK_EQ(uut.value(), -2);
+  telemetry::sharded_metric::flush_all();
+  CHECK_EQ(backend.value(), -2);
+}
+
+TEST(sharded metrics flush pending updates on destruction) {
+  auto backend = counter("tmp");
+  {
+    telemetry::sharded_int_counter uut{backend};
+    uut.inc(42);
+  }
+  CHECK_EQ(backend.value(), 42);
+}
+
+TEST(sharded metrics count updates from all threads) {
+  auto backend = counter("mt");
+  telemetry::sharded_int_counter uut{backend};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+    threads.emplace_back([&uut] {
+      for (int j = 0; j < 1000; ++j)
+        uut.inc();
+    });
+  for (auto& thread : threads)
+    thread.join();
+  telemetry::sharded_metric::flush_all();
+  CHECK_EQ(backend.value(), 4000);
+}
+
+FIXTURE_SCOPE_END()
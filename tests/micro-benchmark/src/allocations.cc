@@ -0,0 +1,125 @@
+#include "main.hh"
+
+#include "broker/defaults.hh"
+#include "broker/detail/alloc_stage.hh"
+#include "broker/internal/wire_format.hh"
+#include "broker/message.hh"
+
+#include "alloc-tracker.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+#include <caf/byte_buffer.hpp>
+
+#include <array>
+#include <string>
+#include <tuple>
+
+using namespace broker;
+
+namespace {
+
+// Runs the stages of the message pipeline for a single message in isolation.
+// This mimics what the core actor does for a message that a local publisher
+// sends to a peer, with the peer being on the same host.
+class allocations : public benchmark::Fixture {
+public:
+  static constexpr size_t num_message_types = 3;
+
+  allocations() {
+    generator g;
+    sender = g.next_endpoint_id();
+    for (size_t index = 0; index < num_message_types; ++index)
+      values[index] = g.next_data(index + 1);
+  }
+
+  // Creates a data message from a copy of the input value.
+  data_message publish(data value) {
+    BROKER_ALLOC_STAGE(publish);
+    return make_data_message(std::string{"/micro/benchmark"}, std::move(value));
+  }
+
+  // Serializes the content of the data message, as done by the core actor.
+  packed_message pack(const data_message& msg) {
+    BROKER_ALLOC_STAGE(pack);
+    buf.clear();
+    caf::binary_serializer sink{nullptr, buf};
+    std::ignore = sink.apply(get_data(msg));
+    return make_packed_message(packed_message_type::data, defaults::ttl,
+                               get_topic(msg), buf);
+  }
+
+  // Wraps the packed message for the central merge point.
+  node_message route(packed_message msg) {
+    BROKER_ALLOC_STAGE(route);
+    return make_node_message(sender, std::move(msg));
+  }
+
+  // Unpacks the payload of a node message into a data message.
+  data_message unpack(const node_message& msg) {
+    BROKER_ALLOC_STAGE(unpack);
+    caf::binary_deserializer source{nullptr, get_payload(msg)};
+    data content;
+    std::ignore = source.apply(content);
+    return make_data_message(get_topic(msg), std::move(content));
+  }
+
+  // Sender of all messages.
+  endpoint_id sender;
+
+  // One input value per message type.
+  std::array<data, num_message_types> values;
+
+  // Reused buffer for packing messages, like the buffer of the core actor.
+  caf::byte_buffer buf;
+};
+
+// Adds per-iteration counters for each pipeline stage to the results.
+void add_counters(benchmark::State& state, const alloc_snapshot& xs) {
+  auto add = [&state](std::string name, const alloc_counters& x) {
+    using benchmark::Counter;
+    state.counters[name + "-allocs"] =
+      Counter(static_cast<double>(x.allocations), Counter::kAvgIterations);
+    state.counters[name + "-bytes"] =
+      Counter(static_cast<double>(x.bytes), Counter::kAvgIterations);
+  };
+  add("total", total(xs));
+  for (size_t index = 0; index < xs.size(); ++index) {
+    auto stage = static_cast<detail::alloc_stage>(index);
+    if (stage == detail::alloc_stage::none)
+      add("other", xs[index]);
+    else if (xs[index].allocations > 0)
+      add(std::string{to_string(stage)}, xs[index]);
+  }
+}
+
+} // namespace
+
+// -- pipeline -----------------------------------------------------------------
+
+// Reports the allocations per message for each stage. Allocations for copying
+// the input value show up as "other".
+BENCHMARK_DEFINE_F(allocations, pipeline)(benchmark::State& state) {
+  if (!alloc_tracking_enabled()) {
+    state.SkipWithError("requires BROKER_ENABLE_ALLOC_TRACKING");
+    return;
+  }
+  const auto& value = values[static_cast<size_t>(state.range(0))];
+  internal::wire_format::v1::trait trait;
+  caf::byte_buffer wire_buf;
+  auto before = alloc_counters_snapshot();
+  for (auto _ : state) {
+    auto msg = route(pack(publish(value)));
+    // Note: the trait marks the wire_encode and wire_decode stages itself.
+    wire_buf.clear();
+    std::ignore = trait.convert(msg, wire_buf);
+    node_message received;
+    std::ignore = trait.convert(wire_buf, received);
+    benchmark::DoNotOptimize(unpack(received));
+  }
+  add_counters(state, alloc_counters_snapshot() - before);
+}
+
+BENCHMARK_REGISTER_F(allocations, pipeline)->DenseRange(0, 2, 1);
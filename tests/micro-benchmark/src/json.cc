@@ -0,0 +1,138 @@
+#include "main.hh"
+
+#include "broker/format/json.hh"
+#include "broker/internal/json_type_mapper.hh"
+#include "broker/internal/type_id.hh"
+#include "broker/message.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <caf/json_reader.hpp>
+#include <caf/json_writer.hpp>
+
+#include <array>
+#include <string>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+// Renders data messages the same way the JSON client did before switching to
+// the dedicated JSON codec.
+struct const_data_message_decorator {
+  const topic& t;
+  const data& d;
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, const_data_message_decorator& x) {
+  static_assert(!Inspector::is_loading);
+  auto do_inspect = [&f, &x](const auto& val) -> bool {
+    internal::json_type_mapper tm;
+    using val_t = std::decay_t<decltype(val)>;
+    auto type = "data-message"s;
+    auto dtype = to_string(tm(caf::type_id_v<val_t>));
+    return f.object(x).fields(f.field("type", type),
+                              f.field("topic", const_cast<topic&>(x.t)),
+                              f.field("@data-type", dtype),
+                              f.field("data", const_cast<val_t&>(val)));
+  };
+  return visit(do_inspect, x.d);
+}
+
+class json : public benchmark::Fixture {
+public:
+  static constexpr size_t num_message_types = 3;
+
+  template <class T>
+  using array_t = std::array<T, num_message_types>;
+
+  json() {
+    reader.mapper(&mapper);
+    writer.mapper(&mapper);
+    writer.skip_object_type_annotation(true);
+    generator g;
+    for (size_t index = 0; index < num_message_types; ++index) {
+      dmsg[index] = make_data_message("/micro/benchmark",
+                                      g.next_data(index + 1));
+      format::json::v1::encode_data_message(get_topic(dmsg[index]),
+                                            get_data(dmsg[index]),
+                                            dmsg_str[index]);
+    }
+  }
+
+  internal::json_type_mapper mapper;
+
+  caf::json_reader reader;
+
+  caf::json_writer writer;
+
+  // One data message per type.
+  array_t<data_message> dmsg;
+
+  // JSON versions of dmsg.
+  array_t<std::string> dmsg_str;
+
+  // A pre-allocated buffer for the benchmarks to render into.
+  std::string sink_buf;
+};
+
+} // namespace
+
+// -- rendering data messages --------------------------------------------------
+
+BENCHMARK_DEFINE_F(json, caf_save_data_message)(benchmark::State& state) {
+  const auto& msg = dmsg[static_cast<size_t>(state.range(0))];
+  for (auto _ : state) {
+    writer.reset();
+    auto& [t, d] = msg.data();
+    const_data_message_decorator decorator{t, d};
+    std::ignore = writer.apply(decorator);
+    auto str = writer.str();
+    sink_buf.assign(str.begin(), str.end());
+    benchmark::DoNotOptimize(sink_buf);
+  }
+}
+
+BENCHMARK_REGISTER_F(json, caf_save_data_message)->DenseRange(0, 2, 1);
+
+BENCHMARK_DEFINE_F(json, broker_save_data_message)(benchmark::State& state) {
+  const auto& msg = dmsg[static_cast<size_t>(state.range(0))];
+  for (auto _ : state) {
+    sink_buf.clear();
+    format::json::v1::encode_data_message(get_topic(msg), get_data(msg),
+                                          sink_buf);
+    benchmark::DoNotOptimize(sink_buf);
+  }
+}
+
+BENCHMARK_REGISTER_F(json, broker_save_data_message)->DenseRange(0, 2, 1);
+
+// -- parsing data messages ----------------------------------------------------
+
+BENCHMARK_DEFINE_F(json, caf_load_data_message)(benchmark::State& state) {
+  const auto& str = dmsg_str[static_cast<size_t>(state.range(0))];
+  for (auto _ : state) {
+    data_message msg;
+    reader.reset();
+    std::ignore = reader.load(str);
+    auto decorator = decorated(msg);
+    std::ignore = reader.apply(decorator);
+    benchmark::DoNotOptimize(msg);
+  }
+}
+
+BENCHMARK_REGISTER_F(json, caf_load_data_message)->DenseRange(0, 2, 1);
+
+BENCHMARK_DEFINE_F(json, broker_load_data_message)(benchmark::State& state) {
+  const auto& str = dmsg_str[static_cast<size_t>(state.range(0))];
+  for (auto _ : state) {
+    topic t;
+    data d;
+    std::ignore = format::json::v1::decode_data_message(str, t, d);
+    benchmark::DoNotOptimize(d);
+  }
+}
+
+BENCHMARK_REGISTER_F(json, broker_load_data_message)->DenseRange(0, 2, 1);
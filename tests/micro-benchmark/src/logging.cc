@@ -0,0 +1,74 @@
+#include "main.hh"
+
+#include "broker/data.hh"
+#include "broker/internal/logger.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+
+using namespace broker;
+
+// Use the same log component as `endpoint::publish`.
+#undef BROKER_LOG_COMPONENT
+#define BROKER_LOG_COMPONENT endpoint
+
+namespace {
+
+// Measures the cost of log statements on the publish path. At default
+// settings, the benchmarks with log statements must perform on par with the
+// baseline.
+class logging : public benchmark::Fixture {
+public:
+  static constexpr size_t num_message_types = 3;
+
+  logging() : t("/micro/benchmark") {
+    generator g;
+    for (size_t index = 0; index < num_message_types; ++index)
+      xs[index] = g.next_data(index + 1);
+  }
+
+  topic t;
+
+  std::array<data, num_message_types> xs;
+};
+
+} // namespace
+
+// Creates the message just like `endpoint::publish` without any logging.
+BENCHMARK_DEFINE_F(logging, publish_baseline)(benchmark::State& state) {
+  const auto& d = xs[static_cast<size_t>(state.range(0))];
+  for (auto _ : state) {
+    auto msg = make_data_message(t, d);
+    benchmark::DoNotOptimize(msg);
+  }
+}
+
+BENCHMARK_REGISTER_F(logging, publish_baseline)->DenseRange(0, 2, 1);
+
+// Same as above, but with the log statement of `endpoint::publish`.
+BENCHMARK_DEFINE_F(logging, publish_with_log)(benchmark::State& state) {
+  const auto& d = xs[static_cast<size_t>(state.range(0))];
+  for (auto _ : state) {
+    BROKER_DEBUG("publishing" << BROKER_ARG(t) << BROKER_ARG(d));
+    auto msg = make_data_message(t, d);
+    benchmark::DoNotOptimize(msg);
+  }
+}
+
+BENCHMARK_REGISTER_F(logging, publish_with_log)->DenseRange(0, 2, 1);
+
+// Same as above, but with a log statement that copies its arguments.
+BENCHMARK_DEFINE_F(logging, publish_with_copying_log)
+(benchmark::State& state) {
+  const auto& d = xs[static_cast<size_t>(state.range(0))];
+  for (auto _ : state) {
+    BROKER_INFO("publishing" << std::make_pair(t, d));
+    auto msg = make_data_message(t, d);
+    benchmark::DoNotOptimize(msg);
+  }
+}
+
+BENCHMARK_REGISTER_F(logging, publish_with_copying_log)->DenseRange(0, 2, 1);
@@ -0,0 +1,443 @@
+#include "broker/backend_options.hh"
+#include "broker/data.hh"
+#include "broker/detail/abstract_backend.hh"
+#include "broker/detail/memory_backend.hh"
+#include "broker/detail/sqlite_backend.hh"
+#include "broker/time.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace broker;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// -- benchmark parameters -----------------------------------------------------
+
+// Largest store for the memory backend. Nested tables use at most 1M entries.
+constexpr int64_t max_memory_entries = 10'000'000;
+
+// Largest store for the SQLite backends.
+constexpr int64_t max_sqlite_entries = 1'000'000;
+
+// Number of distinct keys that each benchmark cycles through.
+constexpr size_t num_probes = 1024;
+
+/// Selects the backend and its configuration.
+enum class backend_kind {
+  /// The in-memory backend.
+  memory,
+  /// SQLite with default settings.
+  sqlite,
+  /// SQLite with `journal_mode=WAL` and `synchronous=NORMAL`.
+  sqlite_wal,
+  /// SQLite with `journal_mode=WAL` and `synchronous=OFF`.
+  sqlite_wal_nosync,
+  /// SQLite with `journal_mode=DELETE` and `synchronous=FULL`.
+  sqlite_full,
+};
+
+/// Selects the type of keys and values in the store.
+enum class entry_shape {
+  /// Maps counts to counts.
+  count,
+  /// Maps short strings to strings with 32 characters.
+  string,
+  /// Maps IPv4 addresses to timestamps, like Zeek's known hosts.
+  address,
+  /// Maps subnets to strings.
+  subnet,
+  /// Maps strings to tables of sets, like Zeek's cluster-wide state.
+  table,
+};
+
+constexpr std::array<backend_kind, 5> all_backends = {
+  backend_kind::memory,     backend_kind::sqlite,
+  backend_kind::sqlite_wal, backend_kind::sqlite_wal_nosync,
+  backend_kind::sqlite_full,
+};
+
+constexpr std::array<entry_shape, 5> all_shapes = {
+  entry_shape::count,  entry_shape::string, entry_shape::address,
+  entry_shape::subnet, entry_shape::table,
+};
+
+// -- generating entries -------------------------------------------------------
+
+data make_key(entry_shape shape, size_t i) {
+  switch (shape) {
+    case entry_shape::count:
+      return count{i};
+    case entry_shape::address: {
+      auto bytes = static_cast<uint32_t>(i);
+      return address{&bytes, address::family::ipv4, address::byte_order::host};
+    }
+    case entry_shape::subnet: {
+      auto bytes = static_cast<uint32_t>(i << 8);
+      return subnet{
+        address{&bytes, address::family::ipv4, address::byte_order::host}, 24};
+    }
+    default:
+      return "key-" + std::to_string(i);
+  }
+}
+
+data make_value(entry_shape shape, size_t i) {
+  switch (shape) {
+    case entry_shape::count:
+      return count{i};
+    case entry_shape::address:
+      return timestamp{timespan{static_cast<int64_t>(i)}};
+    case entry_shape::table: {
+      table result;
+      for (size_t j = 0; j < 10; ++j) {
+        set xs;
+        for (size_t k = 0; k < 3; ++k)
+          xs.emplace("item-" + std::to_string(i + j + k));
+        result.emplace("field-" + std::to_string(j), std::move(xs));
+      }
+      return result;
+    }
+    default: {
+      char buf[40];
+      snprintf(buf, sizeof(buf), "value-%026zu", i);
+      return std::string{buf};
+    }
+  }
+}
+
+// An expiry in the past, i.e., `expire` removes the entry.
+timestamp past_expiry() {
+  return timestamp{timespan{1}};
+}
+
+// -- SQLite database files ----------------------------------------------------
+
+// Filling a database one `put` at a time is slow, so we create each database
+// once with durability turned off and copy the file for each benchmark.
+class sqlite_templates {
+public:
+  ~sqlite_templates() {
+    std::error_code err;
+    for (auto& kvp : files_)
+      fs::remove(kvp.second, err);
+  }
+
+  // Returns the path to a database with `n` entries of the given shape.
+  const fs::path& get(entry_shape shape, size_t n, bool with_expiry) {
+    auto key = std::make_tuple(shape, n, with_expiry);
+    if (auto i = files_.find(key); i != files_.end())
+      return i->second;
+    auto file_name = "broker-store-bench-" + std::to_string(files_.size())
+                     + ".db";
+    auto path = fs::temp_directory_path() / file_name;
+    std::error_code err;
+    fs::remove(path, err);
+    {
+      detail::sqlite_backend db{backend_options{{"path", path.string()}}};
+      db.exec_pragma("journal_mode", "MEMORY");
+      db.exec_pragma("synchronous", "OFF");
+      std::optional<timestamp> expiry;
+      if (with_expiry)
+        expiry = past_expiry();
+      for (size_t i = 0; i < n; ++i)
+        std::ignore = db.put(make_key(shape, i), make_value(shape, i), expiry);
+    }
+    return files_.emplace(key, std::move(path)).first->second;
+  }
+
+private:
+  std::map<std::tuple<entry_shape, size_t, bool>, fs::path> files_;
+};
+
+sqlite_templates& templates() {
+  static sqlite_templates instance;
+  return instance;
+}
+
+backend_options sqlite_options(backend_kind kind, const fs::path& path) {
+  backend_options result{{"path", path.string()}};
+  auto set_pragmas = [&result](const char* journal_mode,
+                               const char* synchronous) {
+    result.emplace("journal_mode", enum_value{journal_mode});
+    result.emplace("synchronous", enum_value{synchronous});
+  };
+  switch (kind) {
+    case backend_kind::sqlite_wal:
+      set_pragmas("Broker::SQLITE_JOURNAL_MODE_WAL",
+                  "Broker::SQLITE_SYNCHRONOUS_NORMAL");
+      break;
+    case backend_kind::sqlite_wal_nosync:
+      set_pragmas("Broker::SQLITE_JOURNAL_MODE_WAL",
+                  "Broker::SQLITE_SYNCHRONOUS_OFF");
+      break;
+    case backend_kind::sqlite_full:
+      set_pragmas("Broker::SQLITE_JOURNAL_MODE_DELETE",
+                  "Broker::SQLITE_SYNCHRONOUS_FULL");
+      break;
+    default:
+      break;
+  }
+  return result;
+}
+
+void remove_database(const fs::path& path) {
+  std::error_code err;
+  for (auto suffix : {"", "-journal", "-wal", "-shm"})
+    fs::remove(path.string() + suffix, err);
+}
+
+// -- fixture ------------------------------------------------------------------
+
+class store_backend : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State& state) override {
+    entries = static_cast<size_t>(state.range(0));
+    kind = static_cast<backend_kind>(state.range(1));
+    shape = static_cast<entry_shape>(state.range(2));
+    db_path = fs::temp_directory_path() / "broker-store-bench.db";
+    hits.clear();
+    misses.clear();
+    values.clear();
+    for (size_t i = 0; i < num_probes; ++i) {
+      auto index = i * (entries / num_probes);
+      hits.emplace_back(make_key(shape, index));
+      misses.emplace_back(make_key(shape, entries + i));
+      values.emplace_back(make_value(shape, index + 1));
+    }
+  }
+
+  void TearDown(const benchmark::State&) override {
+    backend.reset();
+    remove_database(db_path);
+  }
+
+  // (Re-)creates the backend with `entries` entries. Returns `false` and
+  // marks the benchmark as failed on error.
+  bool populate(benchmark::State& state, bool with_expiry = false) {
+    backend.reset();
+    if (kind == backend_kind::memory) {
+      backend = std::make_unique<detail::memory_backend>();
+      std::optional<timestamp> expiry;
+      if (with_expiry)
+        expiry = past_expiry();
+      for (size_t i = 0; i < entries; ++i)
+        std::ignore = backend->put(make_key(shape, i), make_value(shape, i),
+                                   expiry);
+      return true;
+    }
+    remove_database(db_path);
+    std::error_code err;
+    fs::copy_file(templates().get(shape, entries, with_expiry), db_path, err);
+    if (err) {
+      state.SkipWithError("failed to copy the SQLite database");
+      return false;
+    }
+    auto db = std::make_unique<detail::sqlite_backend>(
+      sqlite_options(kind, db_path));
+    if (db->init_failed()) {
+      state.SkipWithError("failed to open the SQLite database");
+      return false;
+    }
+    backend = std::move(db);
+    return true;
+  }
+
+  size_t entries = 0;
+
+  backend_kind kind = backend_kind::memory;
+
+  entry_shape shape = entry_shape::count;
+
+  fs::path db_path;
+
+  std::unique_ptr<detail::abstract_backend> backend;
+
+  // Existing keys, spread evenly over the store.
+  std::vector<data> hits;
+
+  // Keys that do not exist in the store.
+  std::vector<data> misses;
+
+  // New values for the keys in `hits`.
+  std::vector<data> values;
+};
+
+// Registers all combinations of store sizes, backends, and entry shapes.
+void all_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"entries", "backend", "shape"});
+  for (auto kind : all_backends) {
+    for (auto shape : all_shapes) {
+      auto max_entries = kind != backend_kind::memory ? max_sqlite_entries
+                         : shape == entry_shape::table
+                           ? std::min(max_memory_entries, int64_t{1'000'000})
+                           : max_memory_entries;
+      for (int64_t n = 10'000; n <= max_entries; n *= 10)
+        b->Args({n, static_cast<int64_t>(kind), static_cast<int64_t>(shape)});
+    }
+  }
+}
+
+// Registers all store sizes and backends with count entries only.
+void count_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"entries", "backend", "shape"});
+  for (auto kind : all_backends) {
+    auto max_entries = kind == backend_kind::memory ? max_memory_entries
+                                                    : max_sqlite_entries;
+    for (int64_t n = 10'000; n <= max_entries; n *= 10)
+      b->Args({n, static_cast<int64_t>(kind),
+               static_cast<int64_t>(entry_shape::count)});
+  }
+}
+
+} // namespace
+
+// -- modifiers ----------------------------------------------------------------
+
+// Overrides existing entries.
+BENCHMARK_DEFINE_F(store_backend, put)(benchmark::State& state) {
+  if (!populate(state))
+    return;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto res = backend->put(hits[i], values[i], std::nullopt);
+    benchmark::DoNotOptimize(res);
+    i = (i + 1) % num_probes;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(store_backend, put)->Apply(all_args);
+
+// Increments and decrements an existing counter.
+BENCHMARK_DEFINE_F(store_backend, add_subtract)(benchmark::State& state) {
+  if (!populate(state))
+    return;
+  data one{count{1}};
+  size_t i = 0;
+  for (auto _ : state) {
+    auto res1 = backend->add(hits[i], one, data::type::count, std::nullopt);
+    auto res2 = backend->subtract(hits[i], one, std::nullopt);
+    benchmark::DoNotOptimize(res1);
+    benchmark::DoNotOptimize(res2);
+    i = (i + 1) % num_probes;
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+BENCHMARK_REGISTER_F(store_backend, add_subtract)->Apply(count_args);
+
+// Removes an entry and puts it back to keep the size of the store constant.
+BENCHMARK_DEFINE_F(store_backend, erase_put)(benchmark::State& state) {
+  if (!populate(state))
+    return;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto res1 = backend->erase(hits[i]);
+    auto res2 = backend->put(hits[i], values[i], std::nullopt);
+    benchmark::DoNotOptimize(res1);
+    benchmark::DoNotOptimize(res2);
+    i = (i + 1) % num_probes;
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+BENCHMARK_REGISTER_F(store_backend, erase_put)->Apply(all_args);
+
+// Expires all entries of the store, like the periodic sweep of the master.
+BENCHMARK_DEFINE_F(store_backend, expire_sweep)(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    if (!populate(state, true))
+      return;
+    auto now = broker::now();
+    state.ResumeTiming();
+    auto xs = backend->expiries();
+    if (!xs) {
+      state.SkipWithError("failed to read the expiries");
+      return;
+    }
+    for (auto& [key, expiry] : *xs)
+      if (expiry <= now)
+        std::ignore = backend->expire(key, now);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(store_backend, expire_sweep)
+  ->Apply(all_args)
+  ->Unit(benchmark::kMillisecond);
+
+// -- inspectors ---------------------------------------------------------------
+
+// Reads existing entries.
+BENCHMARK_DEFINE_F(store_backend, get)(benchmark::State& state) {
+  if (!populate(state))
+    return;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto res = backend->get(hits[i]);
+    benchmark::DoNotOptimize(res);
+    i = (i + 1) % num_probes;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(store_backend, get)->Apply(all_args);
+
+// Checks for an existing and a missing key.
+BENCHMARK_DEFINE_F(store_backend, exists)(benchmark::State& state) {
+  if (!populate(state))
+    return;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto res1 = backend->exists(hits[i]);
+    auto res2 = backend->exists(misses[i]);
+    benchmark::DoNotOptimize(res1);
+    benchmark::DoNotOptimize(res2);
+    i = (i + 1) % num_probes;
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+BENCHMARK_REGISTER_F(store_backend, exists)->Apply(all_args);
+
+// Copies all keys, e.g., for `store::keys`.
+BENCHMARK_DEFINE_F(store_backend, keys)(benchmark::State& state) {
+  if (!populate(state))
+    return;
+  for (auto _ : state) {
+    auto res = backend->keys();
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(store_backend, keys)
+  ->Apply(all_args)
+  ->Unit(benchmark::kMillisecond);
+
+// Copies the entire store, e.g., for synchronizing a new clone.
+BENCHMARK_DEFINE_F(store_backend, snapshot)(benchmark::State& state) {
+  if (!populate(state))
+    return;
+  for (auto _ : state) {
+    auto res = backend->snapshot();
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(store_backend, snapshot)
+  ->Apply(all_args)
+  ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,249 @@
+#include "broker/detail/prefix_matcher.hh"
+#include "broker/detail/radix_tree.hh"
+#include "broker/filter_type.hh"
+#include "broker/topic.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace broker;
+
+namespace {
+
+// Number of topics for matching against a filter. Half of them match.
+constexpr size_t num_probes = 1024;
+
+// Generates the i-th subscription of a Zeek cluster. The topics mimic the
+// naming scheme of Zeek: per-node topics, node IDs, logs, events and stores.
+// The trailing slash guarantees that no topic is a prefix of another.
+std::string zeek_topic(size_t i) {
+  char buf[96];
+  switch (i % 5) {
+    case 0:
+      snprintf(buf, sizeof(buf), "zeek/cluster/node/worker-%zu/", i);
+      break;
+    case 1:
+      snprintf(buf, sizeof(buf), "zeek/cluster/nodeid/%016zx/",
+               i * 0x9e3779b97f4a7c15ull);
+      break;
+    case 2:
+      snprintf(buf, sizeof(buf), "zeek/logs/stream-%zu/", i);
+      break;
+    case 3:
+      snprintf(buf, sizeof(buf), "zeek/event/module-%zu/", i);
+      break;
+    default:
+      snprintf(buf, sizeof(buf), "zeek/known/store-%zu/data/clone/", i);
+  }
+  return buf;
+}
+
+// Returns a sorted filter with `n` non-overlapping subscriptions, i.e., the
+// same result as calling `filter_extend` `n` times but much faster.
+filter_type zeek_filter(size_t n) {
+  filter_type result;
+  result.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    result.emplace_back(zeek_topic(i));
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// Returns topics of published messages for a filter with `n` subscriptions.
+std::vector<topic> zeek_probes(size_t n) {
+  std::minstd_rand rng{42};
+  std::uniform_int_distribution<size_t> pick{0, n - 1};
+  std::vector<topic> result;
+  result.reserve(num_probes);
+  for (size_t i = 0; i < num_probes; ++i) {
+    if (i % 2 == 0)
+      result.emplace_back(zeek_topic(pick(rng)) + "event");
+    else
+      result.emplace_back("zeek/misc/" + std::to_string(i));
+  }
+  return result;
+}
+
+class topic_matching : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State& state) override {
+    auto n = static_cast<size_t>(state.range(0));
+    filter = zeek_filter(n);
+    probes = zeek_probes(n);
+    tree = detail::radix_tree<size_t>{};
+    for (size_t i = 0; i < filter.size(); ++i)
+      tree.insert({filter[i].string(), i});
+  }
+
+  void TearDown(const benchmark::State&) override {
+    filter.clear();
+    probes.clear();
+    tree = detail::radix_tree<size_t>{};
+  }
+
+  filter_type filter;
+
+  std::vector<topic> probes;
+
+  detail::radix_tree<size_t> tree;
+};
+
+} // namespace
+
+// -- matching -----------------------------------------------------------------
+
+// Baseline: a single prefix check.
+static void topic_prefix_of(benchmark::State& state) {
+  topic prefix{"zeek/cluster/node/worker-1/"};
+  topic match{"zeek/cluster/node/worker-1/event"};
+  topic mismatch{"zeek/cluster/node/worker-2/event"};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(prefix.prefix_of(match));
+    benchmark::DoNotOptimize(prefix.prefix_of(mismatch));
+  }
+}
+
+BENCHMARK(topic_prefix_of);
+
+// What the core does for each message and subscriber: a linear scan.
+BENCHMARK_DEFINE_F(topic_matching, prefix_matcher)(benchmark::State& state) {
+  detail::prefix_matcher f;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(f(filter, probes[i]));
+    i = (i + 1) % num_probes;
+  }
+}
+
+BENCHMARK_REGISTER_F(topic_matching, prefix_matcher)
+  ->RangeMultiplier(10)
+  ->Range(10, 100'000);
+
+// Lookup in a radix tree as a potential index for the filter.
+BENCHMARK_DEFINE_F(topic_matching, radix_tree)(benchmark::State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    auto matches = tree.prefix_of(probes[i].string());
+    benchmark::DoNotOptimize(matches);
+    i = (i + 1) % num_probes;
+  }
+}
+
+BENCHMARK_REGISTER_F(topic_matching, radix_tree)
+  ->RangeMultiplier(10)
+  ->Range(10, 100'000);
+
+// -- filter maintenance -------------------------------------------------------
+
+// Builds a filter from scratch via `filter_extend`, e.g., when a peer connects.
+static void filter_build(benchmark::State& state) {
+  auto n = static_cast<size_t>(state.range(0));
+  std::vector<topic> topics;
+  for (size_t i = 0; i < n; ++i)
+    topics.emplace_back(zeek_topic(i));
+  for (auto _ : state) {
+    filter_type f;
+    for (auto& x : topics)
+      filter_extend(f, x);
+    benchmark::DoNotOptimize(f);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(filter_build)->RangeMultiplier(10)->Range(10, 10'000);
+
+// Adds and removes a subscription on an existing filter, e.g., when a
+// subscriber comes and goes.
+static void filter_churn(benchmark::State& state) {
+  auto f = zeek_filter(static_cast<size_t>(state.range(0)));
+  topic extra{"zeek/cluster/node/manager/"};
+  for (auto _ : state) {
+    filter_extend(f, extra);
+    f.erase(std::find(f.begin(), f.end(), extra));
+    benchmark::DoNotOptimize(f);
+  }
+}
+
+BENCHMARK(filter_churn)->RangeMultiplier(10)->Range(10, 100'000);
+
+// Adds a subscription that replaces more specific ones, e.g., subscribing to
+// all logs.
+static void filter_truncate(benchmark::State& state) {
+  auto base = zeek_filter(static_cast<size_t>(state.range(0)));
+  topic logs{"zeek/logs/"};
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto f = base;
+    state.ResumeTiming();
+    filter_extend(f, logs);
+    benchmark::DoNotOptimize(f);
+  }
+}
+
+BENCHMARK(filter_truncate)->RangeMultiplier(10)->Range(10, 100'000);
+
+// -- shared filter contention -------------------------------------------------
+
+namespace {
+
+shared_filter_type& shared_zeek_filter() {
+  static shared_filter_type instance{zeek_filter(1000)};
+  return instance;
+}
+
+const std::vector<topic>& shared_zeek_probes() {
+  static auto instance = zeek_probes(1000);
+  return instance;
+}
+
+} // namespace
+
+// Concurrent readers matching topics against the shared filter.
+static void shared_filter_read(benchmark::State& state) {
+  auto& shared = shared_zeek_filter();
+  auto& probes = shared_zeek_probes();
+  detail::prefix_matcher f;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto res = shared.read([&](auto&, const filter_type& xs) {
+      return f(xs, probes[i]);
+    });
+    benchmark::DoNotOptimize(res);
+    i = (i + 1) % num_probes;
+  }
+}
+
+BENCHMARK(shared_filter_read)->ThreadRange(1, 8)->UseRealTime();
+
+// Same as above, but one out of 64 operations per thread updates the filter.
+static void shared_filter_read_update(benchmark::State& state) {
+  auto& shared = shared_zeek_filter();
+  auto& probes = shared_zeek_probes();
+  topic extra{"zeek/cluster/node/manager/"};
+  detail::prefix_matcher f;
+  size_t i = 0;
+  for (auto _ : state) {
+    if (i % 64 == 63) {
+      shared.update([&](auto& version, filter_type& xs) {
+        ++version;
+        if (auto j = std::find(xs.begin(), xs.end(), extra); j != xs.end())
+          xs.erase(j);
+        else
+          filter_extend(xs, extra);
+      });
+    } else {
+      auto res = shared.read([&](auto&, const filter_type& xs) {
+        return f(xs, probes[i]);
+      });
+      benchmark::DoNotOptimize(res);
+    }
+    i = (i + 1) % num_probes;
+  }
+}
+
+BENCHMARK(shared_filter_read_update)->ThreadRange(1, 8)->UseRealTime();